@@ -10,6 +10,7 @@
 #include <random.h>
 #include <uint256.h>
 #include <util/time.h>
+#include <crypto/neoscrypt.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
 #include <crypto/sha256.h>
@@ -61,6 +62,36 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+static void NeoScrypt(benchmark::State& state)
+{
+    uint8_t hash[32];
+    std::vector<uint8_t> in(80, 0);
+    while (state.KeepRunning()) {
+        neoscrypt(in.data(), hash, 0x0);
+        in[76] += 1;
+    }
+}
+
+static void NeoScrypt_8(benchmark::State& state)
+{
+    std::vector<uint8_t> hashes(32 * 8);
+    std::vector<uint8_t> in(80 * 8, 0);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 8; ++i) {
+            neoscrypt(in.data() + 80 * i, hashes.data() + 32 * i, 0x0);
+        }
+    }
+}
+
+static void NeoScrypt_8_multi(benchmark::State& state)
+{
+    std::vector<uint8_t> hashes(32 * 8);
+    std::vector<uint8_t> in(80 * 8, 0);
+    while (state.KeepRunning()) {
+        neoscrypt_multi(in.data(), hashes.data(), 0x0, 8);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -102,5 +133,8 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(NeoScrypt, 2000);
+BENCHMARK(NeoScrypt_8, 250);
+BENCHMARK(NeoScrypt_8_multi, 250);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
@@ -0,0 +1,91 @@
+#include <bench/bench.h>
+
+#include <omnicore/dbbase.h>
+#include <omnicore/dbspinfo.h>
+#include <omnicore/dbtransaction.h>
+#include <omnicore/dbtxlist.h>
+#include <omnicore/omnicore.h>
+
+#include <chainparams.h>
+#include <fs.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+using namespace mastercore;
+
+//! Number of transactions per benchmarked block
+static const int NUM_BLOCK_TRANSACTIONS = 20;
+
+/** Databases, which are written to, when a block with grants is processed. */
+struct BenchBlockDBs
+{
+    CMPTxList txlist;
+    COmniTransactionDB txdb;
+    CMPSPInfo spinfo;
+    uint32_t propertyId;
+
+    BenchBlockDBs()
+      : txlist(GetDataDir() / "MP_txlist_batch_bench", true),
+        txdb(GetDataDir() / "MP_txdb_batch_bench", true),
+        spinfo(GetDataDir() / "MP_spinfo_batch_bench", true)
+    {
+        CMPSPInfo::Entry info;
+        info.issuer = "issuer";
+        info.prop_type = MSC_PROPERTY_TYPE_DIVISIBLE;
+        info.name = "Managed token";
+        info.manual = true;
+        propertyId = spinfo.putSP(OMNI_PROPERTY_MSC, info);
+    }
+
+    ~BenchBlockDBs()
+    {
+        fs::remove_all(GetDataDir() / "MP_txlist_batch_bench");
+        fs::remove_all(GetDataDir() / "MP_txdb_batch_bench");
+        fs::remove_all(GetDataDir() / "MP_spinfo_batch_bench");
+    }
+
+    /** Records the transactions of a block, each granting tokens. */
+    void ProcessBlock(int nBlock)
+    {
+        const uint256 blockHash = uint256S(strprintf("%x", nBlock));
+        for (int n = 0; n < NUM_BLOCK_TRANSACTIONS; ++n) {
+            const uint256 txid = uint256S(strprintf("%x%08x", nBlock, n));
+            txlist.recordTX(txid, true, nBlock, MSC_TYPE_GRANT_PROPERTY_TOKENS, 1000);
+            txdb.RecordTransaction(txid, n + 1, 0);
+            CMPSPInfo::History records;
+            records[txid] = {1000, 0};
+            assert(spinfo.putHistory(propertyId, records, blockHash));
+        }
+    }
+};
+
+static void OmniBlockWritesDirect(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    BenchBlockDBs dbs;
+
+    int nBlock = 0;
+    while (state.KeepRunning()) {
+        dbs.ProcessBlock(++nBlock);
+    }
+}
+
+static void OmniBlockWritesBatched(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    BenchBlockDBs dbs;
+
+    int nBlock = 0;
+    while (state.KeepRunning()) {
+        CDBBase::BeginBlockBatch();
+        dbs.ProcessBlock(++nBlock);
+        assert(CDBBase::CommitBlockBatch());
+    }
+}
+
+BENCHMARK(OmniBlockWritesDirect, 20);
+BENCHMARK(OmniBlockWritesBatched, 20);
@@ -0,0 +1,199 @@
+#include <bench/bench.h>
+
+#include <omnicore/createpayload.h>
+#include <omnicore/encoding.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/parsing.h>
+#include <omnicore/script.h>
+#include <omnicore/tx.h>
+
+#include <chainparams.h>
+#include <coins.h>
+#include <key.h>
+#include <key_io.h>
+#include <primitives/transaction.h>
+#include <pubkey.h>
+#include <script/script.h>
+#include <script/standard.h>
+#include <span.h>
+#include <sync.h>
+#include <util/strencodings.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace mastercore;
+
+//! Number of transactions of each kind in the corpus
+static const int NUM_TRANSACTIONS = 50;
+
+/** Creates a transaction, which spends a coin of the sender, and adds the coin to the coins view. */
+static CTransactionRef CreateTransaction(const std::string& sender, int64_t nValueIn, const std::vector<std::pair<CScript, int64_t> >& vecOutputs, int n)
+{
+    CMutableTransaction inputTx;
+    inputTx.nLockTime = n;
+    inputTx.vout.push_back(CTxOut(nValueIn, GetScriptForDestination(DecodeDestination(sender))));
+    CTransaction input(inputTx);
+
+    Coin coin(input.vout[0], 1, false);
+    {
+        LOCK(cs_tx_cache);
+        view.AddCoin(COutPoint(input.GetHash(), 0), std::move(coin), true);
+    }
+
+    CMutableTransaction mutableTx;
+    mutableTx.vin.push_back(CTxIn(input.GetHash(), 0));
+    for (const auto& output : vecOutputs) {
+        mutableTx.vout.push_back(CTxOut(output.second, output.first));
+    }
+
+    return MakeTransactionRef(mutableTx);
+}
+
+/** Returns the output script of an address. */
+static CScript ScriptFor(const std::string& address)
+{
+    return GetScriptForDestination(DecodeDestination(address));
+}
+
+/**
+ * Corpus of transactions in the shape of Omni transactions on mainnet: Class A
+ * simple sends, Class B and Class C transactions with a reference, as well as
+ * ordinary payments, which make up most of the blocks.
+ */
+struct BenchCorpus
+{
+    std::vector<CTransactionRef> vTransactions;
+    int nOmniTransactions;
+
+    BenchCorpus() : nOmniTransactions(0)
+    {
+        SelectParams(CBaseChainParams::MAIN);
+
+        const std::string sender = "6vBuAESPceiDMvbqRzvN2Jbho4JwXcUTST";
+        const std::string receiver = "6qMhVN4gUP4B3fp4hyDN2MNW97TfHMX42W";
+        CKey key;
+        key.MakeNewKey(true);
+        const CPubKey redeemingPubKey = key.GetPubKey();
+
+        for (int n = 0; n < NUM_TRANSACTIONS; ++n) {
+            // Class A: data and reference address, with sequence numbers
+            std::vector<std::pair<CScript, int64_t> > vecOutputs;
+            vecOutputs.push_back(std::make_pair(ScriptFor("6eXoDUSUV7yrAxKVNPEeKAHMY8San5Z37V"), 6000));
+            vecOutputs.push_back(std::make_pair(ScriptFor("6qDfvh53TmFJopWAz3Mw1FeXjdu4NhqwzB"), 6000));
+            vecOutputs.push_back(std::make_pair(ScriptFor(receiver), 6000));
+            vecOutputs.push_back(std::make_pair(ScriptFor(sender), 1747000));
+            vTransactions.push_back(CreateTransaction(sender, 1815000, vecOutputs, n));
+
+            // Class B: obfuscated multisig packets
+            vecOutputs.clear();
+            vecOutputs.push_back(std::make_pair(ScriptFor(receiver), 6000));
+            OmniCore_Encode_ClassB(sender, redeemingPubKey, CreatePayload_SendToOwners(3, 100000, 1), vecOutputs);
+            vTransactions.push_back(CreateTransaction(sender, 1815000, vecOutputs, n));
+
+            // Class C: marker and payload in an OP_RETURN output
+            vecOutputs.clear();
+            OmniCore_Encode_ClassC(CreatePayload_SimpleSend(31, 100000000 + n), vecOutputs);
+            vecOutputs.push_back(std::make_pair(ScriptFor(receiver), 6000));
+            vTransactions.push_back(CreateTransaction(sender, 1815000, vecOutputs, n));
+
+            nOmniTransactions += 3;
+
+            // ordinary payments
+            for (int k = 0; k < 7; ++k) {
+                vecOutputs.clear();
+                vecOutputs.push_back(std::make_pair(ScriptFor(receiver), 100000 + k));
+                vecOutputs.push_back(std::make_pair(ScriptFor(sender), 1700000));
+                vTransactions.push_back(CreateTransaction(sender, 1815000, vecOutputs, n));
+            }
+        }
+    }
+
+    ~BenchCorpus()
+    {
+        LOCK(cs_tx_cache);
+        view.Flush();
+    }
+};
+
+static void OmniParseTransactions(benchmark::State& state)
+{
+    BenchCorpus corpus;
+    const int nBlock = std::numeric_limits<int>::max();
+
+    while (state.KeepRunning()) {
+        int nParsed = 0;
+        for (unsigned int n = 0; n < corpus.vTransactions.size(); ++n) {
+            CMPTransaction mp_obj;
+            if (ParseTransaction(*corpus.vTransactions[n], nBlock, n, mp_obj) == 0) ++nParsed;
+        }
+        assert(nParsed == corpus.nOmniTransactions);
+    }
+}
+
+static void OmniScriptPushesHex(benchmark::State& state)
+{
+    BenchCorpus corpus;
+
+    while (state.KeepRunning()) {
+        size_t nPushes = 0;
+        for (const CTransactionRef& tx : corpus.vTransactions) {
+            for (const CTxOut& output : tx->vout) {
+                std::vector<std::string> vstrPushes;
+                GetScriptPushes(output.scriptPubKey, vstrPushes);
+                nPushes += vstrPushes.size();
+            }
+        }
+        assert(nPushes > 0);
+    }
+}
+
+static void OmniScriptPushes(benchmark::State& state)
+{
+    BenchCorpus corpus;
+
+    while (state.KeepRunning()) {
+        size_t nPushes = 0;
+        for (const CTransactionRef& tx : corpus.vTransactions) {
+            for (const CTxOut& output : tx->vout) {
+                std::vector<Span<const unsigned char> > vPushes;
+                GetScriptPushes(output.scriptPubKey, vPushes);
+                nPushes += vPushes.size();
+            }
+        }
+        assert(nPushes > 0);
+    }
+}
+
+static void OmniObfuscatedHashesHex(benchmark::State& state)
+{
+    const std::string strSeed = "6vBuAESPceiDMvbqRzvN2Jbho4JwXcUTST";
+
+    while (state.KeepRunning()) {
+        std::string vstrHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
+        PrepareObfuscatedHashes(strSeed, MAX_SHA256_OBFUSCATION_TIMES, vstrHashes);
+        std::vector<unsigned char> vchHash = ParseHex(vstrHashes[MAX_SHA256_OBFUSCATION_TIMES]);
+        assert(vchHash.size() == OBFUSCATION_HASH_SIZE);
+    }
+}
+
+static void OmniObfuscatedHashes(benchmark::State& state)
+{
+    const std::string strSeed = "6vBuAESPceiDMvbqRzvN2Jbho4JwXcUTST";
+
+    while (state.KeepRunning()) {
+        unsigned char vchHashes[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE];
+        PrepareObfuscatedHashes(strSeed, MAX_SHA256_OBFUSCATION_TIMES, vchHashes);
+    }
+}
+
+BENCHMARK(OmniParseTransactions, 20);
+BENCHMARK(OmniScriptPushesHex, 200);
+BENCHMARK(OmniScriptPushes, 200);
+BENCHMARK(OmniObfuscatedHashesHex, 200);
+BENCHMARK(OmniObfuscatedHashes, 200);
@@ -0,0 +1,122 @@
+#include <bench/bench.h>
+
+#include <omnicore/dbspinfo.h>
+#include <omnicore/log.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/persistence.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <chainparams.h>
+#include <fs.h>
+#include <hash.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <fstream>
+#include <string>
+
+//! Number of funded addresses of the benchmarked state
+static const int NUM_ADDRESSES = 100 * 1000;
+//! Number of properties, which are spread over the addresses
+static const uint32_t NUM_PROPERTIES = 3;
+
+/** Fills the tally map, and provides a temporary SP database for the globals. */
+class PersistenceBenchSetup
+{
+public:
+    uint256 blockHash;
+    fs::path pathSnapshot;
+    fs::path pathBalances;
+
+    PersistenceBenchSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        blockHash = uint256S("01");
+        pathSnapshot = GetDataDir() / "snapshot-bench.dat";
+        pathBalances = GetDataDir() / "balances-bench.dat";
+        mastercore::pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_bench", true);
+        msc_debug_tally = false;
+
+        LOCK(cs_tally);
+        mastercore::mp_tally_map.clear();
+        for (int n = 0; n < NUM_ADDRESSES; ++n) {
+            CMPTally tally;
+            tally.updateMoney(1 + n % NUM_PROPERTIES, n + 1, BALANCE);
+            tally.updateMoney(1 + (n + 1) % NUM_PROPERTIES, n + 2, SELLOFFER_RESERVE);
+            mastercore::mp_tally_map.insert(std::make_pair(strprintf("1Omni%029d", n), tally));
+        }
+    }
+
+    ~PersistenceBenchSetup()
+    {
+        LOCK(cs_tally);
+        mastercore::mp_tally_map.clear();
+        delete mastercore::pDbSpInfo;
+        mastercore::pDbSpInfo = nullptr;
+        msc_debug_tally = true;
+    }
+
+    /** Writes the balances in the text format, which was used before snapshots. */
+    void WriteLegacyBalances()
+    {
+        std::ofstream file(pathBalances.string().c_str());
+        CHash256 hasher;
+        for (CMPTallyMap::iterator it = mastercore::mp_tally_map.begin(); it != mastercore::mp_tally_map.end(); ++it) {
+            std::string lineOut = it->first;
+            lineOut.append("=");
+            CMPTally& tally = it->second;
+            tally.init();
+            uint32_t propertyId = 0;
+            while (0 != (propertyId = tally.next())) {
+                lineOut.append(strprintf("%d:%d,%d,%d;", propertyId, tally.getMoney(propertyId, BALANCE),
+                        tally.getMoney(propertyId, SELLOFFER_RESERVE), tally.getMoney(propertyId, ACCEPT_RESERVE)));
+            }
+            hasher.Write((unsigned char*)lineOut.c_str(), lineOut.length());
+            file << lineOut << std::endl;
+        }
+        uint256 hash;
+        hasher.Finalize(hash.begin());
+        file << "!" << hash.ToString() << std::endl;
+    }
+};
+
+static void OmniSnapshotSave(benchmark::State& state)
+{
+    PersistenceBenchSetup setup;
+
+    LOCK(cs_tally);
+    while (state.KeepRunning()) {
+        WriteStateSnapshot(setup.pathSnapshot, setup.blockHash);
+    }
+}
+
+static void OmniSnapshotLoad(benchmark::State& state)
+{
+    PersistenceBenchSetup setup;
+
+    LOCK(cs_tally);
+    WriteStateSnapshot(setup.pathSnapshot, setup.blockHash);
+    while (state.KeepRunning()) {
+        assert(RestoreStateSnapshot(setup.pathSnapshot, setup.blockHash, true) == 0);
+    }
+    assert(mastercore::mp_tally_map.size() == (size_t) NUM_ADDRESSES);
+}
+
+static void OmniLegacyBalancesLoad(benchmark::State& state)
+{
+    PersistenceBenchSetup setup;
+
+    LOCK(cs_tally);
+    setup.WriteLegacyBalances();
+    while (state.KeepRunning()) {
+        assert(RestoreInMemoryState(setup.pathBalances.string(), FILETYPE_BALANCES, true) == 0);
+    }
+    assert(mastercore::mp_tally_map.size() == (size_t) NUM_ADDRESSES);
+}
+
+BENCHMARK(OmniSnapshotSave, 10);
+BENCHMARK(OmniSnapshotLoad, 10);
+BENCHMARK(OmniLegacyBalancesLoad, 2);
@@ -0,0 +1,140 @@
+#include <bench/bench.h>
+
+#include <omnicore/dbstolist.h>
+#include <omnicore/dbtxlist.h>
+
+#include <chainparams.h>
+#include <fs.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/system.h>
+
+#include <leveldb/db.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+//! Number of transactions of the benchmarked transaction list
+static const int NUM_TRANSACTIONS = 20 * 1000;
+//! Number of receipts of the benchmarked STO recipient
+static const int NUM_RECEIPTS = 1000;
+
+/** Transaction list, which stores the records either as colon-separated strings, or in the binary format. */
+class CBenchTxList : public CMPTxList
+{
+public:
+    std::vector<uint256> txids;
+
+    CBenchTxList(const fs::path& path, bool fLegacy) : CMPTxList(path, true)
+    {
+        for (int n = 0; n < NUM_TRANSACTIONS; ++n) {
+            const uint256 txid = uint256S(strprintf("%x", n + 1));
+            const int block = 2000000 + n / 10;
+            const uint64_t nValue = 100000000ULL * (n + 1);
+            if (fLegacy) {
+                pdb->Put(writeoptions, txid.ToString(), strprintf("%u:%d:%u:%lu", n % 2, block, n % 60, nValue));
+            } else {
+                pdb->Put(writeoptions, txid.ToString(), EncodeRecord(TxRecord(n % 2, block, n % 60, nValue)));
+            }
+            txids.push_back(txid);
+        }
+    }
+
+    /** Reads a master record, and parses it the way it was done before the binary format. */
+    bool getLegacyValidMPTX(const uint256& txid, int* block, unsigned int* type, uint64_t* nAmended)
+    {
+        std::string result;
+        if (!pdb->Get(readoptions, txid.ToString(), &result).ok()) return false;
+
+        std::vector<std::string> vstr;
+        boost::split(vstr, result, boost::is_any_of(":"), boost::token_compress_on);
+        if (4 != vstr.size()) return false;
+
+        *block = atoi(vstr[1].c_str());
+        *type = atoi(vstr[2].c_str());
+        *nAmended = boost::lexical_cast<uint64_t>(vstr[3]);
+        return atoi(vstr[0].c_str()) == 1;
+    }
+};
+
+static void OmniTxRecordReadLegacy(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    CBenchTxList txlist(GetDataDir() / "MP_txlist_bench_legacy", true);
+
+    int block = 0;
+    unsigned int type = 0;
+    uint64_t nValue = 0;
+    while (state.KeepRunning()) {
+        for (std::vector<uint256>::const_iterator it = txlist.txids.begin(); it != txlist.txids.end(); ++it) {
+            txlist.getLegacyValidMPTX(*it, &block, &type, &nValue);
+        }
+    }
+    assert(block == 2000000 + (NUM_TRANSACTIONS - 1) / 10);
+}
+
+static void OmniTxRecordRead(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    CBenchTxList txlist(GetDataDir() / "MP_txlist_bench", false);
+
+    int block = 0;
+    unsigned int type = 0;
+    uint64_t nValue = 0;
+    while (state.KeepRunning()) {
+        for (std::vector<uint256>::const_iterator it = txlist.txids.begin(); it != txlist.txids.end(); ++it) {
+            txlist.getValidMPTX(*it, &block, &type, &nValue);
+        }
+    }
+    assert(block == 2000000 + (NUM_TRANSACTIONS - 1) / 10);
+}
+
+/** STO list, which can also append receipts to one string per address, as it was done before one record per receipt was stored. */
+class CBenchSTOList : public CMPSTOList
+{
+public:
+    CBenchSTOList(const fs::path& path) : CMPSTOList(path, true) {}
+
+    void recordLegacySTOReceive(const std::string& address, const uint256& txid, int nBlock, unsigned int propertyId, uint64_t amount)
+    {
+        std::string strValue;
+        pdb->Get(readoptions, address, &strValue);
+        if (strValue.find(txid.ToString()) != std::string::npos) return;
+        strValue += strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
+        pdb->Put(writeoptions, address, strValue);
+    }
+};
+
+static void OmniSTOReceiveLegacy(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    while (state.KeepRunning()) {
+        CBenchSTOList stolist(GetDataDir() / "MP_stolist_bench_legacy");
+        for (int n = 0; n < NUM_RECEIPTS; ++n) {
+            stolist.recordLegacySTOReceive("1Omni", uint256S(strprintf("%x", n + 1)), 2000000 + n, 3, 100000000ULL * (n + 1));
+        }
+    }
+}
+
+static void OmniSTOReceive(benchmark::State& state)
+{
+    SelectParams(CBaseChainParams::REGTEST);
+    while (state.KeepRunning()) {
+        CBenchSTOList stolist(GetDataDir() / "MP_stolist_bench");
+        for (int n = 0; n < NUM_RECEIPTS; ++n) {
+            stolist.recordSTOReceive("1Omni", uint256S(strprintf("%x", n + 1)), 2000000 + n, 3, 100000000ULL * (n + 1));
+        }
+        assert(stolist.getReceipts("1Omni").size() == (size_t) NUM_RECEIPTS);
+    }
+}
+
+BENCHMARK(OmniTxRecordReadLegacy, 5);
+BENCHMARK(OmniTxRecordRead, 5);
+BENCHMARK(OmniSTOReceiveLegacy, 2);
+BENCHMARK(OmniSTOReceive, 2);
@@ -0,0 +1,200 @@
+#include <bench/bench.h>
+
+#include <omnicore/dbspinfo.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <fs.h>
+#include <key_io.h>
+#include <pubkey.h>
+#include <rpc/register.h>
+#include <rpc/server.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <univalue.h>
+#include <util/system.h>
+
+#include <leveldb/write_batch.h>
+
+#include <assert.h>
+#include <stdint.h>
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace mastercore;
+
+//! Number of properties held by the benchmarked address
+static const uint32_t NUM_PROPERTIES = 100;
+//! Number of grants, which are recorded as historical data of each property
+static const int NUM_GRANTS = 200;
+
+// defined in omnicore/rpc.cpp
+bool BalanceToJSON(const std::string& address, uint32_t property, UniValue& balance_obj, bool divisible);
+
+/** SP database with managed properties, which are also stored in the format, which included the historical data. */
+class CBenchSPInfo : public CMPSPInfo
+{
+public:
+    CBenchSPInfo(const fs::path& path) : CMPSPInfo(path, true)
+    {
+        for (uint32_t n = 0; n < NUM_PROPERTIES; ++n) {
+            Entry info;
+            info.issuer = "issuer";
+            info.prop_type = (n % 2) ? MSC_PROPERTY_TYPE_DIVISIBLE : MSC_PROPERTY_TYPE_INDIVISIBLE;
+            info.name = strprintf("Managed token %d", n);
+            info.manual = true;
+            info.txid = uint256S(strprintf("%x", n + 1));
+            History history;
+            for (int k = 0; k < NUM_GRANTS; ++k) {
+                history[uint256S(strprintf("%x%08x", n + 1, k))] = {1000, 0};
+            }
+            uint32_t propertyId = putSP(OMNI_PROPERTY_MSC, info);
+            putHistory(propertyId, history, uint256());
+            putLegacySP(propertyId, info, history, false);
+        }
+    }
+
+    /** Stores an entry in the legacy format, and optionally moves the previous one, the way updateSP did. */
+    void putLegacySP(uint32_t propertyId, Entry info, History history, bool fMovePrev)
+    {
+        const std::string key = strprintf("L%d", propertyId);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << LegacyEntry(info, history);
+
+        leveldb::WriteBatch batch;
+        std::string strPrevValue;
+        if (fMovePrev && pdb->Get(readoptions, key, &strPrevValue).ok()) {
+            batch.Put(strprintf("P%d%s", propertyId, info.update_block.GetHex()), strPrevValue);
+        }
+        batch.Put(key, std::string(ssValue.begin(), ssValue.end()));
+        pdb->Write(syncoptions, &batch);
+    }
+
+    /** Reads and decodes the full entry in the legacy format. */
+    bool getLegacySP(uint32_t propertyId, Entry& info, History& history) const
+    {
+        std::string strSpValue;
+        if (!pdb->Get(readoptions, strprintf("L%d", propertyId), &strSpValue).ok()) return false;
+        CDataStream ssSpValue(strSpValue.data(), strSpValue.data() + strSpValue.size(), SER_DISK, CLIENT_VERSION);
+        LegacyEntry legacy(info, history);
+        ssSpValue >> legacy;
+        return true;
+    }
+};
+
+/** Provides the SP database and the balances of the benchmarked address. */
+struct BenchBalances
+{
+    CMPSPInfo* pDbSpInfoPrev;
+    CBenchSPInfo* pSpInfo;
+    std::string address;
+
+    BenchBalances() : pDbSpInfoPrev(pDbSpInfo)
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        pSpInfo = new CBenchSPInfo(GetDataDir() / "MP_spinfo_bench");
+        pDbSpInfo = pSpInfo;
+        address = EncodeDestination(CKeyID(uint160(std::vector<unsigned char>(20, 0x42))));
+
+        LOCK(cs_tally);
+        for (uint32_t propertyId = 4; propertyId < 4 + NUM_PROPERTIES; ++propertyId) {
+            update_tally_map(address, propertyId, 1000, BALANCE);
+        }
+    }
+
+    ~BenchBalances()
+    {
+        LOCK(cs_tally);
+        mp_tally_map.clear();
+        pDbSpInfo = pDbSpInfoPrev;
+        delete pSpInfo;
+        fs::remove_all(GetDataDir() / "MP_spinfo_bench");
+    }
+};
+
+static void OmniGetAllBalancesLegacy(benchmark::State& state)
+{
+    BenchBalances balances;
+
+    while (state.KeepRunning()) {
+        UniValue response(UniValue::VARR);
+        LOCK(cs_tally);
+        CMPTally* addressTally = getTally(balances.address);
+        addressTally->init();
+        uint32_t propertyId = 0;
+        while (0 != (propertyId = addressTally->next())) {
+            CMPSPInfo::Entry property;
+            CMPSPInfo::History history;
+            if (!balances.pSpInfo->getLegacySP(propertyId, property, history)) continue;
+            UniValue balanceObj(UniValue::VOBJ);
+            balanceObj.pushKV("propertyid", (uint64_t) propertyId);
+            balanceObj.pushKV("name", property.name);
+            if (BalanceToJSON(balances.address, propertyId, balanceObj, property.isDivisible())) {
+                response.push_back(balanceObj);
+            }
+        }
+        assert(response.size() == NUM_PROPERTIES);
+    }
+}
+
+static void OmniGetAllBalances(benchmark::State& state)
+{
+    BenchBalances balances;
+
+    CRPCTable table;
+    RegisterOmniDataRetrievalRPCCommands(table);
+    const CRPCCommand* command = table["omni_getallbalancesforaddress"];
+    assert(command);
+
+    JSONRPCRequest request;
+    request.strMethod = "omni_getallbalancesforaddress";
+    request.params = UniValue(UniValue::VARR);
+    request.params.push_back(balances.address);
+
+    while (state.KeepRunning()) {
+        UniValue response = command->actor(request);
+        assert(response.size() == NUM_PROPERTIES);
+    }
+}
+
+static void OmniGrantTokensLegacy(benchmark::State& state)
+{
+    BenchBalances balances;
+    const uint32_t propertyId = 4;
+
+    int n = 0;
+    while (state.KeepRunning()) {
+        CMPSPInfo::Entry info;
+        CMPSPInfo::History history;
+        assert(balances.pSpInfo->getLegacySP(propertyId, info, history));
+        history[uint256S(strprintf("ff%08x", n))] = {1000, 0};
+        info.update_block = uint256S(strprintf("%x", ++n));
+        balances.pSpInfo->putLegacySP(propertyId, info, history, true);
+    }
+}
+
+static void OmniGrantTokens(benchmark::State& state)
+{
+    BenchBalances balances;
+    const uint32_t propertyId = 4;
+
+    int n = 0;
+    while (state.KeepRunning()) {
+        CMPSPInfo::History records;
+        records[uint256S(strprintf("ff%08x", n))] = {1000, 0};
+        assert(balances.pSpInfo->putHistory(propertyId, records, uint256S(strprintf("%x", ++n))));
+    }
+}
+
+BENCHMARK(OmniGetAllBalancesLegacy, 50);
+BENCHMARK(OmniGetAllBalances, 50);
+BENCHMARK(OmniGrantTokensLegacy, 200);
+BENCHMARK(OmniGrantTokens, 200);
@@ -0,0 +1,87 @@
+#include <bench/bench.h>
+
+#include <omnicore/omnicore.h>
+#include <omnicore/tally.h>
+
+#include <tinyformat.h>
+
+#include <array>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//! Number of funded addresses of the benchmarked tally maps
+static const int NUM_ADDRESSES = 1000 * 1000;
+//! Number of properties, which are spread over the addresses
+static const uint32_t NUM_PROPERTIES = 3;
+
+//! Layout of the tally map before addresses were interned
+typedef std::unordered_map<std::string, std::map<uint32_t, std::array<int64_t, TALLY_TYPE_COUNT> > > LegacyTallyMap;
+
+static std::vector<std::string> MakeAddresses()
+{
+    std::vector<std::string> addresses;
+    addresses.reserve(NUM_ADDRESSES);
+    for (int n = 0; n < NUM_ADDRESSES; ++n) {
+        addresses.push_back(strprintf("1Omni%029d", n));
+    }
+    return addresses;
+}
+
+static void OmniTallyMapLookup(benchmark::State& state)
+{
+    const std::vector<std::string> addresses = MakeAddresses();
+
+    CMPTallyMap tallyMap;
+    for (int n = 0; n < NUM_ADDRESSES; ++n) {
+        CMPTally& tally = tallyMap.insert(std::make_pair(addresses[n], CMPTally())).first->second;
+        tally.updateMoney(1 + n % NUM_PROPERTIES, n + 1, BALANCE);
+    }
+
+    int n = 0;
+    while (state.KeepRunning()) {
+        CMPTallyMap::iterator it = tallyMap.find(addresses[n]);
+        it->second.updateMoney(1 + n % NUM_PROPERTIES, 1, BALANCE);
+        n = (n + 7919) % NUM_ADDRESSES;
+    }
+}
+
+static void OmniLegacyTallyMapLookup(benchmark::State& state)
+{
+    const std::vector<std::string> addresses = MakeAddresses();
+
+    LegacyTallyMap tallyMap;
+    for (int n = 0; n < NUM_ADDRESSES; ++n) {
+        tallyMap[addresses[n]][1 + n % NUM_PROPERTIES][BALANCE] = n + 1;
+    }
+
+    int n = 0;
+    while (state.KeepRunning()) {
+        LegacyTallyMap::iterator it = tallyMap.find(addresses[n]);
+        it->second[1 + n % NUM_PROPERTIES][BALANCE] += 1;
+        n = (n + 7919) % NUM_ADDRESSES;
+    }
+}
+
+static void OmniUpdateTallyMap(benchmark::State& state)
+{
+    const std::vector<std::string> addresses = MakeAddresses();
+
+    for (int n = 0; n < NUM_ADDRESSES; ++n) {
+        mastercore::update_tally_map(addresses[n], 1 + n % NUM_PROPERTIES, n + 1, BALANCE);
+    }
+
+    int n = 0;
+    while (state.KeepRunning()) {
+        mastercore::update_tally_map(addresses[n], 1 + n % NUM_PROPERTIES, 1, BALANCE);
+        n = (n + 7919) % NUM_ADDRESSES;
+    }
+
+    LOCK(cs_tally);
+    mastercore::mp_tally_map.clear();
+}
+
+BENCHMARK(OmniTallyMapLookup, 5 * 1000 * 1000);
+BENCHMARK(OmniLegacyTallyMapLookup, 5 * 1000 * 1000);
+BENCHMARK(OmniUpdateTallyMap, 2 * 1000 * 1000);
@@ -0,0 +1,78 @@
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <validation.h>
+
+#include <assert.h>
+
+namespace block_bench {
+#include <bench/data/block413567.raw.h>
+} // namespace block_bench
+
+/** Stores a block with a valid NeoScrypt proof-of-work in the block files of the temporary datadir. */
+class ReadBlockBenchSetup
+{
+public:
+    CBlock block;
+    uint256 blockHash;
+    CBlockIndex index;
+
+    ReadBlockBenchSetup()
+    {
+        SelectParams(CBaseChainParams::REGTEST);
+        const Consensus::Params& params = Params().GetConsensus();
+
+        CDataStream stream((const char*)block_bench::block413567,
+                (const char*)block_bench::block413567 + sizeof(block_bench::block413567),
+                SER_NETWORK, PROTOCOL_VERSION);
+        stream >> block;
+
+        // the block is from another chain, so it is mined again at the minimum difficulty
+        unsigned int profile = (block.GetBlockTime() >= params.nNeoScryptFork) ? 0x0 : 0x3;
+        block.nBits = UintToArith256(params.powLimit).GetCompact();
+        while (!CheckProofOfWork(block.GetPoWHash(profile), block.nBits, params)) {
+            ++block.nNonce;
+        }
+        blockHash = block.GetHash();
+
+        CDiskBlockPos pos(0, 0);
+        CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
+        assert(!fileout.IsNull());
+        fileout << block;
+
+        index.phashBlock = &blockHash;
+        index.nFile = pos.nFile;
+        index.nDataPos = pos.nPos;
+        index.nStatus |= BLOCK_HAVE_DATA;
+    }
+};
+
+static void ReadBlockFromDiskTest(benchmark::State& state, bool fCheckPoW)
+{
+    ReadBlockBenchSetup setup;
+
+    while (state.KeepRunning()) {
+        CBlock block;
+        bool read = ReadBlockFromDisk(block, &setup.index, Params().GetConsensus(), fCheckPoW);
+        assert(read);
+    }
+}
+
+static void ReadBlockFromDiskCheckPoW(benchmark::State& state)
+{
+    ReadBlockFromDiskTest(state, true);
+}
+
+static void ReadBlockFromDiskTrusted(benchmark::State& state)
+{
+    ReadBlockFromDiskTest(state, false);
+}
+
+BENCHMARK(ReadBlockFromDiskCheckPoW, 100);
+BENCHMARK(ReadBlockFromDiskTrusted, 100);
@@ -12,12 +12,33 @@ void neoscrypt_blake2s(const void *input, const unsigned int input_size,
   const void *key, const unsigned char key_size,
   void *output, const unsigned char output_size);
 
+void neoscrypt_pbkdf2_sha256(const unsigned char *password,
+  unsigned int password_len, const unsigned char *salt, unsigned int salt_len,
+  unsigned int N, unsigned char *output, unsigned int output_len);
+
 void neoscrypt_copy(void *dstp, const void *srcp, unsigned int len);
 void neoscrypt_erase(void *dstp, unsigned int len);
 void neoscrypt_xor(void *dstp, const void *srcp, unsigned int len);
 
+/* Multi-lane NeoScrypt: hash 4, 8 or count consecutive 80 byte inputs into
+ * consecutive 32 byte outputs, with the SIMD kernels selected by
+ * NeoScryptAutoDetect(), or one by one, if none are available */
+void neoscrypt_4way(const unsigned char *password, unsigned char *output,
+  unsigned int profile);
+void neoscrypt_8way(const unsigned char *password, unsigned char *output,
+  unsigned int profile);
+void neoscrypt_multi(const unsigned char *password, unsigned char *output,
+  unsigned int profile, unsigned int count);
+
 #if (__cplusplus)
 }
+
+#include <string>
+
+/** Autodetect the best available multi-lane NeoScrypt implementation.
+ *  Returns the name of the implementation.
+ */
+std::string NeoScryptAutoDetect();
 #else
 
 #ifndef MIN
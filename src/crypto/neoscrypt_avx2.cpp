@@ -0,0 +1,38 @@
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/neoscrypt_lanes.h>
+
+namespace neoscrypt_avx2 {
+namespace {
+
+/** Eight 32-bit lanes of an AVX2 register. */
+struct Lanes
+{
+    typedef __m256i Vec;
+    static const int COUNT = 8;
+
+    static inline Vec Set1(uint32_t x) { return _mm256_set1_epi32(x); }
+    static inline Vec Add(Vec x, Vec y) { return _mm256_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+    static inline Vec RotL(Vec x, int n) { return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+    static inline Vec Load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm256_storeu_si256((__m256i*)p, x); }
+    static inline Vec Gather(const uint32_t* base, const uint32_t* offsets)
+    {
+        return _mm256_i32gather_epi32((const int*)base, _mm256_loadu_si256((const __m256i*)offsets), 4);
+    }
+};
+
+}
+
+void Hash_8way(const unsigned char* input, unsigned char* output, unsigned int profile)
+{
+    neoscrypt_lanes::Hash<Lanes>(input, output, profile);
+}
+
+}
+
+#endif
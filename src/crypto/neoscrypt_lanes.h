@@ -0,0 +1,412 @@
+#ifndef BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
+#define BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
+
+#include <crypto/neoscrypt.h>
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <memory>
+
+/**
+ * Multi-lane NeoScrypt, which hashes L::COUNT independent 80 byte inputs at
+ * once. L provides the vector type and the operations of one instruction set
+ * with 32-bit lanes, see neoscrypt_sse41.cpp and neoscrypt_avx2.cpp.
+ *
+ * A vector holds the same word of all inputs, so a block of 16 words is
+ * stored as 16 vectors. Only the data dependent parts, the FastKDF buffer
+ * pointers and the SMix indexes, are handled per lane.
+ */
+namespace neoscrypt_lanes {
+
+/** Size of the FastKDF buffers. */
+static const unsigned int FASTKDF_BUFFER_SIZE = 256;
+
+template <typename L>
+inline typename L::Vec RotR(typename L::Vec x, int n) { return L::RotL(x, 32 - n); }
+
+template <typename L>
+inline void SalsaQuarter(typename L::Vec& a, typename L::Vec& b, typename L::Vec& c, typename L::Vec& d)
+{
+    b = L::Xor(b, L::RotL(L::Add(a, d), 7));
+    c = L::Xor(c, L::RotL(L::Add(b, a), 9));
+    d = L::Xor(d, L::RotL(L::Add(c, b), 13));
+    a = L::Xor(a, L::RotL(L::Add(d, c), 18));
+}
+
+template <typename L>
+inline void ChaChaQuarter(typename L::Vec& a, typename L::Vec& b, typename L::Vec& c, typename L::Vec& d)
+{
+    a = L::Add(a, b); d = L::RotL(L::Xor(d, a), 16);
+    c = L::Add(c, d); b = L::RotL(L::Xor(b, c), 12);
+    a = L::Add(a, b); d = L::RotL(L::Xor(d, a), 8);
+    c = L::Add(c, d); b = L::RotL(L::Xor(b, c), 7);
+}
+
+/** Salsa20 of one block, rounds must be a multiple of 2. */
+template <typename L>
+void Salsa(typename L::Vec* X, unsigned int rounds)
+{
+    typename L::Vec x[16];
+    for (int i = 0; i < 16; ++i) x[i] = X[i];
+
+    for (; rounds; rounds -= 2) {
+        SalsaQuarter<L>(x[0], x[4], x[8], x[12]);
+        SalsaQuarter<L>(x[5], x[9], x[13], x[1]);
+        SalsaQuarter<L>(x[10], x[14], x[2], x[6]);
+        SalsaQuarter<L>(x[15], x[3], x[7], x[11]);
+        SalsaQuarter<L>(x[0], x[1], x[2], x[3]);
+        SalsaQuarter<L>(x[5], x[6], x[7], x[4]);
+        SalsaQuarter<L>(x[10], x[11], x[8], x[9]);
+        SalsaQuarter<L>(x[15], x[12], x[13], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) X[i] = L::Add(X[i], x[i]);
+}
+
+/** ChaCha20 of one block, rounds must be a multiple of 2. */
+template <typename L>
+void ChaCha(typename L::Vec* X, unsigned int rounds)
+{
+    typename L::Vec x[16];
+    for (int i = 0; i < 16; ++i) x[i] = X[i];
+
+    for (; rounds; rounds -= 2) {
+        ChaChaQuarter<L>(x[0], x[4], x[8], x[12]);
+        ChaChaQuarter<L>(x[1], x[5], x[9], x[13]);
+        ChaChaQuarter<L>(x[2], x[6], x[10], x[14]);
+        ChaChaQuarter<L>(x[3], x[7], x[11], x[15]);
+        ChaChaQuarter<L>(x[0], x[5], x[10], x[15]);
+        ChaChaQuarter<L>(x[1], x[6], x[11], x[12]);
+        ChaChaQuarter<L>(x[2], x[7], x[8], x[13]);
+        ChaChaQuarter<L>(x[3], x[4], x[9], x[14]);
+    }
+
+    for (int i = 0; i < 16; ++i) X[i] = L::Add(X[i], x[i]);
+}
+
+template <typename L>
+inline void BlkCpy(typename L::Vec* dst, const typename L::Vec* src, unsigned int words)
+{
+    for (unsigned int i = 0; i < words; ++i) dst[i] = src[i];
+}
+
+template <typename L>
+inline void BlkXor(typename L::Vec* dst, const typename L::Vec* src, unsigned int words)
+{
+    for (unsigned int i = 0; i < words; ++i) dst[i] = L::Xor(dst[i], src[i]);
+}
+
+template <typename L>
+inline void BlkSwp(typename L::Vec* a, typename L::Vec* b, unsigned int words)
+{
+    for (unsigned int i = 0; i < words; ++i) {
+        typename L::Vec t = a[i];
+        a[i] = b[i];
+        b[i] = t;
+    }
+}
+
+template <typename L>
+inline void Mix(typename L::Vec* X, unsigned int mixer, unsigned int rounds)
+{
+    if (mixer) {
+        ChaCha<L>(X, rounds);
+    } else {
+        Salsa<L>(X, rounds);
+    }
+}
+
+/** Block mixer, see neoscrypt_blkmix() for the flow. */
+template <typename L>
+void BlkMix(typename L::Vec* X, typename L::Vec* Y, unsigned int r, unsigned int mixmode)
+{
+    const unsigned int mixer = mixmode >> 8;
+    const unsigned int rounds = mixmode & 0xFF;
+
+    if (r == 2) {
+        BlkXor<L>(&X[0], &X[48], 16);
+        Mix<L>(&X[0], mixer, rounds);
+        BlkXor<L>(&X[16], &X[0], 16);
+        Mix<L>(&X[16], mixer, rounds);
+        BlkXor<L>(&X[32], &X[16], 16);
+        Mix<L>(&X[32], mixer, rounds);
+        BlkXor<L>(&X[48], &X[32], 16);
+        Mix<L>(&X[48], mixer, rounds);
+        BlkSwp<L>(&X[16], &X[32], 16);
+        return;
+    }
+
+    for (unsigned int i = 0; i < 2 * r; ++i) {
+        BlkXor<L>(&X[16 * i], &X[16 * ((i + 2 * r - 1) % (2 * r))], 16);
+        Mix<L>(&X[16 * i], mixer, rounds);
+        BlkCpy<L>(&Y[16 * i], &X[16 * i], 16);
+    }
+    if (r == 1) return;
+    for (unsigned int i = 0; i < r; ++i) BlkCpy<L>(&X[16 * i], &Y[16 * 2 * i], 16);
+    for (unsigned int i = 0; i < r; ++i) BlkCpy<L>(&X[16 * (i + r)], &Y[16 * (2 * i + 1)], 16);
+}
+
+/** Sequential memory-hard mixing of X, using the scratchpad V of N * 32 * r vectors. */
+template <typename L>
+void SMix(typename L::Vec* X, typename L::Vec* Y, typename L::Vec* V, unsigned int N, unsigned int r, unsigned int mixmode)
+{
+    const unsigned int words = 32 * r;
+
+    for (unsigned int i = 0; i < N; ++i) {
+        BlkCpy<L>(&V[i * words], X, words);
+        BlkMix<L>(X, Y, r, mixmode);
+    }
+
+    const uint32_t* base = reinterpret_cast<const uint32_t*>(V);
+    uint32_t integers[L::COUNT];
+    uint32_t offsets[L::COUNT];
+    for (unsigned int i = 0; i < N; ++i) {
+        // integerify(X) mod N differs per lane, so the words of V are gathered
+        L::Store(integers, X[16 * (2 * r - 1)]);
+        for (int l = 0; l < L::COUNT; ++l) {
+            offsets[l] = (integers[l] & (N - 1)) * words * L::COUNT + l;
+        }
+        for (unsigned int w = 0; w < words; ++w) {
+            X[w] = L::Xor(X[w], L::Gather(base + w * L::COUNT, offsets));
+        }
+        BlkMix<L>(X, Y, r, mixmode);
+    }
+}
+
+template <typename L>
+inline void Blake2sG(typename L::Vec& a, typename L::Vec& b, typename L::Vec& c, typename L::Vec& d, typename L::Vec x, typename L::Vec y)
+{
+    a = L::Add(L::Add(a, b), x); d = RotR<L>(L::Xor(d, a), 16);
+    c = L::Add(c, d); b = RotR<L>(L::Xor(b, c), 12);
+    a = L::Add(L::Add(a, b), y); d = RotR<L>(L::Xor(d, a), 8);
+    c = L::Add(c, d); b = RotR<L>(L::Xor(b, c), 7);
+}
+
+/** BLAKE2s compression of one 64 byte block per lane; the counter and finalisation flag are the same for all lanes. */
+template <typename L>
+void Blake2sCompress(typename L::Vec* h, const typename L::Vec* m, uint32_t t0, uint32_t f0)
+{
+    static const uint32_t IV[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+    static const unsigned char SIGMA[10][16] = {
+        { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+        { 14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3 },
+        { 11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4 },
+        { 7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8 },
+        { 9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13 },
+        { 2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9 },
+        { 12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11 },
+        { 13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10 },
+        { 6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5 },
+        { 10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0 }
+    };
+
+    typename L::Vec v[16];
+    for (int i = 0; i < 8; ++i) v[i] = h[i];
+    for (int i = 0; i < 4; ++i) v[8 + i] = L::Set1(IV[i]);
+    v[12] = L::Set1(t0 ^ IV[4]);
+    v[13] = L::Set1(IV[5]);
+    v[14] = L::Set1(f0 ^ IV[6]);
+    v[15] = L::Set1(IV[7]);
+
+    for (int round = 0; round < 10; ++round) {
+        const unsigned char* s = SIGMA[round];
+        Blake2sG<L>(v[0], v[4], v[8], v[12], m[s[0]], m[s[1]]);
+        Blake2sG<L>(v[1], v[5], v[9], v[13], m[s[2]], m[s[3]]);
+        Blake2sG<L>(v[2], v[6], v[10], v[14], m[s[4]], m[s[5]]);
+        Blake2sG<L>(v[3], v[7], v[11], v[15], m[s[6]], m[s[7]]);
+        Blake2sG<L>(v[0], v[5], v[10], v[15], m[s[8]], m[s[9]]);
+        Blake2sG<L>(v[1], v[6], v[11], v[12], m[s[10]], m[s[11]]);
+        Blake2sG<L>(v[2], v[7], v[8], v[13], m[s[12]], m[s[13]]);
+        Blake2sG<L>(v[3], v[4], v[9], v[14], m[s[14]], m[s[15]]);
+    }
+
+    for (int i = 0; i < 8; ++i) h[i] = L::Xor(h[i], L::Xor(v[i], v[i + 8]));
+}
+
+/** Loads words of one input per lane into vectors. */
+template <typename L>
+void ToLanes(typename L::Vec* out, const unsigned char* const in[], unsigned int words)
+{
+    uint32_t lanes[L::COUNT];
+    for (unsigned int w = 0; w < words; ++w) {
+        for (int l = 0; l < L::COUNT; ++l) memcpy(&lanes[l], in[l] + 4 * w, 4);
+        out[w] = L::Load(lanes);
+    }
+}
+
+/** Stores the lanes of vectors as words of one output per lane. */
+template <typename L>
+void FromLanes(unsigned char* const out[], const typename L::Vec* in, unsigned int words)
+{
+    uint32_t lanes[L::COUNT];
+    for (unsigned int w = 0; w < words; ++w) {
+        L::Store(lanes, in[w]);
+        for (int l = 0; l < L::COUNT; ++l) memcpy(out[l] + 4 * w, &lanes[l], 4);
+    }
+}
+
+/** Fills a FastKDF buffer with repetitions of the input. */
+inline void FillBuffer(unsigned char* buffer, const unsigned char* in, unsigned int len)
+{
+    unsigned int i = 0;
+    for (; i + len <= FASTKDF_BUFFER_SIZE; i += len) memcpy(&buffer[i], in, len);
+    memcpy(&buffer[i], in, FASTKDF_BUFFER_SIZE - i);
+}
+
+/** FastKDF with 32 iterations of BLAKE2s, see neoscrypt_fastkdf(). */
+template <typename L>
+void FastKDF(const unsigned char* const password[], const unsigned char* const salt[], unsigned int salt_len,
+        unsigned char* const output[], unsigned int output_len)
+{
+    const unsigned int password_len = 80, prf_input_size = 64, prf_key_size = 32, prf_output_size = 32;
+    // initial BLAKE2s state with the parameter block of a 32 byte key and digest
+    static const uint32_t IV_P_XOR[8] = {
+        0x6B08C647, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+        0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+
+    unsigned char A[L::COUNT][FASTKDF_BUFFER_SIZE + prf_input_size];
+    unsigned char B[L::COUNT][FASTKDF_BUFFER_SIZE + prf_key_size];
+    unsigned int bufptr[L::COUNT];
+
+    for (int l = 0; l < L::COUNT; ++l) {
+        FillBuffer(A[l], password[l], password_len);
+        memcpy(&A[l][FASTKDF_BUFFER_SIZE], password[l], prf_input_size);
+        FillBuffer(B[l], salt[l], salt_len);
+        memcpy(&B[l][FASTKDF_BUFFER_SIZE], salt[l], prf_key_size);
+        bufptr[l] = 0;
+    }
+
+    uint32_t words[16][L::COUNT];
+    typename L::Vec h[8], m[16];
+    unsigned char prf_output[prf_output_size];
+
+    for (int i = 0; i < 32; ++i) {
+        for (int k = 0; k < 8; ++k) h[k] = L::Set1(IV_P_XOR[k]);
+
+        // the key, padded to a block
+        for (int l = 0; l < L::COUNT; ++l) {
+            for (int k = 0; k < 8; ++k) memcpy(&words[k][l], &B[l][bufptr[l] + 4 * k], 4);
+        }
+        for (int k = 0; k < 8; ++k) m[k] = L::Load(words[k]);
+        for (int k = 8; k < 16; ++k) m[k] = L::Set1(0);
+        Blake2sCompress<L>(h, m, 64, 0);
+
+        // the input, as last block
+        for (int l = 0; l < L::COUNT; ++l) {
+            for (int k = 0; k < 16; ++k) memcpy(&words[k][l], &A[l][bufptr[l] + 4 * k], 4);
+        }
+        for (int k = 0; k < 16; ++k) m[k] = L::Load(words[k]);
+        Blake2sCompress<L>(h, m, 128, ~0U);
+
+        for (int k = 0; k < 8; ++k) L::Store(words[k], h[k]);
+        for (int l = 0; l < L::COUNT; ++l) {
+            for (int k = 0; k < 8; ++k) memcpy(&prf_output[4 * k], &words[k][l], 4);
+
+            unsigned int ptr = 0;
+            for (unsigned int j = 0; j < prf_output_size; ++j) ptr += prf_output[j];
+            ptr &= (FASTKDF_BUFFER_SIZE - 1);
+            bufptr[l] = ptr;
+
+            for (unsigned int j = 0; j < prf_output_size; ++j) B[l][ptr + j] ^= prf_output[j];
+
+            // head modified, tail updated, or tail modified, head updated
+            if (ptr < prf_key_size) {
+                memcpy(&B[l][FASTKDF_BUFFER_SIZE + ptr], &B[l][ptr], std::min(prf_output_size, prf_key_size - ptr));
+            } else if ((FASTKDF_BUFFER_SIZE - ptr) < prf_output_size) {
+                memcpy(&B[l][0], &B[l][FASTKDF_BUFFER_SIZE], prf_output_size - (FASTKDF_BUFFER_SIZE - ptr));
+            }
+        }
+    }
+
+    for (int l = 0; l < L::COUNT; ++l) {
+        const unsigned int ptr = bufptr[l];
+        const unsigned int a = FASTKDF_BUFFER_SIZE - ptr;
+        if (a >= output_len) {
+            for (unsigned int j = 0; j < output_len; ++j) output[l][j] = B[l][ptr + j] ^ A[l][j];
+        } else {
+            for (unsigned int j = 0; j < a; ++j) output[l][j] = B[l][ptr + j] ^ A[l][j];
+            for (unsigned int j = a; j < output_len; ++j) output[l][j] = B[l][j - a] ^ A[l][j];
+        }
+    }
+}
+
+/**
+ * Hashes L::COUNT consecutive 80 byte inputs into consecutive 32 byte
+ * outputs, with the same result as neoscrypt() for each input.
+ */
+template <typename L>
+void Hash(const unsigned char* password, unsigned char* output, unsigned int profile)
+{
+    typedef typename L::Vec Vec;
+
+    // extended profiles are not used by the chain, and are hashed one by one
+    if (profile >> 31) {
+        for (int l = 0; l < L::COUNT; ++l) neoscrypt(password + 80 * l, output + 32 * l, profile);
+        return;
+    }
+
+    unsigned int N = 128, r = 2, dblmix = 1, mixmode = 0x14;
+    if (profile & 0x1) {
+        N = 1024;
+        r = 1;
+        dblmix = 0;
+        mixmode = 0x08;
+    }
+    const unsigned int words = 32 * r;
+    const unsigned int kdf = (profile >> 1) & 0xF;
+
+    const unsigned char* in[L::COUNT];
+    unsigned char* out[L::COUNT];
+    unsigned char state[L::COUNT][FASTKDF_BUFFER_SIZE];
+    unsigned char* pstate[L::COUNT];
+    for (int l = 0; l < L::COUNT; ++l) {
+        in[l] = password + 80 * l;
+        out[l] = output + 32 * l;
+        pstate[l] = state[l];
+    }
+
+    // X = KDF(password, salt)
+    if (kdf == 0x1) {
+        for (int l = 0; l < L::COUNT; ++l) neoscrypt_pbkdf2_sha256(in[l], 80, in[l], 80, 1, state[l], words * 4);
+    } else {
+        FastKDF<L>(in, in, 80, pstate, words * 4);
+    }
+
+    // X, Z as copy of X for ChaCha, Y as temporal space, and the scratchpad V
+    const size_t align = 64;
+    std::unique_ptr<unsigned char[]> memory(new unsigned char[(N + 3) * words * sizeof(Vec) + align]);
+    Vec* X = reinterpret_cast<Vec*>((reinterpret_cast<uintptr_t>(memory.get()) + align - 1) & ~(uintptr_t)(align - 1));
+    Vec* Z = &X[words];
+    Vec* Y = &X[2 * words];
+    Vec* V = &X[3 * words];
+
+    ToLanes<L>(X, pstate, words);
+
+    if (dblmix) {
+        BlkCpy<L>(Z, X, words);
+        SMix<L>(Z, Y, V, N, r, mixmode | 0x0100);
+    }
+    SMix<L>(X, Y, V, N, r, mixmode);
+    if (dblmix) {
+        BlkXor<L>(X, Z, words);
+    }
+
+    FromLanes<L>(pstate, X, words);
+
+    // output = KDF(password, X)
+    if (kdf == 0x1) {
+        for (int l = 0; l < L::COUNT; ++l) neoscrypt_pbkdf2_sha256(in[l], 80, state[l], words * 4, 1, out[l], 32);
+    } else {
+        FastKDF<L>(in, pstate, words * 4, out, 32);
+    }
+}
+
+} // namespace neoscrypt_lanes
+
+#endif // BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
@@ -0,0 +1,175 @@
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
+#include <crypto/neoscrypt.h>
+
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#include <cpuid.h>
+#endif
+
+namespace neoscrypt_sse41
+{
+void Hash_4way(const unsigned char* input, unsigned char* output, unsigned int profile);
+}
+
+namespace neoscrypt_avx2
+{
+void Hash_8way(const unsigned char* input, unsigned char* output, unsigned int profile);
+}
+
+namespace
+{
+typedef void (*HashType)(const unsigned char*, unsigned char*, unsigned int);
+
+HashType Hash_4way = nullptr;
+HashType Hash_8way = nullptr;
+
+/** Compares the multi-lane implementations with the portable one. */
+bool SelfTest()
+{
+    unsigned char input[8 * 80];
+    for (unsigned int i = 0; i < sizeof(input); ++i) {
+        input[i] = (unsigned char)(i * 7 + 1);
+    }
+    unsigned char expected[8 * 32];
+    for (int n = 0; n < 8; ++n) {
+        neoscrypt(input + 80 * n, expected + 32 * n, 0x0);
+    }
+
+    unsigned char output[8 * 32];
+    if (Hash_4way) {
+        Hash_4way(input, output, 0x0);
+        if (memcmp(output, expected, 4 * 32) != 0) return false;
+    }
+    if (Hash_8way) {
+        Hash_8way(input, output, 0x0);
+        if (memcmp(output, expected, 8 * 32) != 0) return false;
+    }
+
+    return true;
+}
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+// We can't use cpuid.h's __get_cpuid as it does not support subleafs.
+void inline cpuid(uint32_t leaf, uint32_t subleaf, uint32_t& a, uint32_t& b, uint32_t& c, uint32_t& d)
+{
+#ifdef __GNUC__
+    __cpuid_count(leaf, subleaf, a, b, c, d);
+#else
+  __asm__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "0"(leaf), "2"(subleaf));
+#endif
+}
+
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return (a & 6) == 6;
+}
+#endif
+} // namespace
+
+
+std::string NeoScryptAutoDetect()
+{
+    std::string ret = "standard";
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    bool have_sse4 = false;
+    bool have_xsave = false;
+    bool have_avx = false;
+    bool have_avx2 = false;
+    bool enabled_avx = false;
+
+    (void)AVXEnabled;
+    (void)have_sse4;
+    (void)have_avx;
+    (void)have_xsave;
+    (void)have_avx2;
+    (void)enabled_avx;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, eax, ebx, ecx, edx);
+    have_sse4 = (ecx >> 19) & 1;
+    have_xsave = (ecx >> 27) & 1;
+    have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        enabled_avx = AVXEnabled();
+    }
+    if (have_sse4) {
+        cpuid(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+    }
+
+#if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_sse4) {
+        Hash_4way = neoscrypt_sse41::Hash_4way;
+        ret = "sse41(4way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx && enabled_avx) {
+        Hash_8way = neoscrypt_avx2::Hash_8way;
+        ret += ",avx2(8way)";
+    }
+#endif
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void neoscrypt_4way(const unsigned char* password, unsigned char* output, unsigned int profile)
+{
+    if (Hash_4way) {
+        Hash_4way(password, output, profile);
+        return;
+    }
+    for (int n = 0; n < 4; ++n) {
+        neoscrypt(password + 80 * n, output + 32 * n, profile);
+    }
+}
+
+void neoscrypt_8way(const unsigned char* password, unsigned char* output, unsigned int profile)
+{
+    if (Hash_8way) {
+        Hash_8way(password, output, profile);
+        return;
+    }
+    neoscrypt_4way(password, output, profile);
+    neoscrypt_4way(password + 4 * 80, output + 4 * 32, profile);
+}
+
+void neoscrypt_multi(const unsigned char* password, unsigned char* output, unsigned int profile, unsigned int count)
+{
+    if (Hash_8way) {
+        while (count >= 8) {
+            Hash_8way(password, output, profile);
+            password += 8 * 80;
+            output += 8 * 32;
+            count -= 8;
+        }
+    }
+    if (Hash_4way) {
+        while (count >= 4) {
+            Hash_4way(password, output, profile);
+            password += 4 * 80;
+            output += 4 * 32;
+            count -= 4;
+        }
+    }
+    while (count > 0) {
+        neoscrypt(password, output, profile);
+        password += 80;
+        output += 32;
+        count -= 1;
+    }
+}
@@ -0,0 +1,38 @@
+#ifdef ENABLE_SSE41
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include <crypto/neoscrypt_lanes.h>
+
+namespace neoscrypt_sse41 {
+namespace {
+
+/** Four 32-bit lanes of an SSE register. */
+struct Lanes
+{
+    typedef __m128i Vec;
+    static const int COUNT = 4;
+
+    static inline Vec Set1(uint32_t x) { return _mm_set1_epi32(x); }
+    static inline Vec Add(Vec x, Vec y) { return _mm_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+    static inline Vec RotL(Vec x, int n) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+    static inline Vec Load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm_storeu_si128((__m128i*)p, x); }
+    static inline Vec Gather(const uint32_t* base, const uint32_t* offsets)
+    {
+        return _mm_set_epi32(base[offsets[3]], base[offsets[2]], base[offsets[1]], base[offsets[0]]);
+    }
+};
+
+}
+
+void Hash_4way(const unsigned char* input, unsigned char* output, unsigned int profile)
+{
+    neoscrypt_lanes::Hash<Lanes>(input, output, profile);
+}
+
+}
+
+#endif
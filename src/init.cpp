@@ -18,6 +18,7 @@
 #include <checkpointsync.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
+#include <crypto/neoscrypt.h>
 #include <fs.h>
 #include <httpserver.h>
 #include <httprpc.h>
@@ -53,6 +54,10 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <omnicore/dbaddressindex.h>
+#include <omnicore/dbbase.h>
+#include <omnicore/dbpropertyindex.h>
+#include <omnicore/omnicore.h>
 #include <omnicore/version.h>
 
 #ifndef WIN32
@@ -97,10 +102,8 @@ std::unique_ptr<BanMan> g_banman;
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
 
-// Omni Core initialization and shutdown handlers
-extern int mastercore_init();
-extern int mastercore_shutdown();
-extern int CheckWalletUpdate(bool forceUpdate = false);
+// Omni Core transaction parser threads
+extern void ThreadOmniParse();
 
 /**
  * The PID file facilities.
@@ -560,7 +563,14 @@ void SetupServerArgs()
     // TODO: translation
     gArgs.AddArg("-startclean", "Clear all persistence files on startup; triggers reparsing of Omni transactions (default: 0)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-omnitxcache", "The maximum number of transactions in the input transaction cache (default: 500000)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omniaddressindex", strprintf("Maintain an index of the Omni transactions of each address, used by omni_listaddresstransactions (default: %u)", DEFAULT_OMNI_ADDRESS_INDEX), false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnipropertyindex", strprintf("Maintain an index of the Omni transactions of each property, used by omni_listpropertytransactions (default: %u)", DEFAULT_OMNI_PROPERTY_INDEX), false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnidbcache=<n>", strprintf("Size of the block cache shared by the Omni databases in MiB, which is taken from -dbcache, 0 to use a default cache per database (default: %d)", DEFAULT_OMNI_DB_CACHE), false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnidbbloomfilter", strprintf("Use bloom filters to speed up lookups of the Omni databases, which applies to newly written tables (default: %u)", DEFAULT_OMNI_DB_BLOOM_FILTER), false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnidbchecksums", strprintf("Verify checksums, when values of the Omni databases are looked up (default: %u)", DEFAULT_OMNI_DB_CHECKSUMS), false, OptionsCategory::OMNI);
     gArgs.AddArg("-omniprogressfrequency", "Time in seconds after which the initial scanning progress is reported (default: 30)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omniscanthreads", "Number of threads, which read blocks ahead of the initial scan, 0 to disable (default: 2)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omniparsethreads=<n>", strprintf("Number of threads, which parse the transactions of a connected block, before they are processed in order (0 = one per core, 1 = serial, default: %d)", DEFAULT_OMNI_PARSE_THREADS), false, OptionsCategory::OMNI);
     gArgs.AddArg("-omnilogfile", "The path of the log file (default: omnicore.log)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-omnidebug=<category>", "Enable or disable log categories, can be \"all\" or \"none\"", false, OptionsCategory::OMNI);
     gArgs.AddArg("-autocommit", "Enable or disable broadcasting of transactions, when creating transactions (default: 1)", false, OptionsCategory::OMNI);
@@ -572,6 +582,8 @@ void SetupServerArgs()
     gArgs.AddArg("-disclaimer", "Explicitly show QT disclaimer on startup (default: 0)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-omniuiwalletscope", "Max. transactions to show in trade and transaction history (default: 65535)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-omnishowblockconsensushash", "Calculate and log the consensus hash for the specified block", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnistatehash", "Maintain an incremental, order-independent hash of the state (default: 0)", false, OptionsCategory::OMNI);
+    gArgs.AddArg("-omnistatehashcheck", "Compare the incremental state hash with a recomputed one at checkpoint heights (default: 0)", false, OptionsCategory::OMNI);
     gArgs.AddArg("-omniuseragent", "Show Omni and Omni version in user agent string (default: 1)", false, OptionsCategory::OMNI);
 
 
@@ -1232,6 +1244,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string neoscrypt_algo = NeoScryptAutoDetect();
+    LogPrintf("Using the '%s' NeoScrypt implementation\n", neoscrypt_algo);
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1320,8 +1334,19 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadPoWCheck);
     }
 
+    // -omniparsethreads=0 means autodetect, but nOmniParseThreads==1 means no concurrency
+    nOmniParseThreads = gArgs.GetArg("-omniparsethreads", DEFAULT_OMNI_PARSE_THREADS);
+    if (nOmniParseThreads <= 0)
+        nOmniParseThreads += GetNumCores();
+    nOmniParseThreads = std::max(1, std::min(nOmniParseThreads, MAX_SCRIPTCHECK_THREADS));
+    LogPrintf("Using %u threads for Omni transaction parsing\n", nOmniParseThreads);
+    for (int i=0; i<nOmniParseThreads-1; i++)
+        threadGroup.create_thread(&ThreadOmniParse);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1511,6 +1536,8 @@ bool AppInitMain(InitInterfaces& interfaces)
     nTotalCache -= nBlockTreeDBCache;
     int64_t nTxIndexCache = std::min(nTotalCache / 8, gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxTxIndexCache << 20 : 0);
     nTotalCache -= nTxIndexCache;
+    int64_t nOmniDBCache = std::min(nTotalCache / 8, std::max<int64_t>(gArgs.GetArg("-omnidbcache", DEFAULT_OMNI_DB_CACHE), 0) << 20);
+    nTotalCache -= nOmniDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
@@ -1521,6 +1548,7 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1f MiB for transaction index database\n", nTxIndexCache * (1.0 / 1024 / 1024));
     }
+    LogPrintf("* Using %.1f MiB for Omni databases\n", nOmniDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1f MiB for in-memory UTXO set (plus up to %.1f MiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
@@ -1726,6 +1754,8 @@ bool AppInitMain(InitInterfaces& interfaces)
 
     uiInterface.InitMessage(_("Parsing Omni Layer transactions..."));
 
+    CDBBase::Configure(nOmniDBCache, gArgs.GetBoolArg("-omnidbbloomfilter", DEFAULT_OMNI_DB_BLOOM_FILTER),
+            gArgs.GetBoolArg("-omnidbchecksums", DEFAULT_OMNI_DB_CHECKSUMS));
     mastercore_init();
 
     // ********************************************************* Step 9: load wallet
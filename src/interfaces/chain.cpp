@@ -168,7 +168,7 @@ public:
                 *time_max = index->GetBlockTimeMax();
             }
         }
-        if (block && !ReadBlockFromDisk(*block, index, Params().GetConsensus())) {
+        if (block && !ReadBlockFromDisk(*block, index, Params().GetConsensus(), false)) {
             block->SetNull();
         }
         return true;
@@ -9,6 +9,7 @@
 #include <omnicore/activation.h>
 
 #include <omnicore/log.h>
+#include <omnicore/persistence.h>
 #include <omnicore/version.h>
 
 #include <fs.h>
@@ -91,6 +92,7 @@ void CheckLiveActivations(int blockHeight)
             PrintToConsole(msgText);
             if (!gArgs.GetBoolArg("-overrideforcedshutdown", false)) {
                 fs::path persistPath = GetDataDir() / "MP_persist";
+                FlushStatePersistence();
                 if (fs::exists(persistPath)) fs::remove_all(persistPath); // prevent the node being restarted without a reparse after forced shutdown
                 DoAbortNode(msgText, msgText);
             }
@@ -8,19 +8,81 @@
 #include <omnicore/dbspinfo.h>
 #include <omnicore/dex.h>
 #include <omnicore/log.h>
+#include <omnicore/omnicore.h>
 #include <omnicore/parse_string.h>
+#include <omnicore/rules.h>
 #include <omnicore/sp.h>
+#include <omnicore/tally.h>
 
 #include <arith_uint256.h>
+#include <crypto/sha256.h>
 #include <uint256.h>
 
 #include <stdint.h>
 #include <algorithm>
+#include <set>
 #include <string>
 #include <vector>
 
+/**
+ * Adds an element to the multiset.
+ */
+void CMPMultisetHash::Insert(const std::string& element)
+{
+    muhash.Insert((const unsigned char*) element.data(), element.size());
+}
+
+/**
+ * Removes an element from the multiset.
+ */
+void CMPMultisetHash::Erase(const std::string& element)
+{
+    muhash.Remove((const unsigned char*) element.data(), element.size());
+}
+
+/**
+ * Replaces an element by another one.
+ *
+ * Empty strings represent absent elements, for example empty balances.
+ */
+void CMPMultisetHash::Replace(const std::string& before, const std::string& after)
+{
+    if (before == after) return;
+    if (!before.empty()) Erase(before);
+    if (!after.empty()) Insert(after);
+}
+
+/**
+ * Returns the hash of the multiset.
+ */
+uint256 CMPMultisetHash::GetHash() const
+{
+    MuHash3072 copy(muhash);
+    uint256 hash;
+    copy.Finalize(hash);
+    return hash;
+}
+
 namespace mastercore
 {
+//! Whether the incremental state hash is maintained, enabled with -omnistatehash
+bool fOmniStateHash = false;
+//! Whether the incremental state hash is verified, enabled with -omnistatehashcheck
+bool fOmniStateHashCheck = false;
+
+//! Incrementally maintained hash of all balances
+static CMPMultisetHash balancesStateHash;
+//! Incrementally maintained hashes of the DEx offers, DEx accepts and crowdsales
+static CMPMultisetHash offersStateHash;
+static CMPMultisetHash acceptsStateHash;
+static CMPMultisetHash crowdsStateHash;
+//! Keys of the offers, accepts and crowdsales, which were changed since they were hashed
+static std::set<std::string> setChangedOffers;
+static std::set<std::string> setChangedAccepts;
+static std::set<std::string> setChangedCrowds;
+//! Whether the offers, accepts and crowdsales must be hashed from scratch
+static bool fRehashDExAndCrowdsales = true;
+
 bool ShouldConsensusHashBlock(int block) {
     if (msc_debug_consensus_hash_every_block) {
         return true;
@@ -141,7 +203,7 @@ uint256 GetConsensusHash()
     // Placeholders:  "address|propertyid|balance|selloffer_reserve|accept_reserve"
     // Sort alphabetically first
     std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<std::string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
+    for (CMPTallyMap::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
         tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
     }
     for (std::map<std::string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
@@ -217,8 +279,8 @@ uint256 GetConsensusHash()
     for (uint8_t ecosystem = 1; ecosystem <= 2; ecosystem++) {
         uint32_t startPropertyId = (ecosystem == 1) ? 1 : TEST_ECO_PROPERTY_1;
         for (uint32_t propertyId = startPropertyId; propertyId < pDbSpInfo->peekNextSPID(ecosystem); propertyId++) {
-            CMPSPInfo::Entry sp;
-            if (!pDbSpInfo->getSP(propertyId, sp)) {
+            CMPSPInfo::Header sp;
+            if (!pDbSpInfo->getHeader(propertyId, sp)) {
                 PrintToLog("Error loading property ID %d for consensus hashing, hash should not be trusted!\n");
                 continue;
             }
@@ -244,7 +306,7 @@ uint256 GetBalancesHash(const uint32_t hashPropertyId)
     LOCK(cs_tally);
 
     std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<std::string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
+    for (CMPTallyMap::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
         tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
     }
     for (std::map<std::string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
@@ -267,4 +329,244 @@ uint256 GetBalancesHash(const uint32_t hashPropertyId)
     return balancesHash;
 }
 
+/** Updates the balances of the incremental state hash. */
+void UpdateStateHashBalance(const std::string& before, const std::string& after)
+{
+    balancesStateHash.Replace(before, after);
+}
+
+/** Removes all balances from the incremental state hash. */
+void ClearStateHashBalances()
+{
+    balancesStateHash.Clear();
+}
+
+/** Returns the consensus string of a DEx offer. */
+static std::string GetOfferConsensusString(const OfferMap::value_type& entry)
+{
+    const std::string& sellCombo = entry.first;
+    std::string seller = sellCombo.substr(0, sellCombo.size() - 2);
+    return GenerateConsensusString(entry.second, seller);
+}
+
+/** Returns the consensus string of a DEx accept. */
+static std::string GetAcceptConsensusString(const AcceptMap::value_type& entry)
+{
+    const std::string& acceptCombo = entry.first;
+    std::string buyer = acceptCombo.substr((acceptCombo.find("+") + 1), (acceptCombo.size()-(acceptCombo.find("+") + 1)));
+    return GenerateConsensusString(entry.second, buyer);
+}
+
+/** Returns the consensus string of a crowdsale. */
+static std::string GetCrowdConsensusString(const CrowdMap::value_type& entry)
+{
+    return GenerateConsensusString(entry.second);
+}
+
+/**
+ * Removes an entry from a multiset hash, when it is changed the first time
+ * after it was hashed. The entry is added again, once it was changed.
+ */
+template <typename Map>
+static void EraseChangedEntry(const Map& map, const std::string& key, std::set<std::string>& setChanged,
+        CMPMultisetHash& hash, std::string (*toString)(const typename Map::value_type&))
+{
+    if (!fOmniStateHash || fRehashDExAndCrowdsales || !setChanged.insert(key).second) {
+        return;
+    }
+    typename Map::const_iterator it = map.find(key);
+    if (it != map.end()) {
+        hash.Erase(toString(*it));
+    }
+}
+
+/** Adds the changed entries to a multiset hash again. */
+template <typename Map>
+static void InsertChangedEntries(const Map& map, std::set<std::string>& setChanged,
+        CMPMultisetHash& hash, std::string (*toString)(const typename Map::value_type&))
+{
+    for (std::set<std::string>::const_iterator it = setChanged.begin(); it != setChanged.end(); ++it) {
+        typename Map::const_iterator itEntry = map.find(*it);
+        if (itEntry != map.end()) {
+            hash.Insert(toString(*itEntry));
+        }
+    }
+    setChanged.clear();
+}
+
+/** Records, that a DEx offer is about to be added, modified or removed. */
+void UpdateStateHashOffer(const std::string& key)
+{
+    EraseChangedEntry(my_offers, key, setChangedOffers, offersStateHash, GetOfferConsensusString);
+}
+
+/** Records, that a DEx accept is about to be added, modified or removed. */
+void UpdateStateHashAccept(const std::string& key)
+{
+    EraseChangedEntry(my_accepts, key, setChangedAccepts, acceptsStateHash, GetAcceptConsensusString);
+}
+
+/** Records, that a crowdsale is about to be added, modified or removed. */
+void UpdateStateHashCrowd(const std::string& key)
+{
+    EraseChangedEntry(my_crowds, key, setChangedCrowds, crowdsStateHash, GetCrowdConsensusString);
+}
+
+/** Hashes the DEx offers, accepts and crowdsales from scratch, when the state hash is obtained next time. */
+void ResetStateHashDExAndCrowdsales()
+{
+    fRehashDExAndCrowdsales = true;
+    setChangedOffers.clear();
+    setChangedAccepts.clear();
+    setChangedCrowds.clear();
+}
+
+/** Hashes all balances from scratch, in the same way as the incremental state hash. */
+static CMPMultisetHash GetBalancesMultisetHash()
+{
+    CMPMultisetHash balances;
+    for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        CMPTally& tally = it->second;
+        tally.init();
+        uint32_t propertyId = 0;
+        while (0 != (propertyId = tally.next())) {
+            balances.Replace("", GenerateConsensusString(tally, it->first, propertyId));
+        }
+    }
+    return balances;
+}
+
+/** Hashes the DEx offers, accepts and active crowdsales from scratch. */
+static void GetDExAndCrowdsaleMultisetHashes(CMPMultisetHash& offers, CMPMultisetHash& accepts, CMPMultisetHash& crowds)
+{
+    for (OfferMap::const_iterator it = my_offers.begin(); it != my_offers.end(); ++it) {
+        offers.Insert(GetOfferConsensusString(*it));
+    }
+    for (AcceptMap::const_iterator it = my_accepts.begin(); it != my_accepts.end(); ++it) {
+        accepts.Insert(GetAcceptConsensusString(*it));
+    }
+    for (CrowdMap::const_iterator it = my_crowds.begin(); it != my_crowds.end(); ++it) {
+        crowds.Insert(GetCrowdConsensusString(*it));
+    }
+}
+
+/** Brings the hashes of the DEx offers, accepts and crowdsales up to date. */
+static void UpdateDExAndCrowdsaleHashes()
+{
+    if (fRehashDExAndCrowdsales) {
+        offersStateHash.Clear();
+        acceptsStateHash.Clear();
+        crowdsStateHash.Clear();
+        GetDExAndCrowdsaleMultisetHashes(offersStateHash, acceptsStateHash, crowdsStateHash);
+        fRehashDExAndCrowdsales = false;
+        return;
+    }
+
+    InsertChangedEntries(my_offers, setChangedOffers, offersStateHash, GetOfferConsensusString);
+    InsertChangedEntries(my_accepts, setChangedAccepts, acceptsStateHash, GetAcceptConsensusString);
+    InsertChangedEntries(my_crowds, setChangedCrowds, crowdsStateHash, GetCrowdConsensusString);
+}
+
+/** Combines the hashes of all parts of the state. */
+static uint256 CombineStateHash(const CMPMultisetHash& balances, const CMPMultisetHash& offers,
+        const CMPMultisetHash& accepts, const CMPMultisetHash& crowds, const CMPMultisetHash& issuers)
+{
+    CSHA256 hasher;
+    const CMPMultisetHash* parts[] = {&balances, &offers, &accepts, &crowds, &issuers};
+    for (const CMPMultisetHash* part : parts) {
+        uint256 partHash = part->GetHash();
+        hasher.Write(partHash.begin(), partHash.size());
+    }
+
+    uint256 stateHash;
+    hasher.Finalize(stateHash.begin());
+
+    return stateHash;
+}
+
+/**
+ * Obtains the incrementally maintained hash of the state.
+ *
+ * The state hash covers the same data as the consensus hash: balances, DEx
+ * offers, DEx accepts, crowdsales and property issuers, formatted with the
+ * same consensus strings. Each part is hashed as a multiset, so it does not
+ * depend on any order, and the hashes of the parts are hashed together.
+ *
+ * Every part is updated with each change, so obtaining the hash does not
+ * require to sort the tally map, to iterate over the DEx and crowdsales, or
+ * to load every property from the database.
+ *
+ * The state hash is only available with -omnistatehash, and it does not
+ * replace the consensus hash.
+ */
+uint256 GetStateHash()
+{
+    LOCK(cs_tally);
+
+    UpdateDExAndCrowdsaleHashes();
+
+    return CombineStateHash(balancesStateHash, offersStateHash, acceptsStateHash, crowdsStateHash, pDbSpInfo->getIssuersHash());
+}
+
+/**
+ * Compares the incremental state hash with a recomputed one at checkpoint heights.
+ *
+ * Only enabled with -omnistatehashcheck. Mismatches are logged and the
+ * incremental hashes are replaced by the recomputed ones.
+ *
+ * @param block  The height of the block
+ * @return True, if the hashes match, or if there was nothing to check
+ */
+bool VerifyStateHash(int block)
+{
+    if (!fOmniStateHash || !fOmniStateHashCheck) {
+        return true;
+    }
+
+    bool fCheckpoint = false;
+    const std::vector<ConsensusCheckpoint>& vCheckpoints = ConsensusParams().GetCheckpoints();
+    for (std::vector<ConsensusCheckpoint>::const_iterator it = vCheckpoints.begin(); it != vCheckpoints.end(); ++it) {
+        if (it->blockHeight == block) {
+            fCheckpoint = true;
+            break;
+        }
+    }
+    if (!fCheckpoint) {
+        return true;
+    }
+
+    LOCK(cs_tally);
+
+    UpdateDExAndCrowdsaleHashes();
+
+    CMPMultisetHash balances = GetBalancesMultisetHash();
+    CMPMultisetHash offers;
+    CMPMultisetHash accepts;
+    CMPMultisetHash crowds;
+    GetDExAndCrowdsaleMultisetHashes(offers, accepts, crowds);
+    CMPMultisetHash issuers = pDbSpInfo->computeIssuersHash();
+    uint256 stateHash = CombineStateHash(balancesStateHash, offersStateHash, acceptsStateHash, crowdsStateHash, pDbSpInfo->getIssuersHash());
+    uint256 expectedHash = CombineStateHash(balances, offers, accepts, crowds, issuers);
+
+    PrintToLog("%s(): block %d, state hash %s\n", __func__, block, stateHash.GetHex());
+
+    if (stateHash != expectedHash) {
+        PrintToLog("%s(): ERROR: state hash mismatch at block %d - expected %s, maintained %s (balances %s, offers %s, accepts %s, crowdsales %s, issuers %s)\n",
+                __func__, block, expectedHash.GetHex(), stateHash.GetHex(),
+                (balances == balancesStateHash) ? "ok" : "mismatch",
+                (offers == offersStateHash) ? "ok" : "mismatch",
+                (accepts == acceptsStateHash) ? "ok" : "mismatch",
+                (crowds == crowdsStateHash) ? "ok" : "mismatch",
+                (issuers == pDbSpInfo->getIssuersHash()) ? "ok" : "mismatch");
+        balancesStateHash = balances;
+        offersStateHash = offers;
+        acceptsStateHash = accepts;
+        crowdsStateHash = crowds;
+        pDbSpInfo->resetIssuersHash();
+        return false;
+    }
+
+    return true;
+}
+
 } // namespace mastercore
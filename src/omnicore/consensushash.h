@@ -1,10 +1,59 @@
 #ifndef BITCOIN_OMNICORE_CONSENSUSHASH_H
 #define BITCOIN_OMNICORE_CONSENSUSHASH_H
 
+#include <crypto/muhash.h>
 #include <uint256.h>
 
+#include <stdint.h>
+#include <string>
+
+class CMPTally;
+
+/** Order-independent hash of a multiset of strings.
+ *
+ * The hash is a MuHash3072 of all elements, so elements can be inserted and
+ * erased in any order with constant cost. Obtaining the hash requires one
+ * modular inversion.
+ */
+class CMPMultisetHash
+{
+private:
+    //! Product of the inserted elements, divided by the erased ones
+    MuHash3072 muhash;
+
+public:
+    /** Adds an element to the multiset. */
+    void Insert(const std::string& element);
+
+    /** Removes an element from the multiset. */
+    void Erase(const std::string& element);
+
+    /** Replaces an element, empty strings are not part of the multiset. */
+    void Replace(const std::string& before, const std::string& after);
+
+    /** Removes all elements. */
+    void Clear() { muhash = MuHash3072(); }
+
+    /** Returns the hash of the multiset. */
+    uint256 GetHash() const;
+
+    bool operator==(const CMPMultisetHash& rhs) const { return GetHash() == rhs.GetHash(); }
+    bool operator!=(const CMPMultisetHash& rhs) const { return GetHash() != rhs.GetHash(); }
+};
+
 namespace mastercore
 {
+//! Whether the incremental state hash is maintained
+extern bool fOmniStateHash;
+//! Whether the incremental state hash is compared with a recomputed one at checkpoint heights
+extern bool fOmniStateHashCheck;
+
+/** Generates a consensus string for hashing based on a tally object. */
+std::string GenerateConsensusString(const CMPTally& tallyObj, const std::string& address, const uint32_t propertyId);
+
+/** Generates a consensus string for hashing based on a property issuer. */
+std::string GenerateConsensusString(const uint32_t propertyId, const std::string& address);
+
 /** Checks if a given block should be consensus hashed. */
 bool ShouldConsensusHashBlock(int block);
 
@@ -14,6 +63,30 @@ uint256 GetConsensusHash();
 /** Obtains a hash of the balances for a specific property. */
 uint256 GetBalancesHash(const uint32_t hashPropertyId);
 
+/** Updates the balances of the incremental state hash. */
+void UpdateStateHashBalance(const std::string& before, const std::string& after);
+
+/** Removes all balances from the incremental state hash. */
+void ClearStateHashBalances();
+
+/** Records, that a DEx offer is about to be added, modified or removed. */
+void UpdateStateHashOffer(const std::string& key);
+
+/** Records, that a DEx accept is about to be added, modified or removed. */
+void UpdateStateHashAccept(const std::string& key);
+
+/** Records, that a crowdsale is about to be added, modified or removed. */
+void UpdateStateHashCrowd(const std::string& key);
+
+/** Hashes the DEx offers, accepts and crowdsales from scratch, when the state hash is obtained next time. */
+void ResetStateHashDExAndCrowdsales();
+
+/** Obtains the incrementally maintained, order-independent hash of the state. */
+uint256 GetStateHash();
+
+/** Compares the incremental state hash with a recomputed one at checkpoint heights. */
+bool VerifyStateHash(int block);
+
 }
 
 #endif // BITCOIN_OMNICORE_CONSENSUSHASH_H
@@ -0,0 +1,74 @@
+#include <omnicore/dbaddressindex.h>
+
+#include <omnicore/log.h>
+
+#include <fs.h>
+#include <uint256.h>
+
+#include <leveldb/status.h>
+#include <leveldb/write_batch.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+CMPAddressIndex::CMPAddressIndex(const fs::path& path, bool fWipe) : CMPTxIndex(path, fWipe, 'a', "address index")
+{
+}
+
+CMPAddressIndex::~CMPAddressIndex()
+{
+    if (msc_debug_persistence) PrintToLog("CMPAddressIndex closed\n");
+}
+
+/**
+ * Records a transaction for the sender, and the reference address, if any.
+ *
+ * If the sender is also the reference, the transaction is recorded once with both roles.
+ */
+void CMPAddressIndex::recordTransaction(const uint256& txid, int block, uint32_t position, const std::string& sender, const std::string& reference)
+{
+    if (!pdb) return;
+
+    leveldb::WriteBatch batch;
+    Entry entry;
+    entry.txid = txid;
+
+    if (!sender.empty()) {
+        entry.roles = ROLE_SENDER;
+        if (sender == reference) entry.roles |= ROLE_REFERENCE;
+        putRecord(batch, sender, block, position, EncodeRecord(entry));
+    }
+    if (!reference.empty() && reference != sender) {
+        entry.roles = ROLE_REFERENCE;
+        putRecord(batch, reference, block, position, EncodeRecord(entry));
+    }
+
+    leveldb::Status status = writeBatch(batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR: failed to index %s: %s\n", __func__, txid.GetHex(), status.ToString());
+    }
+}
+
+/**
+ * Returns the transactions of an address, ordered by block and position.
+ */
+std::vector<CMPAddressIndex::Entry> CMPAddressIndex::getTransactions(const std::string& address, int startBlock, uint32_t startPosition, int endBlock, size_t nCount)
+{
+    std::vector<Entry> entries;
+    for (const Record& record : getRecords(address, startBlock, startPosition, endBlock, nCount)) {
+        Entry entry;
+        if (!DecodeRecord(record.value, entry)) {
+            PrintToLog("%s(): ERROR: unexpected record of %s in block %d\n", __func__, address, record.block);
+            continue;
+        }
+        entry.address = address;
+        entry.block = record.block;
+        entry.position = record.position;
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
@@ -0,0 +1,86 @@
+#ifndef BITCOIN_OMNICORE_DBADDRESSINDEX_H
+#define BITCOIN_OMNICORE_DBADDRESSINDEX_H
+
+#include <omnicore/dbtxindex.h>
+
+#include <fs.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+//! Default for -omniaddressindex
+static const bool DEFAULT_OMNI_ADDRESS_INDEX = false;
+
+/** LevelDB based index of the Omni transactions of each address.
+ *
+ * The index is optional, and each transaction is stored under two keys, so
+ * that the transactions of an address can be listed in order, and the
+ * transactions of disconnected blocks can be removed:
+ *
+ *   a|address|block|position -> txid, roles
+ *   b|block|position|address -> (empty)
+ *
+ * Blocks and positions are zero padded, so that transactions are ordered by
+ * block and position within the block, see CMPTxIndex.
+ */
+class CMPAddressIndex : public CMPTxIndex
+{
+public:
+    //! Roles of an address within a transaction, which can be combined
+    enum Role : uint8_t
+    {
+        ROLE_SENDER = 1,
+        ROLE_REFERENCE = 2,
+    };
+
+    /** Transaction, which involved an address. */
+    struct Entry
+    {
+        //! Address, block and position are part of the key, and therefore not serialized
+        std::string address;
+        int block;
+        uint32_t position;
+        uint256 txid;
+        uint8_t roles;
+
+        Entry() : block(0), position(0), roles(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(txid);
+            READWRITE(roles);
+        }
+    };
+
+    CMPAddressIndex(const fs::path& path, bool fWipe);
+    virtual ~CMPAddressIndex();
+
+    /** Records a transaction for the sender, and the reference address, if any. */
+    void recordTransaction(const uint256& txid, int block, uint32_t position, const std::string& sender, const std::string& reference);
+
+    /**
+     * Returns the transactions of an address, ordered by block and position.
+     *
+     * @param address        The address
+     * @param startBlock     The block of the first transaction to include
+     * @param startPosition  The position of the first transaction to include within the start block
+     * @param endBlock       The last block to include
+     * @param nCount         The maximal number of transactions to return
+     */
+    std::vector<Entry> getTransactions(const std::string& address, int startBlock, uint32_t startPosition, int endBlock, size_t nCount);
+};
+
+namespace mastercore
+{
+    //! LevelDB based index of the transactions of each address, if enabled
+    extern CMPAddressIndex* pDbAddressIndex;
+}
+
+#endif // BITCOIN_OMNICORE_DBADDRESSINDEX_H
@@ -3,13 +3,425 @@
 #include <omnicore/log.h>
 
 #include <fs.h>
+#include <sync.h>
 #include <util/system.h>
 
+#include <leveldb/cache.h>
 #include <leveldb/db.h>
+#include <leveldb/filter_policy.h>
+#include <leveldb/iterator.h>
 #include <leveldb/write_batch.h>
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+//! Block cache shared by the databases opened after configuration, if any
+std::shared_ptr<leveldb::Cache> g_block_cache;
+//! Capacity of the shared block cache in bytes
+size_t g_block_cache_size = 0;
+//! Filter policy used by the databases opened after configuration, if any
+std::shared_ptr<const leveldb::FilterPolicy> g_filter_policy;
+//! Whether checksums are verified, when values are looked up
+bool g_verify_checksums = DEFAULT_OMNI_DB_CHECKSUMS;
+
+/** Pending value of a key, where a deleted key has no value. */
+struct PendingValue
+{
+    bool fDeleted;
+    std::string value;
+};
+
+typedef std::map<std::string, PendingValue> PendingMap;
+
+/**
+ * Iterator, which merges the pending writes of a batch into an iterator of the database.
+ *
+ * The pending writes are a snapshot, taken when the iterator was created, and writes
+ * to the database, while iterating, are not visible, just like with LevelDB iterators.
+ */
+class CMergingIterator : public leveldb::Iterator
+{
+private:
+    //! Iterator of the underlying database
+    leveldb::Iterator* pbase;
+    //! Pending writes, which shadow the values of the underlying database
+    std::shared_ptr<const PendingMap> pending;
+    //! Current position in the pending writes, or the end, if exhausted
+    PendingMap::const_iterator itPending;
+    //! Whether the current entry is a pending write
+    bool fPending;
+    //! Whether the current entry shadows the current entry of the underlying database
+    bool fShadowed;
+    //! Whether the iterator was moved forwards last
+    bool fForward;
+    //! Whether the iterator is positioned at an entry
+    bool fValid;
+
+    /** Moves to the first visible entry at or after the current positions. */
+    void FindNext()
+    {
+        fForward = true;
+        while (true) {
+            bool fBaseValid = pbase->Valid();
+            bool fPendingValid = itPending != pending->end();
+            if (!fBaseValid && !fPendingValid) {
+                fValid = false;
+                return;
+            }
+            int cmp = !fPendingValid ? 1 : (!fBaseValid ? -1 : leveldb::Slice(itPending->first).compare(pbase->key()));
+            if (cmp > 0) {
+                fPending = false;
+                fShadowed = false;
+                fValid = true;
+                return;
+            }
+            if (itPending->second.fDeleted) {
+                ++itPending;
+                if (cmp == 0) pbase->Next();
+                continue;
+            }
+            fPending = true;
+            fShadowed = (cmp == 0);
+            fValid = true;
+            return;
+        }
+    }
+
+    /** Moves to the last visible entry at or before the current positions. */
+    void FindPrev()
+    {
+        fForward = false;
+        while (true) {
+            bool fBaseValid = pbase->Valid();
+            bool fPendingValid = itPending != pending->end();
+            if (!fBaseValid && !fPendingValid) {
+                fValid = false;
+                return;
+            }
+            int cmp = !fPendingValid ? -1 : (!fBaseValid ? 1 : leveldb::Slice(itPending->first).compare(pbase->key()));
+            if (cmp < 0) {
+                fPending = false;
+                fShadowed = false;
+                fValid = true;
+                return;
+            }
+            if (itPending->second.fDeleted) {
+                PrevPending();
+                if (cmp == 0) pbase->Prev();
+                continue;
+            }
+            fPending = true;
+            fShadowed = (cmp == 0);
+            fValid = true;
+            return;
+        }
+    }
+
+    /** Moves the position in the pending writes backwards, or to the end, if exhausted. */
+    void PrevPending()
+    {
+        if (itPending == pending->begin()) {
+            itPending = pending->end();
+        } else {
+            --itPending;
+        }
+    }
+
+public:
+    CMergingIterator(leveldb::Iterator* it, std::shared_ptr<const PendingMap> writes)
+      : pbase(it), pending(std::move(writes)), itPending(pending->end()),
+        fPending(false), fShadowed(false), fForward(true), fValid(false) {}
+
+    ~CMergingIterator()
+    {
+        delete pbase;
+    }
+
+    bool Valid() const override { return fValid; }
+
+    void SeekToFirst() override
+    {
+        pbase->SeekToFirst();
+        itPending = pending->begin();
+        FindNext();
+    }
+
+    void SeekToLast() override
+    {
+        pbase->SeekToLast();
+        itPending = pending->end();
+        PrevPending();
+        FindPrev();
+    }
+
+    void Seek(const leveldb::Slice& target) override
+    {
+        pbase->Seek(target);
+        itPending = pending->lower_bound(target.ToString());
+        FindNext();
+    }
+
+    void Next() override
+    {
+        assert(fValid);
+        if (!fForward) {
+            // reposition both iterators after the current key
+            const std::string strKey = key().ToString();
+            pbase->Seek(strKey);
+            if (pbase->Valid() && pbase->key() == leveldb::Slice(strKey)) pbase->Next();
+            itPending = pending->upper_bound(strKey);
+        } else if (fPending) {
+            ++itPending;
+            if (fShadowed) pbase->Next();
+        } else {
+            pbase->Next();
+        }
+        FindNext();
+    }
+
+    void Prev() override
+    {
+        assert(fValid);
+        // reposition both iterators before the current key
+        const std::string strKey = key().ToString();
+        pbase->Seek(strKey);
+        if (pbase->Valid()) {
+            pbase->Prev();
+        } else {
+            pbase->SeekToLast();
+        }
+        itPending = pending->lower_bound(strKey);
+        PrevPending();
+        FindPrev();
+    }
+
+    leveldb::Slice key() const override
+    {
+        assert(fValid);
+        return fPending ? leveldb::Slice(itPending->first) : pbase->key();
+    }
+
+    leveldb::Slice value() const override
+    {
+        assert(fValid);
+        return fPending ? leveldb::Slice(itPending->second.value) : pbase->value();
+    }
+
+    leveldb::Status status() const override
+    {
+        return pbase->status();
+    }
+};
+
+/**
+ * Database, which either writes through to LevelDB, or collects the writes during a block.
+ *
+ * The collected writes are kept as batch, which is written at once, and as sorted map,
+ * which is used to answer lookups and iterations, before the batch is committed.
+ */
+class CBlockBatchDB : public leveldb::DB
+{
+private:
+    //! The underlying database
+    leveldb::DB* pbase;
+    //! Name of the database directory
+    std::string name;
+    //! Number of lookups
+    std::atomic<uint64_t> nReads;
+    //! Number of write operations
+    std::atomic<uint64_t> nWrites;
+    //! Guards the pending writes
+    mutable CCriticalSection cs_batch;
+    //! Whether writes are collected
+    bool fActive;
+    //! Whether one of the collected writes was requested to be synchronized
+    bool fSync;
+    //! Collected writes, in the order they were made
+    leveldb::WriteBatch batch;
+    //! Collected writes by key, shared with iterators, and copied when modified while shared
+    std::shared_ptr<PendingMap> pending;
+
+    /** Returns the pending writes, which are safe to modify. */
+    PendingMap& MutablePending()
+    {
+        if (pending.use_count() > 1) {
+            pending = std::make_shared<PendingMap>(*pending);
+        }
+        return *pending;
+    }
+
+    /** Adds the entries of a batch to the pending writes. */
+    class CBatchCollector : public leveldb::WriteBatch::Handler
+    {
+    public:
+        CBlockBatchDB& db;
+        explicit CBatchCollector(CBlockBatchDB& dbIn) : db(dbIn) {}
+
+        void Put(const leveldb::Slice& key, const leveldb::Slice& value) override
+        {
+            db.batch.Put(key, value);
+            db.MutablePending()[key.ToString()] = PendingValue{false, value.ToString()};
+        }
+
+        void Delete(const leveldb::Slice& key) override
+        {
+            db.batch.Delete(key);
+            db.MutablePending()[key.ToString()] = PendingValue{true, std::string()};
+        }
+    };
+
+public:
+    CBlockBatchDB(leveldb::DB* db, const std::string& nameIn)
+      : pbase(db), name(nameIn), nReads(0), nWrites(0), fActive(false), fSync(false),
+        pending(std::make_shared<PendingMap>()) {}
+
+    ~CBlockBatchDB();
+
+    /** Returns the usage statistics of the database. */
+    DBUsage GetUsage()
+    {
+        DBUsage usage;
+        usage.name = name;
+        usage.nReads = nReads;
+        usage.nWrites = nWrites;
+
+        // all keys start with a printable prefix, or are hex strings
+        leveldb::Range range(leveldb::Slice(), leveldb::Slice("\xff\xff\xff\xff"));
+        pbase->GetApproximateSizes(&range, 1, &usage.nDiskSize);
+
+        std::string strMemory;
+        usage.nMemoryUsage = 0;
+        if (pbase->GetProperty("leveldb.approximate-memory-usage", &strMemory)) {
+            usage.nMemoryUsage = std::stoull(strMemory);
+            // the shared block cache is reported separately
+            if (g_block_cache) {
+                size_t nCacheUsage = g_block_cache->TotalCharge();
+                usage.nMemoryUsage = usage.nMemoryUsage > nCacheUsage ? usage.nMemoryUsage - nCacheUsage : 0;
+            }
+        }
+        return usage;
+    }
+
+    /** Starts to collect writes, and commits the ones collected before, if any. */
+    leveldb::Status Begin()
+    {
+        LOCK(cs_batch);
+        leveldb::Status status = Commit();
+        fActive = true;
+        return status;
+    }
+
+    /** Writes the collected writes at once, and stops collecting writes. */
+    leveldb::Status Commit(size_t* pnWritten = nullptr)
+    {
+        LOCK(cs_batch);
+        leveldb::Status status;
+        if (!pending->empty()) {
+            leveldb::WriteOptions options;
+            options.sync = fSync;
+            status = pbase->Write(options, &batch);
+            if (pnWritten) *pnWritten += pending->size();
+        }
+        batch.Clear();
+        pending = std::make_shared<PendingMap>();
+        fActive = false;
+        fSync = false;
+        return status;
+    }
+
+    leveldb::Status Put(const leveldb::WriteOptions& options, const leveldb::Slice& key, const leveldb::Slice& value) override
+    {
+        LOCK(cs_batch);
+        ++nWrites;
+        if (!fActive) return pbase->Put(options, key, value);
+        fSync |= options.sync;
+        CBatchCollector(*this).Put(key, value);
+        return leveldb::Status::OK();
+    }
+
+    leveldb::Status Delete(const leveldb::WriteOptions& options, const leveldb::Slice& key) override
+    {
+        LOCK(cs_batch);
+        ++nWrites;
+        if (!fActive) return pbase->Delete(options, key);
+        fSync |= options.sync;
+        CBatchCollector(*this).Delete(key);
+        return leveldb::Status::OK();
+    }
+
+    leveldb::Status Write(const leveldb::WriteOptions& options, leveldb::WriteBatch* updates) override
+    {
+        LOCK(cs_batch);
+        ++nWrites;
+        if (!fActive) return pbase->Write(options, updates);
+        fSync |= options.sync;
+        CBatchCollector collector(*this);
+        return updates->Iterate(&collector);
+    }
+
+    leveldb::Status Get(const leveldb::ReadOptions& options, const leveldb::Slice& key, std::string* value) override
+    {
+        ++nReads;
+        {
+            LOCK(cs_batch);
+            auto it = pending->find(key.ToString());
+            if (it != pending->end()) {
+                if (it->second.fDeleted) return leveldb::Status::NotFound(leveldb::Slice());
+                *value = it->second.value;
+                return leveldb::Status::OK();
+            }
+        }
+        return pbase->Get(options, key, value);
+    }
+
+    leveldb::Iterator* NewIterator(const leveldb::ReadOptions& options) override
+    {
+        std::shared_ptr<const PendingMap> writes;
+        {
+            LOCK(cs_batch);
+            if (pending->empty()) return pbase->NewIterator(options);
+            writes = pending;
+        }
+        return new CMergingIterator(pbase->NewIterator(options), writes);
+    }
+
+    const leveldb::Snapshot* GetSnapshot() override { return pbase->GetSnapshot(); }
+    void ReleaseSnapshot(const leveldb::Snapshot* snapshot) override { pbase->ReleaseSnapshot(snapshot); }
+    bool GetProperty(const leveldb::Slice& property, std::string* value) override { return pbase->GetProperty(property, value); }
+    void GetApproximateSizes(const leveldb::Range* range, int n, uint64_t* sizes) override { pbase->GetApproximateSizes(range, n, sizes); }
+    void CompactRange(const leveldb::Slice* begin, const leveldb::Slice* end) override { pbase->CompactRange(begin, end); }
+};
+
+//! Guards the open databases
+CCriticalSection cs_batchdbs;
+//! Databases, which take part in block batches
+std::set<CBlockBatchDB*> setBatchDBs;
+
+CBlockBatchDB::~CBlockBatchDB()
+{
+    {
+        LOCK(cs_batchdbs);
+        setBatchDBs.erase(this);
+    }
+    leveldb::Status status = Commit();
+    if (!status.ok()) {
+        PrintToLog("%s(): failed to commit pending writes: %s\n", __func__, status.ToString());
+    }
+    delete pbase;
+}
+
+} // namespace
+
 /**
  * Opens or creates a LevelDB based database.
  */
@@ -22,7 +434,22 @@ leveldb::Status CDBBase::Open(const fs::path& path, bool fWipe)
     TryCreateDirectories(path);
     if (msc_debug_persistence) PrintToLog("Opening LevelDB in %s\n", path.string());
 
-    return leveldb::DB::Open(options, path.string(), &pdb);
+    pblockcache = g_block_cache;
+    pfilterpolicy = g_filter_policy;
+    options.block_cache = pblockcache.get();
+    options.filter_policy = pfilterpolicy.get();
+    readoptions.verify_checksums = g_verify_checksums;
+
+    leveldb::DB* pbase = NULL;
+    leveldb::Status status = leveldb::DB::Open(options, path.string(), &pbase);
+    if (status.ok()) {
+        CBlockBatchDB* pbatchdb = new CBlockBatchDB(pbase, path.filename().string());
+        pdb = pbatchdb;
+        LOCK(cs_batchdbs);
+        setBatchDBs.insert(pbatchdb);
+    }
+
+    return status;
 }
 
 /**
@@ -62,3 +489,90 @@ void CDBBase::Close()
         pdb = NULL;
     }
 }
+
+/**
+ * Starts to collect the writes to all open databases.
+ */
+bool CDBBase::BeginBlockBatch()
+{
+    bool fSuccess = true;
+
+    LOCK(cs_batchdbs);
+    for (CBlockBatchDB* pbatchdb : setBatchDBs) {
+        leveldb::Status status = pbatchdb->Begin();
+        if (!status.ok()) {
+            PrintToLog("%s(): failed to commit previous block batch: %s\n", __func__, status.ToString());
+            fSuccess = false;
+        }
+    }
+
+    return fSuccess;
+}
+
+/**
+ * Commits the writes collected since BeginBlockBatch().
+ */
+bool CDBBase::CommitBlockBatch()
+{
+    int64_t nTimeStart = GetTimeMicros();
+    bool fSuccess = true;
+    size_t nWritten = 0;
+
+    LOCK(cs_batchdbs);
+    for (CBlockBatchDB* pbatchdb : setBatchDBs) {
+        leveldb::Status status = pbatchdb->Commit(&nWritten);
+        if (!status.ok()) {
+            PrintToLog("%s(): failed to commit block batch: %s\n", __func__, status.ToString());
+            fSuccess = false;
+        }
+    }
+
+    int64_t nTime = GetTimeMicros() - nTimeStart;
+    if (msc_debug_persistence)
+        PrintToLog("Committed %d entries of %d databases [%.3f ms total]\n", nWritten, setBatchDBs.size(), 0.001 * nTime);
+
+    return fSuccess;
+}
+
+/**
+ * Configures the databases, which are opened afterwards.
+ */
+void CDBBase::Configure(size_t nCacheSize, bool fBloomFilter, bool fVerifyChecksums)
+{
+    g_block_cache.reset(nCacheSize > 0 ? leveldb::NewLRUCache(nCacheSize) : nullptr);
+    g_block_cache_size = nCacheSize;
+    g_filter_policy.reset(fBloomFilter ? leveldb::NewBloomFilterPolicy(10) : nullptr);
+    g_verify_checksums = fVerifyChecksums;
+
+    PrintToLog("Using a %.1f MiB block cache for the Omni databases, bloom filter: %s, verify checksums: %s\n",
+        nCacheSize * (1.0 / 1024 / 1024), fBloomFilter ? "yes" : "no", fVerifyChecksums ? "yes" : "no");
+}
+
+/**
+ * Returns the usage statistics of all open databases.
+ */
+std::vector<DBUsage> CDBBase::GetUsage()
+{
+    std::vector<DBUsage> vUsage;
+
+    LOCK(cs_batchdbs);
+    for (CBlockBatchDB* pbatchdb : setBatchDBs) {
+        vUsage.push_back(pbatchdb->GetUsage());
+    }
+    std::sort(vUsage.begin(), vUsage.end(), [](const DBUsage& a, const DBUsage& b) { return a.name < b.name; });
+
+    return vUsage;
+}
+
+/**
+ * Returns the size and the used bytes of the shared block cache.
+ */
+void CDBBase::GetCacheUsage(size_t& nCacheSize, size_t& nCacheUsage)
+{
+    nCacheSize = 0;
+    nCacheUsage = 0;
+    if (g_block_cache) {
+        nCacheSize = g_block_cache_size;
+        nCacheUsage = g_block_cache->TotalCharge();
+    }
+}
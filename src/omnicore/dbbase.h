@@ -3,10 +3,44 @@
 
 #include <leveldb/db.h>
 
+#include <clientversion.h>
 #include <fs.h>
+#include <serialize.h>
+#include <streams.h>
 
 #include <assert.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+//! Version of the binary record format, stored as first byte of each record
+static const unsigned char DB_RECORD_FORMAT = 0x01;
+
+//! Default for -omnidbcache, the size of the block cache shared by the Omni databases in MiB
+static const int64_t DEFAULT_OMNI_DB_CACHE = 16;
+//! Default for -omnidbbloomfilter, whether the databases use bloom filters for lookups
+static const bool DEFAULT_OMNI_DB_BLOOM_FILTER = false;
+//! Default for -omnidbchecksums, whether checksums are verified, when values are looked up
+static const bool DEFAULT_OMNI_DB_CHECKSUMS = true;
+
+/** Usage statistics of a database, since it was opened. */
+struct DBUsage
+{
+    //! Name of the database directory
+    std::string name;
+    //! Number of lookups
+    uint64_t nReads;
+    //! Number of write operations, where a batch counts as one
+    uint64_t nWrites;
+    //! Approximate size on disk in bytes
+    uint64_t nDiskSize;
+    //! Approximate memory used by the database in bytes, without the shared block cache
+    uint64_t nMemoryUsage;
+};
 
 /** Base class for LevelDB based storage.
  */
@@ -16,6 +50,12 @@ private:
     //! Options used when iterating over values of the database
     leveldb::ReadOptions iteroptions;
 
+    //! Block cache, which is kept alive as long as the database uses it
+    std::shared_ptr<leveldb::Cache> pblockcache;
+
+    //! Filter policy, which is kept alive as long as the database uses it
+    std::shared_ptr<const leveldb::FilterPolicy> pfilterpolicy;
+
 protected:
     //! Database options used
     leveldb::Options options;
@@ -73,7 +113,8 @@ protected:
      * Opens or creates a LevelDB based database.
      *
      * If the database is wiped before opening, it's content is destroyed, including
-     * all log files and meta data.
+     * all log files and meta data. The database uses the block cache, filter policy
+     * and checksum verification configured with Configure().
      *
      * @param path   The path of the database to open
      * @param fWipe  Whether to wipe the database before opening
@@ -91,6 +132,79 @@ public:
      * Deletes all entries of the database, and resets the counters.
      */
     void Clear();
+
+    /**
+     * Starts to collect the writes to all open databases, instead of writing them
+     * one by one, until the batch is committed.
+     *
+     * Lookups and iterators of the databases include the collected writes. Writes
+     * collected by a previous batch, which was not committed, are committed first.
+     *
+     * @return False, if the writes of a previous batch couldn't be committed to one of the databases
+     */
+    static bool BeginBlockBatch();
+
+    /**
+     * Commits the writes collected since BeginBlockBatch(), with one synchronized
+     * write per database, and writes directly to the databases afterwards.
+     *
+     * @return False, if the writes couldn't be committed to one of the databases
+     */
+    static bool CommitBlockBatch();
+
+    /**
+     * Configures the databases, which are opened afterwards.
+     *
+     * @param nCacheSize        The size of the block cache shared by all databases in bytes, or 0 to use a default cache per database
+     * @param fBloomFilter      Whether to use bloom filters to skip lookups of missing keys
+     * @param fVerifyChecksums  Whether to verify checksums, when values are looked up
+     */
+    static void Configure(size_t nCacheSize, bool fBloomFilter, bool fVerifyChecksums);
+
+    /**
+     * Returns the usage statistics of all open databases.
+     */
+    static std::vector<DBUsage> GetUsage();
+
+    /**
+     * Returns the size and the used bytes of the block cache shared by all databases.
+     */
+    static void GetCacheUsage(size_t& nCacheSize, size_t& nCacheUsage);
+
+    /**
+     * Serializes a record, prefixed with the version of the record format.
+     *
+     * Records stored before the binary format was introduced are colon-separated
+     * strings, and therefore never start with the version byte.
+     */
+    template <typename T>
+    static std::string EncodeRecord(const T& record)
+    {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << DB_RECORD_FORMAT;
+        ssValue << record;
+        return std::string(ssValue.begin(), ssValue.end());
+    }
+
+    /**
+     * Deserializes a record, which was serialized with EncodeRecord().
+     *
+     * @return False, if the value is not a record of the expected type
+     */
+    template <typename T>
+    static bool DecodeRecord(const std::string& strValue, T& record)
+    {
+        if (strValue.empty() || strValue[0] != DB_RECORD_FORMAT) {
+            return false;
+        }
+        try {
+            CDataStream ssValue(strValue.data() + 1, strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> record;
+            return ssValue.empty();
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
 };
 
 
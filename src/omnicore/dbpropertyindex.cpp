@@ -0,0 +1,76 @@
+#include <omnicore/dbpropertyindex.h>
+
+#include <omnicore/log.h>
+
+#include <fs.h>
+#include <tinyformat.h>
+#include <uint256.h>
+
+#include <leveldb/status.h>
+#include <leveldb/write_batch.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+namespace
+{
+/** Returns the subject of the transactions of a property, zero padded to order them by property. */
+std::string PropertySubject(uint32_t propertyId)
+{
+    return strprintf("%010u", propertyId);
+}
+} // anonymous namespace
+
+CMPPropertyIndex::CMPPropertyIndex(const fs::path& path, bool fWipe) : CMPTxIndex(path, fWipe, 'p', "property index")
+{
+}
+
+CMPPropertyIndex::~CMPPropertyIndex()
+{
+    if (msc_debug_persistence) PrintToLog("CMPPropertyIndex closed\n");
+}
+
+/**
+ * Records a transaction of a property.
+ */
+void CMPPropertyIndex::recordTransaction(uint32_t propertyId, int block, uint32_t position, const uint256& txid, uint32_t type, uint64_t amount, bool fValid)
+{
+    if (!pdb) return;
+
+    Entry entry;
+    entry.txid = txid;
+    entry.type = type;
+    entry.amount = amount;
+    entry.fValid = fValid;
+
+    leveldb::WriteBatch batch;
+    putRecord(batch, PropertySubject(propertyId), block, position, EncodeRecord(entry));
+    leveldb::Status status = writeBatch(batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR: failed to index %s: %s\n", __func__, txid.GetHex(), status.ToString());
+    }
+}
+
+/**
+ * Returns the transactions of a property, ordered by block and position.
+ */
+std::vector<CMPPropertyIndex::Entry> CMPPropertyIndex::getTransactions(uint32_t propertyId, int startBlock, uint32_t startPosition, int endBlock, size_t nCount)
+{
+    std::vector<Entry> entries;
+    for (const Record& record : getRecords(PropertySubject(propertyId), startBlock, startPosition, endBlock, nCount)) {
+        Entry entry;
+        if (!DecodeRecord(record.value, entry)) {
+            PrintToLog("%s(): ERROR: unexpected record of property %d in block %d\n", __func__, propertyId, record.block);
+            continue;
+        }
+        entry.propertyId = propertyId;
+        entry.block = record.block;
+        entry.position = record.position;
+        entries.push_back(entry);
+    }
+
+    return entries;
+}
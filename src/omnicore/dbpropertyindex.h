@@ -0,0 +1,83 @@
+#ifndef BITCOIN_OMNICORE_DBPROPERTYINDEX_H
+#define BITCOIN_OMNICORE_DBPROPERTYINDEX_H
+
+#include <omnicore/dbtxindex.h>
+
+#include <fs.h>
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+//! Default for -omnipropertyindex
+static const bool DEFAULT_OMNI_PROPERTY_INDEX = false;
+
+/** LevelDB based index of the Omni transactions of each property.
+ *
+ * The index is optional, and each transaction is stored under two keys, so that the transactions of a
+ * property can be listed in order, and the transactions of disconnected
+ * blocks can be removed:
+ *
+ *   p|property|block|position -> txid, type, amount, validity
+ *   b|block|position|property -> (empty)
+ *
+ * Properties, blocks and positions are zero padded, so that transactions are
+ * ordered by block and position within the block, see CMPTxIndex.
+ */
+class CMPPropertyIndex : public CMPTxIndex
+{
+public:
+    /** Transaction of a property. */
+    struct Entry
+    {
+        //! Property, block and position are part of the key, and therefore not serialized
+        uint32_t propertyId;
+        int block;
+        uint32_t position;
+        uint256 txid;
+        uint32_t type;
+        uint64_t amount;
+        bool fValid;
+
+        Entry() : propertyId(0), block(0), position(0), type(0), amount(0), fValid(false) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(txid);
+            READWRITE(VARINT(type));
+            READWRITE(VARINT(amount));
+            READWRITE(fValid);
+        }
+    };
+
+    CMPPropertyIndex(const fs::path& path, bool fWipe);
+    virtual ~CMPPropertyIndex();
+
+    /** Records a transaction of a property. */
+    void recordTransaction(uint32_t propertyId, int block, uint32_t position, const uint256& txid, uint32_t type, uint64_t amount, bool fValid);
+
+    /**
+     * Returns the transactions of a property, ordered by block and position.
+     *
+     * @param propertyId     The property
+     * @param startBlock     The block of the first transaction to include
+     * @param startPosition  The position of the first transaction to include within the start block
+     * @param endBlock       The last block to include
+     * @param nCount         The maximal number of transactions to return
+     */
+    std::vector<Entry> getTransactions(uint32_t propertyId, int startBlock, uint32_t startPosition, int endBlock, size_t nCount);
+};
+
+namespace mastercore
+{
+    //! LevelDB based index of the transactions of each property, if enabled
+    extern CMPPropertyIndex* pDbPropertyIndex;
+}
+
+#endif // BITCOIN_OMNICORE_DBPROPERTYINDEX_H
@@ -1,5 +1,6 @@
 #include <omnicore/dbspinfo.h>
 
+#include <omnicore/consensushash.h>
 #include <omnicore/dbbase.h>
 #include <omnicore/log.h>
 
@@ -17,8 +18,81 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <map>
+#include <set>
 #include <string>
+#include <utility>
+#include <vector>
 
+/** Returns whether a property of the given type is divisible. */
+static bool IsDivisibleType(uint16_t prop_type)
+{
+    switch (prop_type) {
+        case MSC_PROPERTY_TYPE_DIVISIBLE:
+        case MSC_PROPERTY_TYPE_DIVISIBLE_REPLACING:
+        case MSC_PROPERTY_TYPE_DIVISIBLE_APPENDING:
+            return true;
+    }
+    return false;
+}
+
+/** Returns the DB key of the header record of a property. */
+static std::string HeaderKey(uint32_t propertyId)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair('h', propertyId);
+    return std::string(ssKey.begin(), ssKey.end());
+}
+
+/** Returns the DB key of the historical data of a property, or the prefix of all its records, if no txid is given. */
+static std::string HistoryKey(uint32_t propertyId, const uint256* txid = nullptr)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << 'd' << propertyId;
+    if (txid) ssKey << *txid;
+    return std::string(ssKey.begin(), ssKey.end());
+}
+
+/** Returns the DB key of the properties, which were changed in a block. */
+static std::string TouchedKey(const uint256& blockHash)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << 'u' << blockHash;
+    return std::string(ssKey.begin(), ssKey.end());
+}
+
+/** Adds a property to the properties, which were changed in a block, unless it's already included. */
+static bool AddTouchedProperty(leveldb::DB* pdb, const leveldb::ReadOptions& readoptions, leveldb::WriteBatch& batch, const uint256& blockHash, uint32_t propertyId)
+{
+    const std::string key = TouchedKey(blockHash);
+    std::vector<uint32_t> propertyIds;
+    std::string strValue;
+    if (pdb->Get(readoptions, key, &strValue).ok() && !CDBBase::DecodeRecord(strValue, propertyIds)) {
+        return false;
+    }
+    if (std::find(propertyIds.begin(), propertyIds.end(), propertyId) == propertyIds.end()) {
+        propertyIds.push_back(propertyId);
+        batch.Put(key, CDBBase::EncodeRecord(propertyIds));
+    }
+    return true;
+}
+
+/** Returns the prefix of the DB keys, which revert the historical data of a block. */
+static std::string HistoryUndoPrefix(const uint256& blockHash)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << 'e' << blockHash;
+    return std::string(ssKey.begin(), ssKey.end());
+}
+
+/** Returns the DB key, which reverts the historical data of a transaction. */
+static std::string HistoryUndoKey(const uint256& blockHash, uint32_t propertyId, const uint256& txid)
+{
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << 'e' << blockHash << propertyId << txid;
+    return std::string(ssKey.begin(), ssKey.end());
+}
 
 CMPSPInfo::Entry::Entry()
   : prop_type(0), prev_prop_id(0), num_tokens(0), property_desired(0),
@@ -28,13 +102,7 @@ CMPSPInfo::Entry::Entry()
 
 bool CMPSPInfo::Entry::isDivisible() const
 {
-    switch (prop_type) {
-        case MSC_PROPERTY_TYPE_DIVISIBLE:
-        case MSC_PROPERTY_TYPE_DIVISIBLE_REPLACING:
-        case MSC_PROPERTY_TYPE_DIVISIBLE_APPENDING:
-            return true;
-    }
-    return false;
+    return IsDivisibleType(prop_type);
 }
 
 void CMPSPInfo::Entry::print() const
@@ -86,7 +154,18 @@ std::string CMPSPInfo::Entry::getIssuer(int block) const
     return _issuer;
 }
 
+CMPSPInfo::Header::Header() : prop_type(0), unique(false) {}
+
+CMPSPInfo::Header::Header(const Entry& info)
+  : prop_type(info.prop_type), unique(info.unique), name(info.name), issuer(info.issuer) {}
+
+bool CMPSPInfo::Header::isDivisible() const
+{
+    return IsDivisibleType(prop_type);
+}
+
 CMPSPInfo::CMPSPInfo(const fs::path& path, bool fWipe)
+  : cacheEntries(SP_ENTRY_CACHE_SIZE), cacheHeaders(SP_HEADER_CACHE_SIZE), nCacheGeneration(0)
 {
     leveldb::Status status = Open(path, fWipe);
     PrintToConsole("Loading smart property database: %s\n", status.ToString());
@@ -112,6 +191,8 @@ CMPSPInfo::CMPSPInfo(const fs::path& path, bool fWipe)
     implied_tomni.url = "N/A";
     implied_tomni.data = "Reserved";
 
+    fIssuersHashValid = false;
+
     init();
 }
 
@@ -126,6 +207,21 @@ void CMPSPInfo::Clear()
     CDBBase::Clear();
     // reset "next property identifiers"
     init();
+    // rebuild the issuers hash on next use
+    resetIssuersHash();
+    // drop cached entries
+    LOCK(cs_cache);
+    cacheEntries.clear();
+    cacheHeaders.clear();
+    ++nCacheGeneration;
+}
+
+void CMPSPInfo::uncache(uint32_t propertyId)
+{
+    LOCK(cs_cache);
+    cacheEntries.erase(propertyId);
+    cacheHeaders.erase(propertyId);
+    ++nCacheGeneration;
 }
 
 void CMPSPInfo::init(uint32_t nextSPID, uint32_t nextTestSPID)
@@ -180,18 +276,44 @@ bool CMPSPInfo::updateSP(uint32_t propertyId, const Entry& info)
     leveldb::WriteBatch batch;
     std::string strSpPrevValue;
 
-    // if a value exists move it to the old key
-    if (!pdb->Get(readoptions, slSpKey, &strSpPrevValue).IsNotFound()) {
+    // if a value exists move it to the old key, unless the state before the block was already kept
+    bool fPrevExists = !pdb->Get(readoptions, slSpKey, &strSpPrevValue).IsNotFound();
+    std::string strSpOlderValue;
+    if (fPrevExists && pdb->Get(readoptions, slSpPrevKey, &strSpOlderValue).IsNotFound()) {
         batch.Put(slSpPrevKey, strSpPrevValue);
     }
     batch.Put(slSpKey, slSpValue);
+    batch.Put(HeaderKey(propertyId), EncodeRecord(Header(info)));
+    if (!AddTouchedProperty(pdb, readoptions, batch, info.update_block, propertyId)) {
+        PrintToLog("%s(): ERROR for SP %d: failed to decode properties changed in block %s\n", __func__, propertyId, info.update_block.GetHex());
+        return false;
+    }
     leveldb::Status status = pdb->Write(syncoptions, &batch);
+    uncache(propertyId);
 
     if (!status.ok()) {
         PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
         return false;
     }
 
+    if (fIssuersHashValid) {
+        Entry prevInfo;
+        if (fPrevExists) {
+            try {
+                CDataStream ssValue(strSpPrevValue.data(), strSpPrevValue.data() + strSpPrevValue.size(), SER_DISK, CLIENT_VERSION);
+                ssValue >> prevInfo;
+            } catch (const std::exception& e) {
+                PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, e.what());
+                resetIssuersHash();
+                return true;
+            }
+        }
+        if (fPrevExists) {
+            issuersHash.Erase(mastercore::GenerateConsensusString(propertyId, prevInfo.issuer));
+        }
+        issuersHash.Insert(mastercore::GenerateConsensusString(propertyId, info.issuer));
+    }
+
     PrintToLog("%s(): updated entry for SP %d successfully\n", __func__, propertyId);
     return true;
 }
@@ -242,7 +364,8 @@ void CMPSPInfo::putSPGeneral(const Entry& info, const uint32_t& propertyId) {
 
     // sanity checking
     std::string existingEntry;
-    if (!pdb->Get(readoptions, slSpKey, &existingEntry).IsNotFound() && slSpValue.compare(existingEntry) != 0) {
+    bool fExists = !pdb->Get(readoptions, slSpKey, &existingEntry).IsNotFound();
+    if (fExists && slSpValue.compare(existingEntry) != 0) {
         std::string strError = strprintf("writing SP %d to DB, when a different SP already exists for that identifier", propertyId);
         PrintToLog("%s() ERROR: %s\n", __func__, strError);
     } else if (!pdb->Get(readoptions, slTxIndexKey, &existingEntry).IsNotFound() && slTxValue.compare(existingEntry) != 0) {
@@ -254,12 +377,24 @@ void CMPSPInfo::putSPGeneral(const Entry& info, const uint32_t& propertyId) {
     leveldb::WriteBatch batch;
     batch.Put(slSpKey, slSpValue);
     batch.Put(slTxIndexKey, slTxValue);
+    batch.Put(HeaderKey(propertyId), EncodeRecord(Header(info)));
+    if (!AddTouchedProperty(pdb, readoptions, batch, info.update_block, propertyId)) {
+        PrintToLog("%s(): ERROR for SP %d: failed to decode properties changed in block %s\n", __func__, propertyId, info.update_block.GetHex());
+    }
 
     leveldb::Status status = pdb->Write(syncoptions, &batch);
+    uncache(propertyId);
 
     if (!status.ok()) {
         PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
     }
+
+    // overwritten entries are rare, so the hash is rebuilt in this case
+    if (fExists) {
+        resetIssuersHash();
+    } else if (fIssuersHashValid) {
+        issuersHash.Insert(mastercore::GenerateConsensusString(propertyId, info.issuer));
+    }
 }
 
 bool CMPSPInfo::getSP(uint32_t propertyId, Entry& info) const
@@ -273,6 +408,16 @@ bool CMPSPInfo::getSP(uint32_t propertyId, Entry& info) const
         return true;
     }
 
+    // entries invalidated while reading from the database must not be cached
+    uint64_t nGeneration;
+    {
+        LOCK(cs_cache);
+        if (cacheEntries.get(propertyId, info)) {
+            return true;
+        }
+        nGeneration = nCacheGeneration;
+    }
+
     // DB key for property entry
     CDataStream ssSpKey(SER_DISK, CLIENT_VERSION);
     ssSpKey << std::make_pair('s', propertyId);
@@ -296,6 +441,54 @@ bool CMPSPInfo::getSP(uint32_t propertyId, Entry& info) const
         return false;
     }
 
+    LOCK(cs_cache);
+    if (nGeneration == nCacheGeneration) {
+        cacheEntries.put(propertyId, info);
+    }
+
+    return true;
+}
+
+bool CMPSPInfo::getHeader(uint32_t propertyId, Header& header) const
+{
+    // special cases for constant SPs MSC and TMSC
+    if (OMNI_PROPERTY_MSC == propertyId) {
+        header = Header(implied_omni);
+        return true;
+    } else if (OMNI_PROPERTY_TMSC == propertyId) {
+        header = Header(implied_tomni);
+        return true;
+    }
+
+    // entries invalidated while reading from the database must not be cached
+    uint64_t nGeneration;
+    {
+        LOCK(cs_cache);
+        if (cacheHeaders.get(propertyId, header)) {
+            return true;
+        }
+        nGeneration = nCacheGeneration;
+    }
+
+    std::string strValue;
+    leveldb::Status status = pdb->Get(readoptions, HeaderKey(propertyId), &strValue);
+    if (!status.ok()) {
+        if (!status.IsNotFound()) {
+            PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
+        }
+        return false;
+    }
+
+    if (!DecodeRecord(strValue, header)) {
+        PrintToLog("%s(): ERROR for SP %d: failed to decode header\n", __func__, propertyId);
+        return false;
+    }
+
+    LOCK(cs_cache);
+    if (nGeneration == nCacheGeneration) {
+        cacheHeaders.put(propertyId, header);
+    }
+
     return true;
 }
 
@@ -318,6 +511,90 @@ bool CMPSPInfo::hasSP(uint32_t propertyId) const
     return status.ok();
 }
 
+/**
+ * Stores records of historical data of a property.
+ *
+ * The previous values are kept, so the records can be reverted, when the
+ * block is popped. Unchanged records are skipped.
+ *
+ * @param propertyId  The property
+ * @param records     The records to store, by txid
+ * @param blockHash   The block, which adds or changes the records
+ * @return True, if the records were stored
+ */
+bool CMPSPInfo::putHistory(uint32_t propertyId, const History& records, const uint256& blockHash)
+{
+    leveldb::WriteBatch batch;
+
+    for (History::const_iterator it = records.begin(); it != records.end(); ++it) {
+        const std::string key = HistoryKey(propertyId, &it->first);
+        const std::string value = EncodeRecord(it->second);
+
+        std::string strPrevValue;
+        bool fPrevExists = pdb->Get(readoptions, key, &strPrevValue).ok();
+        if (fPrevExists && strPrevValue == value) {
+            continue;
+        }
+
+        // only the first change within a block needs to be reverted
+        const std::string undoKey = HistoryUndoKey(blockHash, propertyId, it->first);
+        std::string strUndoValue;
+        if (pdb->Get(readoptions, undoKey, &strUndoValue).IsNotFound()) {
+            batch.Put(undoKey, fPrevExists ? strPrevValue : EncodeRecord(std::vector<int64_t>()));
+        }
+        batch.Put(key, value);
+    }
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, status.ToString());
+        return false;
+    }
+
+    return true;
+}
+
+bool CMPSPInfo::getHistory(uint32_t propertyId, History& history) const
+{
+    history.clear();
+
+    const std::string prefix = HistoryKey(propertyId);
+    leveldb::Iterator* iter = NewIterator();
+
+    for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next()) {
+        uint256 txid;
+        std::vector<int64_t> record;
+        try {
+            CDataStream ssKey(iter->key().data() + prefix.size(), iter->key().data() + iter->key().size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> txid;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR for SP %d: %s\n", __func__, propertyId, e.what());
+            delete iter;
+            return false;
+        }
+        if (!DecodeRecord(iter->value().ToString(), record)) {
+            PrintToLog("%s(): ERROR for SP %d: failed to decode record of %s\n", __func__, propertyId, txid.GetHex());
+            delete iter;
+            return false;
+        }
+        history.emplace(txid, record);
+    }
+
+    delete iter;
+
+    return true;
+}
+
+bool CMPSPInfo::getHistoryRecord(uint32_t propertyId, const uint256& txid, std::vector<int64_t>& record) const
+{
+    std::string strValue;
+    if (!pdb->Get(readoptions, HistoryKey(propertyId, &txid), &strValue).ok()) {
+        return false;
+    }
+
+    return DecodeRecord(strValue, record);
+}
+
 uint32_t CMPSPInfo::findSPByTX(const uint256& txid) const
 {
     uint32_t propertyId = 0;
@@ -346,83 +623,132 @@ uint32_t CMPSPInfo::findSPByTX(const uint256& txid) const
     return propertyId;
 }
 
+/**
+ * Rolls back the properties and the historical data, which were changed in the block.
+ *
+ * @param block_hash  The block to pop
+ * @return The number of rolled back or removed properties, or a negative value on failure
+ */
 int64_t CMPSPInfo::popBlock(const uint256& block_hash)
 {
-    int64_t remainingSPs = 0;
+    int64_t nRolledBack = 0;
     leveldb::WriteBatch commitBatch;
     leveldb::Iterator* iter = NewIterator();
 
-    CDataStream ssSpKeyPrefix(SER_DISK, CLIENT_VERSION);
-    ssSpKeyPrefix << 's';
-    leveldb::Slice slSpKeyPrefix(&ssSpKeyPrefix[0], ssSpKeyPrefix.size());
+    // revert the historical data, which was changed in the block
+    const std::string undoPrefix = HistoryUndoPrefix(block_hash);
+    for (iter->Seek(undoPrefix); iter->Valid() && iter->key().starts_with(undoPrefix); iter->Next()) {
+        uint32_t propertyId = 0;
+        uint256 txid;
+        std::vector<int64_t> prevRecord;
+        try {
+            CDataStream ssKey(iter->key().data() + undoPrefix.size(), iter->key().data() + iter->key().size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> propertyId >> txid;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            delete iter;
+            return -1;
+        }
+        if (!DecodeRecord(iter->value().ToString(), prevRecord)) {
+            PrintToLog("%s(): ERROR: failed to decode previous record of %s\n", __func__, txid.GetHex());
+            delete iter;
+            return -1;
+        }
+        if (prevRecord.empty()) {
+            commitBatch.Delete(HistoryKey(propertyId, &txid));
+        } else {
+            commitBatch.Put(HistoryKey(propertyId, &txid), iter->value());
+        }
+        commitBatch.Delete(iter->key());
+    }
+
+    // clean up the iterator
+    delete iter;
+
+    // only the properties, which were changed in the block, are rolled back
+    std::vector<uint32_t> propertyIds;
+    const std::string touchedKey = TouchedKey(block_hash);
+    std::string strTouchedValue;
+    if (pdb->Get(readoptions, touchedKey, &strTouchedValue).ok() && !DecodeRecord(strTouchedValue, propertyIds)) {
+        PrintToLog("%s(): ERROR: failed to decode properties changed in block %s\n", __func__, block_hash.GetHex());
+        return -1;
+    }
+    commitBatch.Delete(touchedKey);
+
+    for (uint32_t propertyId : propertyIds) {
+        CDataStream ssSpKey(SER_DISK, CLIENT_VERSION);
+        ssSpKey << std::make_pair('s', propertyId);
+        leveldb::Slice slSpKey(&ssSpKey[0], ssSpKey.size());
 
-    for (iter->Seek(slSpKeyPrefix); iter->Valid() && iter->key().starts_with(slSpKeyPrefix); iter->Next()) {
         // deserialize the persisted value
-        leveldb::Slice slSpValue = iter->value();
+        std::string strSpValue;
+        if (!pdb->Get(readoptions, slSpKey, &strSpValue).ok()) {
+            continue;
+        }
         Entry info;
         try {
-            CDataStream ssValue(slSpValue.data(), slSpValue.data() + slSpValue.size(), SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(strSpValue.data(), strSpValue.data() + strSpValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> info;
         } catch (const std::exception& e) {
             PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
-            return -1;
+            return -2;
+        }
+        if (info.update_block != block_hash) {
+            continue;
         }
-        // pop the block
-        if (info.update_block == block_hash) {
-            leveldb::Slice slSpKey = iter->key();
-
-            // need to roll this SP back
-            if (info.update_block == info.creation_block) {
-                // this is the block that created this SP, so delete the SP and the tx index entry
-                CDataStream ssTxIndexKey(SER_DISK, CLIENT_VERSION);
-                ssTxIndexKey << std::make_pair('t', info.txid);
-                leveldb::Slice slTxIndexKey(&ssTxIndexKey[0], ssTxIndexKey.size());
-                commitBatch.Delete(slSpKey);
-                commitBatch.Delete(slTxIndexKey);
-            } else {
-                uint32_t propertyId = 0;
-                try {
-                    CDataStream ssValue(1+slSpKey.data(), 1+slSpKey.data()+slSpKey.size(), SER_DISK, CLIENT_VERSION);
-                    ssValue >> propertyId;
-                } catch (const std::exception& e) {
-                    PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
-                    return -2;
-                }
 
-                CDataStream ssSpPrevKey(SER_DISK, CLIENT_VERSION);
-                ssSpPrevKey << 'b';
-                ssSpPrevKey << info.update_block;
-                ssSpPrevKey << propertyId;
-                leveldb::Slice slSpPrevKey(&ssSpPrevKey[0], ssSpPrevKey.size());
-
-                std::string strSpPrevValue;
-                if (!pdb->Get(readoptions, slSpPrevKey, &strSpPrevValue).IsNotFound()) {
-                    // copy the prev state to the current state and delete the old state
-                    commitBatch.Put(slSpKey, strSpPrevValue);
-                    commitBatch.Delete(slSpPrevKey);
-                    ++remainingSPs;
-                } else {
-                    // failed to find a previous SP entry, trigger reparse
-                    PrintToLog("%s(): ERROR: failed to retrieve previous SP entry\n", __func__);
-                    return -3;
-                }
-            }
+        // need to roll this SP back
+        if (info.update_block == info.creation_block) {
+            // this is the block that created this SP, so delete the SP and the tx index entry
+            CDataStream ssTxIndexKey(SER_DISK, CLIENT_VERSION);
+            ssTxIndexKey << std::make_pair('t', info.txid);
+            leveldb::Slice slTxIndexKey(&ssTxIndexKey[0], ssTxIndexKey.size());
+            commitBatch.Delete(slSpKey);
+            commitBatch.Delete(slTxIndexKey);
+            commitBatch.Delete(HeaderKey(propertyId));
         } else {
-            ++remainingSPs;
+            CDataStream ssSpPrevKey(SER_DISK, CLIENT_VERSION);
+            ssSpPrevKey << 'b';
+            ssSpPrevKey << info.update_block;
+            ssSpPrevKey << propertyId;
+            leveldb::Slice slSpPrevKey(&ssSpPrevKey[0], ssSpPrevKey.size());
+
+            std::string strSpPrevValue;
+            Entry prevInfo;
+            if (pdb->Get(readoptions, slSpPrevKey, &strSpPrevValue).IsNotFound()) {
+                // failed to find a previous SP entry, trigger reparse
+                PrintToLog("%s(): ERROR: failed to retrieve previous SP entry\n", __func__);
+                return -3;
+            }
+            try {
+                CDataStream ssValue(strSpPrevValue.data(), strSpPrevValue.data() + strSpPrevValue.size(), SER_DISK, CLIENT_VERSION);
+                ssValue >> prevInfo;
+            } catch (const std::exception& e) {
+                PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+                return -3;
+            }
+            // copy the prev state to the current state and delete the old state
+            commitBatch.Put(slSpKey, strSpPrevValue);
+            commitBatch.Delete(slSpPrevKey);
+            commitBatch.Put(HeaderKey(propertyId), EncodeRecord(Header(prevInfo)));
         }
+        ++nRolledBack;
     }
 
-    // clean up the iterator
-    delete iter;
-
     leveldb::Status status = pdb->Write(syncoptions, &commitBatch);
 
+    // reorgs are rare, so the issuers hash is rebuilt on next use
+    resetIssuersHash();
+    for (uint32_t propertyId : propertyIds) {
+        uncache(propertyId);
+    }
+
     if (!status.ok()) {
         PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
         return -4;
     }
 
-    return remainingSPs;
+    return nRolledBack;
 }
 
 void CMPSPInfo::setWatermark(const uint256& watermark)
@@ -473,6 +799,58 @@ bool CMPSPInfo::getWatermark(uint256& watermark) const
     return true;
 }
 
+const CMPMultisetHash& CMPSPInfo::getIssuersHash()
+{
+    if (!fIssuersHashValid) {
+        issuersHash = computeIssuersHash();
+        fIssuersHashValid = true;
+    }
+
+    return issuersHash;
+}
+
+CMPMultisetHash CMPSPInfo::computeIssuersHash() const
+{
+    CMPMultisetHash hash;
+
+    // the hard coded MSC and TMSC entries are not stored in the DB
+    hash.Insert(mastercore::GenerateConsensusString(OMNI_PROPERTY_MSC, implied_omni.issuer));
+    hash.Insert(mastercore::GenerateConsensusString(OMNI_PROPERTY_TMSC, implied_tomni.issuer));
+
+    leveldb::Iterator* iter = NewIterator();
+
+    CDataStream ssSpKeyPrefix(SER_DISK, CLIENT_VERSION);
+    ssSpKeyPrefix << 's';
+    leveldb::Slice slSpKeyPrefix(&ssSpKeyPrefix[0], ssSpKeyPrefix.size());
+
+    for (iter->Seek(slSpKeyPrefix); iter->Valid() && iter->key().starts_with(slSpKeyPrefix); iter->Next()) {
+        leveldb::Slice slSpKey = iter->key();
+        leveldb::Slice slSpValue = iter->value();
+        uint32_t propertyId = 0;
+        Entry info;
+        try {
+            CDataStream ssKey(1+slSpKey.data(), slSpKey.data()+slSpKey.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> propertyId;
+            CDataStream ssValue(slSpValue.data(), slSpValue.data() + slSpValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> info;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            continue;
+        }
+        hash.Insert(mastercore::GenerateConsensusString(propertyId, info.issuer));
+    }
+
+    delete iter;
+
+    return hash;
+}
+
+void CMPSPInfo::resetIssuersHash()
+{
+    issuersHash.Clear();
+    fIssuersHashValid = false;
+}
+
 void CMPSPInfo::printAll() const
 {
     // print off the hard coded MSC and TMSC entries
@@ -522,3 +900,233 @@ void CMPSPInfo::printAll() const
     // clean up the iterator
     delete iter;
 }
+
+/**
+ * Stores the header records of all properties, which were created without one.
+ *
+ * @return The number of stored headers, or -1 on failure
+ */
+int CMPSPInfo::BuildHeaders()
+{
+    int nHeaders = 0;
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* iter = NewIterator();
+
+    CDataStream ssSpKeyPrefix(SER_DISK, CLIENT_VERSION);
+    ssSpKeyPrefix << 's';
+    leveldb::Slice slSpKeyPrefix(&ssSpKeyPrefix[0], ssSpKeyPrefix.size());
+
+    for (iter->Seek(slSpKeyPrefix); iter->Valid() && iter->key().starts_with(slSpKeyPrefix); iter->Next()) {
+        leveldb::Slice slSpKey = iter->key();
+        leveldb::Slice slSpValue = iter->value();
+        uint32_t propertyId = 0;
+        Entry info;
+        try {
+            CDataStream ssKey(1+slSpKey.data(), slSpKey.data()+slSpKey.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> propertyId;
+            CDataStream ssValue(slSpValue.data(), slSpValue.data() + slSpValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> info;
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            delete iter;
+            return -1;
+        }
+        batch.Put(HeaderKey(propertyId), EncodeRecord(Header(info)));
+        ++nHeaders;
+    }
+
+    delete iter;
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
+        return -1;
+    }
+
+    LOCK(cs_cache);
+    cacheHeaders.clear();
+
+    PrintToLog("%s(): stored %d property headers\n", __func__, nHeaders);
+
+    return nHeaders;
+}
+
+/**
+ * Moves the historical data out of the entries, which were stored in the
+ * format of version 13 and earlier.
+ *
+ * The previous entries, which are kept to pop blocks, are converted as well,
+ * and the differences between them become the records, which revert the
+ * historical data of a block.
+ *
+ * @return The number of moved records, or -1 on failure
+ */
+int CMPSPInfo::UpgradeHistory()
+{
+    typedef std::pair<Entry, History> LegacyValue;
+    std::map<uint32_t, LegacyValue> current;
+    std::map<std::pair<uint256, uint32_t>, LegacyValue> previous;
+
+    leveldb::Iterator* iter = NewIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        leveldb::Slice slKey = iter->key();
+        leveldb::Slice slValue = iter->value();
+        if (slKey.size() == 0 || (slKey[0] != 's' && slKey[0] != 'b')) {
+            continue;
+        }
+        LegacyValue value;
+        LegacyEntry legacy(value.first, value.second);
+        try {
+            CDataStream ssKey(slKey.data() + 1, slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> legacy;
+            if (slKey[0] == 's') {
+                uint32_t propertyId = 0;
+                ssKey >> propertyId;
+                current.emplace(propertyId, value);
+            } else {
+                std::pair<uint256, uint32_t> blockProperty;
+                ssKey >> blockProperty.first >> blockProperty.second;
+                previous.emplace(blockProperty, value);
+            }
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            delete iter;
+            return -1;
+        }
+    }
+    delete iter;
+
+    int nRecords = 0;
+    leveldb::WriteBatch batch;
+
+    for (std::map<uint32_t, LegacyValue>::const_iterator it = current.begin(); it != current.end(); ++it) {
+        const uint32_t propertyId = it->first;
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << std::make_pair('s', propertyId);
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << it->second.first;
+        batch.Put(std::string(ssKey.begin(), ssKey.end()), std::string(ssValue.begin(), ssValue.end()));
+
+        const History& history = it->second.second;
+        for (History::const_iterator itRecord = history.begin(); itRecord != history.end(); ++itRecord) {
+            batch.Put(HistoryKey(propertyId, &itRecord->first), EncodeRecord(itRecord->second));
+            ++nRecords;
+        }
+
+        // walk back the previous entries, and record what each block changed
+        const LegacyValue* pAfter = &it->second;
+        std::set<uint256> visited;
+        while (visited.insert(pAfter->first.update_block).second) {
+            const uint256& blockHash = pAfter->first.update_block;
+            std::map<std::pair<uint256, uint32_t>, LegacyValue>::const_iterator itBefore = previous.find(std::make_pair(blockHash, propertyId));
+            if (itBefore == previous.end()) {
+                // records of the block, which created the property, are removed with it
+                if (blockHash == pAfter->first.creation_block) {
+                    for (History::const_iterator itRecord = pAfter->second.begin(); itRecord != pAfter->second.end(); ++itRecord) {
+                        batch.Put(HistoryUndoKey(blockHash, propertyId, itRecord->first), EncodeRecord(std::vector<int64_t>()));
+                    }
+                }
+                break;
+            }
+            const History& before = itBefore->second.second;
+            const History& after = pAfter->second;
+            for (History::const_iterator itRecord = after.begin(); itRecord != after.end(); ++itRecord) {
+                History::const_iterator itPrev = before.find(itRecord->first);
+                if (itPrev == before.end()) {
+                    batch.Put(HistoryUndoKey(blockHash, propertyId, itRecord->first), EncodeRecord(std::vector<int64_t>()));
+                } else if (itPrev->second != itRecord->second) {
+                    batch.Put(HistoryUndoKey(blockHash, propertyId, itRecord->first), EncodeRecord(itPrev->second));
+                }
+            }
+            for (History::const_iterator itPrev = before.begin(); itPrev != before.end(); ++itPrev) {
+                if (after.find(itPrev->first) == after.end()) {
+                    batch.Put(HistoryUndoKey(blockHash, propertyId, itPrev->first), EncodeRecord(itPrev->second));
+                }
+            }
+            pAfter = &itBefore->second;
+        }
+    }
+
+    for (std::map<std::pair<uint256, uint32_t>, LegacyValue>::const_iterator it = previous.begin(); it != previous.end(); ++it) {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << 'b' << it->first.first << it->first.second;
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << it->second.first;
+        batch.Put(std::string(ssKey.begin(), ssKey.end()), std::string(ssValue.begin(), ssValue.end()));
+    }
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
+        return -1;
+    }
+
+    {
+        LOCK(cs_cache);
+        cacheEntries.clear();
+        cacheHeaders.clear();
+    }
+
+    PrintToLog("%s(): moved %d historical records of %d properties\n", __func__, nRecords, current.size());
+
+    return nRecords;
+}
+
+/**
+ * Indexes the properties, which were stored in each block.
+ *
+ * The current entries, and the previous entries kept to pop blocks, refer to
+ * all blocks, which can still be popped.
+ *
+ * @return The number of indexed blocks, or -1 on failure
+ */
+int CMPSPInfo::BuildTouchedIndex()
+{
+    std::map<uint256, std::set<uint32_t> > touched;
+
+    leveldb::Iterator* iter = NewIterator();
+    for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+        leveldb::Slice slKey = iter->key();
+        leveldb::Slice slValue = iter->value();
+        if (slKey.size() == 0 || (slKey[0] != 's' && slKey[0] != 'b')) {
+            continue;
+        }
+        Entry info;
+        try {
+            CDataStream ssKey(slKey.data() + 1, slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            ssValue >> info;
+            uint32_t propertyId = 0;
+            if (slKey[0] == 'b') {
+                // the previous entry was replaced in this block
+                uint256 blockHash;
+                ssKey >> blockHash >> propertyId;
+                touched[blockHash].insert(propertyId);
+            } else {
+                ssKey >> propertyId;
+            }
+            touched[info.update_block].insert(propertyId);
+        } catch (const std::exception& e) {
+            PrintToLog("%s(): ERROR: %s\n", __func__, e.what());
+            delete iter;
+            return -1;
+        }
+    }
+    delete iter;
+
+    leveldb::WriteBatch batch;
+    for (std::map<uint256, std::set<uint32_t> >::const_iterator it = touched.begin(); it != touched.end(); ++it) {
+        batch.Put(TouchedKey(it->first), EncodeRecord(std::vector<uint32_t>(it->second.begin(), it->second.end())));
+    }
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    if (!status.ok()) {
+        PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
+        return -1;
+    }
+
+    PrintToLog("%s(): indexed the properties of %d blocks\n", __func__, touched.size());
+
+    return touched.size();
+}
@@ -1,18 +1,27 @@
 #ifndef BITCOIN_OMNICORE_DBSPINFO_H
 #define BITCOIN_OMNICORE_DBSPINFO_H
 
+#include <omnicore/consensushash.h>
 #include <omnicore/dbbase.h>
 #include <omnicore/log.h>
+#include <omnicore/lrucache.h>
 #include <omnicore/omnicore.h>
 
 #include <fs.h>
 #include <serialize.h>
+#include <sync.h>
 #include <uint256.h>
 
 #include <stdint.h>
 
 #include <map>
 #include <string>
+#include <vector>
+
+//! Number of decoded property entries, which are kept in memory
+static const size_t SP_ENTRY_CACHE_SIZE = 256;
+//! Number of property headers, which are kept in memory
+static const size_t SP_HEADER_CACHE_SIZE = 4096;
 
 /** LevelDB based storage for currencies, smart properties and tokens.
  *
@@ -41,6 +50,33 @@
  *      uint32_t propertyId
  *  Value:
  *      CMPSPInfo::Entry info
+ *
+ *  Key:
+ *      char 'h'
+ *      uint32_t propertyId
+ *  Value:
+ *      CMPSPInfo::Header header (binary record format)
+ *
+ *  Key:
+ *      char 'd'
+ *      uint32_t propertyId
+ *      uint256 hashTxid
+ *  Value:
+ *      std::vector<int64_t> historical data (binary record format)
+ *
+ *  Key:
+ *      char 'e'
+ *      uint256 hashBlock
+ *      uint32_t propertyId
+ *      uint256 hashTxid
+ *  Value:
+ *      std::vector<int64_t> historical data before the block, or empty, if new (binary record format)
+ *
+ *  Key:
+ *      char 'u'
+ *      uint256 hashBlock
+ *  Value:
+ *      std::vector<uint32_t> properties, whose entries were stored in the block (binary record format)
  */
 class CMPSPInfo : public CDBBase
 {
@@ -78,12 +114,6 @@ public:
         bool manual;
         bool unique;
 
-        // For crowdsale properties:
-        //   txid -> amount invested, crowdsale deadline, user issued tokens, issuer issued tokens
-        // For managed properties:
-        //   txid -> granted amount, revoked amount
-        std::map<uint256, std::vector<int64_t> > historicalData;
-
         // Historical issuers:
         //   (block, idx) -> issuer
         std::map<std::pair<int, int>, std::string > historicalIssuers;
@@ -94,6 +124,13 @@ public:
 
         template <typename Stream, typename Operation>
         inline void SerializationOp(Stream& s, Operation ser_action) {
+            SerializeProperties(s, ser_action);
+            READWRITE(historicalIssuers);
+        }
+
+        /** Serializes the fields, which precede the historical data in the legacy format. */
+        template <typename Stream, typename Operation>
+        inline void SerializeProperties(Stream& s, Operation ser_action) {
             READWRITE(issuer);
             READWRITE(prop_type);
             READWRITE(prev_prop_id);
@@ -118,8 +155,6 @@ public:
             READWRITE(fixed);
             READWRITE(manual);
             READWRITE(unique);
-            READWRITE(historicalData);
-            READWRITE(historicalIssuers);
         }
 
         bool isDivisible() const;
@@ -132,6 +167,55 @@ public:
         std::string getIssuer(int block) const;
     };
 
+    /** Compact metadata of a property, which is stored apart from the full entry. */
+    struct Header {
+        uint16_t prop_type;
+        bool unique;
+        std::string name;
+        std::string issuer;
+
+        Header();
+        explicit Header(const Entry& info);
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(prop_type);
+            READWRITE(unique);
+            READWRITE(name);
+            READWRITE(issuer);
+        }
+
+        bool isDivisible() const;
+    };
+
+    /** Historical data of a property.
+     *
+     * For crowdsale properties:
+     *   txid -> amount invested, crowdsale deadline, user issued tokens, issuer issued tokens
+     * For managed properties:
+     *   txid -> granted amount, revoked amount
+     */
+    typedef std::map<uint256, std::vector<int64_t> > History;
+
+    /** Entry in the format of version 13 and earlier, which stored the historical data within the entry. */
+    struct LegacyEntry {
+        Entry& info;
+        History& history;
+
+        LegacyEntry(Entry& infoIn, History& historyIn) : info(infoIn), history(historyIn) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            info.SerializeProperties(s, ser_action);
+            READWRITE(history);
+            READWRITE(info.historicalIssuers);
+        }
+    };
+
 private:
     // implied version of OMN and TOMN so they don't hit the leveldb
     Entry implied_omni;
@@ -140,6 +224,23 @@ private:
     uint32_t next_spid;
     uint32_t next_test_spid;
 
+    //! Hash of all property issuers, used for the state hash
+    CMPMultisetHash issuersHash;
+    //! Whether the hash of property issuers is up to date
+    bool fIssuersHashValid;
+
+    //! Guards the caches, which are also filled by const lookups
+    mutable CCriticalSection cs_cache;
+    //! Recently used, decoded property entries
+    mutable CMPLruCache<uint32_t, Entry> cacheEntries;
+    //! Recently used property headers
+    mutable CMPLruCache<uint32_t, Header> cacheHeaders;
+    //! Incremented whenever cached properties are invalidated, guarded by cs_cache
+    uint64_t nCacheGeneration;
+
+    /** Removes a property from the caches. */
+    void uncache(uint32_t propertyId);
+
 public:
     CMPSPInfo(const fs::path& path, bool fWipe);
     virtual ~CMPSPInfo();
@@ -154,7 +255,16 @@ public:
     uint32_t putSP(uint8_t ecosystem, const Entry& info);
     void putSPGeneral(const Entry& info, const uint32_t& propertyId);
     bool getSP(uint32_t propertyId, Entry& info) const;
+    /** Retrieves the header of a property, without decoding the full entry. */
+    bool getHeader(uint32_t propertyId, Header& header) const;
     bool hasSP(uint32_t propertyId) const;
+
+    /** Stores records of historical data, which are reverted, when the block is popped. */
+    bool putHistory(uint32_t propertyId, const History& records, const uint256& blockHash);
+    /** Retrieves all historical data of a property. */
+    bool getHistory(uint32_t propertyId, History& history) const;
+    /** Retrieves the historical data of a property for one transaction. */
+    bool getHistoryRecord(uint32_t propertyId, const uint256& txid, std::vector<int64_t>& record) const;
     uint32_t findSPByTX(const uint256& txid) const;
 
     int64_t popBlock(const uint256& block_hash);
@@ -163,6 +273,20 @@ public:
     bool getWatermark(uint256& watermark) const;
 
     void printAll() const;
+
+    /** Stores the header records of all properties, which were created without one. */
+    int BuildHeaders();
+    /** Moves the historical data out of entries, which were stored in the legacy format. */
+    int UpgradeHistory();
+    /** Indexes the properties, which were stored in each block, based on the current and previous entries. */
+    int BuildTouchedIndex();
+
+    /** Returns the hash of all property issuers, and builds it on first use. */
+    const CMPMultisetHash& getIssuersHash();
+    /** Hashes all property issuers from scratch. */
+    CMPMultisetHash computeIssuersHash() const;
+    /** Rebuilds the hash of property issuers on next use. */
+    void resetIssuersHash();
 };
 
 
@@ -4,8 +4,10 @@
 #include <omnicore/sp.h>
 #include <omnicore/walletutils.h>
 
+#include <clientversion.h>
 #include <fs.h>
 #include <interfaces/wallet.h>
+#include <streams.h>
 #include <uint256.h>
 #include <util/strencodings.h>
 #include <tinyformat.h>
@@ -15,6 +17,7 @@
 #include <leveldb/iterator.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -22,12 +25,74 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <exception>
+#include <set>
 #include <string>
 #include <vector>
 
 using mastercore::IsMyAddress;
 using mastercore::isPropertyDivisible;
 
+namespace
+{
+/** Receipt, as stored by version 11, where all receipts of an address were concatenated in one value. */
+struct ConcatenatedReceipt
+{
+    uint256 txid;
+    CMPSTOList::Receipt receipt;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(txid);
+        READWRITE(receipt);
+    }
+};
+
+/** Returns the prefix of the receipts of an address. */
+std::string AddressPrefix(const std::string& address)
+{
+    return "r|" + address + "|";
+}
+
+/** Returns the key of a receipt, ordered by address and block. */
+std::string AddressKey(const std::string& address, int block, const uint256& txid)
+{
+    return strprintf("r|%s|%010d|%s", address, block, txid.ToString());
+}
+
+/** Returns the prefix of the receipts of a transaction. */
+std::string TransactionPrefix(const uint256& txid)
+{
+    return "t|" + txid.ToString() + "|";
+}
+
+/** Returns the key of a receipt, ordered by transaction and address. */
+std::string TransactionKey(const uint256& txid, const std::string& address)
+{
+    return TransactionPrefix(txid) + address;
+}
+
+/** Returns the prefix of the receipts of a block. */
+std::string BlockPrefix(int block)
+{
+    return strprintf("b|%010d|", block);
+}
+
+/** Returns the key of a receipt, ordered by block. */
+std::string BlockKey(int block, const uint256& txid, const std::string& address)
+{
+    return strprintf("b|%010d|%s|%s", block, txid.ToString(), address);
+}
+
+/** Returns true, if the key is part of the key spaces of the receipts. */
+bool IsReceiptKey(const leveldb::Slice& sKey)
+{
+    return sKey.size() > 2 && sKey[1] == '|';
+}
+} // anonymous namespace
+
 CMPSTOList::CMPSTOList(const fs::path& path, bool fWipe)
 {
     leveldb::Status status = Open(path, fWipe);
@@ -39,6 +104,58 @@ CMPSTOList::~CMPSTOList()
     if (msc_debug_persistence) PrintToLog("CMPSTOList closed\n");
 }
 
+/**
+ * Returns the receipts of an address, ordered by block.
+ */
+std::vector<CMPSTOList::Receipt> CMPSTOList::getReceipts(const std::string& address)
+{
+    std::vector<Receipt> receipts;
+    if (!pdb) return receipts;
+
+    const std::string strPrefix = AddressPrefix(address);
+    leveldb::Iterator* it = NewIterator();
+    for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
+        Receipt receipt;
+        if (!DecodeRecord(it->value().ToString(), receipt)) {
+            PrintToLog("STODB Error - unexpected record %s\n", it->key().ToString());
+            continue;
+        }
+        receipt.txid = uint256S(it->key().ToString().substr(strPrefix.size() + 11));
+        receipt.address = address;
+        receipts.push_back(receipt);
+        ++nRead;
+    }
+    delete it;
+
+    return receipts;
+}
+
+/**
+ * Returns the receipts of a transaction, ordered by recipient.
+ */
+std::vector<CMPSTOList::Receipt> CMPSTOList::getTransactionReceipts(const uint256& txid)
+{
+    std::vector<Receipt> receipts;
+    if (!pdb) return receipts;
+
+    const std::string strPrefix = TransactionPrefix(txid);
+    leveldb::Iterator* it = NewIterator();
+    for (it->Seek(strPrefix); it->Valid() && it->key().starts_with(strPrefix); it->Next()) {
+        Receipt receipt;
+        if (!DecodeRecord(it->value().ToString(), receipt)) {
+            PrintToLog("STODB Error - unexpected record %s\n", it->key().ToString());
+            continue;
+        }
+        receipt.txid = txid;
+        receipt.address = it->key().ToString().substr(strPrefix.size());
+        receipts.push_back(receipt);
+        ++nRead;
+    }
+    delete it;
+
+    return receipts;
+}
+
 void CMPSTOList::getRecipients(const uint256 txid, std::string filterAddress, UniValue* recipientArray, uint64_t* total, uint64_t* numRecipients, interfaces::Wallet* iWallet)
 {
     if (!pdb) return;
@@ -53,137 +170,97 @@ void CMPSTOList::getRecipients(const uint256 txid, std::string filterAddress, Un
         filterByAddress = true;
     }
 
-    // iterate through SDB, dropping all records where key is not filterAddress (if filtering)
-    int count = 0;
-
     // the fee is variable based on version of STO - provide number of recipients and allow calling function to work out fee
     *numRecipients = 0;
 
-    leveldb::Slice skey, svalue;
-    leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        std::string recipientAddress = skey.ToString();
-        svalue = it->value();
-        std::string strValue = svalue.ToString();
-        // see if txid is in the data
-        size_t txidMatch = strValue.find(txid.ToString());
-        if (txidMatch != std::string::npos) {
-            ++*numRecipients;
-            // the txid exists inside the data, this address was a recipient of this STO, check filter and add the details
-            if (filter) {
-                if (((filterByAddress) && (filterAddress == recipientAddress)) || ((filterByWallet) && (IsMyAddress(recipientAddress, iWallet)))) {
-                } else {
-                    continue;
-                } // move on if no filter match (but counter still increased for fee)
-            }
-            std::vector<std::string> vstr;
-            boost::split(vstr, strValue, boost::is_any_of(","), boost::token_compress_on);
-            for (uint32_t i = 0; i < vstr.size(); i++) {
-                std::vector<std::string> svstr;
-                boost::split(svstr, vstr[i], boost::is_any_of(":"), boost::token_compress_on);
-                if (4 == svstr.size()) {
-                    if (svstr[0] == txid.ToString()) {
-                        //add data to array
-                        uint64_t amount = 0;
-                        uint64_t propertyId = 0;
-                        try {
-                            amount = boost::lexical_cast<uint64_t>(svstr[3]);
-                            propertyId = boost::lexical_cast<uint64_t>(svstr[2]);
-                        } catch (const boost::bad_lexical_cast &e) {
-                            PrintToLog("DEBUG STO - error in converting values from leveldb\n");
-                            delete it;
-                            return; //(something went wrong)
-                        }
-                        UniValue recipient(UniValue::VOBJ);
-                        recipient.pushKV("address", recipientAddress);
-                        if (isPropertyDivisible(propertyId)) {
-                            recipient.pushKV("amount", FormatDivisibleMP(amount));
-                        } else {
-                            recipient.pushKV("amount", FormatIndivisibleMP(amount));
-                        }
-                        *total += amount;
-                        recipientArray->push_back(recipient);
-                        ++count;
-                    }
-                }
-            }
+    // iterate through the recipients of the transaction, dropping all where the address is not filterAddress (if filtering)
+    std::vector<Receipt> receipts = getTransactionReceipts(txid);
+    for (std::vector<Receipt>::const_iterator it = receipts.begin(); it != receipts.end(); ++it) {
+        const std::string& recipientAddress = it->address;
+        ++*numRecipients;
+        // check filter and add the details
+        if (filter) {
+            if (((filterByAddress) && (filterAddress == recipientAddress)) || ((filterByWallet) && (IsMyAddress(recipientAddress, iWallet)))) {
+            } else {
+                continue;
+            } // move on if no filter match (but counter still increased for fee)
         }
+        //add data to array
+        UniValue recipient(UniValue::VOBJ);
+        recipient.pushKV("address", recipientAddress);
+        if (isPropertyDivisible(it->propertyId)) {
+            recipient.pushKV("amount", FormatDivisibleMP(it->amount));
+        } else {
+            recipient.pushKV("amount", FormatIndivisibleMP(it->amount));
+        }
+        *total += it->amount;
+        recipientArray->push_back(recipient);
     }
-
-    delete it;
-    return;
 }
 
-std::string CMPSTOList::getMySTOReceipts(std::string filterAddress, interfaces::Wallet &iWallet)
+/**
+ * Returns the receipts of the wallet, with one receipt per transaction.
+ */
+std::vector<CMPSTOList::Receipt> CMPSTOList::getMySTOReceipts(std::string filterAddress, interfaces::Wallet &iWallet)
 {
-    if (!pdb) return "";
-    std::string mySTOReceipts = "";
-    leveldb::Slice skey, svalue;
-    leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        std::string recipientAddress = skey.ToString();
-        if (!IsMyAddress(recipientAddress, &iWallet)) continue; // not ours, not interested
-        if ((!filterAddress.empty()) && (filterAddress != recipientAddress)) continue; // not the filtered address
-        // ours, get info
-        svalue = it->value();
-        std::string strValue = svalue.ToString();
-        // break into individual receipts
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(","), boost::token_compress_on);
-        for (uint32_t i = 0; i < vstr.size(); i++) {
-            // add to array
-            std::vector<std::string> svstr;
-            boost::split(svstr, vstr[i], boost::is_any_of(":"), boost::token_compress_on);
-            if (4 == svstr.size()) {
-                size_t txidMatch = mySTOReceipts.find(svstr[0]);
-                if (txidMatch == std::string::npos) mySTOReceipts += svstr[0] + ":" + svstr[1] + ":" + recipientAddress + ":" + svstr[2] + ",";
-            }
+    std::vector<Receipt> mySTOReceipts;
+    if (!pdb) return mySTOReceipts;
+
+    std::vector<std::string> addresses;
+    if (!filterAddress.empty()) {
+        if (IsMyAddress(filterAddress, &iWallet)) addresses.push_back(filterAddress);
+    } else {
+        // visit each recipient once, and skip over the receipts of addresses, which are not ours
+        leveldb::Iterator* it = NewIterator();
+        for (it->Seek("r|"); it->Valid() && it->key().starts_with("r|"); ) {
+            const std::string strKey = it->key().ToString();
+            const std::string recipientAddress = strKey.substr(2, strKey.size() - 2 - 76);
+            if (IsMyAddress(recipientAddress, &iWallet)) addresses.push_back(recipientAddress);
+            it->Seek(AddressPrefix(recipientAddress) + "\xff");
         }
+        delete it;
     }
-    delete it;
-    // above code will leave a trailing comma - strip it
-    if (mySTOReceipts.size() > 0) mySTOReceipts.resize(mySTOReceipts.size() - 1);
+
+    std::set<uint256> seenTxids;
+    for (std::vector<std::string>::const_iterator address = addresses.begin(); address != addresses.end(); ++address) {
+        std::vector<Receipt> receipts = getReceipts(*address);
+        for (std::vector<Receipt>::const_iterator receipt = receipts.begin(); receipt != receipts.end(); ++receipt) {
+            if (!seenTxids.insert(receipt->txid).second) continue;
+            mySTOReceipts.push_back(*receipt);
+        }
+    }
+
     return mySTOReceipts;
 }
 
 /**
  * This function deletes records of STO receivers above/equal to a specific block from the STO database.
  *
- * Returns the number of records changed.
+ * Returns the number of receipts removed.
  */
 int CMPSTOList::deleteAboveBlock(int blockNum)
 {
     unsigned int n_found = 0;
-    std::vector<std::string> vecSTORecords;
+    leveldb::WriteBatch batch;
     leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string newValue;
-        std::string oldValue = it->value().ToString();
-        bool needsUpdate = false;
-        boost::split(vecSTORecords, oldValue, boost::is_any_of(","), boost::token_compress_on);
-        for (uint32_t i = 0; i < vecSTORecords.size(); i++) {
-            std::vector<std::string> vecSTORecordFields;
-            boost::split(vecSTORecordFields, vecSTORecords[i], boost::is_any_of(":"), boost::token_compress_on);
-            if (4 != vecSTORecordFields.size()) continue;
-            if (atoi(vecSTORecordFields[1]) < blockNum) {
-                newValue += vecSTORecords[i].append(","); // STO before the reorg, add data back to new value string
-            } else {
-                needsUpdate = true;
-            }
-        }
-        if (needsUpdate) { // rewrite record with existing key and new value
-            ++n_found;
-            leveldb::Status status = pdb->Put(writeoptions, it->key().ToString(), newValue);
-            PrintToLog("DEBUG STO - rewriting STO data after reorg\n");
-            PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
-        }
+    for (it->Seek(BlockPrefix(blockNum)); it->Valid() && it->key().starts_with("b|"); it->Next()) {
+        const std::string strKey = it->key().ToString();
+        const int block = atoi(strKey.substr(2, 10));
+        const uint256 txid = uint256S(strKey.substr(13, 64));
+        const std::string address = strKey.substr(78);
+        batch.Delete(strKey);
+        batch.Delete(AddressKey(address, block, txid));
+        batch.Delete(TransactionKey(txid, address));
+        ++n_found;
     }
+    delete it;
 
-    PrintToLog("%s(%d); stodb updated records= %d\n", __FUNCTION__, blockNum, n_found);
+    if (n_found > 0) {
+        leveldb::Status status = pdb->Write(writeoptions, &batch);
+        PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
+    }
 
-    delete it;
+    PrintToLog("%s(%d); stodb removed receipts= %d\n", __FUNCTION__, blockNum, n_found);
 
     return (n_found);
 }
@@ -203,59 +280,119 @@ void CMPSTOList::printAll()
         skey = it->key();
         svalue = it->value();
         ++count;
-        PrintToConsole("entry #%8d= %s:%s\n", count, skey.ToString(), svalue.ToString());
+        PrintToConsole("entry #%8d= %s:%s\n", count, skey.ToString(), HexStr(svalue.ToString()));
     }
 
     delete it;
 }
 
+/**
+ * Returns true, if the address received tokens sent to owners.
+ */
 bool CMPSTOList::exists(std::string address)
 {
     if (!pdb) return false;
 
-    std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, address, &strValue);
-
-    if (!status.ok()) {
-        if (status.IsNotFound()) return false;
-    }
+    const std::string strPrefix = AddressPrefix(address);
+    leveldb::Iterator* it = NewIterator();
+    it->Seek(strPrefix);
+    bool fFound = it->Valid() && it->key().starts_with(strPrefix);
+    delete it;
 
-    return true;
+    return fFound;
 }
 
 void CMPSTOList::recordSTOReceive(std::string address, const uint256 &txid, int nBlock, unsigned int propertyId, uint64_t amount)
 {
     if (!pdb) return;
 
-    bool addressExists = exists(address);
-    if (addressExists) {
-        // retrieve existing record
-        std::vector<std::string> vstr;
-        std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, address, &strValue);
-        if (status.ok()) {
-            // add details to record
-            // see if we are overwriting (check)
-            size_t txidMatch = strValue.find(txid.ToString());
-            if (txidMatch != std::string::npos) PrintToLog("STODEBUG : Duplicating entry for %s : %s\n", address, txid.ToString());
-
-            const std::string key = address;
-            const std::string newValue = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
-            strValue += newValue;
-            // write updated record
-            leveldb::Status status;
-            if (pdb) {
-                status = pdb->Put(writeoptions, key, strValue);
-                PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
+    Receipt receipt;
+    receipt.block = nBlock;
+    receipt.propertyId = propertyId;
+    receipt.amount = amount;
+    const std::string strValue = EncodeRecord(receipt);
+
+    // see if we are overwriting (check)
+    std::string strPrevValue;
+    if (pdb->Get(readoptions, TransactionKey(txid, address), &strPrevValue).ok()) {
+        PrintToLog("STODEBUG : Duplicating entry for %s : %s\n", address, txid.ToString());
+    }
+
+    leveldb::WriteBatch batch;
+    batch.Put(AddressKey(address, nBlock, txid), strValue);
+    batch.Put(TransactionKey(txid, address), strValue);
+    batch.Put(BlockKey(nBlock, txid, address), "");
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    ++nWritten;
+    PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
+}
+
+/**
+ * Converts the records, which stored all receipts of an address in one value, into one record per receipt.
+ *
+ * Both the colon-separated strings, and the concatenated binary receipts of version 11 are converted.
+ *
+ * Returns the number of converted receipts.
+ */
+int CMPSTOList::UpgradeRecordFormat()
+{
+    if (!pdb) return 0;
+
+    int count = 0;
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* it = NewIterator();
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        if (IsReceiptKey(it->key())) continue;
+        const std::string address = it->key().ToString();
+        const std::string strValue = it->value().ToString();
+
+        std::vector<ConcatenatedReceipt> receipts;
+        if (!strValue.empty() && strValue[0] == DB_RECORD_FORMAT) {
+            try {
+                CDataStream ssValue(strValue.data() + 1, strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+                while (!ssValue.empty()) {
+                    ConcatenatedReceipt receipt;
+                    ssValue >> receipt;
+                    receipts.push_back(receipt);
+                }
+            } catch (const std::exception& e) {
+                PrintToLog("%s(): ERROR: unexpected record of %s: %s\n", __func__, address, e.what());
+            }
+        } else {
+            std::vector<std::string> vstr;
+            boost::split(vstr, strValue, boost::is_any_of(","), boost::token_compress_on);
+            for (size_t i = 0; i < vstr.size(); ++i) {
+                std::vector<std::string> svstr;
+                boost::split(svstr, vstr[i], boost::is_any_of(":"), boost::token_compress_on);
+                if (4 != svstr.size()) continue; // the trailing comma leaves an empty chunk
+                try {
+                    ConcatenatedReceipt receipt;
+                    receipt.txid = uint256S(svstr[0]);
+                    receipt.receipt.block = boost::lexical_cast<int>(svstr[1]);
+                    receipt.receipt.propertyId = boost::lexical_cast<uint32_t>(svstr[2]);
+                    receipt.receipt.amount = boost::lexical_cast<uint64_t>(svstr[3]);
+                    receipts.push_back(receipt);
+                } catch (const boost::bad_lexical_cast& e) {
+                    PrintToLog("%s(): ERROR: unexpected receipt of %s: %s\n", __func__, address, vstr[i]);
+                }
             }
         }
-    } else {
-        const std::string key = address;
-        const std::string value = strprintf("%s:%d:%u:%lu,", txid.ToString(), nBlock, propertyId, amount);
-        leveldb::Status status;
-        if (pdb) {
-            status = pdb->Put(writeoptions, key, value);
-            PrintToLog("STODBDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
+
+        for (std::vector<ConcatenatedReceipt>::const_iterator receipt = receipts.begin(); receipt != receipts.end(); ++receipt) {
+            const std::string strReceipt = EncodeRecord(receipt->receipt);
+            batch.Put(AddressKey(address, receipt->receipt.block, receipt->txid), strReceipt);
+            batch.Put(TransactionKey(receipt->txid, address), strReceipt);
+            batch.Put(BlockKey(receipt->receipt.block, receipt->txid, address), "");
+            ++count;
         }
+        batch.Delete(it->key());
     }
+
+    delete it;
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    PrintToLog("%s(): converted %d receipts: %s\n", __func__, count, status.ToString());
+
+    return status.ok() ? count : -1;
 }
@@ -4,6 +4,7 @@
 #include <omnicore/dbbase.h>
 
 #include <fs.h>
+#include <serialize.h>
 #include <uint256.h>
 
 #include <univalue.h>
@@ -11,22 +12,60 @@
 #include <stdint.h>
 
 #include <string>
+#include <vector>
 
 namespace interfaces {
 class Wallet;
 } // namespace interfaces
 
 /** LevelDB based storage for STO recipients.
+ *
+ * Each receipt is stored under three keys, so that the receipts of an
+ * address, the recipients of a transaction, and the receipts of a block range
+ * can be retrieved with prefix scans:
+ *
+ *   r|address|block|txid -> block, property, amount
+ *   t|txid|address       -> block, property, amount
+ *   b|block|txid|address -> (empty)
+ *
+ * Blocks are zero padded, so that receipts are ordered by block.
  */
 class CMPSTOList : public CDBBase
 {
 public:
+    /** Receipt of tokens sent to owners. */
+    struct Receipt
+    {
+        //! Transaction and recipient are part of the key, and therefore not serialized
+        uint256 txid;
+        std::string address;
+        int block;
+        uint32_t propertyId;
+        uint64_t amount;
+
+        Receipt() : block(0), propertyId(0), amount(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(VARINT(block, VarIntMode::NONNEGATIVE_SIGNED));
+            READWRITE(VARINT(propertyId));
+            READWRITE(VARINT(amount));
+        }
+    };
+
     CMPSTOList(const fs::path& path, bool fWipe);
     virtual ~CMPSTOList();
 
     void getRecipients(const uint256 txid, std::string filterAddress, UniValue* recipientArray, uint64_t* total, uint64_t* numRecipients, interfaces::Wallet* iWallet = nullptr);
-    std::string getMySTOReceipts(std::string filterAddress, interfaces::Wallet& iWallet);
-    
+    /** Returns the receipts of the wallet, with one receipt per transaction. */
+    std::vector<Receipt> getMySTOReceipts(std::string filterAddress, interfaces::Wallet& iWallet);
+    /** Returns the receipts of an address, ordered by block. */
+    std::vector<Receipt> getReceipts(const std::string& address);
+    /** Returns the receipts of a transaction, ordered by recipient. */
+    std::vector<Receipt> getTransactionReceipts(const uint256& txid);
+
     /**
      * This function deletes records of STO receivers above/equal to a specific block from the STO database.
      *
@@ -37,6 +76,8 @@ public:
     void printAll();
     bool exists(std::string address);
     void recordSTOReceive(std::string, const uint256&, int, unsigned int, uint64_t);
+    /** Converts the records, which stored all receipts of an address in one value, into one record per receipt. */
+    int UpgradeRecordFormat();
 };
 
 namespace mastercore
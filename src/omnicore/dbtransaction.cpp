@@ -7,7 +7,9 @@
 #include <uint256.h>
 #include <tinyformat.h>
 
+#include <leveldb/iterator.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -30,29 +32,25 @@ COmniTransactionDB::~COmniTransactionDB()
 }
 
 /**
- * Retrieves the serialized transaction details from the DB. 
+ * Retrieves the transaction details from the DB.
  */
-std::vector<std::string> COmniTransactionDB::FetchTransactionDetails(const uint256& txid)
+bool COmniTransactionDB::FetchTransactionDetails(const uint256& txid, TransactionDetails& details)
 {
     assert(pdb);
     std::string strValue;
-    std::vector<std::string> vTransactionDetails;
 
     leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
+    ++nRead;
     if (status.ok()) {
-        std::vector<std::string> vStr;
-        boost::split(vStr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (vStr.size() == 2) {
-            vTransactionDetails.push_back(vStr[0]);
-            vTransactionDetails.push_back(vStr[1]);
-        } else {
-            PrintToLog("ERROR: Entry (%s) found in OmniTXDB with unexpected number of attributes!\n", txid.GetHex());
+        if (DecodeRecord(strValue, details)) {
+            return true;
         }
+        PrintToLog("ERROR: Entry (%s) found in OmniTXDB with unexpected format!\n", txid.GetHex());
     } else {
         PrintToLog("ERROR: Entry (%s) could not be loaded from OmniTXDB!\n", txid.GetHex());
     }
 
-    return vTransactionDetails;
+    return false;
 }
 
 /**
@@ -62,10 +60,11 @@ void COmniTransactionDB::RecordTransaction(const uint256& txid, uint32_t posInBl
 {
     assert(pdb);
 
-    const std::string key = txid.ToString();
-    const std::string value = strprintf("%d:%d", posInBlock, processingResult);
+    TransactionDetails details;
+    details.posInBlock = posInBlock;
+    details.processingResult = processingResult;
 
-    leveldb::Status status = pdb->Put(writeoptions, key, value);
+    leveldb::Status status = pdb->Put(writeoptions, txid.ToString(), EncodeRecord(details));
     ++nWritten;
 }
 
@@ -76,9 +75,9 @@ uint32_t COmniTransactionDB::FetchTransactionPosition(const uint256& txid)
 {
     uint32_t posInBlock = 9999999; // setting an initial arbitrarily high value will ensure transaction is always "last" in event of bug/exploit
 
-    std::vector<std::string> vTransactionDetails = FetchTransactionDetails(txid);
-    if (vTransactionDetails.size() == 2) {
-        posInBlock = boost::lexical_cast<uint32_t>(vTransactionDetails[0]);
+    TransactionDetails details;
+    if (FetchTransactionDetails(txid, details)) {
+        posInBlock = details.posInBlock;
     }
 
     return posInBlock;
@@ -91,10 +90,55 @@ std::string COmniTransactionDB::FetchInvalidReason(const uint256& txid)
 {
     int processingResult = -999999;
 
-    std::vector<std::string> vTransactionDetails = FetchTransactionDetails(txid);
-    if (vTransactionDetails.size() == 2) {
-        processingResult = boost::lexical_cast<int>(vTransactionDetails[1]);
+    TransactionDetails details;
+    if (FetchTransactionDetails(txid, details)) {
+        processingResult = details.processingResult;
     }
 
     return error_str(processingResult);
 }
+
+/**
+ * Converts all records, which were stored as strings, into the binary record format.
+ *
+ * Returns the number of converted records.
+ */
+int COmniTransactionDB::UpgradeRecordFormat()
+{
+    assert(pdb);
+
+    int count = 0;
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* it = NewIterator();
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        const std::string strValue = it->value().ToString();
+        if (!strValue.empty() && strValue[0] == DB_RECORD_FORMAT) continue;
+
+        std::vector<std::string> vStr;
+        boost::split(vStr, strValue, boost::is_any_of(":"), boost::token_compress_on);
+        TransactionDetails details;
+        bool fParsed = false;
+        if (vStr.size() == 2) {
+            try {
+                details.posInBlock = boost::lexical_cast<uint32_t>(vStr[0]);
+                details.processingResult = boost::lexical_cast<int>(vStr[1]);
+                fParsed = true;
+            } catch (const boost::bad_lexical_cast& e) {
+            }
+        }
+        if (!fParsed) {
+            PrintToLog("%s(): ERROR: unexpected record %s=%s\n", __func__, it->key().ToString(), strValue);
+            continue;
+        }
+        batch.Put(it->key(), EncodeRecord(details));
+        ++count;
+    }
+
+    delete it;
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    PrintToLog("%s(): converted %d records: %s\n", __func__, count, status.ToString());
+
+    return status.ok() ? count : -1;
+}
@@ -4,6 +4,7 @@
 #include <omnicore/dbbase.h>
 
 #include <fs.h>
+#include <serialize.h>
 #include <uint256.h>
 
 #include <stdint.h>
@@ -16,6 +17,23 @@
 class COmniTransactionDB : public CDBBase
 {
 public:
+    /** Position in block and validation result of a transaction. */
+    struct TransactionDetails
+    {
+        uint32_t posInBlock;
+        int32_t processingResult;
+
+        TransactionDetails() : posInBlock(0), processingResult(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(VARINT(posInBlock));
+            READWRITE(processingResult);
+        }
+    };
+
     COmniTransactionDB(const fs::path& path, bool fWipe);
     virtual ~COmniTransactionDB();
 
@@ -28,9 +46,12 @@ public:
     /** Returns the reason why a transaction is invalid. */
     std::string FetchInvalidReason(const uint256& txid);
 
+    /** Converts all records, which were stored as strings, into the binary record format. */
+    int UpgradeRecordFormat();
+
 private:
-    /** Retrieves the serialized transaction details from the DB. */
-    std::vector<std::string> FetchTransactionDetails(const uint256& txid);
+    /** Retrieves the transaction details from the DB. */
+    bool FetchTransactionDetails(const uint256& txid, TransactionDetails& details);
 };
 
 namespace mastercore
@@ -0,0 +1,198 @@
+#include <omnicore/dbtxindex.h>
+
+#include <omnicore/log.h>
+
+#include <fs.h>
+#include <tinyformat.h>
+#include <uint256.h>
+
+#include <leveldb/iterator.h>
+#include <leveldb/slice.h>
+#include <leveldb/status.h>
+#include <leveldb/write_batch.h>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+//! Key of the first block covered by the index
+const std::string START_BLOCK_KEY = "startblock";
+//! Key of the last block covered by the index
+const std::string LAST_BLOCK_KEY = "lastblock";
+
+/** Returns the prefix of the transactions of a subject. */
+std::string SubjectPrefix(char prefix, const std::string& subject)
+{
+    return strprintf("%c|%s|", prefix, subject);
+}
+
+/** Returns the key of a transaction, ordered by subject, block and position. */
+std::string SubjectKey(char prefix, const std::string& subject, int block, uint32_t position)
+{
+    return strprintf("%c|%s|%010d|%010u", prefix, subject, block, position);
+}
+
+/** Returns the prefix of the transactions of a block. */
+std::string BlockPrefix(int block)
+{
+    return strprintf("b|%010d|", block);
+}
+
+/** Returns the key of a transaction, ordered by block and position. */
+std::string BlockKey(int block, uint32_t position, const std::string& subject)
+{
+    return strprintf("b|%010d|%010u|%s", block, position, subject);
+}
+} // anonymous namespace
+
+CMPTxIndex::CMPTxIndex(const fs::path& path, bool fWipe, char prefixIn, const std::string& nameIn)
+  : prefix(prefixIn), name(nameIn)
+{
+    leveldb::Status status = Open(path, fWipe);
+    PrintToConsole("Loading %s database: %s\n", name, status.ToString());
+}
+
+CMPTxIndex::~CMPTxIndex()
+{
+}
+
+/**
+ * Adds a transaction of a subject to a batch.
+ */
+void CMPTxIndex::putRecord(leveldb::WriteBatch& batch, const std::string& subject, int block, uint32_t position, const std::string& value) const
+{
+    batch.Put(SubjectKey(prefix, subject, block, position), value);
+    batch.Put(BlockKey(block, position, subject), "");
+}
+
+/**
+ * Writes a batch of added transactions.
+ */
+leveldb::Status CMPTxIndex::writeBatch(leveldb::WriteBatch& batch)
+{
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
+    ++nWritten;
+
+    return status;
+}
+
+/**
+ * Returns the transactions of a subject, ordered by block and position.
+ */
+std::vector<CMPTxIndex::Record> CMPTxIndex::getRecords(const std::string& subject, int startBlock, uint32_t startPosition, int endBlock, size_t nCount)
+{
+    std::vector<Record> records;
+    if (!pdb) return records;
+
+    const std::string strPrefix = SubjectPrefix(prefix, subject);
+    leveldb::Iterator* it = NewIterator();
+    for (it->Seek(SubjectKey(prefix, subject, startBlock, startPosition)); it->Valid() && it->key().starts_with(strPrefix) && records.size() < nCount; it->Next()) {
+        const std::string strKey = it->key().ToString();
+        Record record;
+        record.block = atoi(strKey.substr(strPrefix.size(), 10).c_str());
+        if (record.block > endBlock) break;
+        record.position = strtoul(strKey.substr(strPrefix.size() + 11, 10).c_str(), nullptr, 10);
+        record.value = it->value().ToString();
+        records.push_back(record);
+        ++nRead;
+    }
+    delete it;
+
+    return records;
+}
+
+/**
+ * Deletes the transactions of a block and all following blocks.
+ *
+ * Returns the number of removed entries.
+ */
+int CMPTxIndex::deleteAboveBlock(int blockNum)
+{
+    if (!pdb) return 0;
+
+    int count = 0;
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* it = NewIterator();
+    for (it->Seek(BlockPrefix(blockNum)); it->Valid() && it->key().starts_with("b|"); it->Next()) {
+        const std::string strKey = it->key().ToString();
+        const int block = atoi(strKey.substr(2, 10).c_str());
+        const uint32_t position = strtoul(strKey.substr(13, 10).c_str(), nullptr, 10);
+        const std::string subject = strKey.substr(24);
+        batch.Delete(strKey);
+        batch.Delete(SubjectKey(prefix, subject, block, position));
+        ++count;
+    }
+    delete it;
+
+    if (count > 0) {
+        leveldb::Status status = pdb->Write(writeoptions, &batch);
+        if (!status.ok()) {
+            PrintToLog("%s(): ERROR: failed to remove entries: %s\n", __func__, status.ToString());
+            return -1;
+        }
+    }
+    PrintToLog("%s(%d): removed %d %s entries\n", __func__, blockNum, count, name);
+
+    return count;
+}
+
+/**
+ * Returns the first block covered by the index, or -1, if the index was just created.
+ */
+int CMPTxIndex::getStartBlock()
+{
+    std::string strValue;
+    if (!pdb || !pdb->Get(readoptions, START_BLOCK_KEY, &strValue).ok()) return -1;
+
+    return atoi(strValue.c_str());
+}
+
+/**
+ * Stores the first block covered by the index.
+ */
+void CMPTxIndex::setStartBlock(int block)
+{
+    if (!pdb) return;
+
+    leveldb::Status status = pdb->Put(syncoptions, START_BLOCK_KEY, strprintf("%d", block));
+    PrintToLog("%s(%d): %s\n", __func__, block, status.ToString());
+}
+
+/**
+ * Returns the last block covered by the index, or false, if none was recorded.
+ */
+bool CMPTxIndex::getLastBlock(int& block, uint256& hash)
+{
+    std::string strValue;
+    if (!pdb || !pdb->Get(readoptions, LAST_BLOCK_KEY, &strValue).ok()) return false;
+
+    std::pair<int, uint256> record;
+    if (!DecodeRecord(strValue, record)) {
+        PrintToLog("%s(): ERROR: unexpected record of the last %s block\n", __func__, name);
+        return false;
+    }
+    block = record.first;
+    hash = record.second;
+
+    return true;
+}
+
+/**
+ * Stores the last block covered by the index.
+ */
+void CMPTxIndex::setLastBlock(int block, const uint256& hash)
+{
+    if (!pdb) return;
+
+    leveldb::Status status = pdb->Put(writeoptions, LAST_BLOCK_KEY, EncodeRecord(std::make_pair(block, hash)));
+    ++nWritten;
+    if (!status.ok()) {
+        PrintToLog("%s(%d): ERROR: %s\n", __func__, block, status.ToString());
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef BITCOIN_OMNICORE_DBTXINDEX_H
+#define BITCOIN_OMNICORE_DBTXINDEX_H
+
+#include <omnicore/dbbase.h>
+
+#include <fs.h>
+#include <uint256.h>
+
+#include <leveldb/status.h>
+#include <leveldb/write_batch.h>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+/** Base of the LevelDB based indexes, which list the Omni transactions of a
+ * subject, such as an address or a property.
+ *
+ * Each transaction is stored under two keys, so that the transactions of a
+ * subject can be listed in order, and the transactions of disconnected blocks
+ * can be removed:
+ *
+ *   prefix|subject|block|position -> value
+ *   b|block|position|subject -> (empty)
+ *
+ * Blocks and positions are zero padded, so that transactions are ordered by
+ * block and position within the block. The derived indexes define the subject
+ * and the value of their entries.
+ *
+ * The first and the last block covered by the index are stored as well, so
+ * that an index, which is kept while the node runs without it, can resume.
+ */
+class CMPTxIndex : public CDBBase
+{
+private:
+    //! Prefix of the keys, which are ordered by subject
+    char prefix;
+    //! Name of the index used in log messages
+    std::string name;
+
+protected:
+    /** Stored transaction of a subject. */
+    struct Record
+    {
+        int block;
+        uint32_t position;
+        std::string value;
+    };
+
+    CMPTxIndex(const fs::path& path, bool fWipe, char prefixIn, const std::string& nameIn);
+
+    /** Adds a transaction of a subject to a batch. */
+    void putRecord(leveldb::WriteBatch& batch, const std::string& subject, int block, uint32_t position, const std::string& value) const;
+
+    /** Writes a batch of added transactions. */
+    leveldb::Status writeBatch(leveldb::WriteBatch& batch);
+
+    /**
+     * Returns the transactions of a subject, ordered by block and position.
+     *
+     * @param subject        The subject
+     * @param startBlock     The block of the first transaction to include
+     * @param startPosition  The position of the first transaction to include within the start block
+     * @param endBlock       The last block to include
+     * @param nCount         The maximal number of transactions to return
+     */
+    std::vector<Record> getRecords(const std::string& subject, int startBlock, uint32_t startPosition, int endBlock, size_t nCount);
+
+public:
+    virtual ~CMPTxIndex();
+
+    /**
+     * Deletes the transactions of a block and all following blocks.
+     *
+     * Returns the number of removed entries.
+     */
+    int deleteAboveBlock(int blockNum);
+
+    /** Returns the first block covered by the index, or -1, if the index was just created. */
+    int getStartBlock();
+
+    /** Stores the first block covered by the index. */
+    void setStartBlock(int block);
+
+    /** Returns the last block covered by the index, or false, if none was recorded. */
+    bool getLastBlock(int& block, uint256& hash);
+
+    /** Stores the last block covered by the index. */
+    void setLastBlock(int block, const uint256& hash);
+};
+
+#endif // BITCOIN_OMNICORE_DBTXINDEX_H
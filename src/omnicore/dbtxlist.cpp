@@ -22,6 +22,7 @@
 #include <leveldb/iterator.h>
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
+#include <leveldb/write_batch.h>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/lexical_cast.hpp>
@@ -30,6 +31,7 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <limits>
 #include <string>
 #include <utility>
 #include <vector>
@@ -43,6 +45,48 @@ using mastercore::GetBlockIndex;
 using mastercore::isNonMainNet;
 using mastercore::pDbTransaction;
 
+namespace
+{
+/** Prefix of the height index, which is no hex character, and therefore never the prefix of a txid. */
+const char HEIGHT_INDEX_PREFIX = 'h';
+
+/** Returns the key of the height index, which sorts the transactions by block and txid. */
+std::string HeightIndexKey(int nBlock, const std::string& txidStr = "")
+{
+    return strprintf("%c%010d%s", HEIGHT_INDEX_PREFIX, nBlock, txidStr);
+}
+
+/** Returns the value of the height index, with validity bit and type. */
+std::string HeightIndexValue(bool fValid, uint32_t type)
+{
+    return CDBBase::EncodeRecord(std::make_pair(fValid, type));
+}
+
+/** Parses an entry of the height index. */
+bool ParseHeightIndexEntry(const leveldb::Slice& sKey, const leveldb::Slice& sValue, int& block, uint256& txid, bool& fValid, unsigned int& type)
+{
+    if (sKey.size() != 75 || sKey[0] != HEIGHT_INDEX_PREFIX) return false;
+
+    const std::string strKey = sKey.ToString();
+    std::pair<bool, uint32_t> value;
+    if (!CDBBase::DecodeRecord(sValue.ToString(), value)) return false;
+
+    block = atoi(strKey.substr(1, 10));
+    txid = uint256S(strKey.substr(11));
+    fValid = value.first;
+    type = value.second;
+    return true;
+}
+
+/** Splits a record, which was stored as colon-separated string before the binary record format was introduced. */
+std::vector<std::string> SplitLegacyRecord(const std::string& strValue, const char* separator = ":")
+{
+    std::vector<std::string> vstr;
+    boost::split(vstr, strValue, boost::is_any_of(separator), boost::token_compress_on);
+    return vstr;
+}
+} // anonymous namespace
+
 CMPTxList::CMPTxList(const fs::path& path, bool fWipe)
 {
     leveldb::Status status = Open(path, fWipe);
@@ -58,18 +102,23 @@ void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned
 {
     if (!pdb) return;
 
+    const std::string key = txid.ToString();
+    leveldb::WriteBatch batch;
+
     // overwrite detection, we should never be overwriting a tx, as that means we have redone something a second time
     // reorgs delete all txs from levelDB above reorg_chain_height
-    if (exists(txid)) PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
-
-    const std::string key = txid.ToString();
-    const std::string value = strprintf("%u:%d:%u:%lu", fValid ? 1 : 0, nBlock, type, nValue);
-    leveldb::Status status;
+    TxRecord prevRecord;
+    if (getTX(txid, prevRecord)) {
+        PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
+        batch.Delete(HeightIndexKey(prevRecord.block, key));
+    }
 
     PrintToLog("%s(%s, valid=%s, block= %d, type= %d, value= %lu)\n",
             __func__, txid.ToString(), fValid ? "YES" : "NO", nBlock, type, nValue);
 
-    status = pdb->Put(writeoptions, key, value);
+    batch.Put(key, EncodeRecord(TxRecord(fValid, nBlock, type, nValue)));
+    batch.Put(HeightIndexKey(nBlock, key), HeightIndexValue(fValid, type));
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
     ++nWritten;
 }
 
@@ -84,42 +133,34 @@ void CMPTxList::recordPaymentTX(const uint256& txid, bool fValid, int nBlock, un
     uint64_t existingNumberOfPayments = 0;
 
     // Step 1 - Check TXList to see if this payment TXID exists
-    bool paymentEntryExists = exists(txid);
-
     // Step 2a - If doesn't exist leave number of payments & paymentNumber set to 1
     // Step 2b - If does exist add +1 to existing number of payments and set this paymentNumber as new numberOfPayments
-    if (paymentEntryExists) {
-        //retrieve old numberOfPayments
-        std::vector<std::string> vstr;
-        std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
-        if (status.ok()) {
-            // parse the string returned
-            boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-
-            // obtain the existing number of payments
-            if (4 <= vstr.size()) {
-                existingNumberOfPayments = atoi(vstr[3]);
-                paymentNumber = existingNumberOfPayments + 1;
-                numberOfPayments = existingNumberOfPayments + 1;
-            }
-        }
+    TxRecord prevRecord;
+    if (getTX(txid, prevRecord)) {
+        // obtain the existing number of payments
+        existingNumberOfPayments = prevRecord.nValue;
+        paymentNumber = existingNumberOfPayments + 1;
+        numberOfPayments = existingNumberOfPayments + 1;
     }
 
     // Step 3 - Create new/update master record for payment tx in TXList
     const std::string key = txid.ToString();
-    const std::string value = strprintf("%u:%d:%u:%lu", fValid ? 1 : 0, nBlock, type, numberOfPayments);
-    leveldb::Status status;
+    leveldb::WriteBatch batch;
     PrintToLog("DEXPAYDEBUG : Writing master record %s(%s, valid=%s, block= %d, type= %d, number of payments= %lu)\n", __func__, txid.ToString(), fValid ? "YES" : "NO", nBlock, type, numberOfPayments);
-    status = pdb->Put(writeoptions, key, value);
+    batch.Put(key, EncodeRecord(TxRecord(fValid, nBlock, type, numberOfPayments)));
+    batch.Put(HeightIndexKey(nBlock, key), HeightIndexValue(fValid, type));
 
     // Step 4 - Write sub-record with payment details
-    const std::string txidStr = txid.ToString();
-    const std::string subKey = STR_PAYMENT_SUBKEY_TXID_PAYMENT_COMBO(txidStr, paymentNumber);
-    const std::string subValue = strprintf("%d:%s:%s:%d:%lu", vout, buyer, seller, propertyId, nValue);
-    leveldb::Status subStatus;
-    PrintToLog("DEXPAYDEBUG : Writing sub-record %s with value %s\n", subKey, subValue);
-    subStatus = pdb->Put(writeoptions, subKey, subValue);
+    const std::string subKey = STR_PAYMENT_SUBKEY_TXID_PAYMENT_COMBO(key, paymentNumber);
+    PaymentRecord payment;
+    payment.vout = vout;
+    payment.buyer = buyer;
+    payment.seller = seller;
+    payment.propertyId = propertyId;
+    payment.nValue = nValue;
+    PrintToLog("DEXPAYDEBUG : Writing sub-record %s with value %d:%s:%s:%d:%lu\n", subKey, vout, buyer, seller, propertyId, nValue);
+    batch.Put(subKey, EncodeRecord(payment));
+    leveldb::Status status = pdb->Write(writeoptions, &batch);
 }
 
 /**
@@ -128,11 +169,13 @@ void CMPTxList::recordPaymentTX(const uint256& txid, bool fValid, int nBlock, un
 void CMPTxList::recordSendAllSubRecord(const uint256& txid, int subRecordNumber, uint32_t propertyId, int64_t nValue)
 {
     std::string strKey = strprintf("%s-%d", txid.ToString(), subRecordNumber);
-    std::string strValue = strprintf("%d:%d", propertyId, nValue);
+    SendAllRecord record;
+    record.propertyId = propertyId;
+    record.nValue = nValue;
 
-    leveldb::Status status = pdb->Put(writeoptions, strKey, strValue);
+    leveldb::Status status = pdb->Put(writeoptions, strKey, EncodeRecord(record));
     ++nWritten;
-    if (msc_debug_txdb) PrintToLog("%s(): store: %s=%s, status: %s\n", __func__, strKey, strValue, status.ToString());
+    if (msc_debug_txdb) PrintToLog("%s(): store: %s=%d:%d, status: %s\n", __func__, strKey, propertyId, nValue, status.ToString());
 }
 
 
@@ -155,14 +198,9 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
 {
     int numberOfSubRecords = 0;
 
-    std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
-    if (status.ok()) {
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 <= vstr.size()) {
-            numberOfSubRecords = boost::lexical_cast<int>(vstr[3]);
-        }
+    TxRecord record;
+    if (getTX(txid, record)) {
+        numberOfSubRecords = record.nValue;
     }
 
     return numberOfSubRecords;
@@ -171,21 +209,16 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
 bool CMPTxList::getPurchaseDetails(const uint256 txid, int purchaseNumber, std::string* buyer, std::string* seller, uint64_t* vout, uint64_t* propertyId, uint64_t* nValue)
 {
     if (!pdb) return 0;
-    std::vector<std::string> vstr;
     std::string strValue;
-    leveldb::Status status = pdb->Get(readoptions, txid.ToString() + "-" + std::to_string(purchaseNumber), &strValue);
-    if (status.ok()) {
-        // parse the string returned
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        // obtain the requisite details
-        if (5 == vstr.size()) {
-            *vout = atoi(vstr[0]);
-            *buyer = vstr[1];
-            *seller = vstr[2];
-            *propertyId = atoi64(vstr[3]);
-            *nValue = boost::lexical_cast<boost::uint64_t>(vstr[4]);
-            return true;
-        }
+    PaymentRecord payment;
+    leveldb::Status status = pdb->Get(readoptions, STR_PAYMENT_SUBKEY_TXID_PAYMENT_COMBO(txid.ToString(), purchaseNumber), &strValue);
+    if (status.ok() && DecodeRecord(strValue, payment)) {
+        *vout = payment.vout;
+        *buyer = payment.buyer;
+        *seller = payment.seller;
+        *propertyId = payment.propertyId;
+        *nValue = payment.nValue;
+        return true;
     }
     return false;
 }
@@ -197,15 +230,12 @@ bool CMPTxList::getSendAllDetails(const uint256& txid, int subSend, uint32_t& pr
 {
     std::string strKey = strprintf("%s-%d", txid.ToString(), subSend);
     std::string strValue;
+    SendAllRecord record;
     leveldb::Status status = pdb->Get(readoptions, strKey, &strValue);
-    if (status.ok()) {
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-        if (2 == vstr.size()) {
-            propertyId = boost::lexical_cast<uint32_t>(vstr[0]);
-            amount = boost::lexical_cast<int64_t>(vstr[1]);
-            return true;
-        }
+    if (status.ok() && DecodeRecord(strValue, record)) {
+        propertyId = record.propertyId;
+        amount = record.nValue;
+        return true;
     }
     return false;
 }
@@ -226,54 +256,148 @@ int CMPTxList::getMPTransactionCountTotal()
 }
 
 int CMPTxList::getMPTransactionCountBlock(int block)
+{
+    std::set<uint256> txs;
+    return GetOmniTxsInBlockRange(block, block, txs);
+}
+
+/** Returns a list of all Omni transactions in the given block range. */
+int CMPTxList::GetOmniTxsInBlockRange(int blockFirst, int blockLast, std::set<uint256>& retTxs)
 {
     int count = 0;
-    leveldb::Slice skey, svalue;
+    std::vector<HeightIndexEntry> entries;
+    GetHeightIndexEntries(blockFirst, blockLast, entries);
+
+    for (std::vector<HeightIndexEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        retTxs.insert(it->txid);
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * Returns the entries of the height index in the given block range, ordered by block and txid.
+ *
+ * Block numbers are inclusive.
+ */
+void CMPTxList::GetHeightIndexEntries(int blockFirst, int blockLast, std::vector<HeightIndexEntry>& entries)
+{
+    if (!pdb || blockFirst > blockLast) return;
+
+    const std::string strEnd = HeightIndexKey(blockLast + 1);
     leveldb::Iterator* it = NewIterator();
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        svalue = it->value();
-        if (skey.ToString().length() == 64) {
-            std::string strValue = svalue.ToString();
-            std::vector<std::string> vstr;
-            boost::split(vstr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-            if (4 == vstr.size()) {
-                if (atoi(vstr[1]) == block) {
-                    ++count;
-                }
-            }
+
+    for (it->Seek(HeightIndexKey(blockFirst)); it->Valid() && it->key().compare(strEnd) < 0; it->Next()) {
+        HeightIndexEntry entry;
+        if (ParseHeightIndexEntry(it->key(), it->value(), entry.block, entry.txid, entry.fValid, entry.type)) {
+            entries.push_back(entry);
         }
     }
+
     delete it;
-    return count;
 }
 
-/** Returns a list of all Omni transactions in the given block range. */
-int CMPTxList::GetOmniTxsInBlockRange(int blockFirst, int blockLast, std::set<uint256>& retTxs)
+/**
+ * Adds all transactions to the height index, which were recorded before the index existed.
+ *
+ * Returns the number of indexed transactions.
+ */
+int CMPTxList::BuildHeightIndex()
 {
+    if (!pdb) return 0;
+
     int count = 0;
+    leveldb::WriteBatch batch;
     leveldb::Iterator* it = NewIterator();
-    
+
     for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        const leveldb::Slice& sKey = it->key();
-        const leveldb::Slice& sValue = it->value();
-
-        if (sKey.ToString().length() == 64) {
-            const std::string& strValue = sValue.ToString();
-            std::vector<std::string> vStr;
-            boost::split(vStr, strValue, boost::is_any_of(":"), boost::token_compress_on);
-            if (4 == vStr.size()) {
-                int blockCurrent = atoi(vStr[1]);
-                if (blockCurrent >= blockFirst && blockCurrent <= blockLast) {
-                    retTxs.insert(uint256S(sKey.ToString()));                    
-                    ++count;
+        if (it->key().size() != 64) continue; // only master records are indexed
+        TxRecord record;
+        if (!DecodeRecord(it->value().ToString(), record)) continue;
+        batch.Put(HeightIndexKey(record.block, it->key().ToString()), HeightIndexValue(record.fValid, record.type));
+        ++count;
+    }
+
+    delete it;
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    PrintToLog("%s(): indexed %d transactions by block height: %s\n", __func__, count, status.ToString());
+
+    return status.ok() ? count : -1;
+}
+
+/**
+ * Converts all records, which were stored as strings, into the binary record format.
+ *
+ * The height index is dropped, and has to be rebuilt afterwards.
+ *
+ * Returns the number of converted records.
+ */
+int CMPTxList::UpgradeRecordFormat()
+{
+    if (!pdb) return 0;
+
+    int count = 0;
+    leveldb::WriteBatch batch;
+    leveldb::Iterator* it = NewIterator();
+
+    for (it->SeekToFirst(); it->Valid(); it->Next()) {
+        const std::string strKey = it->key().ToString();
+        const std::string strValue = it->value().ToString();
+        if (strKey == "dbversion" || (!strValue.empty() && strValue[0] == DB_RECORD_FORMAT)) continue;
+        if (strKey[0] == HEIGHT_INDEX_PREFIX) {
+            batch.Delete(strKey);
+            continue;
+        }
+
+        std::string strNewValue;
+        try {
+            if (strKey.size() == 64) {
+                std::vector<std::string> vstr = SplitLegacyRecord(strValue);
+                if (4 == vstr.size()) {
+                    strNewValue = EncodeRecord(TxRecord(atoi(vstr[0]) == 1, atoi(vstr[1]), atoi(vstr[2]), boost::lexical_cast<uint64_t>(vstr[3])));
+                }
+            } else if (boost::algorithm::ends_with(strKey, "-UG")) {
+                std::vector<std::string> vstr = SplitLegacyRecord(strValue, "-");
+                if (2 == vstr.size()) {
+                    strNewValue = EncodeRecord(std::make_pair(boost::lexical_cast<int64_t>(vstr[0]), boost::lexical_cast<int64_t>(vstr[1])));
+                }
+            } else {
+                std::vector<std::string> vstr = SplitLegacyRecord(strValue);
+                if (5 == vstr.size()) {
+                    PaymentRecord payment;
+                    payment.vout = atoi(vstr[0]);
+                    payment.buyer = vstr[1];
+                    payment.seller = vstr[2];
+                    payment.propertyId = atoi64(vstr[3]);
+                    payment.nValue = boost::lexical_cast<uint64_t>(vstr[4]);
+                    strNewValue = EncodeRecord(payment);
+                } else if (2 == vstr.size()) {
+                    SendAllRecord record;
+                    record.propertyId = boost::lexical_cast<uint32_t>(vstr[0]);
+                    record.nValue = boost::lexical_cast<int64_t>(vstr[1]);
+                    strNewValue = EncodeRecord(record);
                 }
             }
+        } catch (const boost::bad_lexical_cast& e) {
+            strNewValue.clear();
         }
+
+        if (strNewValue.empty()) {
+            PrintToLog("%s(): ERROR: unexpected record %s=%s\n", __func__, strKey, strValue);
+            continue;
+        }
+        batch.Put(strKey, strNewValue);
+        ++count;
     }
 
     delete it;
-    return count;
+
+    leveldb::Status status = pdb->Write(syncoptions, &batch);
+    PrintToLog("%s(): converted %d records: %s\n", __func__, count, status.ToString());
+
+    return status.ok() ? count : -1;
 }
 
 /*
@@ -315,13 +439,10 @@ std::pair<int64_t,int64_t> CMPTxList::GetNonFungibleGrant(const uint256& txid)
 {
     std::string strKey = strprintf("%s-UG", txid.ToString());
     std::string strValue;
+    std::pair<int64_t,int64_t> grantedRange;
     leveldb::Status status = pdb->Get(readoptions, strKey, &strValue);
-    if (status.ok()) {
-        std::vector<std::string> vstr;
-        boost::split(vstr, strValue, boost::is_any_of("-"), boost::token_compress_on);
-        if (2 == vstr.size()) {
-            return std::make_pair(boost::lexical_cast<int64_t>(vstr[0]), boost::lexical_cast<int64_t>(vstr[1]));
-        }
+    if (status.ok() && DecodeRecord(strValue, grantedRange)) {
+        return grantedRange;
     }
     return std::make_pair(0,0);
 }
@@ -331,7 +452,7 @@ void CMPTxList::RecordNonFungibleGrant(const uint256& txid, int64_t start, int64
     assert(pdb);
 
     const std::string key = txid.ToString() + "-UG";
-    const std::string value = strprintf("%d-%d", start, end);
+    const std::string value = EncodeRecord(std::make_pair(start, end));
 
     leveldb::Status status = pdb->Put(writeoptions, key, value);
     PrintToLog("%s(): Writing Non-Fungible Grant range %s:%d-%d (%s), line %d, file: %s\n", __FUNCTION__, key, start, end, status.ToString(), __LINE__, __FILE__);
@@ -351,13 +472,17 @@ bool CMPTxList::exists(const uint256 &txid)
     return true;
 }
 
-bool CMPTxList::getTX(const uint256 &txid, std::string& value)
+/**
+ * Retrieves the master record of a transaction.
+ */
+bool CMPTxList::getTX(const uint256& txid, TxRecord& record)
 {
-    leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &value);
+    std::string strValue;
+    leveldb::Status status = pdb->Get(readoptions, txid.ToString(), &strValue);
     ++nRead;
 
     if (status.ok()) {
-        return true;
+        return DecodeRecord(strValue, record);
     }
 
     return false;
@@ -372,67 +497,36 @@ bool CMPTxList::getTX(const uint256 &txid, std::string& value)
 //
 bool CMPTxList::getValidMPTX(const uint256& txid, int* block, unsigned int* type, uint64_t* nAmended)
 {
-    std::string result;
-    int validity = 0;
+    TxRecord record;
 
     if (msc_debug_txdb) PrintToLog("%s()\n", __func__);
 
     if (!pdb) return false;
 
-    if (!getTX(txid, result)) return false;
-
-    // parse the string returned, find the validity flag/bit & other parameters
-    std::vector<std::string> vstr;
-    boost::split(vstr, result, boost::is_any_of(":"), boost::token_compress_on);
-
-    if (msc_debug_txdb) PrintToLog("%s() size=%lu : %s\n", __func__, vstr.size(), result);
-
-    if (1 <= vstr.size()) validity = atoi(vstr[0]);
-
-    if (block) {
-        if (2 <= vstr.size()) *block = atoi(vstr[1]);
-        else *block = 0;
-    }
+    if (!getTX(txid, record)) return false;
 
-    if (type) {
-        if (3 <= vstr.size()) *type = atoi(vstr[2]);
-        else *type = 0;
-    }
+    if (msc_debug_txdb) PrintToLog("%s() : %d:%d:%d:%d\n", __func__, record.fValid, record.block, record.type, record.nValue);
 
-    if (nAmended) {
-        if (4 <= vstr.size()) *nAmended = boost::lexical_cast<boost::uint64_t>(vstr[3]);
-        else nAmended = 0;
-    }
+    if (block) *block = record.block;
+    if (type) *type = record.type;
+    if (nAmended) *nAmended = record.nValue;
 
     if (msc_debug_txdb) printStats();
 
-    if ((int) 0 == validity) return false;
-
-    return true;
+    return record.fValid;
 }
 
 void CMPTxList::LoadAlerts(int blockHeight)
 {
     if (!pdb) return;
-    leveldb::Slice skey, svalue;
-    leveldb::Iterator* it = NewIterator();
-
-    std::vector<std::pair<int64_t, uint256> > loadOrder;
-
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != OMNICORE_MESSAGE_TYPE_ALERT || atoi(vstr[0]) != 1) continue; // not a valid alert
-        uint256 txid = uint256S(it->key().ToString());
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
-    }
 
-    std::sort(loadOrder.begin(), loadOrder.end());
+    // the height index is ordered by block
+    std::vector<HeightIndexEntry> entries;
+    GetHeightIndexEntries(0, blockHeight, entries);
 
-    for (std::vector<std::pair<int64_t, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
-        uint256 txid = (*it).second;
+    for (std::vector<HeightIndexEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->type != OMNICORE_MESSAGE_TYPE_ALERT || !it->fValid) continue; // not a valid alert
+        uint256 txid = it->txid;
         uint256 blockHash;
         CTransactionRef wtx;
         CMPTransaction mp_obj;
@@ -470,7 +564,6 @@ void CMPTxList::LoadAlerts(int blockHeight)
         }
     }
 
-    delete it;
     int64_t blockTime = 0;
     {
         LOCK(cs_main);
@@ -488,27 +581,15 @@ void CMPTxList::LoadActivations(int blockHeight)
 {
     if (!pdb) return;
 
-    leveldb::Slice skey, svalue;
-    leveldb::Iterator* it = NewIterator();
-
     PrintToLog("Loading feature activations from levelDB\n");
 
-    std::vector<std::pair<int64_t, uint256> > loadOrder;
+    // the height index is ordered by block
+    std::vector<HeightIndexEntry> entries;
+    GetHeightIndexEntries(0, blockHeight, entries);
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != OMNICORE_MESSAGE_TYPE_ACTIVATION || atoi(vstr[0]) != 1) continue; // we only care about valid activations
-        uint256 txid = uint256S(it->key().ToString());
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
-    }
-
-    std::sort(loadOrder.begin(), loadOrder.end());
-
-    for (std::vector<std::pair<int64_t, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
-        uint256 hash = (*it).second;
+    for (std::vector<HeightIndexEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        if (it->type != OMNICORE_MESSAGE_TYPE_ACTIVATION || !it->fValid) continue; // we only care about valid activations
+        uint256 hash = it->txid;
         uint256 blockHash;
         CTransactionRef wtx;
         CMPTransaction mp_obj;
@@ -549,7 +630,6 @@ void CMPTxList::LoadActivations(int blockHeight)
             continue;
         }
     }
-    delete it;
     CheckLiveActivations(blockHeight);
 
     // This alert never expires as long as custom activations are used
@@ -565,26 +645,21 @@ bool CMPTxList::LoadFreezeState(int blockHeight)
 
     std::vector<std::pair<std::string, uint256> > loadOrder;
     int txnsLoaded = 0;
-    leveldb::Iterator* it = NewIterator();
     PrintToLog("Loading freeze state from levelDB\n");
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue;
-        uint16_t txtype = atoi(vstr[2]);
+    std::vector<HeightIndexEntry> entries;
+    GetHeightIndexEntries(0, blockHeight, entries);
+
+    for (std::vector<HeightIndexEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        unsigned int txtype = it->type;
         if (txtype != MSC_TYPE_FREEZE_PROPERTY_TOKENS && txtype != MSC_TYPE_UNFREEZE_PROPERTY_TOKENS &&
                 txtype != MSC_TYPE_ENABLE_FREEZING && txtype != MSC_TYPE_DISABLE_FREEZING) continue;
-        if (atoi(vstr[0]) != 1) continue; // invalid, ignore
-        uint256 txid = uint256S(it->key().ToString());
-        int txPosition = pDbTransaction->FetchTransactionPosition(txid);
-        std::string sortKey = strprintf("%06d%010d", atoi(vstr[1]), txPosition);
-        loadOrder.push_back(std::make_pair(sortKey, txid));
+        if (!it->fValid) continue; // invalid, ignore
+        int txPosition = pDbTransaction->FetchTransactionPosition(it->txid);
+        std::string sortKey = strprintf("%06d%010d", it->block, txPosition);
+        loadOrder.push_back(std::make_pair(sortKey, it->txid));
     }
 
-    delete it;
-
     std::sort(loadOrder.begin(), loadOrder.end());
 
     for (std::vector<std::pair<std::string, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
@@ -638,24 +713,17 @@ bool CMPTxList::CheckForFreezeTxs(int blockHeight)
 {
     assert(pdb);
 
-    leveldb::Iterator* it = NewIterator();
+    std::vector<HeightIndexEntry> entries;
+    GetHeightIndexEntries(blockHeight, std::numeric_limits<int>::max() - 1, entries);
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue;
-        int block = atoi(vstr[1]);
-        if (block < blockHeight) continue;
-        uint16_t txtype = atoi(vstr[2]);
+    for (std::vector<HeightIndexEntry>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        unsigned int txtype = it->type;
         if (txtype == MSC_TYPE_FREEZE_PROPERTY_TOKENS || txtype == MSC_TYPE_UNFREEZE_PROPERTY_TOKENS ||
                 txtype == MSC_TYPE_ENABLE_FREEZING || txtype == MSC_TYPE_DISABLE_FREEZING) {
-            delete it;
             return true;
         }
     }
 
-    delete it;
     return false;
 }
 
@@ -674,7 +742,7 @@ void CMPTxList::printAll()
         skey = it->key();
         svalue = it->value();
         ++count;
-        PrintToConsole("entry #%8d= %s:%s\n", count, skey.ToString(), svalue.ToString());
+        PrintToConsole("entry #%8d= %s:%s\n", count, skey.ToString(), HexStr(svalue.ToString()));
     }
 
     delete it;
@@ -682,43 +750,37 @@ void CMPTxList::printAll()
 
 // figure out if there was at least 1 Master Protocol transaction within the block range, or a block if starting equals ending
 // block numbers are inclusive
-// pass in bDeleteFound = true to erase each entry found within the block range
+// pass in bDeleteFound = true to erase each entry found within the block range, including its sub records
 bool CMPTxList::isMPinBlockRange(int starting_block, int ending_block, bool bDeleteFound)
 {
-    leveldb::Slice skey, svalue;
-    unsigned int count = 0;
-    std::vector<std::string> vstr;
-    int block;
     unsigned int n_found = 0;
+    std::vector<HeightIndexEntry> entries;
+    GetHeightIndexEntries(starting_block, ending_block, entries);
 
+    leveldb::WriteBatch batch;
     leveldb::Iterator* it = NewIterator();
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        skey = it->key();
-        svalue = it->value();
-
-        ++count;
-
-        std::string strvalue = it->value().ToString();
+    for (std::vector<HeightIndexEntry>::const_iterator entry = entries.begin(); entry != entries.end(); ++entry) {
+        const std::string txidStr = entry->txid.ToString();
+        ++n_found;
+        PrintToLog("%s() DELETING: %s (block %d)\n", __func__, txidStr, entry->block);
+        if (!bDeleteFound) continue;
 
-        // parse the string returned, find the validity flag/bit & other parameters
-        boost::split(vstr, strvalue, boost::is_any_of(":"), boost::token_compress_on);
+        // the master record is followed by its sub records, which are prefixed with the txid
+        for (it->Seek(txidStr); it->Valid() && it->key().starts_with(txidStr); it->Next()) {
+            batch.Delete(it->key());
+        }
+        batch.Delete(HeightIndexKey(entry->block, txidStr));
+    }
 
-        // only care about the block number/height here
-        if (2 <= vstr.size()) {
-            block = atoi(vstr[1]);
+    delete it;
 
-            if ((starting_block <= block) && (block <= ending_block)) {
-                ++n_found;
-                PrintToLog("%s() DELETING: %s=%s\n", __func__, skey.ToString(), svalue.ToString());
-                if (bDeleteFound) pdb->Delete(writeoptions, skey);
-            }
-        }
+    if (bDeleteFound && n_found > 0) {
+        leveldb::Status status = pdb->Write(writeoptions, &batch);
+        if (!status.ok()) PrintToLog("%s(): ERROR: %s\n", __func__, status.ToString());
     }
 
     PrintToLog("%s(%d, %d); n_found= %d\n", __func__, starting_block, ending_block, n_found);
 
-    delete it;
-
     return (n_found);
 }
@@ -5,18 +5,99 @@
 #include <omnicore/nftdb.h>
 
 #include <fs.h>
+#include <serialize.h>
 #include <uint256.h>
 
 #include <stdint.h>
 
 #include <set>
 #include <string>
+#include <vector>
 
 /** LevelDB based storage for transactions, with txid as key and validity bit, and other data as value.
+ *
+ * Each transaction is also recorded in a height index, with block and txid as
+ * key, and validity bit and type as value, so that block ranges can be
+ * queried without iterating over all transactions.
+ *
+ * Values are stored in the binary record format of CDBBase.
  */
 class CMPTxList : public CDBBase
 {
 public:
+    /** Master record of a transaction, stored with the txid as key. */
+    struct TxRecord
+    {
+        bool fValid;
+        int block;
+        uint32_t type;
+        //! Amount of the transaction, or the number of sub records
+        uint64_t nValue;
+
+        TxRecord() : fValid(false), block(0), type(0), nValue(0) {}
+        TxRecord(bool fValidIn, int blockIn, uint32_t typeIn, uint64_t nValueIn)
+          : fValid(fValidIn), block(blockIn), type(typeIn), nValue(nValueIn) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(fValid);
+            READWRITE(VARINT(block, VarIntMode::NONNEGATIVE_SIGNED));
+            READWRITE(VARINT(type));
+            READWRITE(VARINT(nValue));
+        }
+    };
+
+    /** Sub record of a DEx payment, stored with txid and payment number as key. */
+    struct PaymentRecord
+    {
+        uint32_t vout;
+        std::string buyer;
+        std::string seller;
+        uint32_t propertyId;
+        uint64_t nValue;
+
+        PaymentRecord() : vout(0), propertyId(0), nValue(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(VARINT(vout));
+            READWRITE(buyer);
+            READWRITE(seller);
+            READWRITE(VARINT(propertyId));
+            READWRITE(VARINT(nValue));
+        }
+    };
+
+    /** Sub record of a "send all" transaction, stored with txid and sub record number as key. */
+    struct SendAllRecord
+    {
+        uint32_t propertyId;
+        int64_t nValue;
+
+        SendAllRecord() : propertyId(0), nValue(0) {}
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action) {
+            READWRITE(VARINT(propertyId));
+            READWRITE(nValue);
+        }
+    };
+
+    /** Entry of the height index. */
+    struct HeightIndexEntry
+    {
+        int block;
+        uint256 txid;
+        bool fValid;
+        unsigned int type;
+    };
+
     CMPTxList(const fs::path& path, bool fWipe);
     virtual ~CMPTxList();
 
@@ -28,6 +109,8 @@ public:
     void RecordNonFungibleGrant(const uint256 &txid, int64_t start, int64_t end);
 
     std::string getKeyValue(std::string key);
+    /** Retrieves the master record of a transaction. */
+    bool getTX(const uint256& txid, TxRecord& record);
     /** Returns the number of sub records. */
     int getNumberOfSubRecords(const uint256& txid);
     bool getPurchaseDetails(const uint256 txid, int purchaseNumber, std::string* buyer, std::string* seller, uint64_t* vout, uint64_t *propertyId, uint64_t* nValue);
@@ -40,12 +123,17 @@ public:
     int getMPTransactionCountBlock(int block);
     /** Returns a list of all Omni transactions in the given block range. */
     int GetOmniTxsInBlockRange(int blockFirst, int blockLast, std::set<uint256>& retTxs);
+    /** Returns the entries of the height index in the given block range, ordered by block and txid. */
+    void GetHeightIndexEntries(int blockFirst, int blockLast, std::vector<HeightIndexEntry>& entries);
+    /** Adds all transactions to the height index, which were recorded before the index existed. */
+    int BuildHeightIndex();
+    /** Converts all records, which were stored as strings, into the binary record format. */
+    int UpgradeRecordFormat();
 
     int getDBVersion();
     int setDBVersion();
 
     bool exists(const uint256& txid);
-    bool getTX(const uint256& txid, std::string& value);
     bool getValidMPTX(const uint256& txid, int* block = nullptr, unsigned int* type = nullptr, uint64_t* nAmended = nullptr);
 
     void LoadAlerts(int blockHeight);
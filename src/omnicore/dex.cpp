@@ -6,8 +6,10 @@
 
 #include <omnicore/dex.h>
 
+#include <omnicore/consensushash.h>
 #include <omnicore/convert.h>
 #include <omnicore/dbtxlist.h>
+#include <omnicore/journal.h>
 #include <omnicore/log.h>
 #include <omnicore/rules.h>
 #include <omnicore/uint256_extensions.h>
@@ -245,6 +247,8 @@ int DEx_offerCreate(const std::string& addressSeller, uint32_t propertyId, int64
         assert(update_tally_map(addressSeller, propertyId, amountOffered, SELLOFFER_RESERVE));
 
         CMPOffer sellOffer(block, amountOffered, propertyId, amountDesired, minAcceptFee, paymentWindow, txid);
+        JournalOfferChange(key);
+        UpdateStateHashOffer(key);
         my_offers.insert(std::make_pair(key, sellOffer));
 
         rc = 0;
@@ -277,6 +281,8 @@ int DEx_offerDestroy(const std::string& addressSeller, uint32_t propertyId)
     // delete the offer
     const std::string key = STR_SELLOFFER_ADDR_PROP_COMBO(addressSeller, propertyId);
     OfferMap::iterator it = my_offers.find(key);
+    JournalOfferChange(key);
+    UpdateStateHashOffer(key);
     my_offers.erase(it);
 
     if (msc_debug_dex) PrintToLog("%s(%s|%s)\n", __func__, addressSeller, key);
@@ -361,6 +367,8 @@ int DEx_acceptCreate(const std::string& addressBuyer, const std::string& address
         assert(update_tally_map(addressSeller, propertyId, amountReserved, ACCEPT_RESERVE));
 
         CMPAccept acceptOffer(amountReserved, block, offer.getBlockTimeLimit(), offer.getProperty(), offer.getOfferAmountOriginal(), offer.getBTCDesiredOriginal(), offer.getHash());
+        JournalAcceptChange(keyAcceptOrder);
+        UpdateStateHashAccept(keyAcceptOrder);
         my_accepts.insert(std::make_pair(keyAcceptOrder, acceptOffer));
 
         rc = 0;
@@ -425,6 +433,8 @@ int DEx_acceptDestroy(const std::string& addressBuyer, const std::string& addres
         AcceptMap::iterator it = my_accepts.find(key);
 
         if (my_accepts.end() != it) {
+            JournalAcceptChange(key);
+            UpdateStateHashAccept(key);
             my_accepts.erase(it);
         }
     }
@@ -546,6 +556,9 @@ int DEx_payment(const uint256& txid, unsigned int vout, const std::string& addre
     }
 
     // reduce the amount of units still desired by the buyer and if 0 destroy the Accept order
+    const std::string keyAccept = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(addressSeller, addressBuyer, propertyId);
+    JournalAcceptChange(keyAccept);
+    UpdateStateHashAccept(keyAccept);
     if (p_accept->reduceAcceptAmountRemaining_andIsZero(amountPurchased)) {
         const int64_t reserveSell = GetTokenBalance(addressSeller, propertyId, SELLOFFER_RESERVE);
         const int64_t reserveAccept = GetTokenBalance(addressSeller, propertyId, ACCEPT_RESERVE);
@@ -586,6 +599,8 @@ unsigned int eraseExpiredAccepts(int blockNow)
 
             DEx_acceptDestroy(addressBuyer, addressSeller, propertyId);
 
+            JournalAcceptChange(it->first);
+            UpdateStateHashAccept(it->first);
             my_accepts.erase(it++);
 
             ++how_many_erased;
@@ -9,7 +9,6 @@
 #include <random.h>
 #include <script/script.h>
 #include <script/standard.h>
-#include <util/strencodings.h>
 
 #include <stdint.h>
 #include <string>
@@ -28,8 +27,8 @@ bool OmniCore_Encode_ClassB(const std::string& senderAddress, const CPubKey& red
     unsigned int nRemainingBytes = vchPayload.size();
     unsigned int nNextByte = 0;
     unsigned char chSeqNum = 1;
-    std::string strObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
-    PrepareObfuscatedHashes(senderAddress, MAX_SHA256_OBFUSCATION_TIMES, strObfuscatedHashes);
+    unsigned char obfuscationHashes[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE];
+    PrepareObfuscatedHashes(senderAddress, MAX_SHA256_OBFUSCATION_TIMES, obfuscationHashes);
     while (nRemainingBytes > 0) {
         int nKeys = 1; // Assume one key of data, because we have data remaining
         if (nRemainingBytes > (PACKET_SIZE - 1)) { nKeys += 1; } // ... or enough data to embed in 2 keys
@@ -45,9 +44,9 @@ bool OmniCore_Encode_ClassB(const std::string& senderAddress, const CPubKey& red
             vchFakeKey.resize(PACKET_SIZE); // Pad to 31 total bytes with zeros
             nNextByte += nCurrentBytes;
             nRemainingBytes -= nCurrentBytes;
-            std::vector<unsigned char> vchHash = ParseHex(strObfuscatedHashes[chSeqNum]);
+            const unsigned char* pchHash = obfuscationHashes[chSeqNum];
             for (size_t j = 0; j < PACKET_SIZE; j++) { // Xor in the obfuscation
-                vchFakeKey[j] = vchFakeKey[j] ^ vchHash[j];
+                vchFakeKey[j] = vchFakeKey[j] ^ pchHash[j];
             }
             vchFakeKey.insert(vchFakeKey.begin(), 0x02); // Prepend a public key prefix
             vchFakeKey.resize(33);
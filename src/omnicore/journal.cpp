@@ -0,0 +1,358 @@
+/**
+ * @file journal.cpp
+ *
+ * This file records the changes of the in-memory state per block.
+ *
+ * The journal allows to revert the last blocks in memory during a
+ * reorganization, and to persist the state after a block as delta to the
+ * state after the previous block.
+ */
+
+#include <omnicore/journal.h>
+
+#include <omnicore/consensushash.h>
+#include <omnicore/dbspinfo.h>
+#include <omnicore/dex.h>
+#include <omnicore/log.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <chain.h>
+#include <hash.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+
+extern std::set<std::pair<std::string, uint32_t> > setFrozenAddresses;
+extern std::set<std::pair<uint32_t, int> > setFreezingEnabledProperties;
+
+using namespace mastercore;
+
+CMPBlockDelta::CMPBlockDelta()
+  : block(0), nextSPIDBefore(0), nextSPIDAfter(0), nextTestSPIDBefore(0), nextTestSPIDAfter(0)
+{
+}
+
+size_t CMPBlockDelta::size() const
+{
+    return tally.size()
+            + offersRemoved.size() + offersAdded.size()
+            + acceptsRemoved.size() + acceptsAdded.size()
+            + crowdsRemoved.size() + crowdsAdded.size()
+            + frozenRemoved.size() + frozenAdded.size()
+            + freezingRemoved.size() + freezingAdded.size();
+}
+
+namespace
+{
+/** The entries of the state, which were changed by the current block, as they were before the block. */
+struct BlockBeginState
+{
+    //! Keys of the changed entries
+    std::set<std::string> offerKeys;
+    std::set<std::string> acceptKeys;
+    std::set<std::string> crowdKeys;
+    std::set<std::pair<std::string, uint32_t> > frozenElements;
+    std::set<std::pair<uint32_t, int> > freezingElements;
+
+    //! Changed entries, which existed before the block
+    OfferMap offers;
+    AcceptMap accepts;
+    CrowdMap crowds;
+    std::set<std::pair<std::string, uint32_t> > frozenAddresses;
+    std::set<std::pair<uint32_t, int> > freezingEnabledProperties;
+};
+
+//! Changes of the last blocks, oldest first, each block connecting to the previous one
+std::deque<CMPBlockDelta> journal;
+//! Changes of the block, which is currently processed, or nullptr, if not recording
+std::unique_ptr<CMPBlockDelta> pendingDelta;
+//! Entries changed by the block, which is currently processed, as they were before the block
+std::unique_ptr<BlockBeginState> pendingBegin;
+
+/** Saves an entry of a map, unless it was already changed by the current block. */
+template <typename Map>
+void SaveEntry(const Map& current, const std::string& key, std::set<std::string>& keys, Map& before)
+{
+    if (!keys.insert(key).second) {
+        return;
+    }
+    typename Map::const_iterator it = current.find(key);
+    if (it != current.end()) {
+        before.insert(*it);
+    }
+}
+
+/** Records the changed entries of a map, which were removed, added or modified. */
+template <typename Map>
+void DiffEntries(const std::set<std::string>& keys, const Map& before, const Map& after, Map& removed, Map& added)
+{
+    for (std::set<std::string>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+        typename Map::const_iterator itBefore = before.find(*it);
+        typename Map::const_iterator itAfter = after.find(*it);
+
+        if (itBefore != before.end() && itAfter != after.end()) {
+            if (SerializeHash(itBefore->second) != SerializeHash(itAfter->second)) {
+                removed.insert(*itBefore);
+                added.insert(*itAfter);
+            }
+        } else if (itBefore != before.end()) {
+            removed.insert(*itBefore);
+        } else if (itAfter != after.end()) {
+            added.insert(*itAfter);
+        }
+    }
+}
+
+/** Saves whether an element is part of a set, unless it was already changed by the current block. */
+template <typename Set>
+void SaveElement(const Set& current, const typename Set::value_type& element, Set& elements, Set& before)
+{
+    if (elements.insert(element).second && current.count(element)) {
+        before.insert(element);
+    }
+}
+
+/** Records the changed elements of a set, which were removed or added. */
+template <typename Set>
+void DiffElements(const Set& elements, const Set& before, const Set& after, Set& removed, Set& added)
+{
+    for (typename Set::const_iterator it = elements.begin(); it != elements.end(); ++it) {
+        bool fBefore = before.count(*it) > 0;
+        bool fAfter = after.count(*it) > 0;
+        if (fBefore && !fAfter) {
+            removed.insert(*it);
+        } else if (!fBefore && fAfter) {
+            added.insert(*it);
+        }
+    }
+}
+
+/** Removes the entries of one map and inserts the entries of another one, and updates the state hash. */
+template <typename Map>
+void ReplaceEntries(Map& target, const Map& remove, const Map& insert, void (*updateStateHash)(const std::string&))
+{
+    for (typename Map::const_iterator it = remove.begin(); it != remove.end(); ++it) {
+        updateStateHash(it->first);
+        target.erase(it->first);
+    }
+    for (typename Map::const_iterator it = insert.begin(); it != insert.end(); ++it) {
+        updateStateHash(it->first);
+        target.erase(it->first);
+        target.insert(*it);
+    }
+}
+
+/** Removes the elements of one set and inserts the elements of another one. */
+template <typename Set>
+void ReplaceElements(Set& target, const Set& remove, const Set& insert)
+{
+    for (typename Set::const_iterator it = remove.begin(); it != remove.end(); ++it) {
+        target.erase(*it);
+    }
+    target.insert(insert.begin(), insert.end());
+}
+} // anonymous namespace
+
+void mastercore::JournalBlockBegin(const CBlockIndex* pBlockIndex)
+{
+    LOCK(cs_tally);
+
+    pendingDelta.reset(new CMPBlockDelta());
+    pendingDelta->blockHash = pBlockIndex->GetBlockHash();
+    if (pBlockIndex->pprev) pendingDelta->prevBlockHash = pBlockIndex->pprev->GetBlockHash();
+    pendingDelta->block = pBlockIndex->nHeight;
+    pendingDelta->nextSPIDBefore = pDbSpInfo->peekNextSPID(1);
+    pendingDelta->nextTestSPIDBefore = pDbSpInfo->peekNextSPID(2);
+
+    pendingBegin.reset(new BlockBeginState());
+}
+
+void mastercore::JournalTallyChange(const std::string& address, uint32_t propertyId, int64_t amount, TallyType ttype)
+{
+    if (!pendingDelta || ttype == PENDING) {
+        return;
+    }
+
+    CMPBlockDelta::TallyKey key(address, std::make_pair(propertyId, static_cast<uint8_t>(ttype)));
+    int64_t& netAmount = pendingDelta->tally[key];
+    netAmount += amount;
+    if (netAmount == 0) {
+        pendingDelta->tally.erase(key);
+    }
+}
+
+void mastercore::JournalOfferChange(const std::string& key)
+{
+    if (pendingBegin) {
+        SaveEntry(my_offers, key, pendingBegin->offerKeys, pendingBegin->offers);
+    }
+}
+
+void mastercore::JournalAcceptChange(const std::string& key)
+{
+    if (pendingBegin) {
+        SaveEntry(my_accepts, key, pendingBegin->acceptKeys, pendingBegin->accepts);
+    }
+}
+
+void mastercore::JournalCrowdChange(const std::string& key)
+{
+    if (pendingBegin) {
+        SaveEntry(my_crowds, key, pendingBegin->crowdKeys, pendingBegin->crowds);
+    }
+}
+
+void mastercore::JournalFrozenAddressChange(const std::string& address, uint32_t propertyId)
+{
+    if (pendingBegin) {
+        SaveElement(setFrozenAddresses, std::make_pair(address, propertyId), pendingBegin->frozenElements, pendingBegin->frozenAddresses);
+    }
+}
+
+void mastercore::JournalFreezingChange(uint32_t propertyId, int liveBlock)
+{
+    if (pendingBegin) {
+        SaveElement(setFreezingEnabledProperties, std::make_pair(propertyId, liveBlock), pendingBegin->freezingElements, pendingBegin->freezingEnabledProperties);
+    }
+}
+
+void mastercore::JournalBlockEnd(const CBlockIndex* pBlockIndex)
+{
+    LOCK(cs_tally);
+
+    if (!pendingDelta || pendingDelta->blockHash != pBlockIndex->GetBlockHash()) {
+        pendingDelta.reset();
+        pendingBegin.reset();
+        return;
+    }
+
+    CMPBlockDelta& delta = *pendingDelta;
+    const BlockBeginState& begin = *pendingBegin;
+    DiffEntries(begin.offerKeys, begin.offers, my_offers, delta.offersRemoved, delta.offersAdded);
+    DiffEntries(begin.acceptKeys, begin.accepts, my_accepts, delta.acceptsRemoved, delta.acceptsAdded);
+    DiffEntries(begin.crowdKeys, begin.crowds, my_crowds, delta.crowdsRemoved, delta.crowdsAdded);
+    DiffElements(begin.frozenElements, begin.frozenAddresses, setFrozenAddresses, delta.frozenRemoved, delta.frozenAdded);
+    DiffElements(begin.freezingElements, begin.freezingEnabledProperties, setFreezingEnabledProperties, delta.freezingRemoved, delta.freezingAdded);
+    delta.nextSPIDAfter = pDbSpInfo->peekNextSPID(1);
+    delta.nextTestSPIDAfter = pDbSpInfo->peekNextSPID(2);
+
+    if (msc_debug_persistence) {
+        PrintToLog("%s(): block %d, %d changes\n", __func__, delta.block, delta.size());
+    }
+
+    AddBlockDelta(delta);
+    pendingDelta.reset();
+    pendingBegin.reset();
+}
+
+const CMPBlockDelta* mastercore::GetBlockDelta(const uint256& blockHash)
+{
+    LOCK(cs_tally);
+
+    for (std::deque<CMPBlockDelta>::const_reverse_iterator it = journal.rbegin(); it != journal.rend(); ++it) {
+        if (it->blockHash == blockHash) {
+            return &(*it);
+        }
+    }
+
+    return nullptr;
+}
+
+void mastercore::AddBlockDelta(const CMPBlockDelta& delta)
+{
+    LOCK(cs_tally);
+
+    // the journal must not have gaps, otherwise it can't be used to rewind
+    if (!journal.empty() && journal.back().blockHash != delta.prevBlockHash) {
+        journal.clear();
+    }
+
+    journal.push_back(delta);
+
+    while (journal.size() > static_cast<size_t>(MAX_STATE_HISTORY)) {
+        journal.pop_front();
+    }
+}
+
+void mastercore::ApplyBlockDelta(const CMPBlockDelta& delta, bool fUndo)
+{
+    LOCK(cs_tally);
+
+    // the net changes may debit addresses, which were frozen only before or after the debit
+    std::set<std::pair<std::string, uint32_t> > frozenAddresses;
+    frozenAddresses.swap(setFrozenAddresses);
+
+    for (std::map<CMPBlockDelta::TallyKey, int64_t>::const_iterator it = delta.tally.begin(); it != delta.tally.end(); ++it) {
+        const std::string& address = it->first.first;
+        uint32_t propertyId = it->first.second.first;
+        TallyType ttype = static_cast<TallyType>(it->first.second.second);
+        int64_t amount = fUndo ? -it->second : it->second;
+        update_tally_map(address, propertyId, amount, ttype);
+    }
+
+    frozenAddresses.swap(setFrozenAddresses);
+
+    if (fUndo) {
+        ReplaceEntries(my_offers, delta.offersAdded, delta.offersRemoved, UpdateStateHashOffer);
+        ReplaceEntries(my_accepts, delta.acceptsAdded, delta.acceptsRemoved, UpdateStateHashAccept);
+        ReplaceEntries(my_crowds, delta.crowdsAdded, delta.crowdsRemoved, UpdateStateHashCrowd);
+        ReplaceElements(setFrozenAddresses, delta.frozenAdded, delta.frozenRemoved);
+        ReplaceElements(setFreezingEnabledProperties, delta.freezingAdded, delta.freezingRemoved);
+        pDbSpInfo->init(delta.nextSPIDBefore, delta.nextTestSPIDBefore);
+    } else {
+        ReplaceEntries(my_offers, delta.offersRemoved, delta.offersAdded, UpdateStateHashOffer);
+        ReplaceEntries(my_accepts, delta.acceptsRemoved, delta.acceptsAdded, UpdateStateHashAccept);
+        ReplaceEntries(my_crowds, delta.crowdsRemoved, delta.crowdsAdded, UpdateStateHashCrowd);
+        ReplaceElements(setFrozenAddresses, delta.frozenRemoved, delta.frozenAdded);
+        ReplaceElements(setFreezingEnabledProperties, delta.freezingRemoved, delta.freezingAdded);
+        pDbSpInfo->init(delta.nextSPIDAfter, delta.nextTestSPIDAfter);
+    }
+}
+
+bool mastercore::RewindJournal(int nHeight)
+{
+    LOCK(cs_tally);
+
+    pendingDelta.reset();
+    pendingBegin.reset();
+
+    if (journal.empty() || journal.front().block > nHeight || journal.back().block < nHeight) {
+        return false;
+    }
+
+    while (!journal.empty() && journal.back().block >= nHeight) {
+        const CMPBlockDelta& delta = journal.back();
+        ApplyBlockDelta(delta, true);
+
+        if (pDbSpInfo->popBlock(delta.blockHash) < 0) {
+            PrintToLog("%s(): ERROR: failed to roll back properties of block %s\n", __func__, delta.blockHash.GetHex());
+            journal.clear();
+            return false;
+        }
+        pDbSpInfo->setWatermark(delta.prevBlockHash);
+
+        PrintToLog("%s(): reverted block %d (%s) in memory\n", __func__, delta.block, delta.blockHash.GetHex());
+        journal.pop_back();
+    }
+
+    return true;
+}
+
+void mastercore::ClearJournal()
+{
+    LOCK(cs_tally);
+
+    journal.clear();
+    pendingDelta.reset();
+    pendingBegin.reset();
+}
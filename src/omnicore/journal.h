@@ -0,0 +1,131 @@
+#ifndef BITCOIN_OMNICORE_JOURNAL_H
+#define BITCOIN_OMNICORE_JOURNAL_H
+
+#include <omnicore/dex.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <serialize.h>
+#include <uint256.h>
+
+#include <stdint.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+
+/** Changes of the in-memory state, caused by a single block.
+ *
+ * Balances are recorded as net amount per address, property and tally type.
+ * DEx offers, DEx accepts, crowdsales and the freeze state are recorded as
+ * the entries, which were removed and added by the block. A modified entry is
+ * both removed and added. This allows to apply a delta in both directions.
+ */
+class CMPBlockDelta
+{
+public:
+    //! Key of a balance: address, property identifier and tally type
+    typedef std::pair<std::string, std::pair<uint32_t, uint8_t> > TallyKey;
+
+    uint256 blockHash;
+    uint256 prevBlockHash;
+    int block;
+
+    //! Net balance changes
+    std::map<TallyKey, int64_t> tally;
+
+    mastercore::OfferMap offersRemoved;
+    mastercore::OfferMap offersAdded;
+    mastercore::AcceptMap acceptsRemoved;
+    mastercore::AcceptMap acceptsAdded;
+    mastercore::CrowdMap crowdsRemoved;
+    mastercore::CrowdMap crowdsAdded;
+
+    std::set<std::pair<std::string, uint32_t> > frozenRemoved;
+    std::set<std::pair<std::string, uint32_t> > frozenAdded;
+    std::set<std::pair<uint32_t, int> > freezingRemoved;
+    std::set<std::pair<uint32_t, int> > freezingAdded;
+
+    //! Next property identifiers before and after the block
+    uint32_t nextSPIDBefore;
+    uint32_t nextSPIDAfter;
+    uint32_t nextTestSPIDBefore;
+    uint32_t nextTestSPIDAfter;
+
+    CMPBlockDelta();
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(blockHash);
+        READWRITE(prevBlockHash);
+        READWRITE(block);
+        READWRITE(tally);
+        READWRITE(offersRemoved);
+        READWRITE(offersAdded);
+        READWRITE(acceptsRemoved);
+        READWRITE(acceptsAdded);
+        READWRITE(crowdsRemoved);
+        READWRITE(crowdsAdded);
+        READWRITE(frozenRemoved);
+        READWRITE(frozenAdded);
+        READWRITE(freezingRemoved);
+        READWRITE(freezingAdded);
+        READWRITE(nextSPIDBefore);
+        READWRITE(nextSPIDAfter);
+        READWRITE(nextTestSPIDBefore);
+        READWRITE(nextTestSPIDAfter);
+    }
+
+    /** Returns the number of recorded changes. */
+    size_t size() const;
+};
+
+namespace mastercore
+{
+/** Starts recording the changes of a block. */
+void JournalBlockBegin(const CBlockIndex* pBlockIndex);
+
+/** Records a balance change of the current block. */
+void JournalTallyChange(const std::string& address, uint32_t propertyId, int64_t amount, TallyType ttype);
+
+/** Records, that a DEx offer of the current block is about to be added, modified or removed. */
+void JournalOfferChange(const std::string& key);
+
+/** Records, that a DEx accept of the current block is about to be added, modified or removed. */
+void JournalAcceptChange(const std::string& key);
+
+/** Records, that a crowdsale of the current block is about to be added, modified or removed. */
+void JournalCrowdChange(const std::string& key);
+
+/** Records, that an address of the current block is about to be frozen or unfrozen. */
+void JournalFrozenAddressChange(const std::string& address, uint32_t propertyId);
+
+/** Records, that freezing of a property is about to be enabled or disabled in the current block. */
+void JournalFreezingChange(uint32_t propertyId, int liveBlock);
+
+/** Finishes recording the changes of a block, and adds them to the journal. */
+void JournalBlockEnd(const CBlockIndex* pBlockIndex);
+
+/** Returns the recorded changes of a block, or nullptr, if the block is not in the journal. */
+const CMPBlockDelta* GetBlockDelta(const uint256& blockHash);
+
+/** Adds the changes of a block, which were restored from disk, to the journal. */
+void AddBlockDelta(const CMPBlockDelta& delta);
+
+/** Applies the changes of a block to the in-memory state, or reverts them. */
+void ApplyBlockDelta(const CMPBlockDelta& delta, bool fUndo);
+
+/** Reverts all blocks at and above the given height, if the journal covers them. */
+bool RewindJournal(int nHeight);
+
+/** Removes all blocks from the journal. */
+void ClearJournal();
+}
+
+#endif // BITCOIN_OMNICORE_JOURNAL_H
@@ -123,6 +123,19 @@ static void DebugLogInit()
     mutexDebugLog = new std::mutex();
 }
 
+//! Buffer of the current thread, which receives the log output instead of the log file, if set
+static thread_local std::vector<std::string>* pLogCapture = nullptr;
+
+CLogCapture::CLogCapture(std::vector<std::string>& buffer) : pPrevious(pLogCapture)
+{
+    pLogCapture = &buffer;
+}
+
+CLogCapture::~CLogCapture()
+{
+    pLogCapture = pPrevious;
+}
+
 /**
  * @return The current timestamp in the format: 2009-01-03 18:15:05
  */
@@ -140,11 +153,19 @@ static std::string GetTimestamp()
  * If "-printtoconsole" is enabled, then the message is written to the standard
  * output, usually the console, instead of a log file.
  *
+ * While a CLogCapture is active on the calling thread, the message is stored
+ * in its buffer instead.
+ *
  * @param str[in]  The message to log
  * @return The total number of characters written
  */
 int LogFilePrint(const std::string& str)
 {
+    if (pLogCapture) {
+        pLogCapture->push_back(str);
+        return str.size();
+    }
+
     int ret = 0; // Number of characters written
     if (LogInstance().m_print_to_console) {
         // Print to console
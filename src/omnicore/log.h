@@ -5,10 +5,23 @@
 #include <tinyformat.h>
 
 #include <string>
+#include <vector>
 
 /** Prints to the log file. */
 int LogFilePrint(const std::string& str);
 
+/** Collects the log file output of the current thread, while in scope, so it can be printed later. */
+class CLogCapture
+{
+private:
+    //! Buffer of an enclosing capture, restored when going out of scope
+    std::vector<std::string>* pPrevious;
+
+public:
+    explicit CLogCapture(std::vector<std::string>& buffer);
+    ~CLogCapture();
+};
+
 /** Prints to the console. */
 int ConsolePrint(const std::string& str);
 
@@ -0,0 +1,82 @@
+#ifndef BITCOIN_OMNICORE_LRUCACHE_H
+#define BITCOIN_OMNICORE_LRUCACHE_H
+
+#include <stddef.h>
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+/** Bounded cache, which evicts the least recently used entry, once full.
+ *
+ * The cache is not thread-safe, and access must be synchronized by the owner.
+ */
+template <typename Key, typename Value>
+class CMPLruCache
+{
+private:
+    typedef std::list<std::pair<Key, Value> > ItemList;
+
+    //! Maximal number of cached entries
+    size_t nCapacity;
+    //! Cached entries, most recently used first
+    ItemList items;
+    //! Position of the cached entries
+    std::unordered_map<Key, typename ItemList::iterator> index;
+
+public:
+    explicit CMPLruCache(size_t capacity) : nCapacity(capacity) {}
+
+    /** Copies a cached value, and marks it as most recently used. */
+    bool get(const Key& key, Value& value)
+    {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return false;
+        }
+        items.splice(items.begin(), items, it->second);
+        value = it->second->second;
+        return true;
+    }
+
+    /** Adds or replaces a value, and evicts the least recently used one, if the cache is full. */
+    void put(const Key& key, const Value& value)
+    {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            it->second->second = value;
+            items.splice(items.begin(), items, it->second);
+            return;
+        }
+        if (nCapacity == 0) {
+            return;
+        }
+        if (items.size() >= nCapacity) {
+            index.erase(items.back().first);
+            items.pop_back();
+        }
+        items.emplace_front(key, value);
+        index.emplace(key, items.begin());
+    }
+
+    /** Removes a value from the cache. */
+    void erase(const Key& key)
+    {
+        auto it = index.find(key);
+        if (it != index.end()) {
+            items.erase(it->second);
+            index.erase(it);
+        }
+    }
+
+    /** Removes all values from the cache. */
+    void clear()
+    {
+        items.clear();
+        index.clear();
+    }
+
+    size_t size() const { return items.size(); }
+};
+
+#endif // BITCOIN_OMNICORE_LRUCACHE_H
@@ -9,12 +9,15 @@
 #include <omnicore/activation.h>
 #include <omnicore/consensushash.h>
 #include <omnicore/convert.h>
+#include <omnicore/dbaddressindex.h>
 #include <omnicore/dbbase.h>
+#include <omnicore/dbpropertyindex.h>
 #include <omnicore/dbspinfo.h>
 #include <omnicore/dbstolist.h>
 #include <omnicore/dbtransaction.h>
 #include <omnicore/dbtxlist.h>
 #include <omnicore/dex.h>
+#include <omnicore/journal.h>
 #include <omnicore/log.h>
 #include <omnicore/notifications.h>
 #include <omnicore/parsing.h>
@@ -33,6 +36,7 @@
 
 #include <base58.h>
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <coins.h>
 #include <core_io.h>
 #include <fs.h>
@@ -48,6 +52,7 @@
 #include <tinyformat.h>
 #include <uint256.h>
 #include <ui_interface.h>
+#include <undo.h>
 #include <util/system.h>
 #include <util/strencodings.h>
 #include <util/time.h>
@@ -63,9 +68,14 @@
 #include <stdint.h>
 #include <stdio.h>
 
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
-#include <unordered_map>
+#include <thread>
 #include <vector>
 
 using namespace mastercore;
@@ -92,6 +102,14 @@ static int nWaterlineBlock = 0;
  */
 bool autoCommit = true;
 
+/**
+ * Number of threads, which parse the transactions of a connected block ahead of
+ * processing, including the thread, which connects the block.
+ *
+ * Can be set with configuration "-omniparsethreads", 1 means serial parsing.
+ */
+int nOmniParseThreads = DEFAULT_OMNI_PARSE_THREADS;
+
 //! Path for file based persistence
 fs::path pathStateFiles;
 
@@ -113,6 +131,10 @@ CMPSTOList* mastercore::pDbStoList;
 COmniTransactionDB* mastercore::pDbTransaction;
 //! LevelDB based storage for UITs
 CMPNonFungibleTokensDB *mastercore::pDbNFT;
+//! LevelDB based index of the transactions of each address, if enabled
+CMPAddressIndex* mastercore::pDbAddressIndex = nullptr;
+//! LevelDB based index of the transactions of each property
+CMPPropertyIndex* mastercore::pDbPropertyIndex = nullptr;
 
 //! In-memory collection of DEx offers
 OfferMap mastercore::my_offers;
@@ -127,7 +149,7 @@ std::set<std::pair<uint32_t,int> > setFreezingEnabledProperties;
 std::set<std::pair<std::string,uint32_t> > setFrozenAddresses;
 
 //! In-memory collection of all amounts for all addresses for all properties
-std::unordered_map<std::string, CMPTally> mastercore::mp_tally_map;
+CMPTallyMap mastercore::mp_tally_map;
 
 // Only needed for GUI:
 
@@ -234,7 +256,7 @@ std::string FormatByType(int64_t amount, uint16_t propertyType)
 
 CMPTally* mastercore::getTally(const std::string& address)
 {
-    std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.find(address);
+    CMPTallyMap::iterator it = mp_tally_map.find(address);
 
     if (it != mp_tally_map.end()) return &(it->second);
 
@@ -250,7 +272,7 @@ int64_t GetTokenBalance(const std::string& address, uint32_t propertyId, TallyTy
     }
 
     LOCK(cs_tally);
-    const std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(address);
+    const CMPTallyMap::iterator my_it = mp_tally_map.find(address);
     if (my_it != mp_tally_map.end()) {
         balance = (my_it->second).getMoney(propertyId, ttype);
     }
@@ -325,6 +347,7 @@ void mastercore::PrintFreezeState()
 
 void mastercore::enableFreezing(uint32_t propertyId, int liveBlock)
 {
+    JournalFreezingChange(propertyId, liveBlock);
     setFreezingEnabledProperties.insert(std::make_pair(propertyId, liveBlock));
     assert(isFreezingEnabled(propertyId, liveBlock));
     PrintToLog("Freezing for property %d will be enabled at block %d.\n", propertyId, liveBlock);
@@ -340,6 +363,7 @@ void mastercore::disableFreezing(uint32_t propertyId)
     }
     assert(liveBlock > 0);
 
+    JournalFreezingChange(propertyId, liveBlock);
     setFreezingEnabledProperties.erase(std::make_pair(propertyId, liveBlock));
     PrintToLog("Freezing for property %d has been disabled.\n", propertyId);
 
@@ -347,6 +371,7 @@ void mastercore::disableFreezing(uint32_t propertyId)
     for (std::set<std::pair<std::string,uint32_t> >::iterator it = setFrozenAddresses.begin(); it != setFrozenAddresses.end(); ) {
         if ((*it).second == propertyId) {
             PrintToLog("Address %s has been unfrozen for property %d.\n", (*it).first, propertyId);
+            JournalFrozenAddressChange((*it).first, propertyId);
             it = setFrozenAddresses.erase(it);
             assert(!isAddressFrozen((*it).first, (*it).second));
         } else {
@@ -371,6 +396,7 @@ bool mastercore::isFreezingEnabled(uint32_t propertyId, int block)
 
 void mastercore::freezeAddress(const std::string& address, uint32_t propertyId)
 {
+    JournalFrozenAddressChange(address, propertyId);
     setFrozenAddresses.insert(std::make_pair(address, propertyId));
     assert(isAddressFrozen(address, propertyId));
     PrintToLog("Address %s has been frozen for property %d.\n", address, propertyId);
@@ -378,6 +404,7 @@ void mastercore::freezeAddress(const std::string& address, uint32_t propertyId)
 
 void mastercore::unfreezeAddress(const std::string& address, uint32_t propertyId)
 {
+    JournalFrozenAddressChange(address, propertyId);
     setFrozenAddresses.erase(std::make_pair(address, propertyId));
     assert(!isAddressFrozen(address, propertyId));
     PrintToLog("Address %s has been unfrozen for property %d.\n", address, propertyId);
@@ -410,10 +437,6 @@ std::string mastercore::getTokenLabel(uint32_t propertyId)
 // optionally counts the number of addresses who own that property: n_owners_total
 int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
 {
-    int64_t prev = 0;
-    int64_t owners = 0;
-    int64_t totalTokens = 0;
-
     LOCK(cs_tally);
 
     CMPSPInfo::Entry property;
@@ -421,20 +444,9 @@ int64_t mastercore::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
         return 0; // property ID does not exist
     }
 
-    if (!property.fixed || n_owners_total) {
-        for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const CMPTally& tally = it->second;
-
-            totalTokens += tally.getMoney(propertyId, BALANCE);
-            totalTokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
-            totalTokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
-
-            if (prev != totalTokens) {
-                prev = totalTokens;
-                owners++;
-            }
-        }
-    }
+    // the tally map keeps running totals per property
+    int64_t totalTokens = mp_tally_map.getTotalTokens(propertyId);
+    int64_t owners = mp_tally_map.getNumberOfOwners(propertyId);
 
     if (property.fixed) {
         totalTokens = property.num_tokens; // only valid for TX50
@@ -467,18 +479,26 @@ bool mastercore::update_tally_map(const std::string& who, uint32_t propertyId, i
         assert(!isAddressFrozen(who, propertyId)); // for safety, this should never fail if everything else is working properly.
     }
 
-    before = GetTokenBalance(who, propertyId, ttype);
-
-    std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.find(who);
+    CMPTallyMap::iterator my_it = mp_tally_map.find(who);
     if (my_it == mp_tally_map.end()) {
         // insert an empty element
         my_it = (mp_tally_map.insert(std::make_pair(who, CMPTally()))).first;
     }
 
     CMPTally& tally = my_it->second;
-    bRet = tally.updateMoney(propertyId, amount, ttype);
-
-    after = GetTokenBalance(who, propertyId, ttype);
+    std::string strStateBefore;
+    if (fOmniStateHash && ttype != PENDING) {
+        strStateBefore = GenerateConsensusString(tally, who, propertyId);
+    }
+    before = tally.getMoney(propertyId, ttype);
+    bRet = mp_tally_map.updateMoney(my_it, propertyId, amount, ttype);
+    after = tally.getMoney(propertyId, ttype);
+    if (fOmniStateHash && ttype != PENDING && bRet) {
+        UpdateStateHashBalance(strStateBefore, GenerateConsensusString(tally, who, propertyId));
+    }
+    if (bRet) {
+        JournalTallyChange(who, propertyId, amount, ttype);
+    }
     if (!bRet) {
         assert(before == after);
         PrintToLog("%s(%s, %u=0x%X, %+d, ttype=%d) ERROR: insufficient balance (=%d)\n", __func__, who, propertyId, propertyId, amount, ttype, before);
@@ -539,7 +559,7 @@ void CheckWalletUpdate(bool forceUpdate)
     global_balance_reserved.clear();
 
     // populate global balance totals and wallet property list - note global balances do not include additional balances from watch-only addresses
-    for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+    for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
         // check if the address is a wallet address (including watched addresses)
         std::string address = my_it->first;
         int addressIsMine = IsMyAddressAllWallets(address, false, ISMINE_SPENDABLE);
@@ -569,6 +589,44 @@ static std::set<uint256> setMarkerCache;
 //! Guards marker cache
 static CCriticalSection cs_marker_cache;
 
+//! The marker of Class C transactions: "omni"
+static const unsigned char OMNI_MARKER[] = {0x6f, 0x6d, 0x6e, 0x69};
+
+/** Returns the script of the Exodus address on mainnet. */
+static const CScript& ScriptExodusMainNet()
+{
+    static const CScript scriptExodus = CScript() << OP_DUP << OP_HASH160
+            << ParseHex("08c43043acc4761ad89e9121c58d412b4ad8b296") << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    return scriptExodus;
+}
+
+/** Returns the script of the Exodus address on testnet and regtest. */
+static const CScript& ScriptExodusTestNet()
+{
+    static const CScript scriptExodus = CScript() << OP_DUP << OP_HASH160
+            << ParseHex("5f9e088b99c1515233c3fb1e2f9eb6102110dac2") << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    return scriptExodus;
+}
+
+/**
+ * Checks, if the peeked bytes 1-8 of a Class A packet hold a transaction of
+ * version 0 and type 0, with property 1 or 2, which is all Class A supports.
+ */
+static bool IsClassAPeek(const Span<const unsigned char>& peek)
+{
+    static const unsigned char pchZero[7] = {};
+
+    return peek.size() == 8 && std::equal(std::begin(pchZero), std::end(pchZero), peek.begin()) && (peek[7] == 0x01 || peek[7] == 0x02);
+}
+
+/** Checks, if pushed data starts with the Class C marker. */
+static bool StartsWithMarker(const Span<const unsigned char>& data)
+{
+    return data.size() >= (std::ptrdiff_t) sizeof(OMNI_MARKER) && std::equal(std::begin(OMNI_MARKER), std::end(OMNI_MARKER), data.begin());
+}
+
 /**
  * Checks, if transaction has any Omni marker.
  *
@@ -578,26 +636,44 @@ static CCriticalSection cs_marker_cache;
  */
 static bool HasMarkerUnsafe(const CTransactionRef& tx)
 {
-    const std::string strClassC("6f6d6e69");
-    const std::string strClassAB("76a91408c43043acc4761ad89e9121c58d412b4ad8b29688ac");
-    const std::string strClassABTest("76a9145f9e088b99c1515233c3fb1e2f9eb6102110dac288ac");
+    const CScript& scriptExodus = MainNet() ? ScriptExodusMainNet() : ScriptExodusTestNet();
 
     for (unsigned int n = 0; n < tx->vout.size(); ++n) {
-        const CTxOut& out = tx->vout[n];
-        std::string str = HexStr(out.scriptPubKey.begin(), out.scriptPubKey.end());
+        const CScript& script = tx->vout[n].scriptPubKey;
 
-        if (str.find(strClassC) != std::string::npos) {
+        if (std::search(script.begin(), script.end(), std::begin(OMNI_MARKER), std::end(OMNI_MARKER)) != script.end()) {
             return true;
         }
+        if (script == scriptExodus) {
+            return true;
+        }
+    }
 
-        if (MainNet()) {
-            if (str == strClassAB) {
-                return true;
-            }
-        } else {
-            if (str == strClassABTest) {
-                return true;
-            }
+    return false;
+}
+
+/**
+ * Checks, if a transaction may carry an Omni marker, without examining the outputs closely.
+ *
+ * This is a byte-level version of the fast search in GetEncodingClass():
+ * transactions, for which it returns false, are never classified as Omni
+ * transactions. It does not depend on consensus parameters, which may change
+ * while blocks are scanned, and can therefore be used from any thread.
+ */
+static bool MayHaveMarker(const CTransaction& tx, int nBlock, int nGenesisBlock)
+{
+    // everything is examined, when not on mainnet
+    if (!MainNet()) {
+        return true;
+    }
+
+    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
+        const CScript& script = tx.vout[n].scriptPubKey;
+        if (script == ScriptExodusMainNet()) {
+            return true;
+        }
+        if (nBlock >= nGenesisBlock && std::search(script.begin(), script.end(), std::begin(OMNI_MARKER), std::end(OMNI_MARKER)) != script.end()) {
+            return true;
         }
     }
 
@@ -641,35 +717,8 @@ int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
     bool hasMultisig = false;
     bool hasOpReturn = false;
 
-    /* Fast Search
-     * Perform a string comparison on hex for each scriptPubKey & look directly for Exodus hash160 bytes or omni marker bytes
-     * This allows to drop non-Omni transactions with less work
-     */
-    std::string strClassC = "6f6d6e69";
-    std::string strClassAB = "76a91408c43043acc4761ad89e9121c58d412b4ad8b29688ac";
-    bool examineClosely = false;
-    for (unsigned int n = 0; n < tx.vout.size(); ++n) {
-        const CTxOut& output = tx.vout[n];
-        std::string strSPB = HexStr(output.scriptPubKey.begin(), output.scriptPubKey.end());
-        if (strSPB != strClassAB) { // not an exodus marker
-            if (nBlock < ConsensusParams().GENESIS_BLOCK) {
-                continue;
-            } else {
-                if (strSPB.find(strClassC) != std::string::npos) {
-                    examineClosely = true;
-                    break;
-                }
-            }
-        } else {
-            examineClosely = true;
-            break;
-        }
-    }
-
-    // Examine everything when not on mainnet
-    if (isNonMainNet()) {
-        examineClosely = true;
-    }
+    // drop non-Omni transactions with less work, by looking for the Exodus script or the marker bytes first
+    bool examineClosely = MayHaveMarker(tx, nBlock, ConsensusParams().GENESIS_BLOCK);
 
     if (!examineClosely) return NO_MARKER;
 
@@ -698,19 +747,12 @@ int mastercore::GetEncodingClass(const CTransaction& tx, int nBlock)
         if (outType == TX_NULL_DATA) {
             // Ensure there is a payload, and the first pushed element equals,
             // or starts with the "omni" marker
-            std::vector<std::string> scriptPushes;
-            if (!GetScriptPushes(output.scriptPubKey, scriptPushes)) {
+            std::vector<Span<const unsigned char> > vPushes;
+            if (!GetScriptPushes(output.scriptPubKey, vPushes)) {
                 continue;
             }
-            if (!scriptPushes.empty()) {
-                std::vector<unsigned char> vchMarker = GetOmMarker();
-                std::vector<unsigned char> vchPushed = ParseHex(scriptPushes[0]);
-                if (vchPushed.size() < vchMarker.size()) {
-                    continue;
-                }
-                if (std::equal(vchMarker.begin(), vchMarker.end(), vchPushed.begin())) {
-                    hasOpReturn = true;
-                }
+            if (!vPushes.empty() && StartsWithMarker(vPushes[0])) {
+                hasOpReturn = true;
             }
         }
     }
@@ -746,7 +788,7 @@ static unsigned int nCacheMiss = 0;
  * @param tx[in]  The transaction to fetch inputs for
  * @return True, if all inputs were successfully added to the cache
  */
-static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins)
+static bool FillTxInputCache(const CTransaction& tx)
 {
     static unsigned int nCacheSize = gArgs.GetArg("-omnitxcache", 500000);
 
@@ -771,9 +813,7 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
         CTransactionRef txPrev;
         uint256 hashBlock;
         Coin newcoin;
-        if (removedCoins && removedCoins->find(txIn.prevout) != removedCoins->end()) {
-            newcoin = removedCoins->find(txIn.prevout)->second;
-        } else if (GetTransaction(txIn.prevout.hash, txPrev, Params().GetConsensus(), hashBlock)) {
+        if (GetTransaction(txIn.prevout.hash, txPrev, Params().GetConsensus(), hashBlock)) {
             newcoin.out.scriptPubKey = txPrev->vout[nOut].scriptPubKey;
             newcoin.out.nValue = txPrev->vout[nOut].nValue;
             BlockMap::iterator bit = mapBlockIndex.find(hashBlock);
@@ -788,43 +828,15 @@ static bool FillTxInputCache(const CTransaction& tx, const std::shared_ptr<std::
     return true;
 }
 
-// idx is position within the block, 0-based
-// int msc_tx_push(const CTransaction &wtx, int nBlock, unsigned int idx)
-// INPUT: bRPConly -- set to true to avoid moving funds; to be called from various RPC calls like this
-// RETURNS: 0 if parsed a MP TX
-// RETURNS: < 0 if a non-MP-TX or invalid
-// RETURNS: >0 if 1 or more payments have been made
-static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock, unsigned int idx, CMPTransaction& mp_tx, unsigned int nTime, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = nullptr)
+/**
+ * Identifies the sender of a transaction, and sums up the input values, based
+ * on the coins spent by the transaction, which are in the order of the inputs.
+ *
+ * @return 0 if the inputs are accepted, or the error code of parseTransaction
+ */
+static int IdentifySender(const CTransaction& wtx, int nBlock, int omniClass, const std::vector<Coin>& spentCoins, std::string& strSender, int64_t& inAll)
 {
-    assert(bRPConly == mp_tx.isRpcOnly());
-    mp_tx.Set(wtx.GetHash(), nBlock, idx, nTime);
-
-    // ### CLASS IDENTIFICATION AND MARKER CHECK ###
-    int omniClass = GetEncodingClass(wtx, nBlock);
-
-    if (omniClass == NO_MARKER) {
-        return -1; // No Exodus/Omni marker, thus not a valid Omni transaction
-    }
-
-    if (!bRPConly || msc_debug_parser_readonly) {
-        PrintToLog("____________________________________________________________________________________________________________________________________\n");
-        PrintToLog("%s(block=%d, %s idx= %d); txid: %s\n", __FUNCTION__, nBlock, FormatISO8601DateTime(nTime), idx, wtx.GetHash().GetHex());
-    }
-
-    // ### SENDER IDENTIFICATION ###
-    std::string strSender;
-    int64_t inAll = 0;
-
-    { // needed to ensure the cache isn't cleared in the meantime when doing parallel queries
-    LOCK2(cs_main, cs_tx_cache); // cs_main should be locked first to avoid deadlocks with cs_tx_cache at FillTxInputCache(...)->GetTransaction(...)->LOCK(cs_main)
-
-    // Add previous transaction inputs to the cache
-    if (!FillTxInputCache(wtx, removedCoins)) {
-        PrintToLog("%s() ERROR: failed to get inputs for %s\n", __func__, wtx.GetHash().GetHex());
-        return -101;
-    }
-
-    assert(view.HaveInputs(wtx));
+    assert(spentCoins.size() == wtx.vin.size());
 
     if (omniClass != OMNI_CLASS_C)
     {
@@ -834,9 +846,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         for (unsigned int i = 0; i < wtx.vin.size(); ++i) {
             if (msc_debug_vin) PrintToLog("vin=%d:%s\n", i, ScriptToAsmStr(wtx.vin[i].scriptSig));
 
-            const CTxIn& txIn = wtx.vin[i];
-            const Coin& coin = view.AccessCoin(txIn.prevout);
-            const CTxOut& txOut = coin.out;
+            const CTxOut& txOut = spentCoins[i].out;
 
             assert(!txOut.IsNull());
 
@@ -873,9 +883,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             unsigned int vin_n = 0; // the first input
             if (msc_debug_vin) PrintToLog("vin=%d:%s\n", vin_n, ScriptToAsmStr(wtx.vin[vin_n].scriptSig));
 
-            const CTxIn& txIn = wtx.vin[vin_n];
-            const Coin& coin = view.AccessCoin(txIn.prevout);
-            const CTxOut& txOut = coin.out;
+            const CTxOut& txOut = spentCoins[vin_n].out;
 
             assert(!txOut.IsNull());
 
@@ -894,9 +902,65 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         }
     }
 
-    inAll = view.GetValueIn(wtx);
+    for (const Coin& coin : spentCoins) {
+        inAll += coin.out.nValue;
+    }
+
+    return 0;
+}
+
+// idx is position within the block, 0-based
+// int msc_tx_push(const CTransaction &wtx, int nBlock, unsigned int idx)
+// INPUT: bRPConly -- set to true to avoid moving funds; to be called from various RPC calls like this
+// RETURNS: 0 if parsed a MP TX
+// RETURNS: < 0 if a non-MP-TX or invalid
+// RETURNS: >0 if 1 or more payments have been made
+static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock, unsigned int idx, CMPTransaction& mp_tx, unsigned int nTime, const std::vector<Coin>* pSpentCoins = nullptr)
+{
+    assert(bRPConly == mp_tx.isRpcOnly());
+    mp_tx.Set(wtx.GetHash(), nBlock, idx, nTime);
 
-    } // end of LOCK(cs_tx_cache)
+    // ### CLASS IDENTIFICATION AND MARKER CHECK ###
+    int omniClass = GetEncodingClass(wtx, nBlock);
+
+    if (omniClass == NO_MARKER) {
+        return -1; // No Exodus/Omni marker, thus not a valid Omni transaction
+    }
+
+    if (!bRPConly || msc_debug_parser_readonly) {
+        PrintToLog("____________________________________________________________________________________________________________________________________\n");
+        PrintToLog("%s(block=%d, %s idx= %d); txid: %s\n", __FUNCTION__, nBlock, FormatISO8601DateTime(nTime), idx, wtx.GetHash().GetHex());
+    }
+
+    // ### SENDER IDENTIFICATION ###
+    std::string strSender;
+    int64_t inAll = 0;
+
+    if (pSpentCoins) {
+        // the spent coins were provided, and no lock is needed to access them
+        int nSenderRet = IdentifySender(wtx, nBlock, omniClass, *pSpentCoins, strSender, inAll);
+        if (nSenderRet != 0) return nSenderRet;
+    } else {
+        // needed to ensure the cache isn't cleared in the meantime when doing parallel queries
+        LOCK2(cs_main, cs_tx_cache); // cs_main should be locked first to avoid deadlocks with cs_tx_cache at FillTxInputCache(...)->GetTransaction(...)->LOCK(cs_main)
+
+        // Add previous transaction inputs to the cache
+        if (!FillTxInputCache(wtx)) {
+            PrintToLog("%s() ERROR: failed to get inputs for %s\n", __func__, wtx.GetHash().GetHex());
+            return -101;
+        }
+
+        assert(view.HaveInputs(wtx));
+
+        std::vector<Coin> spentCoins;
+        spentCoins.reserve(wtx.vin.size());
+        for (const CTxIn& txIn : wtx.vin) {
+            spentCoins.push_back(view.AccessCoin(txIn.prevout));
+        }
+
+        int nSenderRet = IdentifySender(wtx, nBlock, omniClass, spentCoins, strSender, inAll);
+        if (nSenderRet != 0) return nSenderRet;
+    }
 
     int64_t outAll = wtx.GetValueOut();
     int64_t txFee = inAll - outAll; // miner fee
@@ -912,7 +976,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
     std::string strReference;
     unsigned char single_pkt[MAX_PACKETS * PACKET_SIZE];
     unsigned int packet_size = 0;
-    std::vector<std::string> script_data;
+    std::vector<Span<const unsigned char> > script_data;
     std::vector<std::string> address_data;
     std::vector<int64_t> value_data;
 
@@ -939,22 +1003,22 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
     // ### CLASS A PARSING ###
     if (omniClass == OMNI_CLASS_A) {
-        std::string strScriptData;
+        Span<const unsigned char> scriptData;
         std::string strDataAddress;
         std::string strRefAddress;
         unsigned char dataAddressSeq = 0xFF;
         unsigned char seq = 0xFF;
         int64_t dataAddressValue = 0;
         for (unsigned k = 0; k < script_data.size(); ++k) { // Step 1, locate the data packet
-            std::string strSub = script_data[k].substr(2,16); // retrieve bytes 1-9 of packet for peek & decode comparison
-            seq = (ParseHex(script_data[k].substr(0,2)))[0]; // retrieve sequence number
-            if ("0000000000000001" == strSub || "0000000000000002" == strSub) { // peek & decode comparison
-                if (strScriptData.empty()) { // confirm we have not already located a data address
-                    strScriptData = script_data[k].substr(2*1,2*PACKET_SIZE_CLASS_A); // populate data packet
+            if (script_data[k].size() < 1 + PACKET_SIZE_CLASS_A) continue; // only hashes are extracted, which hold a full packet
+            seq = script_data[k][0]; // retrieve sequence number
+            if (IsClassAPeek(script_data[k].subspan(1, 8))) { // peek & decode comparison of bytes 1-8 of packet
+                if (scriptData.size() == 0) { // confirm we have not already located a data address
+                    scriptData = script_data[k].subspan(1, PACKET_SIZE_CLASS_A); // populate data packet
                     strDataAddress = address_data[k]; // record data address
                     dataAddressSeq = seq; // record data address seq num for reference matching
                     dataAddressValue = value_data[k]; // record data address amount for reference matching
-                    if (msc_debug_parser_data) PrintToLog("Data Address located - data[%d]:%s: %s (%s)\n", k, script_data[k], address_data[k], FormatDivisibleMP(value_data[k]));
+                    if (msc_debug_parser_data) PrintToLog("Data Address located - data[%d]:%s: %s (%s)\n", k, HexStr(script_data[k].begin(), script_data[k].end()), address_data[k], FormatDivisibleMP(value_data[k]));
                 } else { // invalidate - Class A cannot be more than one data packet - possible collision, treat as default (BTC payment)
                     strDataAddress.clear(); //empty strScriptData to block further parsing
                     if (msc_debug_parser_data) PrintToLog("Multiple Data Addresses found (collision?) Class A invalidated, defaulting to BTC payment\n");
@@ -965,11 +1029,12 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         if (!strDataAddress.empty()) { // Step 2, try to locate address with seqnum = DataAddressSeq+1 (also verify Step 1, we should now have a valid data packet)
             unsigned char expectedRefAddressSeq = dataAddressSeq + 1;
             for (unsigned k = 0; k < script_data.size(); ++k) { // loop through outputs
-                seq = (ParseHex(script_data[k].substr(0,2)))[0]; // retrieve sequence number
+                if (script_data[k].size() == 0) continue;
+                seq = script_data[k][0]; // retrieve sequence number
                 if ((address_data[k] != strDataAddress) && (address_data[k] != exodus_address) && (expectedRefAddressSeq == seq)) { // found reference address with matching sequence number
                     if (strRefAddress.empty()) { // confirm we have not already located a reference address
                         strRefAddress = address_data[k]; // set ref address
-                        if (msc_debug_parser_data) PrintToLog("Reference Address located via seqnum - data[%d]:%s: %s (%s)\n", k, script_data[k], address_data[k], FormatDivisibleMP(value_data[k]));
+                        if (msc_debug_parser_data) PrintToLog("Reference Address located via seqnum - data[%d]:%s: %s (%s)\n", k, HexStr(script_data[k].begin(), script_data[k].end()), address_data[k], FormatDivisibleMP(value_data[k]));
                     } else { // can't trust sequence numbers to provide reference address, there is a collision with >1 address with expected seqnum
                         strRefAddress.clear(); // blank ref address
                         if (msc_debug_parser_data) PrintToLog("Reference Address sequence number collision, will fall back to evaluating matching output amounts\n");
@@ -993,7 +1058,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
                             if (value_data[k] == ExodusValues[exodus_idx]) { //this output matches data address value and exodus address value, choose as ref
                                 if (strRefAddress.empty()) {
                                     strRefAddress = address_data[k];
-                                    if (msc_debug_parser_data) PrintToLog("Reference Address located via matching amounts - data[%d]:%s: %s (%s)\n", k, script_data[k], address_data[k], FormatDivisibleMP(value_data[k]));
+                                    if (msc_debug_parser_data) PrintToLog("Reference Address located via matching amounts - data[%d]:%s: %s (%s)\n", k, HexStr(script_data[k].begin(), script_data[k].end()), address_data[k], FormatDivisibleMP(value_data[k]));
                                 } else {
                                     strRefAddress.clear();
                                     if (msc_debug_parser_data) PrintToLog("Reference Address collision, multiple potential candidates. Class A invalidated, defaulting to BTC payment\n");
@@ -1012,9 +1077,9 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             strDataAddress.clear(); // last validation step, if strRefAddress is empty, blank strDataAddress so we default to BTC payment
         }
         if (!strDataAddress.empty()) { // valid Class A packet almost ready
-            if (msc_debug_parser_data) PrintToLog("valid Class A:from=%s:to=%s:data=%s\n", strSender, strReference, strScriptData);
+            if (msc_debug_parser_data) PrintToLog("valid Class A:from=%s:to=%s:data=%s\n", strSender, strReference, HexStr(scriptData.begin(), scriptData.end()));
             packet_size = PACKET_SIZE_CLASS_A;
-            memcpy(single_pkt, &ParseHex(strScriptData)[0], packet_size);
+            memcpy(single_pkt, scriptData.data(), packet_size);
         } else {
             if ((!bRPConly || msc_debug_parser_readonly) && msc_debug_parser_dex) {
                 PrintToLog("!! sender: %s , receiver: %s\n", strSender, strReference);
@@ -1030,7 +1095,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
         unsigned int potentialReferenceOutputs = 0; // int to hold number of potential reference outputs
         for (unsigned k = 0; k < address_data.size(); ++k) { // how many potential reference outputs do we have, if just one select it right here
             const std::string& addr = address_data[k];
-            if (msc_debug_parser_data) PrintToLog("ref? data[%d]:%s: %s (%s)\n", k, script_data[k], addr, FormatIndivisibleMP(value_data[k]));
+            if (msc_debug_parser_data) PrintToLog("ref? data[%d]:%s: %s (%s)\n", k, HexStr(script_data[k].begin(), script_data[k].end()), addr, FormatIndivisibleMP(value_data[k]));
             if (addr != exodus_address) {
                 ++potentialReferenceOutputs;
                 if (1 == potentialReferenceOutputs) {
@@ -1063,7 +1128,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
         // ### CLASS B SPECIFIC PARSING ###
         if (omniClass == OMNI_CLASS_B) {
-            std::vector<std::string> multisig_script_data;
+            std::vector<Span<const unsigned char> > multisig_script_data;
 
             // ### POPULATE MULTISIG SCRIPT DATA ###
             for (unsigned int i = 0; i < wtx.vout.size(); ++i) {
@@ -1102,8 +1167,8 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
             }
 
             // ### PREPARE A FEW VARS ###
-            std::string strObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
-            PrepareObfuscatedHashes(strSender, 1+nPackets, strObfuscatedHashes);
+            unsigned char obfuscationHashes[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE];
+            PrepareObfuscatedHashes(strSender, 1+nPackets, obfuscationHashes);
             unsigned char packets[MAX_PACKETS][32];
             unsigned int mdata_count = 0;  // multisig data count
 
@@ -1112,25 +1177,24 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
                 assert(mdata_count < MAX_PACKETS);
                 assert(mdata_count < MAX_SHA256_OBFUSCATION_TIMES);
 
-                std::vector<unsigned char> hash = ParseHex(strObfuscatedHashes[mdata_count+1]);
-                std::vector<unsigned char> packet = ParseHex(multisig_script_data[k].substr(2*1,2*PACKET_SIZE));
-                for (unsigned int i = 0; i < packet.size(); i++) { // this is a data packet, must deobfuscate now
-                    packet[i] ^= hash[i];
+                const unsigned char* hash = obfuscationHashes[mdata_count+1];
+                const Span<const unsigned char>& pubKey = multisig_script_data[k];
+                assert(pubKey.size() > PACKET_SIZE); // only public keys are extracted
+                unsigned char* packet = packets[mdata_count];
+                for (unsigned int i = 0; i < PACKET_SIZE; i++) { // this is a data packet, must deobfuscate now
+                    packet[i] = pubKey[1 + i] ^ hash[i];
                 }
-                memcpy(&packets[mdata_count], &packet[0], PACKET_SIZE);
                 ++mdata_count;
 
                 if (msc_debug_parser_data) {
-                    CPubKey key(ParseHex(multisig_script_data[k]));
+                    CPubKey key(pubKey.begin(), pubKey.end());
                     CKeyID keyID = key.GetID();
                     std::string strAddress = EncodeDestination(keyID);
-                    PrintToLog("multisig_data[%d]:%s: %s\n", k, multisig_script_data[k], strAddress);
+                    PrintToLog("multisig_data[%d]:%s: %s\n", k, HexStr(pubKey.begin(), pubKey.end()), strAddress);
                 }
                 if (msc_debug_parser) {
-                    if (!packet.empty()) {
-                        std::string strPacket = HexStr(packet.begin(), packet.end());
-                        PrintToLog("packet #%d: %s\n", mdata_count, strPacket);
-                    }
+                    std::string strPacket = HexStr(packet, packet + PACKET_SIZE);
+                    PrintToLog("packet #%d: %s\n", mdata_count, strPacket);
                 }
             }
             packet_size = mdata_count * (PACKET_SIZE - 1);
@@ -1151,7 +1215,7 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
 
         // ### CLASS C SPECIFIC PARSING ###
         if (omniClass == OMNI_CLASS_C) {
-            std::vector<std::string> op_return_script_data;
+            std::vector<Span<const unsigned char> > op_return_script_data;
 
             // ### POPULATE OP RETURN SCRIPT DATA ###
             for (unsigned int n = 0; n < wtx.vout.size(); ++n) {
@@ -1164,43 +1228,33 @@ static int parseTransaction(bool bRPConly, const CTransaction& wtx, int nBlock,
                 }
                 if (whichType == TX_NULL_DATA) {
                     // only consider outputs, which are explicitly tagged
-                    std::vector<std::string> vstrPushes;
-                    if (!GetScriptPushes(wtx.vout[n].scriptPubKey, vstrPushes)) {
+                    std::vector<Span<const unsigned char> > vPushes;
+                    if (!GetScriptPushes(wtx.vout[n].scriptPubKey, vPushes)) {
                         continue;
                     }
-                    // TODO: maybe encapsulate the following sort of messy code
-                    if (!vstrPushes.empty()) {
-                        std::vector<unsigned char> vchMarker = GetOmMarker();
-                        std::vector<unsigned char> vchPushed = ParseHex(vstrPushes[0]);
-                        if (vchPushed.size() < vchMarker.size()) {
-                            continue;
-                        }
-                        if (std::equal(vchMarker.begin(), vchMarker.end(), vchPushed.begin())) {
-                            size_t sizeHex = vchMarker.size() * 2;
-                            // strip out the marker at the very beginning
-                            vstrPushes[0] = vstrPushes[0].substr(sizeHex);
-                            // add the data to the rest
-                            op_return_script_data.insert(op_return_script_data.end(), vstrPushes.begin(), vstrPushes.end());
-
-                            if (msc_debug_parser_data) {
-                                PrintToLog("Class C transaction detected: %s parsed to %s at vout %d\n", wtx.GetHash().GetHex(), vstrPushes[0], n);
-                            }
+                    if (!vPushes.empty() && StartsWithMarker(vPushes[0])) {
+                        // strip out the marker at the very beginning
+                        vPushes[0] = vPushes[0].subspan(sizeof(OMNI_MARKER));
+                        // add the data to the rest
+                        op_return_script_data.insert(op_return_script_data.end(), vPushes.begin(), vPushes.end());
+
+                        if (msc_debug_parser_data) {
+                            PrintToLog("Class C transaction detected: %s parsed to %s at vout %d\n", wtx.GetHash().GetHex(), HexStr(vPushes[0].begin(), vPushes[0].end()), n);
                         }
                     }
                 }
             }
             // ### EXTRACT PAYLOAD FOR CLASS C ###
             for (unsigned int n = 0; n < op_return_script_data.size(); ++n) {
-                if (!op_return_script_data[n].empty()) {
-                    assert(IsHex(op_return_script_data[n])); // via GetScriptPushes()
-                    std::vector<unsigned char> vch = ParseHex(op_return_script_data[n]);
-                    unsigned int payload_size = vch.size();
+                if (op_return_script_data[n].size() > 0) {
+                    const Span<const unsigned char>& data = op_return_script_data[n];
+                    unsigned int payload_size = data.size();
                     if (packet_size + payload_size > MAX_PACKETS * PACKET_SIZE) {
                         payload_size = MAX_PACKETS * PACKET_SIZE - packet_size;
                         PrintToLog("limiting payload size to %d byte\n", packet_size + payload_size);
                     }
                     if (payload_size > 0) {
-                        memcpy(single_pkt+packet_size, &vch[0], payload_size);
+                        memcpy(single_pkt+packet_size, data.data(), payload_size);
                         packet_size += payload_size;
                     }
                     if (MAX_PACKETS * PACKET_SIZE == packet_size) {
@@ -1232,6 +1286,157 @@ int ParseTransaction(const CTransaction& tx, int nBlock, unsigned int idx, CMPTr
     return parseTransaction(true, tx, nBlock, idx, mptx, nTime);
 }
 
+/**
+ * Transaction of a connected block, which was parsed ahead of processing.
+ */
+struct ParsedTransaction
+{
+    //! Hash of the parsed transaction
+    uint256 txid;
+    //! Whether the transaction was parsed, otherwise it's parsed in order
+    bool fParsed;
+    //! Result of parseTransaction
+    int nResult;
+    //! The parsed transaction, if the result is not negative
+    std::unique_ptr<CMPTransaction> pmp_obj;
+    //! Log output of the parser, which is printed, when the transaction is processed
+    std::vector<std::string> vLog;
+
+    ParsedTransaction() : fParsed(false), nResult(-1) {}
+};
+
+//! Transactions of the processed block, which were parsed ahead, by position
+static std::vector<ParsedTransaction> vParsedTransactions;
+//! Height of the block, whose transactions were parsed ahead
+static int nParsedBlock = -1;
+
+/**
+ * Returns the coins spent by a transaction of a connected block, which are taken
+ * from the undo data of the block.
+ *
+ * @return The spent coins in the order of the inputs, or nullptr, if not available
+ */
+static const std::vector<Coin>* GetSpentCoins(const CTransaction& tx, unsigned int idx, const CBlockUndo* pBlockUndo)
+{
+    // the undo data has no entry for the coinbase transaction
+    if (!pBlockUndo || idx == 0 || idx > pBlockUndo->vtxundo.size()) {
+        return nullptr;
+    }
+
+    const std::vector<Coin>& vprevout = pBlockUndo->vtxundo[idx - 1].vprevout;
+    if (vprevout.size() != tx.vin.size()) {
+        return nullptr;
+    }
+
+    return &vprevout;
+}
+
+/**
+ * Closure representing the parsing of a transaction of a connected block.
+ * The result is stored instead of returned, and transactions, whose spent
+ * coins are not available, are left to be parsed in order.
+ */
+class CMPParseCheck
+{
+private:
+    const CTransaction* ptx;
+    int nBlock;
+    unsigned int idx;
+    unsigned int nTime;
+    const std::vector<Coin>* pSpentCoins;
+    ParsedTransaction* pResult;
+
+public:
+    CMPParseCheck() : ptx(nullptr), nBlock(0), idx(0), nTime(0), pSpentCoins(nullptr), pResult(nullptr) {}
+    CMPParseCheck(const CTransaction& tx, int nBlockIn, unsigned int idxIn, unsigned int nTimeIn, const std::vector<Coin>* pSpentCoinsIn, ParsedTransaction& result) :
+        ptx(&tx), nBlock(nBlockIn), idx(idxIn), nTime(nTimeIn), pSpentCoins(pSpentCoinsIn), pResult(&result) {}
+
+    bool operator()()
+    {
+        // most transactions have no marker, and are done without further allocations
+        if (GetEncodingClass(*ptx, nBlock) == NO_MARKER) {
+            pResult->txid = ptx->GetHash();
+            pResult->nResult = -1;
+            pResult->fParsed = true;
+            return true;
+        }
+
+        // without the spent coins, such as for the coinbase, it's parsed in order
+        if (!pSpentCoins) {
+            return true;
+        }
+
+        std::unique_ptr<CMPTransaction> pmp_obj(new CMPTransaction());
+        pmp_obj->unlockLogic();
+
+        int nResult;
+        {
+            // the output is kept in the order of the transactions
+            CLogCapture capture(pResult->vLog);
+            nResult = parseTransaction(false, *ptx, nBlock, idx, *pmp_obj, nTime, pSpentCoins);
+        }
+
+        pResult->txid = ptx->GetHash();
+        pResult->nResult = nResult;
+        pResult->fParsed = true;
+        if (nResult >= 0) {
+            pResult->pmp_obj = std::move(pmp_obj);
+        }
+        return true;
+    }
+
+    void swap(CMPParseCheck& check)
+    {
+        std::swap(ptx, check.ptx);
+        std::swap(nBlock, check.nBlock);
+        std::swap(idx, check.idx);
+        std::swap(nTime, check.nTime);
+        std::swap(pSpentCoins, check.pSpentCoins);
+        std::swap(pResult, check.pResult);
+    }
+};
+
+static CCheckQueue<CMPParseCheck> parsecheckqueue(128);
+
+void ThreadOmniParse()
+{
+    RenameThread("omni-parse");
+    parsecheckqueue.Thread();
+}
+
+/**
+ * Takes the result of a transaction, which was parsed ahead of processing.
+ *
+ * @return True, if the transaction was parsed ahead
+ */
+static bool TakeParsedTransaction(const CTransaction& tx, int nBlock, unsigned int idx, CMPTransaction& mp_obj, int& nResult)
+{
+    AssertLockHeld(cs_tally);
+
+    if (nBlock != nParsedBlock || idx >= vParsedTransactions.size()) {
+        return false;
+    }
+
+    ParsedTransaction& parsed = vParsedTransactions[idx];
+    if (!parsed.fParsed || parsed.txid != tx.GetHash()) {
+        return false;
+    }
+
+    for (const std::string& str : parsed.vLog) {
+        LogFilePrint(str);
+    }
+    parsed.vLog.clear();
+
+    if (parsed.pmp_obj) {
+        mp_obj = std::move(*parsed.pmp_obj);
+        parsed.pmp_obj.reset();
+    }
+    nResult = parsed.nResult;
+    parsed.fParsed = false;
+
+    return true;
+}
+
 /**
  * Handles potential DEx payments.
  *
@@ -1336,6 +1541,244 @@ public:
     }
 };
 
+
+/**
+ * Reads and pre-filters the blocks of a scan ahead of the consensus thread.
+ *
+ * The consensus thread schedules the blocks of a window ahead of the block it
+ * processes. Reader threads load and deserialize the blocks, and mark the
+ * transactions, which may carry an Omni marker. The consensus thread then
+ * takes the blocks in order.
+ */
+class BlockPrefetcher
+{
+private:
+    /** A scheduled block. */
+    struct Slot
+    {
+        CDiskBlockPos pos;
+        CDiskBlockPos undoPos;
+        uint256 hash;
+        uint256 hashPrev;
+        int nBlock;
+        bool fDone;
+        bool fRead;
+        CBlock block;
+        //! Undo data with the coins spent by the block, if it may have Omni transactions
+        CBlockUndo blockundo;
+        //! Transactions, which may carry an Omni marker
+        std::vector<bool> vMayHaveMarker;
+
+        Slot() : nBlock(0), fDone(false), fRead(false) {}
+    };
+
+    //! Number of blocks, which are scheduled ahead of the processed block
+    static const int WINDOW_SIZE = 64;
+
+    const int m_nLastBlock;
+    const int m_nGenesisBlock;
+    int m_nNextScheduled;
+
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    //! Scheduled blocks by height
+    std::map<int, std::shared_ptr<Slot> > m_slots;
+    //! Scheduled blocks, which are not yet read
+    std::deque<std::shared_ptr<Slot> > m_queue;
+    bool m_fStop;
+    std::vector<std::thread> m_threads;
+
+    /** Sets the positions of a scheduled block. */
+    static void locate(Slot& slot, const CBlockIndex* pindex)
+    {
+        AssertLockHeld(cs_main);
+
+        slot.pos = pindex->GetBlockPos();
+        slot.undoPos = pindex->GetUndoPos();
+        slot.hash = pindex->GetBlockHash();
+        slot.hashPrev = pindex->pprev ? pindex->pprev->GetBlockHash() : uint256();
+        slot.nBlock = pindex->nHeight;
+    }
+
+    /**
+     * Reads and pre-filters a block. The undo data is read as well, if any
+     * transaction other than the coinbase may carry an Omni marker, so the
+     * inputs of the transactions can be resolved without lookups.
+     */
+    void read(Slot& slot) const
+    {
+        slot.fRead = ReadBlockFromDisk(slot.block, slot.pos, Params().GetConsensus(), false) && slot.block.GetHash() == slot.hash;
+        if (!slot.fRead) {
+            return;
+        }
+        bool fMarked = false;
+        slot.vMayHaveMarker.resize(slot.block.vtx.size());
+        for (size_t n = 0; n < slot.block.vtx.size(); ++n) {
+            slot.vMayHaveMarker[n] = MayHaveMarker(*slot.block.vtx[n], slot.nBlock, m_nGenesisBlock);
+            fMarked |= (n > 0 && slot.vMayHaveMarker[n]);
+        }
+        // without undo data, the inputs are looked up by the parser
+        if (fMarked && !slot.undoPos.IsNull() && !UndoReadFromDisk(slot.blockundo, slot.undoPos, slot.hashPrev)) {
+            slot.blockundo.vtxundo.clear();
+        }
+    }
+
+    /** Reads scheduled blocks, until stopped. */
+    void threadRead()
+    {
+        while (true) {
+            std::shared_ptr<Slot> slot;
+            {
+                WAIT_LOCK(m_mutex, lock);
+                m_cond.wait(lock, [this] { return !m_queue.empty() || m_fStop; });
+                if (m_fStop) {
+                    return;
+                }
+                slot = m_queue.front();
+                m_queue.pop_front();
+            }
+
+            read(*slot);
+
+            {
+                LOCK(m_mutex);
+                slot->fDone = true;
+            }
+            m_cond.notify_all();
+        }
+    }
+
+    /** Schedules the blocks of the window ahead of the given block. */
+    void schedule(int nBlock)
+    {
+        int nLast = std::min(m_nLastBlock, nBlock + WINDOW_SIZE);
+        if (m_nNextScheduled > nLast) {
+            return;
+        }
+
+        std::vector<std::shared_ptr<Slot> > vSlots;
+        {
+            LOCK(cs_main);
+            for (; m_nNextScheduled <= nLast; ++m_nNextScheduled) {
+                const CBlockIndex* pindex = chainActive[m_nNextScheduled];
+                if (pindex == nullptr) break;
+
+                std::shared_ptr<Slot> slot = std::make_shared<Slot>();
+                locate(*slot, pindex);
+                vSlots.push_back(slot);
+            }
+        }
+
+        {
+            LOCK(m_mutex);
+            for (std::vector<std::shared_ptr<Slot> >::const_iterator it = vSlots.begin(); it != vSlots.end(); ++it) {
+                m_slots[(*it)->nBlock] = *it;
+                m_queue.push_back(*it);
+            }
+        }
+        m_cond.notify_all();
+    }
+
+public:
+    BlockPrefetcher(int nFirstBlock, int nLastBlock, int nThreads)
+      : m_nLastBlock(nLastBlock), m_nGenesisBlock(ConsensusParams().GENESIS_BLOCK), m_nNextScheduled(nFirstBlock), m_fStop(false)
+    {
+        for (int n = 0; n < nThreads; ++n) {
+            m_threads.emplace_back(&TraceThread<std::function<void()> >, "omniscan", std::function<void()>(std::bind(&BlockPrefetcher::threadRead, this)));
+        }
+    }
+
+    ~BlockPrefetcher()
+    {
+        {
+            LOCK(m_mutex);
+            m_fStop = true;
+        }
+        m_cond.notify_all();
+
+        for (std::vector<std::thread>::iterator it = m_threads.begin(); it != m_threads.end(); ++it) {
+            it->join();
+        }
+    }
+
+    /**
+     * Returns the given block and its undo data, once it was read, and marks
+     * the transactions, which may carry an Omni marker.
+     *
+     * Blocks, which were not scheduled, or which no longer match the active
+     * chain, are read by the calling thread.
+     *
+     * @return True, if the block was read successfully
+     */
+    bool get(const CBlockIndex* pblockindex, CBlock& block, CBlockUndo& blockundo, std::vector<bool>& vMayHaveMarker, int64_t& nWaitMicros)
+    {
+        int nBlock = pblockindex->nHeight;
+        std::shared_ptr<Slot> slot;
+
+        if (!m_threads.empty()) {
+            schedule(nBlock);
+
+            int64_t nTimeStart = GetTimeMicros();
+            WAIT_LOCK(m_mutex, lock);
+            std::map<int, std::shared_ptr<Slot> >::iterator it = m_slots.find(nBlock);
+            if (it != m_slots.end()) {
+                slot = it->second;
+                m_slots.erase(it);
+                m_cond.wait(lock, [&slot] { return slot->fDone; });
+            }
+            nWaitMicros += GetTimeMicros() - nTimeStart;
+        }
+
+        if (!slot || slot->hash != pblockindex->GetBlockHash()) {
+            slot = std::make_shared<Slot>();
+            {
+                LOCK(cs_main);
+                locate(*slot, pblockindex);
+            }
+            read(*slot);
+        }
+
+        block = std::move(slot->block);
+        blockundo.vtxundo.swap(slot->blockundo.vtxundo);
+        vMayHaveMarker.swap(slot->vMayHaveMarker);
+
+        return slot->fRead;
+    }
+};
+
+//! Whether the writes of an earlier block failed to commit, when the batch of the current block was started
+static bool fBlockBatchFailed = false;
+
+/**
+ * Commits the writes to the databases collected for a block.
+ *
+ * If the writes of the block, or writes left over from an earlier block, could
+ * not be committed, the databases are behind the in-memory state, which then
+ * must not be persisted, and the client is shut down.
+ *
+ * @return False, if the writes could not be committed
+ */
+static bool CommitBlockWrites(int nBlock, const CBlockIndex* pBlockIndex)
+{
+    LOCK(cs_tally);
+
+    bool fCommitted = CDBBase::CommitBlockBatch() && !fBlockBatchFailed;
+    fBlockBatchFailed = false;
+    if (fCommitted) return true;
+
+    const std::string& msg = strprintf(
+            "Shutting down due to failed database writes for block %d (hash %s). "
+            "Please restart with -startclean flag and if this doesn't work, please reach out to the support.\n",
+            nBlock, pBlockIndex->GetBlockHash().GetHex());
+    PrintToLog(msg);
+    fs::path persistPath = GetDataDir() / "MP_persist";
+    FlushStatePersistence();
+    if (fs::exists(persistPath)) fs::remove_all(persistPath); // prevent the node being restarted without a reparse
+    DoAbortNode(msg, msg);
+
+    return false;
+}
+
 /**
  * Scans the blockchain for meta transactions.
  *
@@ -1344,6 +1787,11 @@ public:
  *
  * Every 30 seconds the progress of the scan is reported.
  *
+ * Blocks are read and pre-filtered by -omniscanthreads reader threads ahead
+ * of the scan, and transactions without any Omni marker are skipped early.
+ * The undo data of blocks with marked transactions is read alongside, so the
+ * inputs of the transactions are resolved without transaction lookups.
+ *
  * In case the current block being processed is not part of the active chain, or
  * if a block could not be retrieved from the disk, then the scan stops early.
  * Likewise, global shutdown requests are honored, and stop the scan progress.
@@ -1361,6 +1809,7 @@ static int msc_initial_scan(int nFirstBlock)
     int64_t nNow = GetTime();
     unsigned int nTxsTotal = 0;
     unsigned int nTxsFoundTotal = 0;
+    unsigned int nTxsMarkedTotal = 0;
     int nBlock = 999999;
     const int nLastBlock = GetHeight();
 
@@ -1379,6 +1828,11 @@ static int msc_initial_scan(int nFirstBlock)
 
     ProgressReporter progressReporter(pFirstBlock, pLastBlock);
 
+    int nScanThreads = std::max(0, (int) gArgs.GetArg("-omniscanthreads", DEFAULT_OMNI_SCAN_THREADS));
+    BlockPrefetcher prefetcher(nFirstBlock, nLastBlock, nScanThreads);
+    const int64_t nTimeStart = GetTimeMicros();
+    int64_t nWaitMicros = 0;
+
     for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
     {
         if (ShutdownRequested()) {
@@ -1400,6 +1854,10 @@ static int msc_initial_scan(int nFirstBlock)
 
         if (GetTime() >= nNow + nTimeBetweenProgressReports) {
             progressReporter.update(pblockindex);
+            double dSeconds = std::max(1, (int) ((GetTimeMicros() - nTimeStart) / 1000000));
+            PrintToLog("Scan throughput: %d blocks (%.1f/s), %d transactions (%.1f/s), %d with marker, "
+                    "%.3f seconds waited for blocks\n", nBlock - nFirstBlock, (nBlock - nFirstBlock) / dSeconds,
+                    nTxsTotal, nTxsTotal / dSeconds, nTxsMarkedTotal, nWaitMicros * 0.000001);
             nNow = GetTime();
         }
 
@@ -1408,10 +1866,23 @@ static int msc_initial_scan(int nFirstBlock)
         nTxsFoundInBlock = mastercore_handler_block_begin(nBlock, pblockindex);
 
         CBlock block;
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) break;
+        CBlockUndo blockundo;
+        std::vector<bool> vMayHaveMarker;
+        if (!prefetcher.get(pblockindex, block, blockundo, vMayHaveMarker, nWaitMicros)) {
+            // the writes collected since the block began must not be left open for a later block
+            CommitBlockWrites(nBlock, pblockindex);
+            break;
+        }
 
         for(const auto tx : block.vtx) {
-            if (mastercore_handler_tx(*tx, nBlock, nTxNum, pblockindex, nullptr)) ++nTxsFoundInBlock;
+            if (vMayHaveMarker[nTxNum]) {
+                if (mastercore_handler_tx(*tx, nBlock, nTxNum, pblockindex, &blockundo)) ++nTxsFoundInBlock;
+                ++nTxsMarkedTotal;
+            } else {
+                // without marker, the transaction only clears pending amounts
+                LOCK(cs_tally);
+                PendingDelete(tx->GetHash());
+            }
             ++nTxNum;
         }
 
@@ -1426,6 +1897,12 @@ static int msc_initial_scan(int nFirstBlock)
 
     PrintToConsole("%d new transactions processed, %d meta transactions found\n", nTxsTotal, nTxsFoundTotal);
 
+    int64_t nElapsedMicros = std::max((int64_t) 1, GetTimeMicros() - nTimeStart);
+    PrintToLog("Scanned %d blocks and %d transactions in %.3f seconds (%.1f blocks/s, %.1f transactions/s) "
+            "with %d reader threads, %d with marker, %.3f seconds waited for blocks\n",
+            nBlock - nFirstBlock, nTxsTotal, nElapsedMicros * 0.000001, (nBlock - nFirstBlock) * 1000000.0 / nElapsedMicros,
+            nTxsTotal * 1000000.0 / nElapsedMicros, nScanThreads, nTxsMarkedTotal, nWaitMicros * 0.000001);
+
     return 0;
 }
 
@@ -1439,14 +1916,17 @@ void clear_all_state()
 
     // Memory based storage
     mp_tally_map.clear();
+    ClearStateHashBalances();
     my_offers.clear();
     my_accepts.clear();
     my_crowds.clear();
+    ResetStateHashDExAndCrowdsales();
     my_pending.clear();
     ResetConsensusParams();
     ClearActivations();
     ClearAlerts();
     ClearFreezeState();
+    ClearJournal();
 
     // LevelDB based storage
     pDbSpInfo->Clear();
@@ -1454,13 +1934,63 @@ void clear_all_state()
     pDbStoList->Clear();
     pDbTransaction->Clear();
     pDbNFT->Clear();
+    if (pDbAddressIndex) {
+        pDbAddressIndex->Clear();
+        pDbAddressIndex->setStartBlock(0); // all transactions are indexed again
+    }
+    if (pDbPropertyIndex) {
+        pDbPropertyIndex->Clear();
+        pDbPropertyIndex->setStartBlock(0); // all transactions are indexed again
+    }
     assert(pDbTransactionList->setDBVersion() == DB_VERSION); // new set of databases, set DB version
 }
 
+/**
+ * Upgrades the databases of a previous version, which can be upgraded without
+ * a refresh of the state.
+ *
+ * Returns false, if the databases were not upgraded.
+ */
+static bool UpgradeDatabases(int dbVersion)
+{
+    if (dbVersion < DB_VERSION_MIN_UPGRADABLE || dbVersion >= DB_VERSION) {
+        return false;
+    }
+
+    PrintToConsole("Upgrading databases from version %d to version %d...\n", dbVersion, DB_VERSION);
+
+    // version 11 stores the records in the binary record format, and the
+    // height index of version 10 is rebuilt from the converted records
+    if (dbVersion < 11) {
+        if (pDbTransactionList->UpgradeRecordFormat() < 0) return false;
+        if (pDbTransaction->UpgradeRecordFormat() < 0) return false;
+        if (pDbTransactionList->BuildHeightIndex() < 0) return false;
+    }
+
+    // version 12 stores one record per STO receipt
+    if (dbVersion < 12) {
+        if (pDbStoList->UpgradeRecordFormat() < 0) return false;
+    }
+
+    // version 13 stores the headers of properties apart from the full entries, and
+    // version 14 the historical data, which is moved out first, so the headers can
+    // be derived from the converted entries
+    if (dbVersion < 14) {
+        if (pDbSpInfo->UpgradeHistory() < 0) return false;
+        if (pDbSpInfo->BuildHeaders() < 0) return false;
+    }
+
+    // version 15 indexes the properties, which were stored in each block
+    if (pDbSpInfo->BuildTouchedIndex() < 0) return false;
+
+    return true;
+}
+
 void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialParse = false)
 {
     int nWaterline;
     bool reorgContainsFreeze;
+    bool fJournalRewound = false;
     {
         LOCK(cs_tally);
         // Check if any freeze related transactions would be rolled back - if so wipe the state and startclean
@@ -1469,12 +1999,22 @@ void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialParse = fal
         // NOTE: The blockNum parameter is inclusive, so deleteAboveBlock(1000) will delete records in block 1000 and above.
         pDbTransactionList->isMPinBlockRange(nHeight, reorgRecoveryMaxHeight, true);
         pDbStoList->deleteAboveBlock(nHeight);
+        if (pDbPropertyIndex) pDbPropertyIndex->deleteAboveBlock(nHeight);
+        if (pDbAddressIndex) pDbAddressIndex->deleteAboveBlock(nHeight);
         reorgRecoveryMaxHeight = 0;
 
         nWaterlineBlock = ConsensusParams().GENESIS_BLOCK - 1;
+
+        // revert the disconnected blocks in memory, if they are covered by the journal
+        if (!fInitialParse && RewindJournal(nHeight)) {
+            fJournalRewound = true;
+            nWaterlineBlock = nHeight - 1;
+        }
     }
 
-    if (reorgContainsFreeze && !fInitialParse) {
+    if (fJournalRewound) {
+        PrintToLog("Reverted the state to block %d using the state journal\n", nHeight - 1);
+    } else if (reorgContainsFreeze && !fInitialParse) {
        PrintToConsole("Reorganization containing freeze related transactions detected, forcing a reparse...\n");
        clear_all_state(); // unable to reorg freezes safely, clear state and reparse
     } else {
@@ -1508,6 +2048,47 @@ void RewindDBsAndState(int nHeight, int nBlockPrev = 0, bool fInitialParse = fal
  *
  * @return An exit code, indicating success or failure
  */
+/**
+ * Prepares an index to cover the blocks, which are processed from now on.
+ *
+ * An index, which was kept while the node ran without it, drops the transactions
+ * of blocks, which were disconnected in the meantime. If blocks were processed
+ * without the index, it only covers the blocks from now on.
+ */
+static void StartTxIndex(CMPTxIndex& index, const std::string& strName, int nNextBlock)
+{
+    AssertLockHeld(cs_main);
+
+    int nLastBlock;
+    uint256 hashLastBlock;
+    if (index.getLastBlock(nLastBlock, hashLastBlock)) {
+        int nForkBlock = -1;
+        const CBlockIndex* pLastBlockIndex = LookupBlockIndex(hashLastBlock);
+        if (pLastBlockIndex) {
+            const CBlockIndex* pForkBlockIndex = chainActive.FindFork(pLastBlockIndex);
+            if (pForkBlockIndex) nForkBlock = pForkBlockIndex->nHeight;
+        }
+        if (nForkBlock < nLastBlock) {
+            index.deleteAboveBlock(nForkBlock + 1);
+            nLastBlock = nForkBlock;
+        }
+        if (nLastBlock + 1 < nNextBlock) {
+            PrintToConsole("%s misses blocks %d to %d, which were processed while it was disabled\n",
+                    strName, nLastBlock + 1, nNextBlock - 1);
+            index.setStartBlock(nNextBlock);
+        }
+    }
+
+    // a new index covers the blocks, which are processed from now on
+    if (index.getStartBlock() < 0) {
+        index.setStartBlock(nNextBlock);
+    }
+    if (index.getStartBlock() > ConsensusParams().GENESIS_BLOCK) {
+        PrintToConsole("%s covers blocks from %d, restart with -startclean to index earlier transactions\n",
+                strName, index.getStartBlock());
+    }
+}
+
 int mastercore_init()
 {
     bool wrongDBVersion, startClean = false;
@@ -1528,6 +2109,10 @@ int mastercore_init()
         InitDebugLogLevels();
         ShrinkDebugLog();
 
+        // check for --omnistatehash option and maintain the incremental state hash accordingly
+        fOmniStateHash = gArgs.GetBoolArg("-omnistatehash", false);
+        fOmniStateHashCheck = gArgs.GetBoolArg("-omnistatehashcheck", false);
+
         if (TestNet()) {
             exodus_address = exodus_testnet;
         } else if (RegTest()) {
@@ -1551,12 +2136,16 @@ int mastercore_init()
                 fs::path stoPath = GetDataDir() / "MP_stolist";
                 fs::path omniTXDBPath = GetDataDir() / "Omni_TXDB";
                 fs::path nftdbPath = GetDataDir() / "OMNI_nftdb";
+                fs::path propertyIndexPath = GetDataDir() / "MP_propertyindex";
+                fs::path addressIndexPath = GetDataDir() / "MP_addressindex";
                 if (fs::exists(persistPath)) fs::remove_all(persistPath);
                 if (fs::exists(txlistPath)) fs::remove_all(txlistPath);
                 if (fs::exists(spPath)) fs::remove_all(spPath);
                 if (fs::exists(stoPath)) fs::remove_all(stoPath);
                 if (fs::exists(omniTXDBPath)) fs::remove_all(omniTXDBPath);
                 if (fs::exists(nftdbPath)) fs::remove_all(nftdbPath);
+                if (fs::exists(propertyIndexPath)) fs::remove_all(propertyIndexPath);
+                if (fs::exists(addressIndexPath)) fs::remove_all(addressIndexPath);
                 PrintToLog("Success clearing persistence files in datadir %s\n", GetDataDir().string());
                 startClean = true;
             } catch (const fs::filesystem_error& e) {
@@ -1571,9 +2160,21 @@ int mastercore_init()
         pDbTransaction = new COmniTransactionDB(GetDataDir() / "Omni_TXDB", fReindex);
         pDbNFT = new CMPNonFungibleTokensDB(GetDataDir() / "OMNI_nftdb", fReindex);
 
+        // disabled indexes are kept, and resume after the last block they cover, once enabled again
+        if (gArgs.GetBoolArg("-omnipropertyindex", DEFAULT_OMNI_PROPERTY_INDEX)) {
+            pDbPropertyIndex = new CMPPropertyIndex(GetDataDir() / "MP_propertyindex", fReindex);
+        }
+        if (gArgs.GetBoolArg("-omniaddressindex", DEFAULT_OMNI_ADDRESS_INDEX)) {
+            pDbAddressIndex = new CMPAddressIndex(GetDataDir() / "MP_addressindex", fReindex);
+        }
+
         pathStateFiles = GetDataDir() / "MP_persist";
         TryCreateDirectories(pathStateFiles);
 
+        if (!startClean && UpgradeDatabases(pDbTransactionList->getDBVersion())) {
+            assert(pDbTransactionList->setDBVersion() == DB_VERSION);
+        }
+
         wrongDBVersion = (pDbTransactionList->getDBVersion() != DB_VERSION);
 
         ++mastercoreInitialized;
@@ -1643,6 +2244,9 @@ int mastercore_init()
 
     {
         LOCK2(cs_main, cs_tally);
+        if (pDbPropertyIndex) StartTxIndex(*pDbPropertyIndex, "Property index", nWaterlineBlock);
+        if (pDbAddressIndex) StartTxIndex(*pDbAddressIndex, "Address index", nWaterlineBlock);
+
         // load feature activation messages from txlistdb and process them accordingly
         pDbTransactionList->LoadActivations(nWaterlineBlock);
 
@@ -1679,6 +2283,9 @@ int mastercore_init()
  */
 int mastercore_shutdown()
 {
+    // write the remaining captured states, before the databases are closed
+    StopStatePersistence();
+
     LOCK(cs_tally);
 
     if (pDbTransactionList) {
@@ -1701,6 +2308,14 @@ int mastercore_shutdown()
         delete pDbNFT;
         pDbNFT = nullptr;
     }
+    if (pDbPropertyIndex) {
+        delete pDbPropertyIndex;
+        pDbPropertyIndex = nullptr;
+    }
+    if (pDbAddressIndex) {
+        delete pDbAddressIndex;
+        pDbAddressIndex = nullptr;
+    }
 
     mastercoreInitialized = 0;
 
@@ -1717,7 +2332,7 @@ int mastercore_shutdown()
  *
  * @return True, if the transaction was an Exodus purchase, DEx payment or a valid Omni transaction
  */
-bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex, const std::shared_ptr<std::map<COutPoint, Coin> > removedCoins)
+bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex, const CBlockUndo* pBlockUndo)
 {
     int nMastercoreInit, pop_ret;
     {
@@ -1749,7 +2364,9 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
 
     {
         LOCK2(cs_main, cs_tally);
-        pop_ret = parseTransaction(false, tx, nBlock, idx, mp_obj, nBlockTime, removedCoins);
+        if (!TakeParsedTransaction(tx, nBlock, idx, mp_obj, pop_ret)) {
+            pop_ret = parseTransaction(false, tx, nBlock, idx, mp_obj, nBlockTime, GetSpentCoins(tx, idx, pBlockUndo));
+        }
     }
 
     {
@@ -1759,7 +2376,11 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
             assert(mp_obj.getEncodingClass() == OMNI_CLASS_A);
             assert(mp_obj.getPayload().empty() == true);
 
-            fFoundTx |= HandleDExPayments(tx, nBlock, mp_obj.getSender());
+            bool fPayment = HandleDExPayments(tx, nBlock, mp_obj.getSender());
+            if (fPayment && pDbAddressIndex) {
+                pDbAddressIndex->recordTransaction(tx.GetHash(), nBlock, idx, mp_obj.getSender(), "");
+            }
+            fFoundTx |= fPayment;
         }
     }
 
@@ -1774,6 +2395,18 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
             bool bValid = (0 <= interp_ret);
             pDbTransactionList->recordTX(tx.GetHash(), bValid, nBlock, mp_obj.getType(), mp_obj.getNewAmount());
             pDbTransaction->RecordTransaction(tx.GetHash(), idx, interp_ret);
+            if (pDbPropertyIndex) {
+                uint32_t propertyId = mp_obj.getProperty();
+                if (propertyId == 0 && bValid) {
+                    propertyId = pDbSpInfo->findSPByTX(tx.GetHash()); // created properties
+                }
+                if (propertyId != 0) {
+                    pDbPropertyIndex->recordTransaction(propertyId, nBlock, idx, tx.GetHash(), mp_obj.getType(), mp_obj.getNewAmount(), bValid);
+                }
+            }
+            if (pDbAddressIndex) {
+                pDbAddressIndex->recordTransaction(tx.GetHash(), nBlock, idx, mp_obj.getSender(), mp_obj.getReceiver());
+            }
         }
         fFoundTx |= (interp_ret == 0);
     }
@@ -1787,6 +2420,41 @@ bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx,
     return fFoundTx;
 }
 
+/**
+ * This handler is called for every connected block, before its transactions are
+ * processed, and parses the transactions in parallel with -omniparsethreads threads.
+ *
+ * The inputs are taken from the undo data of the block, so no locks are needed to
+ * parse the transactions. Parsing doesn't depend on the state, which is updated
+ * when the transactions are processed in order by mastercore_handler_tx.
+ */
+void mastercore_handler_block_parse(const CBlock& block, int nBlock, const CBlockIndex* pBlockIndex, const CBlockUndo& blockundo)
+{
+    if (nOmniParseThreads <= 1) {
+        return;
+    }
+
+    {
+        LOCK(cs_tally);
+        if (!mastercoreInitialized || nBlock < nWaterlineBlock) return;
+    }
+
+    std::vector<ParsedTransaction> vParsed(block.vtx.size());
+    std::vector<CMPParseCheck> vChecks;
+    vChecks.reserve(block.vtx.size());
+    for (unsigned int idx = 0; idx < block.vtx.size(); ++idx) {
+        vChecks.emplace_back(*block.vtx[idx], nBlock, idx, pBlockIndex->GetBlockTime(), GetSpentCoins(*block.vtx[idx], idx, &blockundo), vParsed[idx]);
+    }
+
+    CCheckQueueControl<CMPParseCheck> control(&parsecheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    LOCK(cs_tally);
+    vParsedTransactions.swap(vParsed);
+    nParsedBlock = nBlock;
+}
+
 /**
  * Determines, whether it is valid to use a Class C transaction for a given payload size.
  *
@@ -1823,6 +2491,20 @@ int mastercore_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockInd
     {
         LOCK(cs_tally);
 
+        // collect the writes to the databases, until the block was processed
+        if (!CDBBase::BeginBlockBatch()) {
+            // writes left over from an earlier block were lost, which is handled when this block is committed
+            fBlockBatchFailed = true;
+        }
+
+        // record the changes of this block, so they can be persisted as delta and reverted in memory,
+        // unless the state is only initialized at the end of the block
+        if (mastercoreInitialized && IsPersistenceEnabled(pBlockIndex->nHeight)) {
+            JournalBlockBegin(pBlockIndex);
+        } else {
+            ClearJournal();
+        }
+
         // handle any features that go live with this block
         CheckLiveActivations(pBlockIndex->nHeight);
 
@@ -1869,6 +2551,10 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         // check that pending transactions are still in the mempool
         PendingCheck();
 
+        // release the transactions, which were parsed ahead
+        vParsedTransactions.clear();
+        nParsedBlock = -1;
+
         // transactions were found in the block, signal the UI accordingly
         if (countMP > 0) CheckWalletUpdate(true);
 
@@ -1881,6 +2567,9 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         // request nftdb sanity check
         pDbNFT->SanityCheck();
 
+        // cross-check the incremental state hash, if requested
+        VerifyStateHash(nBlockNow);
+
         // request checkpoint verification
         checkpointValid = VerifyCheckpoint(nBlockNow, pBlockIndex->GetBlockHash());
         if (!checkpointValid) {
@@ -1892,6 +2581,7 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
             PrintToLog(msg);
             if (!gArgs.GetBoolArg("-overrideforcedshutdown", false)) {
                 fs::path persistPath = GetDataDir() / "MP_persist";
+                FlushStatePersistence();
                 if (fs::exists(persistPath)) fs::remove_all(persistPath); // prevent the node being restarted without a reparse after forced shutdown
                 DoAbortNode(msg, msg);
             }
@@ -1899,6 +2589,16 @@ int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
     }
 
     LOCK2(cs_main, cs_tally);
+    JournalBlockEnd(pBlockIndex);
+
+    // the indexes record the last block they cover, so they can resume after running without them
+    if (pDbPropertyIndex) pDbPropertyIndex->setLastBlock(nBlockNow, pBlockIndex->GetBlockHash());
+    if (pDbAddressIndex) pDbAddressIndex->setLastBlock(nBlockNow, pBlockIndex->GetBlockHash());
+
+    // commit the writes of this block, before the watermark of the persisted state is updated
+    if (!CommitBlockWrites(nBlockNow, pBlockIndex)) {
+        return 0;
+    }
     if (checkpointValid){
         // save out the state after this block
         if (IsPersistenceEnabled(nBlockNow) && nBlockNow >= ConsensusParams().GENESIS_BLOCK) {
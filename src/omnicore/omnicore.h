@@ -1,7 +1,9 @@
 #ifndef BITCOIN_OMNICORE_OMNICORE_H
 #define BITCOIN_OMNICORE_OMNICORE_H
 
+class CBlock;
 class CBlockIndex;
+class CBlockUndo;
 class CCoinsView;
 class CCoinsViewCache;
 class CTransaction;
@@ -23,7 +25,6 @@ class Coin;
 #include <string>
 #include <vector>
 #include <set>
-#include <unordered_map>
 
 // Keep the state of the last 200 blocks to roll back quickly
 // in case of a block reorganization
@@ -34,11 +35,16 @@ int const STORE_EVERY_N_BLOCK = 5000;
 // Don't store the state every block on mainnet until block 622000
 // was reached
 int const DONT_STORE_MAINNET_STATE_UNTIL = 3454000;
+// Number of threads, which read blocks ahead of the initial scan
+int const DEFAULT_OMNI_SCAN_THREADS = 2;
 
 #define TEST_ECO_PROPERTY_1 (0x80000003UL)
 
 // increment this value to force a refresh of the state (similar to --startclean)
-#define DB_VERSION 9
+#define DB_VERSION 15
+
+// databases of this version, or a later one, are upgraded on startup without a refresh of the state
+#define DB_VERSION_MIN_UPGRADABLE 9
 
 // could probably also use: int64_t maxInt64 = std::numeric_limits<int64_t>::max();
 // maximum numeric values from the spec:
@@ -133,6 +139,12 @@ const std::vector<unsigned char> GetOmMarker();
 //! Used to indicate, whether to automatically commit created transactions
 extern bool autoCommit;
 
+//! Default for -omniparsethreads, the number of threads, which parse the transactions of a connected block
+static const int DEFAULT_OMNI_PARSE_THREADS = 1;
+
+//! Number of threads, which parse the transactions of a connected block
+extern int nOmniParseThreads;
+
 //! Global lock for state objects
 extern CCriticalSection cs_tally;
 
@@ -158,7 +170,11 @@ int mastercore_shutdown();
 void mastercore_handler_disc_begin(const int nHeight);
 int mastercore_handler_block_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int);
-bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex, const std::shared_ptr<std::map<COutPoint, Coin>> removedCoins);
+void mastercore_handler_block_parse(const CBlock& block, int nBlock, const CBlockIndex* pBlockIndex, const CBlockUndo& blockundo);
+bool mastercore_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex, const CBlockUndo* pBlockUndo);
+
+/** Runs a thread, which parses transactions of connected blocks. */
+void ThreadOmniParse();
 
 /** Scans for marker and if one is found, add transaction to marker cache. */
 void TryToAddToMarkerCache(const CTransactionRef& tx);
@@ -173,7 +189,7 @@ void CheckWalletUpdate(bool forceUpdate = false);
 namespace mastercore
 {
 //! In-memory collection of all amounts for all addresses for all properties
-extern std::unordered_map<std::string, CMPTally> mp_tally_map;
+extern CMPTallyMap mp_tally_map;
 
 // TODO: move, rename
 extern CCoinsView viewDummy;
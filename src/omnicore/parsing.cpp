@@ -10,6 +10,7 @@
 #include <omnicore/script.h>
 
 #include <base58.h>
+#include <crypto/sha256.h>
 #include <key_io.h>
 #include <uint256.h>
 #include <util/strencodings.h>
@@ -107,28 +108,54 @@ std::string HashToAddress(unsigned char version, const uint160& hash)
  */
 void PrepareObfuscatedHashes(const std::string& strSeed, int hashCount, std::string(&vstrHashes)[1+MAX_SHA256_OBFUSCATION_TIMES])
 {
-    unsigned char sha_input[128];
-    unsigned char sha_result[128];
-    std::vector<unsigned char> vec_chars;
+    unsigned char vchHashes[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE];
+    PrepareObfuscatedHashes(strSeed, hashCount, vchHashes);
 
-    assert(strSeed.size() < sizeof(sha_input));
-    strcpy((char *)sha_input, strSeed.c_str());
+    if (hashCount > MAX_SHA256_OBFUSCATION_TIMES) hashCount = MAX_SHA256_OBFUSCATION_TIMES;
+
+    for (int j = 1; j <= hashCount; ++j) {
+        vstrHashes[j] = HexStr(vchHashes[j], vchHashes[j] + OBFUSCATION_HASH_SIZE);
+        boost::to_upper(vstrHashes[j]); // Convert to upper case characters
+    }
+}
+
+/**
+ * Generates the raw hashes used for obfuscation.
+ *
+ * Each hash is the SHA256 hash of the previous hash as uppercase hex string,
+ * or of the seed for the first one, which is encoded in a fixed buffer, so
+ * the packets can be deobfuscated without any string conversion.
+ *
+ * It is expected that the seed has a length of less than 128 characters.
+ *
+ * @param strSeed[in]      A seed used for the obfuscation
+ * @param hashCount[in]    How many hashes to generate (number of packets to debofuscate)
+ * @param vchHashes[out]   The generated hashes
+ */
+void PrepareObfuscatedHashes(const std::string& strSeed, int hashCount, unsigned char(&vchHashes)[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE])
+{
+    static const char pszHexUpper[] = "0123456789ABCDEF";
+    char pchHex[2 * OBFUSCATION_HASH_SIZE];
+
+    assert(strSeed.size() < 128);
 
     if (hashCount > MAX_SHA256_OBFUSCATION_TIMES) hashCount = MAX_SHA256_OBFUSCATION_TIMES;
 
+    // the seed is hashed as C string, and each hash as uppercase hex string
+    const char* pchInput = strSeed.c_str();
+    size_t nInputSize = strlen(pchInput);
+
     // Do only as many re-hashes as there are data packets, 255 per specification
     for (int j = 1; j <= hashCount; ++j)
     {
-        CSHA256().Write(sha_input, strlen((const char *)sha_input)).Finalize(sha_result);
-        vec_chars.resize(32);
-        memcpy(&vec_chars[0], &sha_result[0], 32);
-        vstrHashes[j] = HexStr(vec_chars);
-        boost::to_upper(vstrHashes[j]); // Convert to upper case characters
-
-        assert(vstrHashes[j].size() < sizeof(sha_input));
-        strcpy((char *)sha_input, vstrHashes[j].c_str());
+        CSHA256().Write((const unsigned char*) pchInput, nInputSize).Finalize(vchHashes[j]);
+        for (int i = 0; i < OBFUSCATION_HASH_SIZE; ++i) {
+            pchHex[2 * i] = pszHexUpper[vchHashes[j][i] >> 4];
+            pchHex[2 * i + 1] = pszHexUpper[vchHashes[j][i] & 0x0f];
+        }
+        pchInput = pchHex;
+        nInputSize = sizeof(pchHex);
     }
 }
 
-
 // Move ParseTransaction into this file
@@ -19,6 +19,7 @@ class uint160;
 #define PACKET_SIZE                    31
 #define MAX_PACKETS                   255
 #define MAX_SHA256_OBFUSCATION_TIMES  255
+#define OBFUSCATION_HASH_SIZE          32
 
 /**
  * Swaps byte order on little-endian systems and does nothing 
@@ -34,6 +35,9 @@ std::string HashToAddress(unsigned char version, const uint160& hash);
 /** Generates hashes used for obfuscation via ToUpper(HexStr(SHA256(x))). */
 void PrepareObfuscatedHashes(const std::string& strSeed, int hashCount, std::string(&vstrHashes)[1+MAX_SHA256_OBFUSCATION_TIMES]);
 
+/** Generates the raw hashes used for obfuscation via SHA256(ToUpper(HexStr(x))). */
+void PrepareObfuscatedHashes(const std::string& strSeed, int hashCount, unsigned char(&vchHashes)[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE]);
+
 /** Parses a transaction and populates the CMPTransaction object. */
 int ParseTransaction(const CTransaction& tx, int nBlock, unsigned int idx, CMPTransaction& mptx, unsigned int nTime=0);
 
@@ -6,7 +6,9 @@
 
 #include <omnicore/persistence.h>
 
+#include <omnicore/consensushash.h>
 #include <omnicore/dex.h>
+#include <omnicore/journal.h>
 #include <omnicore/log.h>
 #include <omnicore/rules.h>
 #include <omnicore/sp.h>
@@ -14,8 +16,12 @@
 #include <omnicore/utilsbitcoin.h>
 
 #include <chain.h>
+#include <clientversion.h>
 #include <fs.h>
 #include <hash.h>
+#include <serialize.h>
+#include <streams.h>
+#include <sync.h>
 #include <validation.h>
 #include <tinyformat.h>
 #include <uint256.h>
@@ -25,12 +31,20 @@
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include <assert.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
 #include <set>
 #include <string>
-#include <unordered_map>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -39,15 +53,6 @@ using namespace mastercore;
 //! Path for file based persistence
 extern fs::path pathStateFiles;
 
-enum FILETYPES {
-  FILETYPE_BALANCES = 0,
-  FILETYPE_OFFERS,
-  FILETYPE_ACCEPTS,
-  FILETYPE_GLOBALS,
-  FILETYPE_CROWDSALES,
-  NUM_FILETYPES
-};
-
 static char const * const statePrefix[NUM_FILETYPES] = {
     "balances",
     "offers",
@@ -56,7 +61,12 @@ static char const * const statePrefix[NUM_FILETYPES] = {
     "crowdsales"
 };
 
-static bool is_state_prefix(std::string const &str)
+//! File name prefix of state snapshots
+static char const * const snapshotPrefix = "snapshot";
+//! File name prefix of state deltas
+static char const * const deltaPrefix = "delta";
+
+static bool is_text_state_prefix(std::string const &str)
 {
     for (int i = 0; i < NUM_FILETYPES; ++i) {
         if (boost::equals(str, statePrefix[i])) {
@@ -67,103 +77,82 @@ static bool is_state_prefix(std::string const &str)
     return false;
 }
 
-static int write_msc_balances(std::ofstream& file, CHash256& hasher)
+static bool is_state_prefix(std::string const &str)
 {
-    std::unordered_map<std::string, CMPTally>::iterator iter;
-    for (iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
-        bool emptyWallet = true;
-
-        std::string lineOut = (*iter).first;
-        lineOut.append("=");
-        CMPTally& curAddr = (*iter).second;
-        curAddr.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = curAddr.next())) {
-            int64_t balance = (*iter).second.getMoney(propertyId, BALANCE);
-            int64_t sellReserved = (*iter).second.getMoney(propertyId, SELLOFFER_RESERVE);
-            int64_t acceptReserved = (*iter).second.getMoney(propertyId, ACCEPT_RESERVE);
-
-            // we don't allow 0 balances to read in, so if we don't write them
-            // it makes things match up better between persisted state and processed state
-            if (0 == balance && 0 == sellReserved && 0 == acceptReserved) {
-                continue;
-            }
-
-            emptyWallet = false;
+    return is_text_state_prefix(str) || boost::equals(str, snapshotPrefix) || boost::equals(str, deltaPrefix);
+}
 
-            lineOut.append(strprintf("%d:%d,%d,%d;",
-                    propertyId,
-                    balance,
-                    sellReserved,
-                    acceptReserved));
-        }
+static fs::path get_snapshot_path(const uint256& blockHash)
+{
+    return pathStateFiles / strprintf("%s-%s.dat", snapshotPrefix, blockHash.ToString());
+}
 
-        if (false == emptyWallet) {
-            // add the line to the hash
-            hasher.Write((unsigned char*)lineOut.c_str(), lineOut.length());
+static fs::path get_delta_path(const uint256& blockHash)
+{
+    return pathStateFiles / strprintf("%s-%s.dat", deltaPrefix, blockHash.ToString());
+}
 
-            // write the line
-            file << lineOut << std::endl;
-        }
-    }
+//! Kinds of persisted state of a block, combined as bit flags
+enum PersistedStateKind {
+    PERSISTED_TEXT = 1,
+    PERSISTED_SNAPSHOT = 2,
+    PERSISTED_DELTA = 4
+};
 
-    return 0;
-}
+//! Persisted state files by block hash, to avoid scanning the directory after every block
+static std::map<uint256, int> mapPersistedStates;
+//! Whether the persisted state files were indexed already
+static bool fPersistedStatesLoaded = false;
 
-static int write_mp_offers(std::ofstream& file, CHash256& hasher)
+/** Indexes the state files in the persistence directory once. */
+static void load_persisted_states()
 {
-    OfferMap::const_iterator iter;
-    for (iter = my_offers.begin(); iter != my_offers.end(); ++iter) {
-        // decompose the key for address
-        std::vector<std::string> vstr;
-        boost::split(vstr, iter->first, boost::is_any_of("-"), boost::token_compress_on);
-        const CMPOffer& offer = iter->second;
-        offer.saveOffer(file, vstr[0], hasher);
+    if (fPersistedStatesLoaded) {
+        return;
     }
 
-    return 0;
-}
+    fs::directory_iterator dIter(pathStateFiles);
+    fs::directory_iterator endIter;
+    for (; dIter != endIter; ++dIter) {
+        std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
+        if (false == fs::is_regular_file(dIter->status())) {
+            // skip funny business
+            PrintToLog("Non-regular file found in persistence directory : %s\n", fName);
+            continue;
+        }
 
-static int write_mp_accepts(std::ofstream& file, CHash256& hasher)
-{
-    AcceptMap::const_iterator iter;
-    for (iter = my_accepts.begin(); iter != my_accepts.end(); ++iter) {
-        // decompose the key for address
         std::vector<std::string> vstr;
-        boost::split(vstr, iter->first, boost::is_any_of("-+"), boost::token_compress_on);
-        const CMPAccept& accept = iter->second;
-        accept.saveAccept(file, vstr[0], vstr[2], hasher);
+        boost::split(vstr, fName, boost::is_any_of("-."), boost::token_compress_on);
+        if (vstr.size() == 3 &&
+                is_state_prefix(vstr[0]) &&
+                boost::equals(vstr[2], "dat")) {
+            uint256 blockHash;
+            blockHash.SetHex(vstr[1]);
+            if (boost::equals(vstr[0], snapshotPrefix)) {
+                mapPersistedStates[blockHash] |= PERSISTED_SNAPSHOT;
+            } else if (boost::equals(vstr[0], deltaPrefix)) {
+                mapPersistedStates[blockHash] |= PERSISTED_DELTA;
+            } else {
+                mapPersistedStates[blockHash] |= PERSISTED_TEXT;
+            }
+        } else {
+            PrintToLog("None state file found in persistence directory : %s\n", fName);
+        }
     }
 
-    return 0;
+    fPersistedStatesLoaded = true;
 }
 
-static int write_globals_state(std::ofstream& file, CHash256& hasher)
+/** Indicates whether the state after the block can be restored from a snapshot or delta. */
+static bool has_persisted_state(const uint256& blockHash)
 {
-    uint32_t nextSPID = pDbSpInfo->peekNextSPID(OMNI_PROPERTY_MSC);
-    uint32_t nextTestSPID = pDbSpInfo->peekNextSPID(OMNI_PROPERTY_TMSC);
-    std::string lineOut = strprintf("%d,%d",
-            nextSPID,
-            nextTestSPID);
-
-    // add the line to the hash
-    hasher.Write((unsigned char*)lineOut.c_str(), lineOut.length());
-
-    // write the line
-    file << lineOut << std::endl;
-
-    return 0;
+    std::map<uint256, int>::const_iterator it = mapPersistedStates.find(blockHash);
+    return it != mapPersistedStates.end() && (it->second & (PERSISTED_SNAPSHOT | PERSISTED_DELTA));
 }
 
-static int write_mp_crowdsales(std::ofstream& file, CHash256& hasher)
+static fs::path get_state_file_path(const uint256& blockHash, int what)
 {
-    for (CrowdMap::const_iterator it = my_crowds.begin(); it != my_crowds.end(); ++it) {
-        // decompose the key for address
-        const CMPCrowd& crowd = it->second;
-        crowd.saveCrowdSale(file, it->first, hasher);
-    }
-
-    return 0;
+    return pathStateFiles / strprintf("%s-%s.dat", statePrefix[what], blockHash.ToString());
 }
 
 static int input_msc_balances_string(const std::string& s)
@@ -339,101 +328,709 @@ static int input_mp_crowdsale_string(const std::string& s)
     return 0;
 }
 
-static int write_state_file(const CBlockIndex* pBlockIndex, int what)
+/** Entry of the section table of a state snapshot. */
+struct SnapshotSection
 {
-    fs::path path = pathStateFiles / strprintf("%s-%s.dat", statePrefix[what], pBlockIndex->GetBlockHash().ToString());
-    const std::string strFile = path.string();
+    //! The type of the section, see FILETYPES
+    uint32_t type;
+    //! The number of records in the section
+    uint32_t count;
+    //! The position of the section, relative to the beginning of the file
+    uint64_t offset;
+    //! The size of the section in bytes
+    uint64_t size;
+
+    SnapshotSection() : type(0), count(0), offset(0), size(0) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(type);
+        READWRITE(count);
+        READWRITE(offset);
+        READWRITE(size);
+    }
+};
 
-    std::ofstream file;
-    file.open(strFile.c_str());
+/** Balance record of a single property in a state snapshot. */
+struct SnapshotBalance
+{
+    uint32_t propertyId;
+    int64_t balance;
+    int64_t sellReserved;
+    int64_t acceptReserved;
 
-    CHash256 hasher;
+    SnapshotBalance() : propertyId(0), balance(0), sellReserved(0), acceptReserved(0) {}
 
-    int result = 0;
+    ADD_SERIALIZE_METHODS;
 
-    switch (what) {
-        case FILETYPE_BALANCES:
-            result = write_msc_balances(file, hasher);
-            break;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(propertyId);
+        READWRITE(balance);
+        READWRITE(sellReserved);
+        READWRITE(acceptReserved);
+    }
+};
 
-        case FILETYPE_OFFERS:
-            result = write_mp_offers(file, hasher);
-            break;
+//! Magic bytes at the beginning of state snapshots
+static const unsigned char SNAPSHOT_MAGIC[4] = {'o', 'm', 'n', 'i'};
+//! Version of the state snapshot format
+static const uint32_t SNAPSHOT_VERSION = 1;
+//! Size of the snapshot header: magic, version, block hash and number of sections
+static const size_t SNAPSHOT_HEADER_SIZE = 4 + 4 + 32 + 4;
+//! Size of an entry of the section table: type, number of records, offset and size
+static const size_t SNAPSHOT_SECTION_SIZE = 4 + 4 + 8 + 8;
+//! Size of the checksum at the end of the snapshot
+static const size_t SNAPSHOT_CHECKSUM_SIZE = 32;
+
+//! Magic bytes at the beginning of state deltas
+static const unsigned char DELTA_MAGIC[4] = {'o', 'm', 'n', 'd'};
+//! Version of the state delta format
+static const uint32_t DELTA_VERSION = 1;
+//! Size of the delta header: magic, version and block hash
+static const size_t DELTA_HEADER_SIZE = 4 + 4 + 32;
+
+static uint32_t write_snapshot_balances(CDataStream& ss)
+{
+    uint32_t count = 0;
+    std::vector<SnapshotBalance> records;
 
-        case FILETYPE_ACCEPTS:
-            result = write_mp_accepts(file, hasher);
-            break;
+    for (CMPTallyMap::iterator iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
+        records.clear();
 
-        case FILETYPE_GLOBALS:
-            result = write_globals_state(file, hasher);
-            break;
+        CMPTally& tally = iter->second;
+        tally.init();
+        uint32_t propertyId = 0;
+        while (0 != (propertyId = tally.next())) {
+            SnapshotBalance record;
+            record.propertyId = propertyId;
+            record.balance = tally.getMoney(propertyId, BALANCE);
+            record.sellReserved = tally.getMoney(propertyId, SELLOFFER_RESERVE);
+            record.acceptReserved = tally.getMoney(propertyId, ACCEPT_RESERVE);
+
+            // empty balances and the pending tally are not persisted
+            if (0 == record.balance && 0 == record.sellReserved && 0 == record.acceptReserved) {
+                continue;
+            }
 
-        case FILETYPE_CROWDSALES:
-            result = write_mp_crowdsales(file, hasher);
-            break;
+            records.push_back(record);
+        }
+
+        if (!records.empty()) {
+            ss << iter->first;
+            ss << records;
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+static uint32_t write_snapshot_offers(CDataStream& ss)
+{
+    for (OfferMap::const_iterator iter = my_offers.begin(); iter != my_offers.end(); ++iter) {
+        // decompose the key for address
+        std::vector<std::string> vstr;
+        boost::split(vstr, iter->first, boost::is_any_of("-"), boost::token_compress_on);
+        ss << vstr[0];
+        ss << iter->second;
+    }
+
+    return my_offers.size();
+}
+
+static uint32_t write_snapshot_accepts(CDataStream& ss)
+{
+    for (AcceptMap::const_iterator iter = my_accepts.begin(); iter != my_accepts.end(); ++iter) {
+        // decompose the key for seller and buyer
+        std::vector<std::string> vstr;
+        boost::split(vstr, iter->first, boost::is_any_of("-+"), boost::token_compress_on);
+        ss << vstr[0];
+        ss << vstr[2];
+        ss << iter->second;
+    }
+
+    return my_accepts.size();
+}
+
+static uint32_t write_snapshot_globals(CDataStream& ss)
+{
+    ss << pDbSpInfo->peekNextSPID(OMNI_PROPERTY_MSC);
+    ss << pDbSpInfo->peekNextSPID(OMNI_PROPERTY_TMSC);
+
+    return 1;
+}
+
+static uint32_t write_snapshot_crowdsales(CDataStream& ss)
+{
+    for (CrowdMap::const_iterator iter = my_crowds.begin(); iter != my_crowds.end(); ++iter) {
+        ss << iter->first;
+        ss << iter->second;
+    }
+
+    return my_crowds.size();
+}
+
+static int read_snapshot_balances(VectorReader& reader, uint32_t count)
+{
+    std::string address;
+    std::vector<SnapshotBalance> records;
+
+    for (uint32_t n = 0; n < count; ++n) {
+        reader >> address;
+        reader >> records;
+
+        CMPTally tally;
+        for (std::vector<SnapshotBalance>::const_iterator it = records.begin(); it != records.end(); ++it) {
+            if (it->balance && !tally.updateMoney(it->propertyId, it->balance, BALANCE)) return -1;
+            if (it->sellReserved && !tally.updateMoney(it->propertyId, it->sellReserved, SELLOFFER_RESERVE)) return -1;
+            if (it->acceptReserved && !tally.updateMoney(it->propertyId, it->acceptReserved, ACCEPT_RESERVE)) return -1;
+        }
+
+        // insert the whole tally at once, instead of updating each balance
+        std::pair<CMPTallyMap::iterator, bool> inserted = mp_tally_map.insert(std::make_pair(address, tally));
+        if (!inserted.second) return -1;
+
+        if (fOmniStateHash) {
+            CMPTally& insertedTally = inserted.first->second;
+            insertedTally.init();
+            uint32_t propertyId = 0;
+            while (0 != (propertyId = insertedTally.next())) {
+                UpdateStateHashBalance("", GenerateConsensusString(insertedTally, address, propertyId));
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int read_snapshot_offers(VectorReader& reader, uint32_t count)
+{
+    for (uint32_t n = 0; n < count; ++n) {
+        std::string sellerAddr;
+        CMPOffer offer;
+        reader >> sellerAddr;
+        reader >> offer;
+
+        const std::string combo = STR_SELLOFFER_ADDR_PROP_COMBO(sellerAddr, offer.getProperty());
+        if (!my_offers.insert(std::make_pair(combo, offer)).second) return -1;
+    }
+
+    return 0;
+}
+
+static int read_snapshot_accepts(VectorReader& reader, uint32_t count)
+{
+    for (uint32_t n = 0; n < count; ++n) {
+        std::string sellerAddr;
+        std::string buyerAddr;
+        CMPAccept accept;
+        reader >> sellerAddr;
+        reader >> buyerAddr;
+        reader >> accept;
+
+        const std::string combo = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(sellerAddr, buyerAddr, accept.getProperty());
+        if (!my_accepts.insert(std::make_pair(combo, accept)).second) return -1;
     }
 
-    // generate and wite the double hash of all the contents written
+    return 0;
+}
+
+static int read_snapshot_globals(VectorReader& reader, uint32_t count)
+{
+    if (1 != count) return -1;
+
+    uint32_t nextSPID = 0;
+    uint32_t nextTestSPID = 0;
+    reader >> nextSPID;
+    reader >> nextTestSPID;
+
+    pDbSpInfo->init(nextSPID, nextTestSPID);
+    return 0;
+}
+
+static int read_snapshot_crowdsales(VectorReader& reader, uint32_t count)
+{
+    for (uint32_t n = 0; n < count; ++n) {
+        std::string sellerAddr;
+        CMPCrowd crowdsale;
+        reader >> sellerAddr;
+        reader >> crowdsale;
+
+        if (!my_crowds.insert(std::make_pair(sellerAddr, crowdsale)).second) return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Appends the double SHA256 of the contents, and writes them to a file.
+ *
+ * The file is first written to a temporary file, which then replaces the
+ * target, so a crash does not leave a partially written file behind.
+ */
+static int write_state_file(const fs::path& path, CDataStream& ssContents)
+{
     uint256 hash;
-    hasher.Finalize(hash.begin());
-    file << "!" << hash.ToString() << std::endl;
+    CHash256().Write((const unsigned char*) ssContents.data(), ssContents.size()).Finalize(hash.begin());
+    ssContents << hash;
 
-    file.flush();
-    file.close();
-    return result;
+    fs::path pathTmp = path;
+    pathTmp += ".new";
+
+    FILE* file = fsbridge::fopen(pathTmp, "wb");
+    if (!file) {
+        PrintToLog("%s(): ERROR: failed to open %s\n", __func__, pathTmp.string());
+        return -1;
+    }
+    bool fWritten = (fwrite(ssContents.data(), 1, ssContents.size(), file) == ssContents.size());
+    fWritten = (fclose(file) == 0) && fWritten;
+
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        PrintToLog("%s(): ERROR: failed to write %s\n", __func__, path.string());
+        fs::remove(pathTmp);
+        return -1;
+    }
+
+    if (msc_debug_persistence) {
+        PrintToLog("%s(): wrote %s, %d bytes\n", __func__, path.string(), ssContents.size());
+    }
+
+    return 0;
+}
+
+/**
+ * Serializes the in-memory state as snapshot.
+ *
+ * Snapshot layout:
+ *
+ *  Header:
+ *      unsigned char[4] magic "omni"
+ *      uint32_t version
+ *      uint256 hashBlock
+ *      uint32_t nSections
+ *  Section table, with fixed size entries:
+ *      SnapshotSection section (type, number of records, offset, size)
+ *  Sections, one for each of FILETYPES:
+ *      balances: string address, vector<SnapshotBalance> records
+ *      offers: string seller, CMPOffer offer
+ *      accepts: string seller, string buyer, CMPAccept accept
+ *      globals: uint32_t nextSPID, uint32_t nextTestSPID
+ *      crowdsales: string address, CMPCrowd crowdsale
+ *  Checksum:
+ *      uint256 double SHA256 of all preceding bytes
+ */
+static void serialize_snapshot(const uint256& blockHash, CDataStream& ssSnapshot)
+{
+    std::vector<CDataStream> payloads(NUM_FILETYPES, CDataStream(SER_DISK, CLIENT_VERSION));
+    std::vector<SnapshotSection> sections(NUM_FILETYPES);
+
+    uint64_t offset = SNAPSHOT_HEADER_SIZE + NUM_FILETYPES * SNAPSHOT_SECTION_SIZE;
+    for (int i = 0; i < NUM_FILETYPES; ++i) {
+        uint32_t count = 0;
+        switch (i) {
+            case FILETYPE_BALANCES:
+                count = write_snapshot_balances(payloads[i]);
+                break;
+
+            case FILETYPE_OFFERS:
+                count = write_snapshot_offers(payloads[i]);
+                break;
+
+            case FILETYPE_ACCEPTS:
+                count = write_snapshot_accepts(payloads[i]);
+                break;
+
+            case FILETYPE_GLOBALS:
+                count = write_snapshot_globals(payloads[i]);
+                break;
+
+            case FILETYPE_CROWDSALES:
+                count = write_snapshot_crowdsales(payloads[i]);
+                break;
+        }
+
+        sections[i].type = i;
+        sections[i].count = count;
+        sections[i].offset = offset;
+        sections[i].size = payloads[i].size();
+        offset += payloads[i].size();
+    }
+
+    ssSnapshot.reserve(offset + SNAPSHOT_CHECKSUM_SIZE);
+    ssSnapshot.write((const char*) SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    ssSnapshot << SNAPSHOT_VERSION;
+    ssSnapshot << blockHash;
+    ssSnapshot << static_cast<uint32_t>(sections.size());
+    for (std::vector<SnapshotSection>::const_iterator it = sections.begin(); it != sections.end(); ++it) {
+        ssSnapshot << *it;
+    }
+    for (std::vector<CDataStream>::const_iterator it = payloads.begin(); it != payloads.end(); ++it) {
+        ssSnapshot.write(it->data(), it->size());
+    }
+    assert(ssSnapshot.size() == offset);
+}
+
+/**
+ * Stores the in-memory state in a snapshot file.
+ */
+int WriteStateSnapshot(const fs::path& path, const uint256& blockHash)
+{
+    CDataStream ssSnapshot(SER_DISK, CLIENT_VERSION);
+    serialize_snapshot(blockHash, ssSnapshot);
+
+    return write_state_file(path, ssSnapshot);
+}
+
+/** Reads the whole file at once. */
+static bool read_state_file(const fs::path& path, std::vector<unsigned char>& data)
+{
+    FILE* file = fsbridge::fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+
+    bool fRead = false;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        long size = ftell(file);
+        if (size >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+            data.resize(size);
+            fRead = (fread(data.data(), 1, data.size(), file) == data.size());
+        }
+    }
+    fclose(file);
+
+    return fRead;
 }
 
-static void prune_state_files(const CBlockIndex* topIndex)
+/**
+ * Loads and restores the in-memory state from a snapshot file.
+ */
+int RestoreStateSnapshot(const fs::path& path, const uint256& blockHash, bool verifyHash)
 {
-    // build a set of blockHashes for which we have any state files
-    std::set<uint256> statefulBlockHashes;
+    if (msc_debug_persistence) {
+        LogPrintf("Loading %s ... \n", path.string());
+    }
+
+    std::vector<unsigned char> data;
+    if (!read_state_file(path, data)) {
+        if (msc_debug_persistence) LogPrintf("%s(%s): file not found\n", __func__, path.string());
+        return -1;
+    }
+
+    if (data.size() < SNAPSHOT_HEADER_SIZE + SNAPSHOT_CHECKSUM_SIZE) {
+        PrintToLog("%s(): ERROR: snapshot %s is truncated\n", __func__, path.string());
+        return -1;
+    }
+    const size_t nPayloadEnd = data.size() - SNAPSHOT_CHECKSUM_SIZE;
+
+    if (verifyHash) {
+        uint256 hash;
+        CHash256().Write(data.data(), nPayloadEnd).Finalize(hash.begin());
+        if (0 != memcmp(hash.begin(), data.data() + nPayloadEnd, SNAPSHOT_CHECKSUM_SIZE)) {
+            PrintToLog("File %s loaded, but failed hash validation!\n", path.string());
+            return -1;
+        }
+    }
+
+    int res = 0;
+    uint32_t nRecords = 0;
+
+    try {
+        VectorReader reader(SER_DISK, CLIENT_VERSION, data, 0);
+
+        unsigned char magic[sizeof(SNAPSHOT_MAGIC)];
+        uint32_t version = 0;
+        uint256 snapshotBlockHash;
+        uint32_t nSections = 0;
+        reader.read((char*) magic, sizeof(magic));
+        reader >> version;
+        reader >> snapshotBlockHash;
+        reader >> nSections;
+
+        if (0 != memcmp(magic, SNAPSHOT_MAGIC, sizeof(magic)) || SNAPSHOT_VERSION != version) {
+            PrintToLog("%s(): ERROR: %s is not a supported snapshot (version %d)\n", __func__, path.string(), version);
+            return -1;
+        }
+        if (snapshotBlockHash != blockHash) {
+            PrintToLog("%s(): ERROR: snapshot %s is for block %s\n", __func__, path.string(), snapshotBlockHash.GetHex());
+            return -1;
+        }
+
+        std::vector<SnapshotSection> sections;
+        std::set<uint32_t> sectionTypes;
+        for (uint32_t n = 0; n < nSections; ++n) {
+            SnapshotSection section;
+            reader >> section;
+            if (section.offset > nPayloadEnd || section.size > nPayloadEnd - section.offset) {
+                PrintToLog("%s(): ERROR: section %d of %s is out of bounds\n", __func__, section.type, path.string());
+                return -1;
+            }
+            // sections of unknown types are skipped
+            if (section.type < NUM_FILETYPES && sectionTypes.insert(section.type).second) {
+                sections.push_back(section);
+            }
+        }
+        if (sectionTypes.size() != NUM_FILETYPES) {
+            PrintToLog("%s(): ERROR: snapshot %s is incomplete\n", __func__, path.string());
+            return -1;
+        }
 
+        mp_tally_map.clear();
+        ClearStateHashBalances();
+        my_offers.clear();
+        my_accepts.clear();
+        my_crowds.clear();
+        ResetStateHashDExAndCrowdsales();
+
+        for (std::vector<SnapshotSection>::const_iterator it = sections.begin(); it != sections.end() && res == 0; ++it) {
+            VectorReader sectionReader(SER_DISK, CLIENT_VERSION, data, it->offset);
+
+            switch (it->type) {
+                case FILETYPE_BALANCES:
+                    res = read_snapshot_balances(sectionReader, it->count);
+                    break;
+
+                case FILETYPE_OFFERS:
+                    res = read_snapshot_offers(sectionReader, it->count);
+                    break;
+
+                case FILETYPE_ACCEPTS:
+                    res = read_snapshot_accepts(sectionReader, it->count);
+                    break;
+
+                case FILETYPE_GLOBALS:
+                    res = read_snapshot_globals(sectionReader, it->count);
+                    break;
+
+                case FILETYPE_CROWDSALES:
+                    res = read_snapshot_crowdsales(sectionReader, it->count);
+                    break;
+            }
+
+            // each section must be consumed completely
+            if (res == 0 && sectionReader.size() != data.size() - it->offset - it->size) {
+                res = -1;
+            }
+            nRecords += it->count;
+        }
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: failed to deserialize %s: %s\n", __func__, path.string(), e.what());
+        return -1;
+    }
+
+    PrintToLog("%s(%s), loaded records= %d, res= %d\n", __func__, path.string(), nRecords, res);
+    LogPrintf("%s(): file: %s , loaded records= %d, res= %d\n", __func__, path.string(), nRecords, res);
+
+    return res;
+}
+
+/**
+ * Serializes the changes of a block as delta.
+ *
+ * Delta layout:
+ *
+ *      unsigned char[4] magic "omnd"
+ *      uint32_t version
+ *      uint256 hashBlock
+ *      CMPBlockDelta delta
+ *      uint256 double SHA256 of all preceding bytes
+ */
+static void serialize_delta(const CMPBlockDelta& delta, CDataStream& ssDelta)
+{
+    ssDelta.write((const char*) DELTA_MAGIC, sizeof(DELTA_MAGIC));
+    ssDelta << DELTA_VERSION;
+    ssDelta << delta.blockHash;
+    ssDelta << delta;
+}
+
+/**
+ * Stores the changes of a block in a delta file.
+ */
+int WriteStateDelta(const fs::path& path, const CMPBlockDelta& delta)
+{
+    CDataStream ssDelta(SER_DISK, CLIENT_VERSION);
+    serialize_delta(delta, ssDelta);
+
+    return write_state_file(path, ssDelta);
+}
+
+/**
+ * Loads the changes of a block from a delta file.
+ */
+int ReadStateDelta(const fs::path& path, const uint256& blockHash, CMPBlockDelta& delta)
+{
+    std::vector<unsigned char> data;
+    if (!read_state_file(path, data)) {
+        if (msc_debug_persistence) LogPrintf("%s(%s): file not found\n", __func__, path.string());
+        return -1;
+    }
+
+    if (data.size() < DELTA_HEADER_SIZE + SNAPSHOT_CHECKSUM_SIZE) {
+        PrintToLog("%s(): ERROR: delta %s is truncated\n", __func__, path.string());
+        return -1;
+    }
+    const size_t nPayloadEnd = data.size() - SNAPSHOT_CHECKSUM_SIZE;
+
+    uint256 hash;
+    CHash256().Write(data.data(), nPayloadEnd).Finalize(hash.begin());
+    if (0 != memcmp(hash.begin(), data.data() + nPayloadEnd, SNAPSHOT_CHECKSUM_SIZE)) {
+        PrintToLog("File %s loaded, but failed hash validation!\n", path.string());
+        return -1;
+    }
+
+    try {
+        VectorReader reader(SER_DISK, CLIENT_VERSION, data, 0);
+
+        unsigned char magic[sizeof(DELTA_MAGIC)];
+        uint32_t version = 0;
+        uint256 deltaBlockHash;
+        reader.read((char*) magic, sizeof(magic));
+        reader >> version;
+        reader >> deltaBlockHash;
+
+        if (0 != memcmp(magic, DELTA_MAGIC, sizeof(magic)) || DELTA_VERSION != version) {
+            PrintToLog("%s(): ERROR: %s is not a supported delta (version %d)\n", __func__, path.string(), version);
+            return -1;
+        }
+        reader >> delta;
+
+        if (deltaBlockHash != blockHash || delta.blockHash != blockHash || reader.size() != SNAPSHOT_CHECKSUM_SIZE) {
+            PrintToLog("%s(): ERROR: delta %s is not valid for block %s\n", __func__, path.string(), blockHash.GetHex());
+            return -1;
+        }
+    } catch (const std::exception& e) {
+        PrintToLog("%s(): ERROR: failed to deserialize %s: %s\n", __func__, path.string(), e.what());
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Converts persisted text state files into state snapshots.
+ *
+ * Each complete and valid set of text files is loaded, written as snapshot
+ * and removed afterwards. The in-memory state is overwritten in the process.
+ */
+int ConvertStateFiles()
+{
+    LOCK(cs_tally);
+
+    // collect the blocks for which text state files exist
+    std::set<uint256> legacyBlockHashes;
     fs::directory_iterator dIter(pathStateFiles);
     fs::directory_iterator endIter;
     for (; dIter != endIter; ++dIter) {
-        std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
-        if (false == fs::is_regular_file(dIter->status())) {
+        if (false == fs::is_regular_file(dIter->status()) || dIter->path().empty()) {
             // skip funny business
-            PrintToLog("Non-regular file found in persistence directory : %s\n", fName);
             continue;
         }
 
+        std::string fName = (*--dIter->path().end()).string();
         std::vector<std::string> vstr;
         boost::split(vstr, fName, boost::is_any_of("-."), boost::token_compress_on);
         if (vstr.size() == 3 &&
-                is_state_prefix(vstr[0]) &&
+                is_text_state_prefix(vstr[0]) &&
                 boost::equals(vstr[2], "dat")) {
             uint256 blockHash;
             blockHash.SetHex(vstr[1]);
-            statefulBlockHashes.insert(blockHash);
-        } else {
-            PrintToLog("None state file found in persistence directory : %s\n", fName);
+            legacyBlockHashes.insert(blockHash);
         }
     }
 
+    int converted = 0;
+    for (std::set<uint256>::const_iterator it = legacyBlockHashes.begin(); it != legacyBlockHashes.end(); ++it) {
+        int success = -1;
+        for (int i = 0; i < NUM_FILETYPES; ++i) {
+            success = RestoreInMemoryState(get_state_file_path(*it, i).string(), i, true);
+            if (success < 0) break;
+        }
+
+        if (success < 0 || WriteStateSnapshot(get_snapshot_path(*it), *it) < 0) {
+            PrintToLog("%s(): failed to convert state files of block %s\n", __func__, it->GetHex());
+            continue;
+        }
+
+        for (int i = 0; i < NUM_FILETYPES; ++i) {
+            fs::remove(get_state_file_path(*it, i));
+        }
+        ++converted;
+    }
+
+    if (!legacyBlockHashes.empty()) {
+        PrintToLog("Converted state files of %d of %d blocks into snapshots\n", converted, legacyBlockHashes.size());
+    }
+
+    return converted;
+}
+
+/**
+ * Collects state files, which are no longer needed, and removes them from the index.
+ *
+ * The state of the last MAX_STATE_HISTORY blocks, of every STORE_EVERY_N_BLOCK
+ * block, and the deltas back to the snapshot of the latest block are kept.
+ */
+static void prune_state_files(const CBlockIndex* topIndex, std::vector<fs::path>& obsoleteFiles)
+{
+    // the deltas of the latest block and their base snapshot are required to restore it
+    std::set<uint256> restoreChain;
+    for (const CBlockIndex* pIndex = topIndex; pIndex != nullptr; pIndex = pIndex->pprev) {
+        std::map<uint256, int>::const_iterator it = mapPersistedStates.find(pIndex->GetBlockHash());
+        if (it == mapPersistedStates.end()) break;
+        restoreChain.insert(it->first);
+        if ((it->second & PERSISTED_SNAPSHOT) || !(it->second & PERSISTED_DELTA)) break;
+    }
+
     // for each blockHash in the set, determine the distance from the given block
-    std::set<uint256>::const_iterator iter;
-    for (iter = statefulBlockHashes.begin(); iter != statefulBlockHashes.end(); ++iter) {
+    std::map<uint256, int>::iterator iter = mapPersistedStates.begin();
+    while (iter != mapPersistedStates.end()) {
+        const uint256& blockHash = iter->first;
         // look up the CBlockIndex for height info
-        CBlockIndex const *curIndex = GetBlockIndex(*iter);
+        CBlockIndex const *curIndex = GetBlockIndex(blockHash);
 
         // if we have nothing int the index, or this block is too old..
         if (nullptr == curIndex || (((topIndex->nHeight - curIndex->nHeight) > MAX_STATE_HISTORY)
-                && (curIndex->nHeight % STORE_EVERY_N_BLOCK != 0))) {
+                && restoreChain.count(blockHash) == 0)) {
+            // keep the snapshots of every STORE_EVERY_N_BLOCK block
+            bool fKeepSnapshot = (curIndex != nullptr && curIndex->nHeight % STORE_EVERY_N_BLOCK == 0
+                    && (iter->second & PERSISTED_SNAPSHOT));
+            if (fKeepSnapshot && iter->second == PERSISTED_SNAPSHOT) {
+                ++iter;
+                continue;
+            }
+
             if (msc_debug_persistence) {
                 if (curIndex) {
-                    PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", (*iter).ToString(), topIndex->nHeight - curIndex->nHeight);
+                    PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", blockHash.ToString(), topIndex->nHeight - curIndex->nHeight);
                 } else {
-                    PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", (*iter).ToString());
+                    PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", blockHash.ToString());
                 }
             }
 
             // destroy the associated files!
-            std::string strBlockHash = iter->ToString();
-            for (int i = 0; i < NUM_FILETYPES; ++i) {
-                fs::path path = pathStateFiles / strprintf("%s-%s.dat", statePrefix[i], strBlockHash);
-                fs::remove(path);
+            if (iter->second & PERSISTED_TEXT) {
+                for (int i = 0; i < NUM_FILETYPES; ++i) {
+                    obsoleteFiles.push_back(get_state_file_path(blockHash, i));
+                }
+            }
+            if (iter->second & PERSISTED_DELTA) {
+                obsoleteFiles.push_back(get_delta_path(blockHash));
             }
+
+            if (fKeepSnapshot) {
+                iter->second = PERSISTED_SNAPSHOT;
+                ++iter;
+            } else {
+                if (iter->second & PERSISTED_SNAPSHOT) {
+                    obsoleteFiles.push_back(get_snapshot_path(blockHash));
+                }
+                iter = mapPersistedStates.erase(iter);
+            }
+        } else {
+            ++iter;
         }
     }
 }
@@ -472,20 +1069,133 @@ bool IsPersistenceEnabled(int blockHeight)
     return true;
 }
 
+/** A captured state, which is written to disk by the persistence thread. */
+struct PersistenceTask
+{
+    uint256 blockHash;
+    fs::path path;
+    CDataStream contents;
+    //! State files, which are removed after the state was written
+    std::vector<fs::path> obsoleteFiles;
+
+    PersistenceTask() : contents(SER_DISK, CLIENT_VERSION) {}
+};
+
+//! Maximal number of captured states, which are not yet written
+static const size_t MAX_PERSISTENCE_QUEUE = 10;
+
+//! Protects the queue of the persistence thread
+static Mutex cs_persistence;
+//! Signals changes of the queue of the persistence thread
+static std::condition_variable condPersistence;
+//! Captured states, which are waiting to be written, oldest first
+static std::deque<std::unique_ptr<PersistenceTask> > queuePersistence;
+//! Whether the persistence thread is writing a state
+static bool fPersistenceBusy = false;
+//! Whether the persistence thread should exit, once the queue is empty
+static bool fPersistenceStop = false;
+//! Blocks, for which the state could not be written
+static std::set<uint256> setPersistenceFailed;
+//! Writes the captured states to disk
+static std::thread threadPersistence;
+
+/** Writes captured states to disk, until it is stopped. */
+static void ThreadPersistence()
+{
+    while (true) {
+        std::unique_ptr<PersistenceTask> task;
+        {
+            WAIT_LOCK(cs_persistence, lock);
+            condPersistence.wait(lock, [] { return !queuePersistence.empty() || fPersistenceStop; });
+            if (queuePersistence.empty()) {
+                return;
+            }
+            task = std::move(queuePersistence.front());
+            queuePersistence.pop_front();
+            fPersistenceBusy = true;
+        }
+        condPersistence.notify_all();
+
+        // the file is checksummed and written without holding any lock
+        if (write_state_file(task->path, task->contents) < 0) {
+            LOCK(cs_persistence);
+            setPersistenceFailed.insert(task->blockHash);
+        }
+        for (std::vector<fs::path>::const_iterator it = task->obsoleteFiles.begin(); it != task->obsoleteFiles.end(); ++it) {
+            try {
+                fs::remove(*it);
+            } catch (const fs::filesystem_error& e) {
+                PrintToLog("%s(): ERROR: failed to remove %s: %s\n", __func__, it->string(), e.what());
+            }
+        }
+
+        {
+            LOCK(cs_persistence);
+            fPersistenceBusy = false;
+        }
+        condPersistence.notify_all();
+    }
+}
+
 /**
- * Stores the in-memory state in files.
+ * Captures the in-memory state as snapshot or delta, which is written to disk
+ * by the persistence thread.
+ *
+ * A delta is written, if the changes of the block were recorded in the
+ * journal, and the state of the previous block is persisted. A full snapshot
+ * is written every STORE_EVERY_N_BLOCK blocks, and whenever the chain of
+ * deltas would be broken.
+ *
+ * The SP database watermark is advanced right away: after a crash, the
+ * loader rolls back to the latest block, which made it to disk.
  */
 int PersistInMemoryState(const CBlockIndex* pBlockIndex)
 {
-    // write the new state as of the given block
-    write_state_file(pBlockIndex, FILETYPE_BALANCES);
-    write_state_file(pBlockIndex, FILETYPE_OFFERS);
-    write_state_file(pBlockIndex, FILETYPE_ACCEPTS);
-    write_state_file(pBlockIndex, FILETYPE_GLOBALS);
-    write_state_file(pBlockIndex, FILETYPE_CROWDSALES);
+    const uint256& blockHash = pBlockIndex->GetBlockHash();
+    load_persisted_states();
+
+    // states, which could not be written, can't be the base of a delta
+    bool fFailed = false;
+    {
+        LOCK(cs_persistence);
+        for (std::set<uint256>::const_iterator it = setPersistenceFailed.begin(); it != setPersistenceFailed.end(); ++it) {
+            mapPersistedStates.erase(*it);
+            fFailed = true;
+        }
+        setPersistenceFailed.clear();
+    }
+
+    const CMPBlockDelta* pDelta = GetBlockDelta(blockHash);
+    bool fSnapshot = (fFailed || pDelta == nullptr || pBlockIndex->nHeight % STORE_EVERY_N_BLOCK == 0
+            || pBlockIndex->pprev == nullptr || !has_persisted_state(pBlockIndex->pprev->GetBlockHash()));
+
+    // capture the new state as of the given block
+    std::unique_ptr<PersistenceTask> task(new PersistenceTask());
+    task->blockHash = blockHash;
+    if (fSnapshot) {
+        task->path = get_snapshot_path(blockHash);
+        serialize_snapshot(blockHash, task->contents);
+        mapPersistedStates[blockHash] |= PERSISTED_SNAPSHOT;
+    } else {
+        task->path = get_delta_path(blockHash);
+        serialize_delta(*pDelta, task->contents);
+        mapPersistedStates[blockHash] |= PERSISTED_DELTA;
+    }
 
     // clean-up the directory
-    prune_state_files(pBlockIndex);
+    prune_state_files(pBlockIndex, task->obsoleteFiles);
+
+    {
+        WAIT_LOCK(cs_persistence, lock);
+        if (!threadPersistence.joinable()) {
+            fPersistenceStop = false;
+            threadPersistence = std::thread(&TraceThread<std::function<void()> >, "omnipersist", std::function<void()>(&ThreadPersistence));
+        }
+        // bound the lag of the persisted state
+        condPersistence.wait(lock, [] { return queuePersistence.size() < MAX_PERSISTENCE_QUEUE; });
+        queuePersistence.push_back(std::move(task));
+    }
+    condPersistence.notify_all();
 
     pDbSpInfo->setWatermark(pBlockIndex->GetBlockHash());
 
@@ -493,7 +1203,32 @@ int PersistInMemoryState(const CBlockIndex* pBlockIndex)
 }
 
 /**
- * Loads and retrieves state from a file.
+ * Waits until all captured states are written to disk.
+ */
+void FlushStatePersistence()
+{
+    WAIT_LOCK(cs_persistence, lock);
+    condPersistence.wait(lock, [] { return queuePersistence.empty() && !fPersistenceBusy; });
+}
+
+/**
+ * Writes all captured states to disk, and stops the persistence thread.
+ */
+void StopStatePersistence()
+{
+    {
+        LOCK(cs_persistence);
+        fPersistenceStop = true;
+    }
+    condPersistence.notify_all();
+
+    if (threadPersistence.joinable()) {
+        threadPersistence.join();
+    }
+}
+
+/**
+ * Loads and retrieves state from a text state file.
  */
 int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
 {
@@ -505,16 +1240,19 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
     switch (what) {
         case FILETYPE_BALANCES:
             mp_tally_map.clear();
+            ClearStateHashBalances();
             inputLineFunc = input_msc_balances_string;
             break;
 
         case FILETYPE_OFFERS:
             my_offers.clear();
+            ResetStateHashDExAndCrowdsales();
             inputLineFunc = input_mp_offers_string;
             break;
 
         case FILETYPE_ACCEPTS:
             my_accepts.clear();
+            ResetStateHashDExAndCrowdsales();
             inputLineFunc = input_mp_accepts_string;
             break;
 
@@ -524,6 +1262,7 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
 
         case FILETYPE_CROWDSALES:
             my_crowds.clear();
+            ResetStateHashDExAndCrowdsales();
             inputLineFunc = input_mp_crowdsale_string;
             break;
 
@@ -594,6 +1333,59 @@ int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash)
     return res;
 }
 
+/**
+ * Restores the state after a block from its snapshot, or from the latest
+ * snapshot before the block and the deltas since then.
+ *
+ * The restored deltas are added to the journal, so the blocks can be
+ * reverted in memory.
+ */
+static int restore_persisted_state(const CBlockIndex* pBlockIndex)
+{
+    // collect the deltas back to the latest snapshot, newest first
+    std::vector<CMPBlockDelta> deltas;
+    const CBlockIndex* pBaseIndex = pBlockIndex;
+    while (pBaseIndex != nullptr && !fs::exists(get_snapshot_path(pBaseIndex->GetBlockHash()))) {
+        fs::path deltaPath = get_delta_path(pBaseIndex->GetBlockHash());
+        if (!fs::exists(deltaPath)) break;
+
+        deltas.push_back(CMPBlockDelta());
+        if (ReadStateDelta(deltaPath, pBaseIndex->GetBlockHash(), deltas.back()) < 0) {
+            return -1;
+        }
+        pBaseIndex = pBaseIndex->pprev;
+        if (pBaseIndex == nullptr || deltas.back().prevBlockHash != pBaseIndex->GetBlockHash()) {
+            return -1;
+        }
+    }
+
+    int success = -1;
+    fs::path snapshotPath = get_snapshot_path(pBaseIndex->GetBlockHash());
+    if (fs::exists(snapshotPath)) {
+        success = RestoreStateSnapshot(snapshotPath, pBaseIndex->GetBlockHash(), true);
+    } else if (deltas.empty()) {
+        // fall back to text state files, which could not be converted
+        for (int i = 0; i < NUM_FILETYPES; ++i) {
+            success = RestoreInMemoryState(get_state_file_path(pBaseIndex->GetBlockHash(), i).string(), i, true);
+            if (success < 0) break;
+        }
+    }
+    if (success < 0) {
+        return -1;
+    }
+
+    ClearJournal();
+    for (std::vector<CMPBlockDelta>::const_reverse_iterator it = deltas.rbegin(); it != deltas.rend(); ++it) {
+        ApplyBlockDelta(*it, false);
+        AddBlockDelta(*it);
+    }
+    if (!deltas.empty()) {
+        PrintToLog("%s(): applied %d state deltas on top of block %d\n", __func__, deltas.size(), pBaseIndex->nHeight);
+    }
+
+    return 0;
+}
+
 /**
  * Loads and restores the latest state. Returns -1 if reparse is required.
  */
@@ -601,6 +1393,13 @@ int LoadMostRelevantInMemoryState()
 {
     int res = -1;
     uint256 spWatermark;
+
+    // make sure all captured states are on disk
+    FlushStatePersistence();
+
+    // convert text state files of previous versions
+    ConvertStateFiles();
+
     {
         LOCK(cs_tally);
         PrintToLog("Trying to load most relevant state into memory..\n");
@@ -668,8 +1467,7 @@ int LoadMostRelevantInMemoryState()
         PrintToLog("Rolling back blocks to active chain.\n");
 
         while (nullptr != spBlockIndex && false == chainActive.Contains(spBlockIndex)) {
-            int remainingSPs = pDbSpInfo->popBlock(spBlockIndex->GetBlockHash());
-            if (remainingSPs < 0) {
+            if (pDbSpInfo->popBlock(spBlockIndex->GetBlockHash()) < 0) {
                 // trigger a full reparse, if the levelDB cannot roll back
                 PrintToLog("Failed to load historical state: no valid state found after rolling back SP database\n");
                 return -1;
@@ -721,17 +1519,11 @@ int LoadMostRelevantInMemoryState()
         }
         while (nullptr != curTip && persistedBlocks.size() > 0 && curTip->nHeight > abortRollBackBlock ) {
             if (persistedBlocks.find(curTip->GetBlockHash()) != persistedBlocks.end()) {
-                int success = -1;
-                for (int i = 0; i < NUM_FILETYPES; ++i) {
-                    fs::path path = pathStateFiles / strprintf("%s-%s.dat", statePrefix[i], curTip->GetBlockHash().ToString());
-                    const std::string strFile = path.string();
-                    success = RestoreInMemoryState(strFile, i, true);
-                    if (success < 0) {
-                        PrintToConsole("Found a state inconsistency at block height %d. "
-                                "Reverting up to %d blocks.. this may take a few minutes.\n",
-                                curTip->nHeight, (curTip->nHeight - abortRollBackBlock - 1));
-                        break;
-                    }
+                int success = restore_persisted_state(curTip);
+                if (success < 0) {
+                    PrintToConsole("Found a state inconsistency at block height %d. "
+                            "Reverting up to %d blocks.. this may take a few minutes.\n",
+                            curTip->nHeight, (curTip->nHeight - abortRollBackBlock - 1));
                 }
 
                 if (success >= 0) {
@@ -744,7 +1536,7 @@ int LoadMostRelevantInMemoryState()
             }
 
             // go to the previous block
-            if (pDbSpInfo->popBlock(curTip->GetBlockHash()) <= 0) {
+            if (pDbSpInfo->popBlock(curTip->GetBlockHash()) < 0) {
                 // trigger a full reparse, if the levelDB cannot roll back
                 PrintToLog("Failed to load historical state: no valid state found after rolling back SP database (2)\n");
                 return -1;
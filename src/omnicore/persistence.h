@@ -1,19 +1,54 @@
 #ifndef BITCOIN_OMNICORE_PERSISTENCE_H
 #define BITCOIN_OMNICORE_PERSISTENCE_H
 
-#include <boost/filesystem.hpp>
+#include <fs.h>
+
+#include <string>
 
 class CBlockIndex;
+class CMPBlockDelta;
+class uint256;
+
+//! Parts of the persisted state, stored in separate text files or snapshot sections
+enum FILETYPES {
+  FILETYPE_BALANCES = 0,
+  FILETYPE_OFFERS,
+  FILETYPE_ACCEPTS,
+  FILETYPE_GLOBALS,
+  FILETYPE_CROWDSALES,
+  NUM_FILETYPES
+};
 
 /** Indicates whether persistence is enabled and the state is stored. */
 bool IsPersistenceEnabled(int blockHeight);
 
-/** Stores the in-memory state in files. */
+/** Captures the in-memory state, which is then written to a snapshot or delta file in the background. */
 int PersistInMemoryState(const CBlockIndex* pBlockIndex);
 
-/** Loads and retrieves state from a file. */
+/** Waits until all captured states are written to disk. */
+void FlushStatePersistence();
+
+/** Writes all captured states to disk, and stops the persistence thread. */
+void StopStatePersistence();
+
+/** Stores the in-memory state in a snapshot file. */
+int WriteStateSnapshot(const fs::path& path, const uint256& blockHash);
+
+/** Loads and restores the in-memory state from a snapshot file. */
+int RestoreStateSnapshot(const fs::path& path, const uint256& blockHash, bool verifyHash = false);
+
+/** Stores the changes of a block in a delta file. */
+int WriteStateDelta(const fs::path& path, const CMPBlockDelta& delta);
+
+/** Loads the changes of a block from a delta file. */
+int ReadStateDelta(const fs::path& path, const uint256& blockHash, CMPBlockDelta& delta);
+
+/** Loads and retrieves state from a text state file. */
 int RestoreInMemoryState(const std::string& filename, int what, bool verifyHash = false);
 
+/** Converts persisted text state files into state snapshots. */
+int ConvertStateFiles();
+
 /** Loads and restores the latest state. Returns -1 if reparse is required. */
 int LoadMostRelevantInMemoryState();
 
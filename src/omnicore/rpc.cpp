@@ -9,6 +9,9 @@
 #include <omnicore/activation.h>
 #include <omnicore/consensushash.h>
 #include <omnicore/convert.h>
+#include <omnicore/dbaddressindex.h>
+#include <omnicore/dbbase.h>
+#include <omnicore/dbpropertyindex.h>
 #include <omnicore/dbspinfo.h>
 #include <omnicore/dbstolist.h>
 #include <omnicore/dbtxlist.h>
@@ -57,6 +60,7 @@
 
 #include <stdint.h>
 #include <map>
+#include <set>
 #include <stdexcept>
 #include <string>
 #include <tuple>
@@ -464,7 +468,7 @@ static UniValue mscrpc(const JSONRPCRequest& request)
             LOCK(cs_tally);
             int64_t total = 0;
             // display all balances
-            for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
                 PrintToConsole("%34s => ", my_it->first);
                 total += (my_it->second).print(extra2, bDivisible);
             }
@@ -491,7 +495,7 @@ static UniValue mscrpc(const JSONRPCRequest& request)
             LOCK(cs_tally);
             uint32_t id = 0;
             // for each address display all currencies it holds
-            for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            for (CMPTallyMap::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
                 PrintToConsole("%34s => ", my_it->first);
                 (my_it->second).print(extra2);
                 (my_it->second).init();
@@ -634,20 +638,11 @@ static UniValue omni_getallbalancesforid(const JSONRPCRequest& request)
 
     LOCK(cs_tally);
 
-    for (std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-        uint32_t id = 0;
-        bool includeAddress = false;
-        std::string address = it->first;
-        (it->second).init();
-        while (0 != (id = (it->second).next())) {
-            if (id == propertyId) {
-                includeAddress = true;
-                break;
-            }
-        }
-        if (!includeAddress) {
-            continue; // ignore this address, has never transacted in this propertyId
-        }
+    // only addresses with a non-zero balance of this property are indexed as holders
+    const std::set<uint32_t>& holders = mp_tally_map.getHolders(propertyId);
+
+    for (std::set<uint32_t>::const_iterator it = holders.begin(); it != holders.end(); ++it) {
+        const std::string& address = mp_tally_map.getAddress(*it);
         UniValue balanceObj(UniValue::VOBJ);
         balanceObj.pushKV("address", address);
         bool nonEmptyBalance = BalanceToJSON(address, propertyId, balanceObj, isDivisible);
@@ -703,8 +698,8 @@ static UniValue omni_getallbalancesforaddress(const JSONRPCRequest& request)
 
     uint32_t propertyId = 0;
     while (0 != (propertyId = addressTally->next())) {
-        CMPSPInfo::Entry property;
-        if (!pDbSpInfo->getSP(propertyId, property)) {
+        CMPSPInfo::Header property;
+        if (!pDbSpInfo->getHeader(propertyId, property)) {
             continue;
         }
 
@@ -831,8 +826,8 @@ static UniValue omni_getwalletbalances(const JSONRPCRequest& request)
         uint32_t propertyId = item.first;
         std::tuple<int64_t, int64_t, int64_t> balance = item.second;
 
-        CMPSPInfo::Entry property;
-        if (!pDbSpInfo->getSP(propertyId, property)) {
+        CMPSPInfo::Header property;
+        if (!pDbSpInfo->getHeader(propertyId, property)) {
             continue; // token wasn't found in the DB
         }
 
@@ -923,8 +918,8 @@ static UniValue omni_getwalletaddressbalances(const JSONRPCRequest& request)
         addressTally->init();
 
         while (0 != (propertyId = addressTally->next())) {
-            CMPSPInfo::Entry property;
-            if (!pDbSpInfo->getSP(propertyId, property)) {
+            CMPSPInfo::Header property;
+            if (!pDbSpInfo->getHeader(propertyId, property)) {
                 continue; // token wasn't found in the DB
             }
 
@@ -1172,7 +1167,8 @@ static UniValue omni_getcrowdsale(const JSONRPCRequest& request)
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Crowdsale is flagged active but cannot be retrieved");
         }
     } else {
-        database = sp.historicalData;
+        LOCK(cs_tally);
+        pDbSpInfo->getHistory(propertyId, database);
     }
 
     int64_t tokensIssued = getTotalTokens(propertyId);
@@ -1355,11 +1351,13 @@ static UniValue omni_getgrants(const JSONRPCRequest& request)
     RequireManagedProperty(propertyId);
 
     CMPSPInfo::Entry sp;
+    CMPSPInfo::History history;
     {
         LOCK(cs_tally);
         if (false == pDbSpInfo->getSP(propertyId, sp)) {
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Property identifier does not exist");
         }
+        pDbSpInfo->getHistory(propertyId, history);
     }
     UniValue response(UniValue::VOBJ);
     const uint256& creationHash = sp.txid;
@@ -1369,7 +1367,7 @@ static UniValue omni_getgrants(const JSONRPCRequest& request)
 
     UniValue issuancetxs(UniValue::VARR);
     std::map<uint256, std::vector<int64_t> >::const_iterator it;
-    for (it = sp.historicalData.begin(); it != sp.historicalData.end(); it++) {
+    for (it = history.begin(); it != history.end(); it++) {
         const std::string& txid = it->first.GetHex();
         int64_t grantedTokens = it->second.at(0);
         int64_t revokedTokens = it->second.at(1);
@@ -1560,7 +1558,7 @@ static UniValue omni_listblocktransactions(const JSONRPCRequest& request)
         LOCK(cs_main);
         CBlockIndex* pBlockIndex = chainActive[blockHeight];
 
-        if (!ReadBlockFromDisk(block, pBlockIndex, Params().GetConsensus())) {
+        if (!ReadBlockFromDisk(block, pBlockIndex, Params().GetConsensus(), false)) {
             throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block from disk");
         }
     }
@@ -1753,6 +1751,233 @@ static UniValue omni_listtransactions(const JSONRPCRequest& request)
 }
 #endif
 
+/**
+ * Parses the cursor of a listing of indexed transactions, which points to the block and position of the
+ * next transaction, and continues the listing there, unless it's before the start block.
+ */
+static void ParseIndexCursor(const UniValue& value, int64_t& nStartBlock, uint32_t& nStartPosition)
+{
+    const std::string& strCursor = value.get_str();
+    if (strCursor.empty()) return;
+
+    size_t nSeparator = strCursor.find(':');
+    int32_t nCursorBlock = 0;
+    uint32_t nCursorPosition = 0;
+    if (nSeparator == std::string::npos || !ParseInt32(strCursor.substr(0, nSeparator), &nCursorBlock) ||
+            !ParseUInt32(strCursor.substr(nSeparator + 1), &nCursorPosition) || nCursorBlock < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    if (nCursorBlock >= nStartBlock) {
+        nStartBlock = nCursorBlock;
+        nStartPosition = nCursorPosition;
+    }
+}
+
+static UniValue omni_listaddresstransactions(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 5)
+        throw runtime_error(
+            RPCHelpMan{"omni_listaddresstransactions",
+               "\nLists the Omni transactions sent from or referencing an address, ordered by block and position.\n"
+               "\nRequires the address index, enabled with -omniaddressindex. The result includes a cursor, if there "
+               "are more transactions, which can be passed to the next call to continue the listing. Transactions "
+               "processed before the index was created, or while it was disabled, are not included, unless Omni "
+               "transactions are reprocessed with -startclean.\n",
+               {
+                   {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "the address to look up\n"},
+                   {"count", RPCArg::Type::NUM, /* default */ "10", "show at most n transactions\n"},
+                   {"cursor", RPCArg::Type::STR, /* default */ "\"\"", "the cursor returned by the previous call\n"},
+                   {"startblock", RPCArg::Type::NUM, /* default */ "0", "first block to begin the search\n"},
+                   {"endblock", RPCArg::Type::NUM, /* default */ "999999999", "last block to include in the search\n"},
+               },
+               RPCResult{
+                   "{\n"
+                   "  \"address\" : \"address\",             (string) the address\n"
+                   "  \"transactions\" : [               (array of JSON objects)\n"
+                   "    {\n"
+                   "      \"txid\" : \"hash\",                (string) the hex-encoded hash of the transaction\n"
+                   "      \"roles\" : [ \"role\", ... ],      (array of strings) the roles of the address (\"sender\" or \"reference\")\n"
+                   "      \"sendingaddress\" : \"address\",   (string) the Feathercoin address of the sender\n"
+                   "      \"referenceaddress\" : \"address\", (string) a Feathercoin address used as reference (if any)\n"
+                   "      \"confirmations\" : nnnnnnnnnn,   (number) the number of transaction confirmations\n"
+                   "      \"fee\" : \"n.nnnnnnnn\",           (string) the transaction fee in feathercoins\n"
+                   "      \"blocktime\" : nnnnnnnnnn,       (number) the timestamp of the block that contains the transaction\n"
+                   "      \"valid\" : true|false,           (boolean) whether the transaction is valid\n"
+                   "      \"version\" : n,                  (number) the transaction version\n"
+                   "      \"type_int\" : n,                 (number) the transaction type as number\n"
+                   "      \"type\" : \"type\",                (string) the transaction type as string\n"
+                   "      [...]                           (mixed) other transaction type specific properties\n"
+                   "    },\n"
+                   "    ...\n"
+                   "  ],\n"
+                   "  \"cursor\" : \"cursor\"                (string) the cursor of the next transactions (only if there are more)\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("omni_listaddresstransactions", "\"3M9qvHKtgARhqcMtM5cRT9VaiDJ5PSfQGY\" 100")
+                   + HelpExampleRpc("omni_listaddresstransactions", "\"3M9qvHKtgARhqcMtM5cRT9VaiDJ5PSfQGY\", 100")
+               }
+            }.ToString());
+
+    std::string address = ParseAddress(request.params[0]);
+    int64_t nCount = 10;
+    if (request.params.size() > 1) nCount = request.params[1].get_int64();
+    if (nCount < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+    int64_t nStartBlock = 0;
+    if (request.params.size() > 3) nStartBlock = request.params[3].get_int64();
+    if (nStartBlock < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative start block");
+    int64_t nEndBlock = 999999999;
+    if (request.params.size() > 4) nEndBlock = request.params[4].get_int64();
+    if (nEndBlock < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative end block");
+
+    // the cursor points to the block and position of the next transaction
+    uint32_t nStartPosition = 0;
+    if (request.params.size() > 2) ParseIndexCursor(request.params[2], nStartBlock, nStartPosition);
+
+    // one more transaction is fetched to tell, whether there are more
+    std::vector<CMPAddressIndex::Entry> entries;
+    {
+        LOCK(cs_tally);
+        if (!pDbAddressIndex) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Address index is disabled, restart with -omniaddressindex to enable it");
+        }
+        entries = pDbAddressIndex->getTransactions(address, nStartBlock, nStartPosition, nEndBlock, nCount + 1);
+    }
+
+    // the transactions are read from the blocks, so neither a wallet, nor -txindex is required
+    UniValue response(UniValue::VOBJ);
+    UniValue transactions(UniValue::VARR);
+    CBlock block;
+    CBlockIndex* pBlockIndex = nullptr;
+    for (const CMPAddressIndex::Entry& entry : entries) {
+        if (transactions.size() == (size_t) nCount) {
+            response.pushKV("cursor", strprintf("%d:%u", entry.block, entry.position));
+            break;
+        }
+        {
+            LOCK(cs_main);
+            CBlockIndex* pEntryBlockIndex = chainActive[entry.block];
+            if (pEntryBlockIndex == nullptr) continue; // disconnected, while the index was queried
+            if (pEntryBlockIndex != pBlockIndex) {
+                if (!ReadBlockFromDisk(block, pEntryBlockIndex, Params().GetConsensus(), false)) {
+                    throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block from disk");
+                }
+                pBlockIndex = pEntryBlockIndex;
+            }
+        }
+        if (entry.position >= block.vtx.size() || block.vtx[entry.position]->GetHash() != entry.txid) continue;
+
+        UniValue txobj(UniValue::VOBJ);
+        int populateResult = populateRPCTransactionObject(*block.vtx[entry.position], pBlockIndex->GetBlockHash(), txobj);
+        if (populateResult != 0) continue;
+
+        UniValue roles(UniValue::VARR);
+        if (entry.roles & CMPAddressIndex::ROLE_SENDER) roles.push_back("sender");
+        if (entry.roles & CMPAddressIndex::ROLE_REFERENCE) roles.push_back("reference");
+        txobj.pushKV("roles", roles);
+        transactions.push_back(txobj);
+    }
+    response.pushKV("address", address);
+    response.pushKV("transactions", transactions);
+
+    return response;
+}
+
+static UniValue omni_listpropertytransactions(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 5)
+        throw runtime_error(
+            RPCHelpMan{"omni_listpropertytransactions",
+               "\nLists the Omni transactions of a property, ordered by block and position.\n"
+               "\nRequires the property index, enabled with -omnipropertyindex. The result includes a cursor, if there "
+               "are more transactions, which can be passed to the next call to continue the listing. Transactions "
+               "processed before the index was created, or while it was disabled, are not included, unless Omni "
+               "transactions are reprocessed with -startclean.\n",
+               {
+                   {"propertyid", RPCArg::Type::NUM, RPCArg::Optional::NO, "the identifier of the property\n"},
+                   {"count", RPCArg::Type::NUM, /* default */ "100", "show at most n transactions\n"},
+                   {"cursor", RPCArg::Type::STR, /* default */ "\"\"", "the cursor returned by the previous call\n"},
+                   {"startblock", RPCArg::Type::NUM, /* default */ "0", "first block to begin the search\n"},
+                   {"endblock", RPCArg::Type::NUM, /* default */ "999999999", "last block to include in the search\n"},
+               },
+               RPCResult{
+                   "{\n"
+                   "  \"propertyid\" : n,                  (number) the identifier of the property\n"
+                   "  \"transactions\" : [               (array of JSON objects)\n"
+                   "    {\n"
+                   "      \"txid\" : \"hash\",                (string) the hex-encoded hash of the transaction\n"
+                   "      \"block\" : nnnnnn,               (number) the index of the block that contains the transaction\n"
+                   "      \"positioninblock\" : n,          (number) the position of the transaction within the block\n"
+                   "      \"valid\" : true|false,           (boolean) whether the transaction is valid\n"
+                   "      \"type_int\" : n,                 (number) the transaction type as number\n"
+                   "      \"type\" : \"type\",                (string) the transaction type as string\n"
+                   "      \"amount\" : \"n.nnnnnnnn\"         (string) the amount of the transaction\n"
+                   "    },\n"
+                   "    ...\n"
+                   "  ],\n"
+                   "  \"cursor\" : \"cursor\"                (string) the cursor of the next transactions (only if there are more)\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("omni_listpropertytransactions", "3 100")
+                   + HelpExampleRpc("omni_listpropertytransactions", "3, 100")
+               }
+            }.ToString());
+
+    uint32_t propertyId = ParsePropertyId(request.params[0]);
+    int64_t nCount = 100;
+    if (request.params.size() > 1) nCount = request.params[1].get_int64();
+    if (nCount < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+    int64_t nStartBlock = 0;
+    if (request.params.size() > 3) nStartBlock = request.params[3].get_int64();
+    if (nStartBlock < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative start block");
+    int64_t nEndBlock = 999999999;
+    if (request.params.size() > 4) nEndBlock = request.params[4].get_int64();
+    if (nEndBlock < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative end block");
+
+    // the cursor points to the block and position of the next transaction
+    uint32_t nStartPosition = 0;
+    if (request.params.size() > 2) ParseIndexCursor(request.params[2], nStartBlock, nStartPosition);
+
+    // disconnected blocks are removed from the index, once the next block is connected
+    {
+        LOCK(cs_main);
+        nEndBlock = std::min(nEndBlock, (int64_t) chainActive.Height());
+    }
+
+    UniValue response(UniValue::VOBJ);
+    UniValue transactions(UniValue::VARR);
+    {
+        LOCK(cs_tally);
+        if (!pDbPropertyIndex) {
+            throw JSONRPCError(RPC_MISC_ERROR, "Property index is disabled, restart with -omnipropertyindex to enable it");
+        }
+        RequireExistingProperty(propertyId);
+
+        // one more transaction is fetched to tell, whether there are more
+        std::vector<CMPPropertyIndex::Entry> entries = pDbPropertyIndex->getTransactions(propertyId, nStartBlock, nStartPosition, nEndBlock, nCount + 1);
+        for (const CMPPropertyIndex::Entry& entry : entries) {
+            if (transactions.size() == (size_t) nCount) {
+                response.pushKV("cursor", strprintf("%d:%u", entry.block, entry.position));
+                break;
+            }
+            UniValue txobj(UniValue::VOBJ);
+            txobj.pushKV("txid", entry.txid.GetHex());
+            txobj.pushKV("block", entry.block);
+            txobj.pushKV("positioninblock", (uint64_t) entry.position);
+            txobj.pushKV("valid", entry.fValid);
+            txobj.pushKV("type_int", (uint64_t) entry.type);
+            txobj.pushKV("type", strTransactionType(entry.type));
+            txobj.pushKV("amount", FormatMP(propertyId, entry.amount));
+            transactions.push_back(txobj);
+        }
+    }
+    response.pushKV("propertyid", (uint64_t) propertyId);
+    response.pushKV("transactions", transactions);
+
+    return response;
+}
+
 static UniValue omni_listpendingtransactions(const JSONRPCRequest& request)
 {
 #ifdef ENABLE_WALLET
@@ -1842,7 +2067,21 @@ static UniValue omni_getinfo(const JSONRPCRequest& request)
                    "      \"alertmessage\" : \"xxx\"                 (string) information about the alert\n"
                    "    },\n"
                    "    ...\n"
-                   "  ]\n"
+                   "  ],\n"
+                   "  \"dbusage\" : {                          (JSON object) usage statistics of the Omni databases\n"
+                   "    \"cachesize\" : nnnnnnnn,             (number) size of the block cache shared by the databases in bytes\n"
+                   "    \"cacheusage\" : nnnnnnnn,            (number) bytes used by the shared block cache\n"
+                   "    \"databases\" : [                     (array of JSON objects) statistics of each database\n"
+                   "      {\n"
+                   "        \"name\" : \"xxx\",                  (string) the name of the database\n"
+                   "        \"reads\" : nnnnnnnn,             (number) lookups since the database was opened\n"
+                   "        \"writes\" : nnnnnnnn,            (number) write operations since the database was opened\n"
+                   "        \"disksize\" : nnnnnnnn,          (number) approximate size on disk in bytes\n"
+                   "        \"memoryusage\" : nnnnnnnn        (number) approximate memory usage in bytes, without the shared block cache\n"
+                   "      },\n"
+                   "      ...\n"
+                   "    ]\n"
+                   "  }\n"
                    "}\n"
                },
                RPCExamples{
@@ -1897,6 +2136,26 @@ static UniValue omni_getinfo(const JSONRPCRequest& request)
     }
     infoResponse.pushKV("alerts", alerts);
 
+    // provide the usage of the databases
+    UniValue dbUsage(UniValue::VOBJ);
+    size_t nCacheSize = 0;
+    size_t nCacheUsage = 0;
+    CDBBase::GetCacheUsage(nCacheSize, nCacheUsage);
+    dbUsage.pushKV("cachesize", (uint64_t) nCacheSize);
+    dbUsage.pushKV("cacheusage", (uint64_t) nCacheUsage);
+    UniValue databases(UniValue::VARR);
+    for (const DBUsage& usage : CDBBase::GetUsage()) {
+        UniValue database(UniValue::VOBJ);
+        database.pushKV("name", usage.name);
+        database.pushKV("reads", usage.nReads);
+        database.pushKV("writes", usage.nWrites);
+        database.pushKV("disksize", usage.nDiskSize);
+        database.pushKV("memoryusage", usage.nMemoryUsage);
+        databases.push_back(database);
+    }
+    dbUsage.pushKV("databases", databases);
+    infoResponse.pushKV("dbusage", dbUsage);
+
     return infoResponse;
 }
 
@@ -2063,6 +2322,48 @@ static UniValue omni_getcurrentconsensushash(const JSONRPCRequest& request)
     return response;
 }
 
+static UniValue omni_getcurrentstatehash(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            RPCHelpMan{"omni_getcurrentstatehash",
+               "\nReturns the incrementally maintained state hash for the current block.\n"
+               "\nThe state hash covers the same data as the consensus hash, but is independent of any order. It is only available with -omnistatehash.\n",
+               {},
+               RPCResult{
+                   "{\n"
+                   "  \"block\" : nnnnnn,          (number) the index of the block this state hash applies to\n"
+                   "  \"blockhash\" : \"hash\",      (string) the hash of the corresponding block\n"
+                   "  \"statehash\" : \"hash\"       (string) the state hash for the block\n"
+                   "}\n"
+               },
+               RPCExamples{
+                   HelpExampleCli("omni_getcurrentstatehash", "")
+                   + HelpExampleRpc("omni_getcurrentstatehash", "")
+               }
+            }.ToString());
+
+    if (!fOmniStateHash) {
+        throw JSONRPCError(RPC_MISC_ERROR, "State hash is not maintained, please restart with -omnistatehash");
+    }
+
+    LOCK(cs_main);
+
+    int block = GetHeight();
+
+    CBlockIndex* pblockindex = chainActive[block];
+    uint256 blockHash = pblockindex->GetBlockHash();
+
+    uint256 stateHash = GetStateHash();
+
+    UniValue response(UniValue::VOBJ);
+    response.pushKV("block", block);
+    response.pushKV("blockhash", blockHash.GetHex());
+    response.pushKV("statehash", stateHash.GetHex());
+
+    return response;
+}
+
 static UniValue omni_getbalanceshash(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -2124,8 +2425,11 @@ static const CRPCCommand commands[] =
     { "omni layer (data retrieval)", "omni_listblocktransactions",     &omni_listblocktransactions,      {"index"} },
     { "omni layer (data retrieval)", "omni_listblockstransactions",    &omni_listblockstransactions,     {"firstblock", "lastblock"} },
     { "omni layer (data retrieval)", "omni_listpendingtransactions",   &omni_listpendingtransactions,    {"address"} },
+    { "omni layer (data retrieval)", "omni_listaddresstransactions",   &omni_listaddresstransactions,    {"address", "count", "cursor", "startblock", "endblock"} },
+    { "omni layer (data retrieval)", "omni_listpropertytransactions",  &omni_listpropertytransactions,   {"propertyid", "count", "cursor", "startblock", "endblock"} },
     { "omni layer (data retrieval)", "omni_getallbalancesforaddress",  &omni_getallbalancesforaddress,   {"address"} },
     { "omni layer (data retrieval)", "omni_getcurrentconsensushash",   &omni_getcurrentconsensushash,    {} },
+    { "omni layer (data retrieval)", "omni_getcurrentstatehash",       &omni_getcurrentstatehash,        {} },
     { "omni layer (data retrieval)", "omni_getpayload",                &omni_getpayload,                 {"txid"} },
     { "omni layer (data retrieval)", "omni_getbalanceshash",           &omni_getbalanceshash,            {"propertyid"} },
     { "omni layer (data retrieval)", "omni_getnonfungibletokens",      &omni_getnonfungibletokens,       {"address", "propertyid"} },
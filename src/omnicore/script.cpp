@@ -59,17 +59,49 @@ bool GetOutputType(const CScript& scriptPubKey, txnouttype& whichTypeRet)
  * @return True if the extraction was successful (result can be empty)
  */
 bool GetScriptPushes(const CScript& script, std::vector<std::string>& vstrRet, bool fSkipFirst)
+{
+    std::vector<Span<const unsigned char> > vPushes;
+    bool fSuccess = GetScriptPushes(script, vPushes, fSkipFirst);
+
+    for (const Span<const unsigned char>& push : vPushes) {
+        vstrRet.push_back(HexStr(push.begin(), push.end()));
+    }
+
+    return fSuccess;
+}
+
+/**
+ * Extracts the pushed data from a script.
+ *
+ * The extracted data refers to the script, which must outlive the result.
+ * In case of an error, the data pushed before the error is still returned.
+ *
+ * @param script[in]       The script
+ * @param vPushesRet[out]  The extracted pushed data
+ * @param fSkipFirst[in]   Whether the first push operation should be skipped (default: false)
+ * @return True if the extraction was successful (result can be empty)
+ */
+bool GetScriptPushes(const CScript& script, std::vector<Span<const unsigned char> >& vPushesRet, bool fSkipFirst)
 {
     int count = 0;
     CScript::const_iterator pc = script.begin();
 
     while (pc < script.end()) {
+        CScript::const_iterator pcOp = pc;
         opcodetype opcode;
-        std::vector<unsigned char> data;
-        if (!script.GetOp(pc, opcode, data))
+        if (!script.GetOp(pc, opcode))
             return false;
-        if (0x00 <= opcode && opcode <= OP_PUSHDATA4)
-            if (count++ || !fSkipFirst) vstrRet.push_back(HexStr(data));
+        if (0x00 <= opcode && opcode <= OP_PUSHDATA4) {
+            // the pushed data follows the opcode and its size
+            size_t nHeaderSize = 1;
+            if (opcode == OP_PUSHDATA1) nHeaderSize += 1;
+            if (opcode == OP_PUSHDATA2) nHeaderSize += 2;
+            if (opcode == OP_PUSHDATA4) nHeaderSize += 4;
+            if (count++ || !fSkipFirst) {
+                const unsigned char* pBegin = script.data() + (pcOp - script.begin());
+                vPushesRet.emplace_back(pBegin + nHeaderSize, script.data() + (pc - script.begin()));
+            }
+        }
     }
 
     return true;
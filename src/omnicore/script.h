@@ -1,6 +1,8 @@
 #ifndef BITCOIN_OMNICORE_SCRIPT_H
 #define BITCOIN_OMNICORE_SCRIPT_H
 
+#include <span.h>
+
 #include <string>
 #include <vector>
 
@@ -17,6 +19,9 @@ bool GetOutputType(const CScript& scriptPubKey, txnouttype& whichTypeRet);
 /** Extracts the pushed data as hex-encoded string from a script. */
 bool GetScriptPushes(const CScript& script, std::vector<std::string>& vstrRet, bool fSkipFirst = false);
 
+/** Extracts the pushed data from a script, without copying or encoding it. */
+bool GetScriptPushes(const CScript& script, std::vector<Span<const unsigned char> >& vPushesRet, bool fSkipFirst = false);
+
 /** Returns public keys or hashes from scriptPubKey, for standard transaction types. */
 bool SafeSolver(const CScript& scriptPubKey, txnouttype& typeRet, std::vector<std::vector<unsigned char> >& vSolutionsRet);
 
@@ -2,6 +2,8 @@
 
 #include <omnicore/sp.h>
 
+#include <omnicore/consensushash.h>
+#include <omnicore/journal.h>
 #include <omnicore/log.h>
 #include <omnicore/omnicore.h>
 #include <omnicore/uint256_extensions.h>
@@ -54,44 +56,6 @@ void CMPCrowd::print(const std::string& address, FILE* fp) const
     fprintf(fp, "%s\n", toString(address).c_str());
 }
 
-void CMPCrowd::saveCrowdSale(std::ofstream& file, const std::string& addr, CHash256& hasher) const
-{
-    // compose the outputline
-    // addr,propertyId,nValue,property_desired,deadline,early_bird,percentage,created,mined
-    std::string lineOut = strprintf("%s,%d,%d,%d,%d,%d,%d,%d,%d",
-            addr,
-            propertyId,
-            nValue,
-            property_desired,
-            deadline,
-            early_bird,
-            percentage,
-            u_created,
-            i_created);
-
-    // append N pairs of address=nValue;blockTime for the database
-    std::map<uint256, std::vector<int64_t> >::const_iterator iter;
-    for (iter = txFundraiserData.begin(); iter != txFundraiserData.end(); ++iter) {
-        lineOut.append(strprintf(",%s=", (*iter).first.GetHex()));
-        std::vector<int64_t> const &vals = (*iter).second;
-
-        std::vector<int64_t>::const_iterator valIter;
-        for (valIter = vals.begin(); valIter != vals.end(); ++valIter) {
-            if (valIter != vals.begin()) {
-                lineOut.append(";");
-            }
-
-            lineOut.append(strprintf("%d", *valIter));
-        }
-    }
-
-    // add the line to the hash
-    hasher.Write((unsigned char*)lineOut.c_str(), lineOut.length());
-
-    // write the line
-    file << lineOut << std::endl;
-}
-
 CMPCrowd* mastercore::getCrowd(const std::string& address)
 {
     CrowdMap::iterator my_it = my_crowds.find(address);
@@ -122,9 +86,9 @@ bool mastercore::IsPropertyIdValid(uint32_t propertyId)
 
 bool mastercore::isPropertyNonFungible(uint32_t propertyId)
 {
-    CMPSPInfo::Entry sp;
+    CMPSPInfo::Header sp;
 
-    if (pDbSpInfo->getSP(propertyId, sp)) return sp.unique;
+    if (pDbSpInfo->getHeader(propertyId, sp)) return sp.unique;
 
     return false;
 }
@@ -132,17 +96,17 @@ bool mastercore::isPropertyNonFungible(uint32_t propertyId)
 bool mastercore::isPropertyDivisible(uint32_t propertyId)
 {
     // TODO: is a lock here needed
-    CMPSPInfo::Entry sp;
+    CMPSPInfo::Header sp;
 
-    if (pDbSpInfo->getSP(propertyId, sp)) return sp.isDivisible();
+    if (pDbSpInfo->getHeader(propertyId, sp)) return sp.isDivisible();
 
     return true;
 }
 
 std::string mastercore::getPropertyName(uint32_t propertyId)
 {
-    CMPSPInfo::Entry sp;
-    if (pDbSpInfo->getSP(propertyId, sp)) return sp.name;
+    CMPSPInfo::Header sp;
+    if (pDbSpInfo->getHeader(propertyId, sp)) return sp.name;
     return "Property Name Not Found";
 }
 
@@ -321,15 +285,12 @@ bool mastercore::isCrowdsalePurchase(const uint256& txid, const std::string& add
     for (uint8_t ecosystem = 1; ecosystem <= 2; ecosystem++) {
         uint32_t startPropertyId = (ecosystem == 1) ? 1 : TEST_ECO_PROPERTY_1;
         for (uint32_t loopPropertyId = startPropertyId; loopPropertyId < pDbSpInfo->peekNextSPID(ecosystem); loopPropertyId++) {
-            CMPSPInfo::Entry sp;
-            if (!pDbSpInfo->getSP(loopPropertyId, sp)) continue;
-            for (std::map<uint256, std::vector<int64_t> >::const_iterator it = sp.historicalData.begin(); it != sp.historicalData.end(); it++) {
-                if (it->first == txid) {
-                    *propertyId = loopPropertyId;
-                    *userTokens = it->second.at(2);
-                    *issuerTokens = it->second.at(3);
-                    return true;
-                }
+            std::vector<int64_t> record;
+            if (pDbSpInfo->getHistoryRecord(loopPropertyId, txid, record)) {
+                *propertyId = loopPropertyId;
+                *userTokens = record.at(2);
+                *issuerTokens = record.at(3);
+                return true;
             }
         }
     }
@@ -358,7 +319,7 @@ void mastercore::eraseMaxedCrowdsale(const std::string& address, int64_t blockTi
         assert(pDbSpInfo->getSP(crowdsale.getPropertyId(), sp));
 
         // get txdata
-        sp.historicalData = crowdsale.getDatabase();
+        assert(pDbSpInfo->putHistory(crowdsale.getPropertyId(), crowdsale.getDatabase(), blockHash));
         sp.close_early = true;
         sp.max_tokens = true;
         sp.timeclosed = blockTime;
@@ -367,6 +328,8 @@ void mastercore::eraseMaxedCrowdsale(const std::string& address, int64_t blockTi
         assert(pDbSpInfo->updateSP(crowdsale.getPropertyId(), sp));
 
         // no calculate fractional calls here, no more tokens (at MAX)
+        JournalCrowdChange(address);
+        UpdateStateHashCrowd(address);
         my_crowds.erase(it);
     }
 }
@@ -401,7 +364,7 @@ unsigned int mastercore::eraseExpiredCrowdsale(const CBlockIndex* pBlockIndex)
             int64_t missedTokens = GetMissedIssuerBonus(sp, crowdsale);
 
             // get txdata
-            sp.historicalData = crowdsale.getDatabase();
+            assert(pDbSpInfo->putHistory(crowdsale.getPropertyId(), crowdsale.getDatabase(), pBlockIndex->GetBlockHash()));
             sp.missedTokens = missedTokens;
 
             // update SP with this data
@@ -413,6 +376,8 @@ unsigned int mastercore::eraseExpiredCrowdsale(const CBlockIndex* pBlockIndex)
                 assert(update_tally_map(sp.issuer, crowdsale.getPropertyId(), missedTokens, BALANCE));
             }
 
+            JournalCrowdChange(address);
+            UpdateStateHashCrowd(address);
             my_crowds.erase(my_it++);
 
             ++how_many_erased;
@@ -5,8 +5,9 @@
 #include <omnicore/dbspinfo.h>
 #include <omnicore/log.h>
 
+#include <serialize.h>
+
 class CBlockIndex;
-class CHash256;
 class uint256;
 
 #include <stdint.h>
@@ -45,6 +46,21 @@ public:
     CMPCrowd();
     CMPCrowd(uint32_t pid, int64_t nv, uint32_t cd, int64_t dl, uint8_t eb, uint8_t per, int64_t uct, int64_t ict);
 
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(propertyId);
+        READWRITE(nValue);
+        READWRITE(property_desired);
+        READWRITE(deadline);
+        READWRITE(early_bird);
+        READWRITE(percentage);
+        READWRITE(u_created);
+        READWRITE(i_created);
+        READWRITE(txFundraiserData);
+    }
+
     uint32_t getPropertyId() const { return propertyId; }
 
     int64_t getDeadline() const { return deadline; }
@@ -61,7 +77,6 @@ public:
 
     std::string toString(const std::string& address) const;
     void print(const std::string& address, FILE* fp = stdout) const;
-    void saveCrowdSale(std::ofstream& file, const std::string& addr, CHash256 &hasher) const;
 };
 
 namespace mastercore
@@ -40,11 +40,11 @@ OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int
 
     {
         LOCK(cs_tally);
-        std::unordered_map<std::string, CMPTally>::iterator it;
+        const std::set<uint32_t>& holders = mp_tally_map.getHolders(property);
 
-        for (it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const std::string& address = it->first;
-            const CMPTally& tally = it->second;
+        for (std::set<uint32_t>::const_iterator it = holders.begin(); it != holders.end(); ++it) {
+            const std::string& address = mp_tally_map.getAddress(*it);
+            const CMPTally& tally = mp_tally_map.getTally(*it);
 
             int64_t tokens = 0;
             tokens += tally.getMoney(property, BALANCE);
@@ -3,15 +3,77 @@
 #include <omnicore/log.h>
 #include <omnicore/omnicore.h>
 
+#include <memusage.h>
+
 #include <stdint.h>
-#include <map>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Orders balance records by property identifier.
+ */
+struct PropertyIdLess
+{
+    template <typename Record>
+    bool operator()(const Record& record, uint32_t propertyId) const
+    {
+        return record.propertyId < propertyId;
+    }
+};
 
 /**
  * Creates an empty tally.
  */
-CMPTally::CMPTally()
+CMPTally::CMPTally() : my_pos(0)
+{
+}
+
+/**
+ * Returns the balance record of a property.
+ *
+ * @param propertyId  The identifier of the balance record
+ * @return The balance record, or nullptr, if there is none
+ */
+const CMPTally::BalanceRecord* CMPTally::findRecord(uint32_t propertyId) const
+{
+    TokenMap::const_iterator it = std::lower_bound(mp_token.begin(), mp_token.end(), propertyId, PropertyIdLess());
+
+    if (it != mp_token.end() && it->propertyId == propertyId) {
+        return &(it->record);
+    }
+
+    return nullptr;
+}
+
+/**
+ * Returns the balance record of a property, and inserts an empty one, if
+ * there is none.
+ *
+ * Balance records are kept sorted, so the internal iterator is moved along,
+ * when a record is inserted at or in front of its position, and continues
+ * with the same record as before.
+ *
+ * @param propertyId  The identifier of the balance record
+ * @return The balance record
+ */
+CMPTally::BalanceRecord& CMPTally::getRecord(uint32_t propertyId)
 {
-    my_it = mp_token.begin();
+    TokenMap::iterator it = std::lower_bound(mp_token.begin(), mp_token.end(), propertyId, PropertyIdLess());
+
+    if (it == mp_token.end() || it->propertyId != propertyId) {
+        uint32_t pos = it - mp_token.begin();
+        if (pos <= my_pos) {
+            ++my_pos;
+        }
+        TokenEntry entry = {propertyId, BalanceRecord()};
+        it = mp_token.insert(it, entry);
+    }
+
+    return it->record;
 }
 
 /**
@@ -22,9 +84,9 @@ CMPTally::CMPTally()
 uint32_t CMPTally::init()
 {
     uint32_t propertyId = 0;
-    my_it = mp_token.begin();
-    if (my_it != mp_token.end()) {
-        propertyId = my_it->first;
+    my_pos = 0;
+    if (my_pos < mp_token.size()) {
+        propertyId = mp_token[my_pos].propertyId;
     }
     return propertyId;
 }
@@ -37,9 +99,9 @@ uint32_t CMPTally::init()
 uint32_t CMPTally::next()
 {
     uint32_t ret = 0;
-    if (my_it != mp_token.end()) {
-        ret = my_it->first;
-        ++my_it;
+    if (my_pos < mp_token.size()) {
+        ret = mp_token[my_pos].propertyId;
+        ++my_pos;
     }
     return ret;
 }
@@ -73,7 +135,8 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
         return false;
     }
     bool fUpdated = false;
-    int64_t now64 = mp_token[propertyId].balance[ttype];
+    BalanceRecord& record = getRecord(propertyId);
+    int64_t now64 = record.balance[ttype];
 
     if (isOverflow(now64, amount)) {
         PrintToLog("%s(): ERROR: arithmetic overflow [%d + %d]\n", __func__, now64, amount);
@@ -86,7 +149,7 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
     } else {
 
         now64 += amount;
-        mp_token[propertyId].balance[ttype] = now64;
+        record.balance[ttype] = now64;
 
         fUpdated = true;
     }
@@ -107,11 +170,10 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
         return 0;
     }
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        money = record.balance[ttype];
+    if (record) {
+        money = record->balance[ttype];
     }
 
     return money;
@@ -128,14 +190,13 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
  */
 int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 {
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        if (record.balance[PENDING] < 0) {
-            return record.balance[BALANCE] + record.balance[PENDING];
+    if (record) {
+        if (record->balance[PENDING] < 0) {
+            return record->balance[BALANCE] + record->balance[PENDING];
         } else {
-            return record.balance[BALANCE];
+            return record->balance[BALANCE];
         }
     }
 
@@ -154,12 +215,11 @@ int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 int64_t CMPTally::getMoneyReserved(uint32_t propertyId) const
 {
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        money += record.balance[SELLOFFER_RESERVE];
-        money += record.balance[ACCEPT_RESERVE];
+    if (record) {
+        money += record->balance[SELLOFFER_RESERVE];
+        money += record->balance[ACCEPT_RESERVE];
     }
 
     return money;
@@ -180,11 +240,11 @@ bool CMPTally::operator==(const CMPTally& rhs) const
     TokenMap::const_iterator pc2 = rhs.mp_token.begin();
 
     for (unsigned int i = 0; i < mp_token.size(); ++i) {
-        if (pc1->first != pc2->first) {
+        if (pc1->propertyId != pc2->propertyId) {
             return false;
         }
-        const BalanceRecord& record1 = pc1->second;
-        const BalanceRecord& record2 = pc2->second;
+        const BalanceRecord& record1 = pc1->record;
+        const BalanceRecord& record2 = pc2->record;
 
         for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
             if (record1.balance[ttype] != record2.balance[ttype]) {
@@ -226,14 +286,13 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
     int64_t accept_reserve = 0;
     int64_t pending = 0;
 
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = findRecord(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        balance = record.balance[BALANCE];
-        selloffer_reserve = record.balance[SELLOFFER_RESERVE];
-        accept_reserve = record.balance[ACCEPT_RESERVE];
-        pending = record.balance[PENDING];
+    if (record) {
+        balance = record->balance[BALANCE];
+        selloffer_reserve = record->balance[SELLOFFER_RESERVE];
+        accept_reserve = record->balance[ACCEPT_RESERVE];
+        pending = record->balance[PENDING];
     }
 
     if (bDivisible) {
@@ -248,3 +307,292 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
 
     return (balance + selloffer_reserve + accept_reserve);
 }
+
+/**
+ * Returns the approximated number of bytes allocated by the tally.
+ *
+ * @return The dynamic memory usage
+ */
+size_t CMPTally::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(mp_token);
+}
+
+const uint32_t CMPTallyMap::NO_ID;
+
+/**
+ * Returns the slot of an address in the hash table, or the empty slot where
+ * the address would be inserted.
+ *
+ * The table is never full, so the linear probing always terminates.
+ *
+ * @param address  The address to look up
+ * @param hash     The hash of the address
+ * @return The position of the slot
+ */
+size_t CMPTallyMap::findSlot(const std::string& address, uint64_t hash) const
+{
+    const size_t mask = slots.size() - 1;
+    const uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    size_t pos = hash & mask;
+
+    while (slots[pos].id != NO_ID) {
+        if (slots[pos].tag == tag && entries[slots[pos].id].first == address) {
+            break;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    return pos;
+}
+
+/**
+ * Resizes the hash table and inserts the identifiers of all addresses.
+ *
+ * @param nSlots  The new number of slots, must be a power of two
+ */
+void CMPTallyMap::rehash(size_t nSlots)
+{
+    const Slot empty = {NO_ID, 0};
+    slots.assign(nSlots, empty);
+    const size_t mask = nSlots - 1;
+
+    for (uint32_t id = 0; id < entries.size(); ++id) {
+        const uint64_t hash = std::hash<std::string>()(entries[id].first);
+        size_t pos = hash & mask;
+        while (slots[pos].id != NO_ID) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos].id = id;
+        slots[pos].tag = static_cast<uint32_t>(hash >> 32);
+    }
+}
+
+/**
+ * Returns the identifier of an address.
+ *
+ * @param address  The address to look up
+ * @return The identifier, or NO_ID, if the address is unknown
+ */
+uint32_t CMPTallyMap::getId(const std::string& address) const
+{
+    if (slots.empty()) {
+        return NO_ID;
+    }
+
+    return slots[findSlot(address, std::hash<std::string>()(address))].id;
+}
+
+/**
+ * Returns the position of an address.
+ *
+ * @param address  The address to look up
+ * @return The position, or end(), if the address is unknown
+ */
+CMPTallyMap::iterator CMPTallyMap::find(const std::string& address)
+{
+    uint32_t id = getId(address);
+
+    return (id == NO_ID) ? entries.end() : entries.begin() + id;
+}
+
+CMPTallyMap::const_iterator CMPTallyMap::find(const std::string& address) const
+{
+    uint32_t id = getId(address);
+
+    return (id == NO_ID) ? entries.end() : entries.begin() + id;
+}
+
+/**
+ * Inserts an address and tally pair, unless the address is already known.
+ *
+ * The address gets the next free identifier. The hash table is grown, when
+ * more than half of the slots are used.
+ *
+ * @param value  The address and tally pair to insert
+ * @return The position of the address, and whether it was inserted
+ */
+std::pair<CMPTallyMap::iterator, bool> CMPTallyMap::insert(const value_type& value)
+{
+    if ((entries.size() + 1) * 2 > slots.size()) {
+        rehash(std::max<size_t>(16, slots.size() * 2));
+    }
+
+    const uint64_t hash = std::hash<std::string>()(value.first);
+    size_t pos = findSlot(value.first, hash);
+    if (slots[pos].id != NO_ID) {
+        return std::make_pair(entries.begin() + slots[pos].id, false);
+    }
+
+    assert(entries.size() < NO_ID);
+    slots[pos].id = entries.size();
+    slots[pos].tag = static_cast<uint32_t>(hash >> 32);
+    entries.push_back(value);
+    indexTally(slots[pos].id);
+
+    return std::make_pair(entries.end() - 1, true);
+}
+
+/**
+ * Returns the sum of balance and reserves of a tally.
+ */
+static int64_t GetTokens(const CMPTally& tally, uint32_t propertyId)
+{
+    return tally.getMoney(propertyId, BALANCE) + tally.getMoney(propertyId, SELLOFFER_RESERVE) + tally.getMoney(propertyId, ACCEPT_RESERVE);
+}
+
+/**
+ * Checks whether any balance of a tally is non-zero.
+ */
+static bool HasAnyMoney(const CMPTally& tally, uint32_t propertyId)
+{
+    for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
+        if (tally.getMoney(propertyId, static_cast<TallyType>(ttype)) != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Adds the balances of a newly inserted tally to the property index.
+ *
+ * @param id  The identifier of the tally
+ */
+void CMPTallyMap::indexTally(uint32_t id)
+{
+    CMPTally& tally = entries[id].second;
+    uint32_t propertyId = tally.init();
+
+    while (0 != (propertyId = tally.next())) {
+        if (!HasAnyMoney(tally, propertyId)) {
+            continue;
+        }
+        PropertyIndex& index = properties[propertyId];
+        int64_t tokens = GetTokens(tally, propertyId);
+        index.holders.insert(id);
+        index.totalTokens += tokens;
+        if (tokens > 0) {
+            ++index.owners;
+        }
+    }
+}
+
+/**
+ * Updates the number of tokens of a tally, and the holders and totals of
+ * the property.
+ *
+ * @param it          The position of the tally to update
+ * @param propertyId  The identifier of the property
+ * @param amount      The amount to add
+ * @param ttype       The tally type
+ * @return True, if the update was successful
+ */
+bool CMPTallyMap::updateMoney(iterator it, uint32_t propertyId, int64_t amount, TallyType ttype)
+{
+    CMPTally& tally = it->second;
+    int64_t tokensBefore = GetTokens(tally, propertyId);
+    bool fHolderBefore = HasAnyMoney(tally, propertyId);
+
+    if (!tally.updateMoney(propertyId, amount, ttype)) {
+        return false;
+    }
+
+    const uint32_t id = it - entries.begin();
+    int64_t tokensAfter = GetTokens(tally, propertyId);
+    bool fHolderAfter = HasAnyMoney(tally, propertyId);
+    PropertyIndex& index = properties[propertyId];
+
+    index.totalTokens += (tokensAfter - tokensBefore);
+    if (tokensBefore <= 0 && tokensAfter > 0) {
+        ++index.owners;
+    } else if (tokensBefore > 0 && tokensAfter <= 0) {
+        --index.owners;
+    }
+    if (!fHolderBefore && fHolderAfter) {
+        index.holders.insert(id);
+    } else if (fHolderBefore && !fHolderAfter) {
+        index.holders.erase(id);
+    }
+
+    return true;
+}
+
+/**
+ * Returns the identifiers of all addresses with any non-zero balance, reserve
+ * or pending amount of a property, in ascending order.
+ *
+ * @param propertyId  The identifier of the property
+ * @return The identifiers of the holders
+ */
+const std::set<uint32_t>& CMPTallyMap::getHolders(uint32_t propertyId) const
+{
+    static const std::set<uint32_t> noHolders;
+    std::map<uint32_t, PropertyIndex>::const_iterator it = properties.find(propertyId);
+
+    return (it != properties.end()) ? it->second.holders : noHolders;
+}
+
+/**
+ * Returns the sum of balances and reserves of a property.
+ *
+ * @param propertyId  The identifier of the property
+ * @return The number of tokens in circulation
+ */
+int64_t CMPTallyMap::getTotalTokens(uint32_t propertyId) const
+{
+    std::map<uint32_t, PropertyIndex>::const_iterator it = properties.find(propertyId);
+
+    return (it != properties.end()) ? it->second.totalTokens : 0;
+}
+
+/**
+ * Returns the number of addresses with a positive sum of balance and reserves
+ * of a property.
+ *
+ * @param propertyId  The identifier of the property
+ * @return The number of owners
+ */
+int64_t CMPTallyMap::getNumberOfOwners(uint32_t propertyId) const
+{
+    std::map<uint32_t, PropertyIndex>::const_iterator it = properties.find(propertyId);
+
+    return (it != properties.end()) ? it->second.owners : 0;
+}
+
+/**
+ * Removes all addresses, tallies and indexes, and releases the hash table.
+ */
+void CMPTallyMap::clear()
+{
+    entries.clear();
+    std::vector<Slot>().swap(slots);
+    properties.clear();
+}
+
+/**
+ * Returns the approximated number of bytes allocated by the collection.
+ *
+ * @return The dynamic memory usage
+ */
+size_t CMPTallyMap::DynamicMemoryUsage() const
+{
+    size_t usage = memusage::DynamicUsage(slots);
+    usage += sizeof(value_type) * entries.size();
+
+    for (const_iterator it = entries.begin(); it != entries.end(); ++it) {
+        const char* data = it->first.data();
+        const char* object = reinterpret_cast<const char*>(&it->first);
+        if (data < object || data >= object + sizeof(std::string)) {
+            usage += memusage::MallocUsage(it->first.capacity() + 1);
+        }
+        usage += it->second.DynamicMemoryUsage();
+    }
+
+    usage += memusage::DynamicUsage(properties);
+    for (std::map<uint32_t, PropertyIndex>::const_iterator it = properties.begin(); it != properties.end(); ++it) {
+        usage += memusage::DynamicUsage(it->second.holders);
+    }
+
+    return usage;
+}
@@ -1,8 +1,15 @@
 #ifndef BITCOIN_OMNICORE_TALLY_H
 #define BITCOIN_OMNICORE_TALLY_H
 
+#include <prevector.h>
+
 #include <stdint.h>
+#include <deque>
 #include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
 
 //! Balance record types
 enum TallyType {
@@ -22,12 +29,24 @@ private:
         int64_t balance[TALLY_TYPE_COUNT];
     } BalanceRecord;
 
-    //! Map of balance records
-    typedef std::map<uint32_t, BalanceRecord> TokenMap;
+    /** Balance record of a property, trivially copyable to be stored in a prevector. */
+    struct TokenEntry {
+        uint32_t propertyId;
+        BalanceRecord record;
+    };
+
+    //! Balance records, ordered by property identifier, the first one is stored inline
+    typedef prevector<1, TokenEntry> TokenMap;
     //! Balance records for different tokens
     TokenMap mp_token;
-    //! Internal iterator pointing to a balance record
-    TokenMap::iterator my_it;
+    //! Internal position of the next balance record
+    uint32_t my_pos;
+
+    /** Returns the balance record of a property, or nullptr, if there is none. */
+    const BalanceRecord* findRecord(uint32_t propertyId) const;
+
+    /** Returns the balance record of a property, and inserts an empty one, if there is none. */
+    BalanceRecord& getRecord(uint32_t propertyId);
 
 public:
     /** Creates an empty tally. */
@@ -59,6 +78,112 @@ public:
 
     /** Prints a balance record to the console. */
     int64_t print(uint32_t propertyId = 1, bool bDivisible = true) const;
+
+    /** Returns the approximated number of bytes allocated by the tally. */
+    size_t DynamicMemoryUsage() const;
+};
+
+/** Collection of tallies, keyed by address.
+ *
+ * Each address is interned to a dense 32-bit identifier, when it is first
+ * inserted, and the tallies are stored contiguously in identifier order.
+ * The lookup from address to identifier is an open-addressing hash table
+ * of identifiers, so every address string is only stored once.
+ *
+ * References to tallies remain valid, when other addresses are inserted.
+ *
+ * For every property the holders and the number of tokens in circulation are
+ * indexed. The index is only kept up to date, when tallies are updated via
+ * updateMoney() of the collection.
+ */
+class CMPTallyMap
+{
+public:
+    typedef std::pair<std::string, CMPTally> value_type;
+    typedef std::deque<value_type>::iterator iterator;
+    typedef std::deque<value_type>::const_iterator const_iterator;
+
+    /** Identifier of an address, which is not part of the collection. */
+    static const uint32_t NO_ID = 0xFFFFFFFF;
+
+private:
+    /** Slot of the hash table, with a part of the address hash to skip most comparisons. */
+    struct Slot {
+        uint32_t id;
+        uint32_t tag;
+    };
+
+    /** Holders and running totals of a single property. */
+    struct PropertyIndex {
+        //! Identifiers of addresses with any non-zero balance
+        std::set<uint32_t> holders;
+        //! Sum of balances and reserves of all addresses
+        int64_t totalTokens;
+        //! Number of addresses with a positive sum of balance and reserves
+        int64_t owners;
+
+        PropertyIndex() : totalTokens(0), owners(0) {}
+    };
+
+    //! Address and tally pairs, indexed by address identifier
+    std::deque<value_type> entries;
+    //! Open-addressing hash table of address identifiers, empty slots are NO_ID
+    std::vector<Slot> slots;
+    //! Holders and totals per property, maintained with every update
+    std::map<uint32_t, PropertyIndex> properties;
+
+    /** Returns the slot of an address, or the empty slot where it would be inserted. */
+    size_t findSlot(const std::string& address, uint64_t hash) const;
+
+    /** Grows the hash table and rehashes all addresses. */
+    void rehash(size_t nSlots);
+
+    /** Adds the balances of a tally to the property index. */
+    void indexTally(uint32_t id);
+
+public:
+    /** Returns the identifier of an address, or NO_ID, if it is unknown. */
+    uint32_t getId(const std::string& address) const;
+
+    /** Returns the address of an identifier. */
+    const std::string& getAddress(uint32_t id) const { return entries[id].first; }
+
+    /** Returns the tally of an identifier. */
+    CMPTally& getTally(uint32_t id) { return entries[id].second; }
+    const CMPTally& getTally(uint32_t id) const { return entries[id].second; }
+
+    /** Returns the position of an address, or end(), if it is unknown. */
+    iterator find(const std::string& address);
+    const_iterator find(const std::string& address) const;
+
+    /** Inserts an address and tally pair, unless the address is already known. */
+    std::pair<iterator, bool> insert(const value_type& value);
+
+    /** Updates the number of tokens of a tally, and the property index. */
+    bool updateMoney(iterator it, uint32_t propertyId, int64_t amount, TallyType ttype);
+
+    /** Returns the identifiers of all addresses with any non-zero balance of a property. */
+    const std::set<uint32_t>& getHolders(uint32_t propertyId) const;
+
+    /** Returns the sum of balances and reserves of a property. */
+    int64_t getTotalTokens(uint32_t propertyId) const;
+
+    /** Returns the number of addresses with a positive sum of balance and reserves of a property. */
+    int64_t getNumberOfOwners(uint32_t propertyId) const;
+
+    iterator begin() { return entries.begin(); }
+    iterator end() { return entries.end(); }
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+
+    /** Removes all addresses and tallies. */
+    void clear();
+
+    /** Returns the approximated number of bytes allocated by the collection. */
+    size_t DynamicMemoryUsage() const;
 };
 
 
@@ -0,0 +1,95 @@
+#include <omnicore/dbaddressindex.h>
+
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_dbaddressindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(address_index_roles_and_cursor)
+{
+    CMPAddressIndex index(GetDataDir() / "MP_addressindex_cursor", true);
+    const std::string alice = "alice";
+    const std::string bob = "bob";
+
+    index.recordTransaction(uint256S("a1"), 100, 2, alice, bob);
+    index.recordTransaction(uint256S("a2"), 100, 7, bob, "");
+    index.recordTransaction(uint256S("a3"), 101, 1, alice, alice);
+    index.recordTransaction(uint256S("a4"), 205, 3, alice, "");
+
+    std::vector<CMPAddressIndex::Entry> entries = index.getTransactions(alice, 0, 0, 999999999, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 3U);
+    BOOST_CHECK(entries[0].txid == uint256S("a1"));
+    BOOST_CHECK_EQUAL(entries[0].block, 100);
+    BOOST_CHECK_EQUAL(entries[0].position, 2U);
+    BOOST_CHECK_EQUAL(entries[0].roles, CMPAddressIndex::ROLE_SENDER);
+    BOOST_CHECK_EQUAL(entries[1].roles, CMPAddressIndex::ROLE_SENDER | CMPAddressIndex::ROLE_REFERENCE);
+
+    entries = index.getTransactions(bob, 0, 0, 999999999, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK_EQUAL(entries[0].roles, CMPAddressIndex::ROLE_REFERENCE);
+    BOOST_CHECK(entries[1].txid == uint256S("a2"));
+
+    // pages continue at the block and position of the next transaction
+    entries = index.getTransactions(alice, 0, 0, 999999999, 1);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].txid == uint256S("a1"));
+    entries = index.getTransactions(alice, 100, 3, 999999999, 1);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].txid == uint256S("a3"));
+
+    // block ranges
+    entries = index.getTransactions(alice, 101, 0, 200, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].txid == uint256S("a3"));
+    BOOST_CHECK(index.getTransactions("carol", 0, 0, 999999999, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(address_index_rollback)
+{
+    CMPAddressIndex index(GetDataDir() / "MP_addressindex_rollback", true);
+    BOOST_CHECK_EQUAL(index.getStartBlock(), -1);
+    index.setStartBlock(50);
+    BOOST_CHECK_EQUAL(index.getStartBlock(), 50);
+
+    index.recordTransaction(uint256S("b1"), 100, 1, "alice", "bob");
+    index.recordTransaction(uint256S("b2"), 101, 1, "alice", "");
+    index.recordTransaction(uint256S("b3"), 102, 4, "bob", "alice");
+
+    // the block and all following blocks are removed
+    BOOST_CHECK_EQUAL(index.deleteAboveBlock(101), 3);
+    std::vector<CMPAddressIndex::Entry> entries = index.getTransactions("alice", 0, 0, 999999999, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].txid == uint256S("b1"));
+    BOOST_CHECK_EQUAL(index.getTransactions("bob", 0, 0, 999999999, 10).size(), 1U);
+    BOOST_CHECK_EQUAL(index.deleteAboveBlock(101), 0);
+    BOOST_CHECK_EQUAL(index.getStartBlock(), 50);
+}
+
+BOOST_AUTO_TEST_CASE(address_index_last_block)
+{
+    CMPAddressIndex index(GetDataDir() / "MP_addressindex_lastblock", true);
+    int block = 0;
+    uint256 hash;
+    BOOST_CHECK(!index.getLastBlock(block, hash));
+
+    index.setLastBlock(100, uint256S("c1"));
+    index.setLastBlock(101, uint256S("c2"));
+    BOOST_REQUIRE(index.getLastBlock(block, hash));
+    BOOST_CHECK_EQUAL(block, 101);
+    BOOST_CHECK(hash == uint256S("c2"));
+
+    // the marker is not listed as transaction, and wiped with the index
+    index.recordTransaction(uint256S("c3"), 101, 1, "alice", "");
+    BOOST_CHECK_EQUAL(index.deleteAboveBlock(0), 1);
+    BOOST_CHECK(index.getLastBlock(block, hash));
+    index.Clear();
+    BOOST_CHECK(!index.getLastBlock(block, hash));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
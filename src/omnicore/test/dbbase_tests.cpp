@@ -0,0 +1,219 @@
+#include <omnicore/dbbase.h>
+
+#include <fs.h>
+#include <test/test_bitcoin.h>
+#include <tinyformat.h>
+#include <util/system.h>
+
+#include <leveldb/iterator.h>
+#include <leveldb/write_batch.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+/** Plain key-value database, which exposes the basic operations. */
+class CTestDB : public CDBBase
+{
+public:
+    explicit CTestDB(const fs::path& path, bool fWipe = true)
+    {
+        leveldb::Status status = Open(path, fWipe);
+        assert(status.ok());
+    }
+
+    void Put(const std::string& key, const std::string& value)
+    {
+        pdb->Put(syncoptions, key, value);
+    }
+
+    void Delete(const std::string& key)
+    {
+        pdb->Delete(writeoptions, key);
+    }
+
+    void Write(leveldb::WriteBatch& batch)
+    {
+        pdb->Write(syncoptions, &batch);
+    }
+
+    bool Get(const std::string& key, std::string& value)
+    {
+        return pdb->Get(readoptions, key, &value).ok();
+    }
+
+    leveldb::Iterator* CreateIterator() const
+    {
+        return NewIterator();
+    }
+
+    /** Returns all keys, iterated from the given key onwards. */
+    std::vector<std::string> Keys(const std::string& start = "")
+    {
+        std::vector<std::string> keys;
+        leveldb::Iterator* it = NewIterator();
+        for (it->Seek(start); it->Valid(); it->Next()) {
+            keys.push_back(it->key().ToString());
+        }
+        delete it;
+        return keys;
+    }
+
+    /** Returns all keys, iterated backwards. */
+    std::vector<std::string> KeysReverse()
+    {
+        std::vector<std::string> keys;
+        leveldb::Iterator* it = NewIterator();
+        for (it->SeekToLast(); it->Valid(); it->Prev()) {
+            keys.push_back(it->key().ToString());
+        }
+        delete it;
+        return keys;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_dbbase_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(block_batch_read_your_writes)
+{
+    const fs::path path = GetDataDir() / "MP_batch_reads";
+    std::string value;
+    {
+        CTestDB db(path);
+        db.Put("a", "1");
+        db.Put("c", "3");
+
+        BOOST_CHECK(CDBBase::BeginBlockBatch());
+        db.Put("b", "2");
+        db.Put("c", "30");
+        db.Delete("a");
+        leveldb::WriteBatch batch;
+        batch.Put("d", "4");
+        batch.Delete("b");
+        batch.Put("b", "20");
+        db.Write(batch);
+
+        BOOST_CHECK(!db.Get("a", value));
+        BOOST_CHECK(db.Get("b", value));
+        BOOST_CHECK_EQUAL(value, "20");
+        BOOST_CHECK(db.Get("c", value));
+        BOOST_CHECK_EQUAL(value, "30");
+        BOOST_CHECK(db.Get("d", value));
+        BOOST_CHECK_EQUAL(value, "4");
+        BOOST_CHECK(CDBBase::CommitBlockBatch());
+
+        // writes after the commit are not collected
+        db.Put("e", "5");
+    }
+
+    // the committed writes are stored
+    CTestDB db(path, false);
+    BOOST_CHECK(!db.Get("a", value));
+    BOOST_CHECK(db.Get("b", value));
+    BOOST_CHECK_EQUAL(value, "20");
+    BOOST_CHECK(db.Get("c", value));
+    BOOST_CHECK_EQUAL(value, "30");
+    BOOST_CHECK(db.Get("e", value));
+    BOOST_CHECK_EQUAL(db.Keys().size(), 4U);
+}
+
+BOOST_AUTO_TEST_CASE(block_batch_iterators)
+{
+    CTestDB db(GetDataDir() / "MP_batch_iterators");
+    db.Put("a", "1");
+    db.Put("c", "3");
+    db.Put("e", "5");
+    db.Put("g", "7");
+
+    BOOST_CHECK(CDBBase::BeginBlockBatch());
+    db.Delete("a");
+    db.Put("b", "2");
+    db.Put("c", "30");
+    db.Delete("e");
+    db.Put("h", "8");
+
+    // pending writes are merged, and deleted entries are skipped in both directions
+    BOOST_CHECK((db.Keys() == std::vector<std::string>{"b", "c", "g", "h"}));
+    BOOST_CHECK((db.Keys("d") == std::vector<std::string>{"g", "h"}));
+    BOOST_CHECK((db.KeysReverse() == std::vector<std::string>{"h", "g", "c", "b"}));
+
+    // the iterator sees the writes made before it was created
+    leveldb::Iterator* it = db.CreateIterator();
+    it->Seek("c");
+    BOOST_REQUIRE(it->Valid());
+    BOOST_CHECK_EQUAL(it->value().ToString(), "30");
+    db.Delete("g");
+    db.Put("d", "4");
+    it->Next();
+    BOOST_REQUIRE(it->Valid());
+    BOOST_CHECK_EQUAL(it->key().ToString(), "g");
+    it->Prev();
+    BOOST_REQUIRE(it->Valid());
+    BOOST_CHECK_EQUAL(it->key().ToString(), "c");
+    delete it;
+
+    BOOST_CHECK((db.Keys() == std::vector<std::string>{"b", "c", "d", "h"}));
+    BOOST_CHECK(CDBBase::CommitBlockBatch());
+    BOOST_CHECK((db.Keys() == std::vector<std::string>{"b", "c", "d", "h"}));
+}
+
+BOOST_AUTO_TEST_CASE(block_batch_left_open)
+{
+    const fs::path path = GetDataDir() / "MP_batch_left_open";
+    std::string value;
+    {
+        CTestDB db(path);
+        BOOST_CHECK(CDBBase::BeginBlockBatch());
+        db.Put("a", "1");
+
+        // the writes of a batch, which was not committed, are committed by the next batch
+        BOOST_CHECK(CDBBase::BeginBlockBatch());
+        db.Put("b", "2");
+        BOOST_CHECK(CDBBase::CommitBlockBatch());
+    }
+
+    CTestDB db(path, false);
+    BOOST_CHECK(db.Get("a", value));
+    BOOST_CHECK_EQUAL(value, "1");
+    BOOST_CHECK(db.Get("b", value));
+    BOOST_CHECK_EQUAL(value, "2");
+}
+
+BOOST_AUTO_TEST_CASE(configured_cache_usage)
+{
+    CDBBase::Configure(1 << 20, true, false);
+    {
+        CTestDB db(GetDataDir() / "MP_configured_cache");
+        for (int n = 0; n < 100; ++n) {
+            db.Put(strprintf("key%03d", n), std::string(100, 'x'));
+        }
+        std::string value;
+        BOOST_CHECK(db.Get("key042", value));
+        BOOST_CHECK(!db.Get("missing", value));
+
+        std::vector<DBUsage> vUsage = CDBBase::GetUsage();
+        auto it = std::find_if(vUsage.begin(), vUsage.end(), [](const DBUsage& usage) { return usage.name == "MP_configured_cache"; });
+        BOOST_REQUIRE(it != vUsage.end());
+        BOOST_CHECK_EQUAL(it->nReads, 2U);
+        BOOST_CHECK_EQUAL(it->nWrites, 100U);
+        BOOST_CHECK(it->nMemoryUsage > 0);
+
+        size_t nCacheSize = 0;
+        size_t nCacheUsage = 0;
+        CDBBase::GetCacheUsage(nCacheSize, nCacheUsage);
+        BOOST_CHECK_EQUAL(nCacheSize, 1U << 20);
+
+        // databases opened before, keep using their block cache
+        CDBBase::Configure(0, DEFAULT_OMNI_DB_BLOOM_FILTER, DEFAULT_OMNI_DB_CHECKSUMS);
+        BOOST_CHECK(db.Get("key042", value));
+    }
+
+    size_t nCacheSize = 0;
+    size_t nCacheUsage = 0;
+    CDBBase::GetCacheUsage(nCacheSize, nCacheUsage);
+    BOOST_CHECK_EQUAL(nCacheSize, 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+#include <omnicore/dbpropertyindex.h>
+
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_dbpropertyindex_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(property_index_cursor)
+{
+    CMPPropertyIndex index(GetDataDir() / "MP_propertyindex_cursor", true);
+
+    index.recordTransaction(3, 100, 2, uint256S("a1"), 50, 1000, true);
+    index.recordTransaction(3, 100, 7, uint256S("a2"), 0, 25, true);
+    index.recordTransaction(4, 100, 8, uint256S("a3"), 0, 5, false);
+    index.recordTransaction(3, 101, 1, uint256S("a4"), 0, 10, false);
+    index.recordTransaction(3, 205, 3, uint256S("a5"), 55, 500, true);
+
+    std::vector<CMPPropertyIndex::Entry> entries = index.getTransactions(3, 0, 0, 999999999, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 4U);
+    BOOST_CHECK(entries[0].txid == uint256S("a1"));
+    BOOST_CHECK_EQUAL(entries[0].propertyId, 3U);
+    BOOST_CHECK_EQUAL(entries[0].block, 100);
+    BOOST_CHECK_EQUAL(entries[0].position, 2U);
+    BOOST_CHECK_EQUAL(entries[0].type, 50U);
+    BOOST_CHECK_EQUAL(entries[0].amount, 1000U);
+    BOOST_CHECK(entries[0].fValid);
+    BOOST_CHECK(!entries[2].fValid);
+
+    // pages continue at the block and position of the next transaction
+    entries = index.getTransactions(3, 0, 0, 999999999, 2);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    entries = index.getTransactions(3, 100, 8, 999999999, 2);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(entries[0].txid == uint256S("a4"));
+    BOOST_CHECK(entries[1].txid == uint256S("a5"));
+
+    // block ranges
+    entries = index.getTransactions(3, 101, 0, 200, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].txid == uint256S("a4"));
+    BOOST_CHECK_EQUAL(index.getTransactions(4, 0, 0, 999999999, 10).size(), 1U);
+    BOOST_CHECK(index.getTransactions(5, 0, 0, 999999999, 10).empty());
+}
+
+BOOST_AUTO_TEST_CASE(property_index_rollback)
+{
+    CMPPropertyIndex index(GetDataDir() / "MP_propertyindex_rollback", true);
+    BOOST_CHECK_EQUAL(index.getStartBlock(), -1);
+    index.setStartBlock(50);
+    BOOST_CHECK_EQUAL(index.getStartBlock(), 50);
+
+    index.recordTransaction(3, 100, 1, uint256S("b1"), 0, 1, true);
+    index.recordTransaction(3, 101, 1, uint256S("b2"), 0, 2, true);
+    index.recordTransaction(4, 101, 2, uint256S("b3"), 0, 3, true);
+    index.recordTransaction(4, 102, 4, uint256S("b4"), 0, 4, true);
+
+    // the block and all following blocks are removed
+    BOOST_CHECK_EQUAL(index.deleteAboveBlock(101), 3);
+    std::vector<CMPPropertyIndex::Entry> entries = index.getTransactions(3, 0, 0, 999999999, 10);
+    BOOST_REQUIRE_EQUAL(entries.size(), 1U);
+    BOOST_CHECK(entries[0].txid == uint256S("b1"));
+    BOOST_CHECK(index.getTransactions(4, 0, 0, 999999999, 10).empty());
+    BOOST_CHECK_EQUAL(index.deleteAboveBlock(101), 0);
+    BOOST_CHECK_EQUAL(index.getStartBlock(), 50);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,368 @@
+#include <omnicore/dbspinfo.h>
+#include <omnicore/lrucache.h>
+#include <omnicore/omnicore.h>
+
+#include <clientversion.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+#include <leveldb/db.h>
+#include <leveldb/status.h>
+
+using namespace mastercore;
+
+/** SP database, which allows to write records, as if they were created by an earlier version. */
+class CLegacySPInfo : public CMPSPInfo
+{
+public:
+    CLegacySPInfo(const fs::path& path) : CMPSPInfo(path, true) {}
+
+    void recordLegacy(const CDataStream& ssKey, Entry info, History history)
+    {
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << LegacyEntry(info, history);
+        pdb->Put(writeoptions, std::string(ssKey.begin(), ssKey.end()), std::string(ssValue.begin(), ssValue.end()));
+    }
+
+    void eraseHeader(uint32_t propertyId)
+    {
+        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+        ssKey << std::make_pair('h', propertyId);
+        pdb->Delete(writeoptions, std::string(ssKey.begin(), ssKey.end()));
+    }
+};
+
+/** Database wrapper, which runs a callback after the next lookup to interleave a write with a read. */
+class CInterleavedDB : public leveldb::DB
+{
+private:
+    leveldb::DB* pbase;
+
+public:
+    //! Called once after the next lookup returned
+    std::function<void()> afterGet;
+
+    explicit CInterleavedDB(leveldb::DB* base) : pbase(base) {}
+
+    leveldb::DB* base() const { return pbase; }
+
+    leveldb::Status Put(const leveldb::WriteOptions& options, const leveldb::Slice& key, const leveldb::Slice& value) override
+    {
+        return pbase->Put(options, key, value);
+    }
+    leveldb::Status Delete(const leveldb::WriteOptions& options, const leveldb::Slice& key) override
+    {
+        return pbase->Delete(options, key);
+    }
+    leveldb::Status Write(const leveldb::WriteOptions& options, leveldb::WriteBatch* updates) override
+    {
+        return pbase->Write(options, updates);
+    }
+    leveldb::Status Get(const leveldb::ReadOptions& options, const leveldb::Slice& key, std::string* value) override
+    {
+        leveldb::Status status = pbase->Get(options, key, value);
+        if (afterGet) {
+            std::function<void()> callback;
+            callback.swap(afterGet);
+            callback();
+        }
+        return status;
+    }
+    leveldb::Iterator* NewIterator(const leveldb::ReadOptions& options) override
+    {
+        return pbase->NewIterator(options);
+    }
+    const leveldb::Snapshot* GetSnapshot() override { return pbase->GetSnapshot(); }
+    void ReleaseSnapshot(const leveldb::Snapshot* snapshot) override { pbase->ReleaseSnapshot(snapshot); }
+    bool GetProperty(const leveldb::Slice& property, std::string* value) override
+    {
+        return pbase->GetProperty(property, value);
+    }
+    void GetApproximateSizes(const leveldb::Range* range, int n, uint64_t* sizes) override
+    {
+        pbase->GetApproximateSizes(range, n, sizes);
+    }
+    void CompactRange(const leveldb::Slice* begin, const leveldb::Slice* end) override
+    {
+        pbase->CompactRange(begin, end);
+    }
+};
+
+/** SP database, which allows to run a write in the middle of a lookup. */
+class CInterleavedSPInfo : public CMPSPInfo
+{
+private:
+    CInterleavedDB* pinterleaved;
+
+public:
+    CInterleavedSPInfo(const fs::path& path) : CMPSPInfo(path, true)
+    {
+        pinterleaved = new CInterleavedDB(pdb);
+        pdb = pinterleaved;
+    }
+
+    ~CInterleavedSPInfo()
+    {
+        pdb = pinterleaved->base();
+        delete pinterleaved;
+    }
+
+    void afterNextRead(std::function<void()> callback)
+    {
+        pinterleaved->afterGet = callback;
+    }
+};
+
+static CMPSPInfo::Entry CreateEntry(const std::string& name, const std::string& issuer, const uint256& block)
+{
+    CMPSPInfo::Entry info;
+    info.issuer = issuer;
+    info.prop_type = MSC_PROPERTY_TYPE_DIVISIBLE;
+    info.name = name;
+    info.txid = uint256S("f1");
+    info.creation_block = block;
+    info.update_block = block;
+    return info;
+}
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_dbspinfo_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sp_headers_follow_updates)
+{
+    CMPSPInfo spinfo(GetDataDir() / "MP_spinfo_headers", true);
+    const uint256 block1 = uint256S("b1");
+    const uint256 block2 = uint256S("b2");
+
+    uint32_t propertyId = spinfo.putSP(1, CreateEntry("Alpha", "alice", block1));
+
+    CMPSPInfo::Header header;
+    BOOST_REQUIRE(spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(header.name, "Alpha");
+    BOOST_CHECK_EQUAL(header.issuer, "alice");
+    BOOST_CHECK(header.isDivisible());
+    BOOST_CHECK(!header.unique);
+
+    // the cached entry is replaced by an update
+    CMPSPInfo::Entry info;
+    BOOST_REQUIRE(spinfo.getSP(propertyId, info));
+    info.issuer = "bob";
+    info.update_block = block2;
+    BOOST_CHECK(spinfo.updateSP(propertyId, info));
+    BOOST_REQUIRE(spinfo.getSP(propertyId, info));
+    BOOST_CHECK_EQUAL(info.issuer, "bob");
+    BOOST_REQUIRE(spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(header.issuer, "bob");
+
+    // rolling back the update restores the previous header
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block2), 1);
+    BOOST_REQUIRE(spinfo.getSP(propertyId, info));
+    BOOST_CHECK_EQUAL(info.issuer, "alice");
+    BOOST_REQUIRE(spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(header.issuer, "alice");
+
+    // rolling back the creation removes the header
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block1), 1);
+    BOOST_CHECK(!spinfo.getSP(propertyId, info));
+    BOOST_CHECK(!spinfo.getHeader(propertyId, header));
+
+    // the implied properties have headers as well
+    BOOST_REQUIRE(spinfo.getHeader(OMNI_PROPERTY_MSC, header));
+    BOOST_CHECK_EQUAL(header.name, "Reserved");
+    BOOST_CHECK(header.isDivisible());
+}
+
+BOOST_AUTO_TEST_CASE(sp_cache_interleaved_update)
+{
+    CInterleavedSPInfo spinfo(GetDataDir() / "MP_spinfo_interleaved");
+    const uint256 block1 = uint256S("b1");
+    const uint256 block2 = uint256S("b2");
+    const uint256 block3 = uint256S("b3");
+
+    uint32_t propertyId = spinfo.putSP(1, CreateEntry("Alpha", "alice", block1));
+
+    // the update lands after the entry was read, but before it was cached
+    spinfo.afterNextRead([&spinfo, propertyId, block2]() {
+        BOOST_CHECK(spinfo.updateSP(propertyId, CreateEntry("Alpha", "bob", block2)));
+    });
+    CMPSPInfo::Entry info;
+    BOOST_REQUIRE(spinfo.getSP(propertyId, info));
+    BOOST_CHECK_EQUAL(info.issuer, "alice");
+    BOOST_REQUIRE(spinfo.getSP(propertyId, info));
+    BOOST_CHECK_EQUAL(info.issuer, "bob");
+
+    // the same applies to headers
+    spinfo.afterNextRead([&spinfo, propertyId, block3]() {
+        BOOST_CHECK(spinfo.updateSP(propertyId, CreateEntry("Alpha", "carol", block3)));
+    });
+    CMPSPInfo::Header header;
+    BOOST_REQUIRE(spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(header.issuer, "bob");
+    BOOST_REQUIRE(spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(header.issuer, "carol");
+    BOOST_REQUIRE(spinfo.getSP(propertyId, info));
+    BOOST_CHECK_EQUAL(info.issuer, "carol");
+}
+
+BOOST_AUTO_TEST_CASE(sp_headers_build)
+{
+    CLegacySPInfo spinfo(GetDataDir() / "MP_spinfo_headers_build");
+
+    uint32_t propertyId = spinfo.putSP(2, CreateEntry("Beta", "carol", uint256S("b3")));
+    spinfo.eraseHeader(propertyId);
+
+    CMPSPInfo::Header header;
+    BOOST_CHECK(!spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(spinfo.BuildHeaders(), 1);
+    BOOST_REQUIRE(spinfo.getHeader(propertyId, header));
+    BOOST_CHECK_EQUAL(header.name, "Beta");
+    BOOST_CHECK_EQUAL(header.issuer, "carol");
+}
+
+BOOST_AUTO_TEST_CASE(sp_touched_index)
+{
+    CMPSPInfo spinfo(GetDataDir() / "MP_spinfo_touched", true);
+    const uint256 block1 = uint256S("b1");
+    const uint256 block2 = uint256S("b2");
+    const uint256 block3 = uint256S("b3");
+
+    uint32_t propertyA = spinfo.putSP(1, CreateEntry("Alpha", "alice", block1));
+    CMPSPInfo::Entry infoB = CreateEntry("Beta", "bob", block1);
+    infoB.txid = uint256S("f2");
+    uint32_t propertyB = spinfo.putSP(1, infoB);
+
+    // the second update within a block is indexed once
+    CMPSPInfo::Entry info;
+    BOOST_REQUIRE(spinfo.getSP(propertyA, info));
+    info.update_block = block2;
+    info.num_tokens = 10;
+    BOOST_CHECK(spinfo.updateSP(propertyA, info));
+    info.num_tokens = 20;
+    BOOST_CHECK(spinfo.updateSP(propertyA, info));
+
+    // blocks without changes don't touch any property
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block3), 0);
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block2), 1);
+    BOOST_REQUIRE(spinfo.getSP(propertyA, info));
+    BOOST_CHECK(info.update_block == block1);
+    BOOST_CHECK(spinfo.hasSP(propertyB));
+
+    // a popped block is not rolled back twice
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block2), 0);
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block1), 2);
+    BOOST_CHECK(!spinfo.hasSP(propertyA));
+    BOOST_CHECK(!spinfo.hasSP(propertyB));
+}
+
+BOOST_AUTO_TEST_CASE(sp_history_undo)
+{
+    CMPSPInfo spinfo(GetDataDir() / "MP_spinfo_history", true);
+    const uint256 block1 = uint256S("b1");
+    const uint256 block2 = uint256S("b2");
+    const uint256 block3 = uint256S("b3");
+    const uint256 txid1 = uint256S("c1");
+    const uint256 txid2 = uint256S("c2");
+    const uint256 txid3 = uint256S("c3");
+
+    uint32_t propertyId = spinfo.putSP(1, CreateEntry("Gamma", "alice", block1));
+    BOOST_CHECK(spinfo.putHistory(propertyId, {{txid1, {100, 0}}}, block1));
+    BOOST_CHECK(spinfo.putHistory(propertyId, {{txid2, {50, 0}}}, block2));
+    BOOST_CHECK(spinfo.putHistory(propertyId, {{txid1, {100, 0}}, {txid2, {50, 5}}, {txid3, {0, 20}}}, block3));
+
+    CMPSPInfo::History history;
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK_EQUAL(history.size(), 3U);
+    std::vector<int64_t> record;
+    BOOST_REQUIRE(spinfo.getHistoryRecord(propertyId, txid2, record));
+    BOOST_CHECK_EQUAL(record.at(1), 5);
+    BOOST_CHECK(!spinfo.getHistoryRecord(propertyId + 1, txid2, record));
+
+    // changed records are restored, and new ones are removed
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block3), 0);
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK_EQUAL(history.size(), 2U);
+    BOOST_CHECK_EQUAL(history[txid2].at(1), 0);
+
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block2), 0);
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK_EQUAL(history.size(), 1U);
+
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block1), 1);
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK(history.empty());
+}
+
+BOOST_AUTO_TEST_CASE(sp_history_upgrade)
+{
+    CLegacySPInfo spinfo(GetDataDir() / "MP_spinfo_history_upgrade");
+    const uint256 block1 = uint256S("b1");
+    const uint256 block2 = uint256S("b2");
+    const uint256 txid1 = uint256S("c1");
+    const uint256 txid2 = uint256S("c2");
+    const uint32_t propertyId = 7;
+
+    // the entry was created with one grant, and a second one was added later
+    CMPSPInfo::Entry info = CreateEntry("Delta", "dave", block1);
+    CDataStream ssPrevKey(SER_DISK, CLIENT_VERSION);
+    ssPrevKey << 'b' << block2 << propertyId;
+    spinfo.recordLegacy(ssPrevKey, info, {{txid1, {100, 0}}});
+    info.update_block = block2;
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+    ssKey << std::make_pair('s', propertyId);
+    spinfo.recordLegacy(ssKey, info, {{txid1, {100, 0}}, {txid2, {0, 30}}});
+
+    BOOST_CHECK_EQUAL(spinfo.UpgradeHistory(), 2);
+    BOOST_CHECK_EQUAL(spinfo.BuildTouchedIndex(), 2);
+    BOOST_CHECK(spinfo.getSP(propertyId, info));
+    BOOST_CHECK_EQUAL(info.name, "Delta");
+    CMPSPInfo::History history;
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK_EQUAL(history.size(), 2U);
+
+    // the previous entries are converted, and the changes of each block can be reverted
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block2), 1);
+    BOOST_CHECK(spinfo.getSP(propertyId, info));
+    BOOST_CHECK(info.update_block == block1);
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK_EQUAL(history.size(), 1U);
+    BOOST_CHECK_EQUAL(spinfo.popBlock(block1), 1);
+    BOOST_CHECK(spinfo.getHistory(propertyId, history));
+    BOOST_CHECK(history.empty());
+}
+
+BOOST_AUTO_TEST_CASE(lru_cache_eviction)
+{
+    CMPLruCache<uint32_t, std::string> cache(2);
+    std::string value;
+
+    cache.put(1, "one");
+    cache.put(2, "two");
+    BOOST_CHECK(cache.get(1, value));
+    BOOST_CHECK_EQUAL(value, "one");
+
+    // the least recently used entry is evicted
+    cache.put(3, "three");
+    BOOST_CHECK_EQUAL(cache.size(), 2U);
+    BOOST_CHECK(!cache.get(2, value));
+    BOOST_CHECK(cache.get(1, value));
+    BOOST_CHECK(cache.get(3, value));
+
+    cache.put(3, "drei");
+    BOOST_CHECK(cache.get(3, value));
+    BOOST_CHECK_EQUAL(value, "drei");
+
+    cache.erase(1);
+    BOOST_CHECK(!cache.get(1, value));
+    cache.clear();
+    BOOST_CHECK_EQUAL(cache.size(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,105 @@
+#include <omnicore/dbstolist.h>
+
+#include <clientversion.h>
+#include <serialize.h>
+#include <streams.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+
+#include <leveldb/db.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+/** STO list, which allows to write records in the formats, which stored all receipts of an address in one value. */
+class CLegacySTOList : public CMPSTOList
+{
+public:
+    CLegacySTOList(const fs::path& path) : CMPSTOList(path, true) {}
+
+    void recordLegacy(const std::string& key, const std::string& value)
+    {
+        pdb->Put(writeoptions, key, value);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_dbstolist_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(sto_receipts)
+{
+    CMPSTOList stolist(GetDataDir() / "MP_stolist_receipts", true);
+
+    stolist.recordSTOReceive("alice", uint256S("c2"), 301, 4, 5000000000LL);
+    stolist.recordSTOReceive("alice", uint256S("c1"), 300, 3, 100);
+    stolist.recordSTOReceive("bob", uint256S("c1"), 300, 3, 50);
+    stolist.recordSTOReceive("alice2", uint256S("c3"), 302, 3, 1);
+
+    // receipts of an address are ordered by block, and addresses sharing a prefix are kept apart
+    std::vector<CMPSTOList::Receipt> receipts = stolist.getReceipts("alice");
+    BOOST_REQUIRE_EQUAL(receipts.size(), 2U);
+    BOOST_CHECK(receipts[0].txid == uint256S("c1"));
+    BOOST_CHECK(receipts[1].txid == uint256S("c2"));
+    BOOST_CHECK_EQUAL(receipts[1].block, 301);
+    BOOST_CHECK_EQUAL(receipts[1].propertyId, 4U);
+    BOOST_CHECK_EQUAL(receipts[1].amount, 5000000000ULL);
+    BOOST_CHECK_EQUAL(receipts[1].address, "alice");
+    BOOST_CHECK(stolist.getReceipts("carol").empty());
+    BOOST_CHECK(stolist.exists("alice2"));
+    BOOST_CHECK(!stolist.exists("alic"));
+
+    receipts = stolist.getTransactionReceipts(uint256S("c1"));
+    BOOST_REQUIRE_EQUAL(receipts.size(), 2U);
+    BOOST_CHECK_EQUAL(receipts[0].address, "alice");
+    BOOST_CHECK_EQUAL(receipts[1].address, "bob");
+    BOOST_CHECK_EQUAL(receipts[1].amount, 50U);
+    BOOST_CHECK_EQUAL(receipts[1].block, 300);
+
+    // receipts at and above the block are removed
+    BOOST_CHECK_EQUAL(stolist.deleteAboveBlock(301), 2);
+    BOOST_CHECK_EQUAL(stolist.getReceipts("alice").size(), 1U);
+    BOOST_CHECK_EQUAL(stolist.getReceipts("bob").size(), 1U);
+    BOOST_CHECK(!stolist.exists("alice2"));
+    BOOST_CHECK(stolist.getTransactionReceipts(uint256S("c2")).empty());
+    BOOST_CHECK_EQUAL(stolist.deleteAboveBlock(301), 0);
+}
+
+BOOST_AUTO_TEST_CASE(sto_record_format_upgrade)
+{
+    CLegacySTOList stolist(GetDataDir() / "MP_stolist_upgrade");
+
+    const std::string txid1 = uint256S("d1").ToString();
+    const std::string txid2 = uint256S("d2").ToString();
+    stolist.recordLegacy("alice", txid1 + ":400:3:100," + txid2 + ":401:2147483651:7,");
+
+    // version 11 concatenated the serialized receipts, prefixed with the record format
+    CMPSTOList::Receipt receipt;
+    receipt.block = 400;
+    receipt.propertyId = 3;
+    receipt.amount = 50;
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << DB_RECORD_FORMAT << uint256S("d1") << receipt;
+    stolist.recordLegacy("bob", std::string(ssValue.begin(), ssValue.end()));
+
+    BOOST_CHECK_EQUAL(stolist.UpgradeRecordFormat(), 3);
+    BOOST_CHECK_EQUAL(stolist.UpgradeRecordFormat(), 0);
+
+    std::vector<CMPSTOList::Receipt> receipts = stolist.getReceipts("alice");
+    BOOST_REQUIRE_EQUAL(receipts.size(), 2U);
+    BOOST_CHECK(receipts[1].txid == uint256S("d2"));
+    BOOST_CHECK_EQUAL(receipts[1].block, 401);
+    BOOST_CHECK_EQUAL(receipts[1].propertyId, 2147483651U);
+    BOOST_CHECK_EQUAL(receipts[1].amount, 7U);
+
+    receipts = stolist.getTransactionReceipts(uint256S("d1"));
+    BOOST_REQUIRE_EQUAL(receipts.size(), 2U);
+    BOOST_CHECK_EQUAL(receipts[1].address, "bob");
+    BOOST_CHECK_EQUAL(receipts[1].amount, 50U);
+
+    stolist.recordSTOReceive("bob", uint256S("d3"), 402, 3, 1);
+    BOOST_CHECK_EQUAL(stolist.getReceipts("bob").size(), 2U);
+    BOOST_CHECK_EQUAL(stolist.deleteAboveBlock(401), 2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
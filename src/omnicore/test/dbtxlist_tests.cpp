@@ -0,0 +1,136 @@
+#include <omnicore/dbtxlist.h>
+#include <omnicore/omnicore.h>
+
+#include <test/test_bitcoin.h>
+#include <tinyformat.h>
+#include <uint256.h>
+
+#include <leveldb/db.h>
+
+#include <set>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+/** Transaction list, which allows to write records in the format before the height index existed. */
+class CLegacyTxList : public CMPTxList
+{
+public:
+    CLegacyTxList(const fs::path& path) : CMPTxList(path, true) {}
+
+    void recordLegacy(const std::string& key, const std::string& value)
+    {
+        pdb->Put(writeoptions, key, value);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_dbtxlist_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(height_index_range)
+{
+    CMPTxList txlist(GetDataDir() / "MP_txlist_range", true);
+
+    txlist.recordTX(uint256S("a1"), true, 100, MSC_TYPE_SIMPLE_SEND, 0);
+    txlist.recordTX(uint256S("a2"), false, 100, MSC_TYPE_SIMPLE_SEND, 0);
+    txlist.recordTX(uint256S("a3"), true, 101, MSC_TYPE_SIMPLE_SEND, 0);
+    txlist.recordTX(uint256S("a4"), true, 105, MSC_TYPE_FREEZE_PROPERTY_TOKENS, 0);
+    txlist.recordTX(uint256S("a5"), true, 1000, MSC_TYPE_SIMPLE_SEND, 0);
+    txlist.recordSendAllSubRecord(uint256S("a5"), 1, 3, 50);
+    txlist.setDBVersion();
+
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountTotal(), 5);
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountBlock(100), 2);
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountBlock(102), 0);
+
+    std::set<uint256> txs;
+    BOOST_CHECK_EQUAL(txlist.GetOmniTxsInBlockRange(101, 999, txs), 2);
+    BOOST_CHECK(txs.count(uint256S("a3")) && txs.count(uint256S("a4")));
+
+    std::vector<CMPTxList::HeightIndexEntry> entries;
+    txlist.GetHeightIndexEntries(0, 1000, entries);
+    BOOST_REQUIRE_EQUAL(entries.size(), 5U);
+    BOOST_CHECK_EQUAL(entries[1].block, 100);
+    BOOST_CHECK(!entries[1].fValid);
+    BOOST_CHECK_EQUAL(entries[3].type, (unsigned int) MSC_TYPE_FREEZE_PROPERTY_TOKENS);
+    BOOST_CHECK_EQUAL(entries[4].block, 1000);
+
+    BOOST_CHECK(txlist.CheckForFreezeTxs(105));
+    BOOST_CHECK(!txlist.CheckForFreezeTxs(106));
+
+    // blocks at and above 101 are removed, including sub records
+    BOOST_CHECK(txlist.isMPinBlockRange(101, 1000, false));
+    BOOST_CHECK(txlist.exists(uint256S("a3")));
+    BOOST_CHECK(txlist.isMPinBlockRange(101, 1000, true));
+    BOOST_CHECK(!txlist.isMPinBlockRange(101, 1000, false));
+    BOOST_CHECK(!txlist.exists(uint256S("a3")));
+    BOOST_CHECK(txlist.getKeyValue(uint256S("a5").ToString() + "-1").empty());
+    BOOST_CHECK(!txlist.CheckForFreezeTxs(0));
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountTotal(), 2);
+    BOOST_CHECK_EQUAL(txlist.getDBVersion(), DB_VERSION);
+
+    // a transaction recorded again moves to the new block
+    txlist.recordTX(uint256S("a2"), true, 102, MSC_TYPE_SIMPLE_SEND, 0);
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountBlock(100), 1);
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountBlock(102), 1);
+}
+
+BOOST_AUTO_TEST_CASE(record_format_upgrade)
+{
+    CLegacyTxList txlist(GetDataDir() / "MP_txlist_upgrade");
+
+    const std::string txid1 = uint256S("b1").ToString();
+    const std::string txid2 = uint256S("b2").ToString();
+    const std::string txid3 = uint256S("b3").ToString();
+    txlist.recordLegacy(txid1, "1:200:4:1");
+    txlist.recordLegacy(txid1 + "-1", "3:50");
+    txlist.recordLegacy(txid2, "0:201:185:0");
+    txlist.recordLegacy(txid3, "1:201:99999999:1");
+    txlist.recordLegacy(txid3 + "-1", "2:buyer:seller:1:2500");
+    txlist.recordLegacy(txid3 + "-UG", "11-20");
+    txlist.recordLegacy("h0000000201" + txid2, "0:185");
+    BOOST_CHECK(!txlist.getValidMPTX(uint256S("b1")));
+
+    BOOST_CHECK_EQUAL(txlist.UpgradeRecordFormat(), 6);
+    BOOST_CHECK_EQUAL(txlist.UpgradeRecordFormat(), 0);
+    BOOST_CHECK_EQUAL(txlist.BuildHeightIndex(), 3);
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountBlock(200), 1);
+    BOOST_CHECK_EQUAL(txlist.getMPTransactionCountBlock(201), 2);
+    BOOST_CHECK(txlist.CheckForFreezeTxs(201));
+
+    int block = 0;
+    unsigned int type = 0;
+    uint64_t nValue = 0;
+    BOOST_CHECK(txlist.getValidMPTX(uint256S("b1"), &block, &type, &nValue));
+    BOOST_CHECK_EQUAL(block, 200);
+    BOOST_CHECK_EQUAL(type, 4U);
+    BOOST_CHECK_EQUAL(nValue, 1U);
+    BOOST_CHECK_EQUAL(txlist.getNumberOfSubRecords(uint256S("b1")), 1);
+
+    uint32_t propertyId = 0;
+    int64_t amount = 0;
+    BOOST_CHECK(txlist.getSendAllDetails(uint256S("b1"), 1, propertyId, amount));
+    BOOST_CHECK_EQUAL(propertyId, 3U);
+    BOOST_CHECK_EQUAL(amount, 50);
+
+    std::string buyer, seller;
+    uint64_t vout = 0, paymentPropertyId = 0, paymentValue = 0;
+    BOOST_CHECK(txlist.getPurchaseDetails(uint256S("b3"), 1, &buyer, &seller, &vout, &paymentPropertyId, &paymentValue));
+    BOOST_CHECK_EQUAL(buyer, "buyer");
+    BOOST_CHECK_EQUAL(seller, "seller");
+    BOOST_CHECK_EQUAL(vout, 2U);
+    BOOST_CHECK_EQUAL(paymentPropertyId, 1U);
+    BOOST_CHECK_EQUAL(paymentValue, 2500U);
+    BOOST_CHECK(txlist.GetNonFungibleGrant(uint256S("b3")) == std::make_pair(int64_t(11), int64_t(20)));
+
+    std::vector<CMPTxList::HeightIndexEntry> entries;
+    txlist.GetHeightIndexEntries(201, 201, entries);
+    BOOST_REQUIRE_EQUAL(entries.size(), 2U);
+    BOOST_CHECK(entries[0].txid == uint256S("b2"));
+    BOOST_CHECK(!entries[0].fValid);
+    BOOST_CHECK_EQUAL(entries[1].type, 99999999U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,255 @@
+#include <omnicore/dbspinfo.h>
+#include <omnicore/dex.h>
+#include <omnicore/journal.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/persistence.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <chain.h>
+#include <fs.h>
+#include <hash.h>
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <tinyformat.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+/** Copy of the in-memory state, which is covered by the journal. */
+struct JournaledState
+{
+    //! Non-zero balances, excluding pending amounts, which are not part of the consensus state
+    std::map<CMPBlockDelta::TallyKey, int64_t> balances;
+    OfferMap offers;
+    AcceptMap accepts;
+    CrowdMap crowds;
+    bool fFrozen;
+    uint32_t nextSPID;
+
+    JournaledState()
+      : offers(my_offers), accepts(my_accepts), crowds(my_crowds),
+        fFrozen(isAddressFrozen("bob", 3)), nextSPID(pDbSpInfo->peekNextSPID(1))
+    {
+        for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+            CMPTally& tally = it->second;
+            tally.init();
+            uint32_t propertyId = 0;
+            while (0 != (propertyId = tally.next())) {
+                for (uint8_t ttype = BALANCE; ttype < PENDING; ++ttype) {
+                    int64_t amount = tally.getMoney(propertyId, static_cast<TallyType>(ttype));
+                    if (amount != 0) {
+                        balances[std::make_pair(it->first, std::make_pair(propertyId, ttype))] = amount;
+                    }
+                }
+            }
+        }
+    }
+
+    bool operator==(const JournaledState& other) const
+    {
+        return balances == other.balances
+                && SerializeHash(offers) == SerializeHash(other.offers)
+                && SerializeHash(accepts) == SerializeHash(other.accepts)
+                && SerializeHash(crowds) == SerializeHash(other.crowds)
+                && fFrozen == other.fFrozen
+                && nextSPID == other.nextSPID;
+    }
+};
+
+/** Provides a temporary SP database and a chain of fake blocks, and clears the in-memory state afterwards. */
+struct JournalTestingSetup : public BasicTestingSetup
+{
+    CMPSPInfo* pDbSpInfoPrev;
+    std::vector<uint256> blockHashes;
+    std::vector<CBlockIndex> blocks;
+
+    JournalTestingSetup() : pDbSpInfoPrev(pDbSpInfo), blockHashes(4), blocks(4)
+    {
+        pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_journal", true);
+        for (size_t n = 0; n < blocks.size(); ++n) {
+            blockHashes[n] = uint256S(strprintf("%x", 0xb0 + n));
+            blocks[n].phashBlock = &blockHashes[n];
+            blocks[n].nHeight = 100 + n;
+            blocks[n].pprev = (n > 0) ? &blocks[n - 1] : nullptr;
+        }
+        ClearJournal();
+    }
+
+    ~JournalTestingSetup()
+    {
+        LOCK(cs_tally);
+        ClearJournal();
+        ClearFreezeState();
+        mp_tally_map.clear();
+        my_offers.clear();
+        my_accepts.clear();
+        my_crowds.clear();
+        delete pDbSpInfo;
+        pDbSpInfo = pDbSpInfoPrev;
+    }
+
+    /** Changes balances, DEx offers and accepts, crowdsales and the freeze state. */
+    void ConnectBlock(size_t n)
+    {
+        const std::string keyOffer = STR_SELLOFFER_ADDR_PROP_COMBO("alice", 3);
+        const std::string keyAccept = STR_ACCEPT_ADDR_PROP_ADDR_COMBO("alice", "dave", 3);
+
+        JournalBlockBegin(&blocks[n]);
+        switch (n) {
+            case 1:
+                BOOST_CHECK(update_tally_map("alice", 3, -40, BALANCE));
+                BOOST_CHECK(update_tally_map("alice", 3, 40, SELLOFFER_RESERVE));
+                BOOST_CHECK(update_tally_map("bob", 3, 7, PENDING));
+                JournalOfferChange(keyOffer);
+                my_offers.insert(std::make_pair(keyOffer, CMPOffer(blocks[n].nHeight, 40, 3, 2000, 1000, 10, uint256S("f1"))));
+                JournalCrowdChange("carol");
+                my_crowds.erase("carol");
+                freezeAddress("bob", 3);
+                pDbSpInfo->init(pDbSpInfo->peekNextSPID(1) + 1, pDbSpInfo->peekNextSPID(2));
+                break;
+            case 2:
+                BOOST_CHECK(update_tally_map("alice", 3, -15, SELLOFFER_RESERVE));
+                BOOST_CHECK(update_tally_map("alice", 3, 15, ACCEPT_RESERVE));
+                BOOST_CHECK(!update_tally_map("dave", 3, -1, BALANCE));
+                JournalOfferChange(keyOffer);
+                my_offers.erase(keyOffer);
+                JournalOfferChange(keyOffer);
+                my_offers.insert(std::make_pair(keyOffer, CMPOffer(blocks[n].nHeight, 25, 3, 1250, 1000, 10, uint256S("f2"))));
+                JournalAcceptChange(keyAccept);
+                my_accepts.insert(std::make_pair(keyAccept, CMPAccept(15, 15, blocks[n].nHeight, 10, 3, 40, 2000, uint256S("f1"))));
+                JournalCrowdChange("erin");
+                my_crowds.insert(std::make_pair("erin", CMPCrowd(4, 100, 1, 1500000000, 6, 10, 0, 0)));
+                unfreezeAddress("bob", 3);
+                BOOST_CHECK(update_tally_map("bob", 3, -25, BALANCE));
+                break;
+            case 3:
+                BOOST_CHECK(update_tally_map("alice", 3, -15, ACCEPT_RESERVE));
+                BOOST_CHECK(update_tally_map("dave", 3, 15, BALANCE));
+                JournalAcceptChange(keyAccept);
+                my_accepts.erase(keyAccept);
+                JournalCrowdChange("erin");
+                getCrowd("erin")->incTokensUserCreated(5);
+                break;
+        }
+        JournalBlockEnd(&blocks[n]);
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_journal_tests, JournalTestingSetup)
+
+BOOST_AUTO_TEST_CASE(journal_undo_redo)
+{
+    LOCK(cs_tally);
+    BOOST_CHECK(update_tally_map("alice", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", 3, 50, BALANCE));
+    my_crowds.insert(std::make_pair("carol", CMPCrowd(3, 100, 1, 1500000000, 6, 10, 200, 20)));
+    enableFreezing(3, 0);
+
+    std::vector<JournaledState> states;
+    states.push_back(JournaledState());
+    for (size_t n = 1; n < blocks.size(); ++n) {
+        ConnectBlock(n);
+        states.push_back(JournaledState());
+        BOOST_CHECK(!(states[n] == states[n - 1]));
+    }
+
+    // revert and reapply each block individually
+    for (size_t n = blocks.size() - 1; n > 0; --n) {
+        const CMPBlockDelta* pDelta = GetBlockDelta(blockHashes[n]);
+        BOOST_REQUIRE(pDelta != nullptr);
+        BOOST_CHECK(pDelta->prevBlockHash == blockHashes[n - 1]);
+        ApplyBlockDelta(*pDelta, true);
+        BOOST_CHECK(JournaledState() == states[n - 1]);
+    }
+    for (size_t n = 1; n < blocks.size(); ++n) {
+        ApplyBlockDelta(*GetBlockDelta(blockHashes[n]), false);
+        BOOST_CHECK(JournaledState() == states[n]);
+    }
+
+    // pending amounts and failed updates are not recorded
+    BOOST_CHECK_EQUAL(GetBlockDelta(blockHashes[1])->tally.count(std::make_pair(std::string("bob"), std::make_pair(3U, (uint8_t) PENDING))), 0U);
+    BOOST_CHECK_EQUAL(GetBlockDelta(blockHashes[2])->tally.count(std::make_pair(std::string("dave"), std::make_pair(3U, (uint8_t) BALANCE))), 0U);
+    BOOST_CHECK_EQUAL(GetBlockDelta(blockHashes[2])->tally.at(std::make_pair(std::string("bob"), std::make_pair(3U, (uint8_t) BALANCE))), -25);
+
+    // only the changed entries are recorded, and a modified entry is both removed and added
+    const CMPBlockDelta* pDelta = GetBlockDelta(blockHashes[2]);
+    BOOST_CHECK_EQUAL(pDelta->offersRemoved.size(), 1U);
+    BOOST_CHECK_EQUAL(pDelta->offersAdded.size(), 1U);
+    BOOST_CHECK_EQUAL(pDelta->acceptsAdded.size(), 1U);
+    BOOST_CHECK_EQUAL(pDelta->crowdsAdded.size(), 1U);
+    BOOST_CHECK(pDelta->crowdsRemoved.empty());
+    BOOST_CHECK_EQUAL(pDelta->frozenRemoved.size(), 1U);
+    pDelta = GetBlockDelta(blockHashes[3]);
+    BOOST_CHECK(pDelta->offersRemoved.empty() && pDelta->offersAdded.empty());
+    BOOST_CHECK_EQUAL(pDelta->acceptsRemoved.size(), 1U);
+    BOOST_CHECK(pDelta->acceptsAdded.empty());
+    BOOST_CHECK_EQUAL(pDelta->crowdsRemoved.size(), 1U);
+    BOOST_CHECK_EQUAL(pDelta->crowdsAdded.size(), 1U);
+    BOOST_CHECK(pDelta->frozenRemoved.empty() && pDelta->frozenAdded.empty());
+}
+
+BOOST_AUTO_TEST_CASE(journal_rewind)
+{
+    LOCK(cs_tally);
+    BOOST_CHECK(update_tally_map("alice", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", 3, 50, BALANCE));
+    enableFreezing(3, 0);
+
+    std::vector<JournaledState> states;
+    states.push_back(JournaledState());
+    for (size_t n = 1; n < blocks.size(); ++n) {
+        ConnectBlock(n);
+        states.push_back(JournaledState());
+    }
+
+    // blocks before the journal can't be reverted
+    BOOST_CHECK(!RewindJournal(blocks[0].nHeight));
+    BOOST_CHECK(!RewindJournal(blocks[3].nHeight + 1));
+
+    BOOST_CHECK(RewindJournal(blocks[2].nHeight));
+    BOOST_CHECK(JournaledState() == states[1]);
+    BOOST_CHECK(GetBlockDelta(blockHashes[3]) == nullptr);
+    BOOST_CHECK(GetBlockDelta(blockHashes[1]) != nullptr);
+
+    // a block, which doesn't connect to the journal, replaces it
+    JournalBlockBegin(&blocks[3]);
+    JournalBlockEnd(&blocks[3]);
+    BOOST_CHECK(GetBlockDelta(blockHashes[1]) == nullptr);
+    BOOST_CHECK(!RewindJournal(blocks[1].nHeight));
+}
+
+BOOST_AUTO_TEST_CASE(delta_file_roundtrip)
+{
+    LOCK(cs_tally);
+    const fs::path path = GetDataDir() / "delta-roundtrip.dat";
+    BOOST_CHECK(update_tally_map("alice", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", 3, 50, BALANCE));
+    my_crowds.insert(std::make_pair("carol", CMPCrowd(3, 100, 1, 1500000000, 6, 10, 200, 20)));
+    enableFreezing(3, 0);
+    ConnectBlock(1);
+
+    const CMPBlockDelta* pDelta = GetBlockDelta(blockHashes[1]);
+    BOOST_REQUIRE(pDelta != nullptr);
+    BOOST_CHECK_EQUAL(WriteStateDelta(path, *pDelta), 0);
+
+    CMPBlockDelta delta;
+    BOOST_CHECK_EQUAL(ReadStateDelta(path, blockHashes[1], delta), 0);
+    BOOST_CHECK(SerializeHash(delta) == SerializeHash(*pDelta));
+    BOOST_CHECK_EQUAL(delta.size(), pDelta->size());
+    BOOST_CHECK_EQUAL(delta.crowdsRemoved.size(), 1U);
+    BOOST_CHECK_EQUAL(delta.frozenAdded.size(), 1U);
+
+    // the delta belongs to another block
+    BOOST_CHECK_EQUAL(ReadStateDelta(path, blockHashes[2], delta), -1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -1,6 +1,7 @@
 #include <omnicore/parsing.h>
 
 #include <test/test_bitcoin.h>
+#include <util/strencodings.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -26,4 +27,23 @@ BOOST_AUTO_TEST_CASE(prepare_obfuscated_hashes)
 }
 
 
+BOOST_AUTO_TEST_CASE(prepare_obfuscated_hashes_binary)
+{
+    std::string strSeed("1CdighsfdfRcj4ytQSskZgQXbUEamuMUNF");
+    std::string vstrObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES];
+    PrepareObfuscatedHashes(strSeed, MAX_SHA256_OBFUSCATION_TIMES, vstrObfuscatedHashes);
+    unsigned char vchObfuscatedHashes[1+MAX_SHA256_OBFUSCATION_TIMES][OBFUSCATION_HASH_SIZE];
+    PrepareObfuscatedHashes(strSeed, MAX_SHA256_OBFUSCATION_TIMES, vchObfuscatedHashes);
+
+    BOOST_CHECK_EQUAL(HexStr(vchObfuscatedHashes[1], vchObfuscatedHashes[1] + OBFUSCATION_HASH_SIZE),
+            "1d9a3de5c2e22bf89a1e41e6fedab54582f8a0c3ae14394a59366293dd130c59");
+    BOOST_CHECK_EQUAL(HexStr(vchObfuscatedHashes[4], vchObfuscatedHashes[4] + OBFUSCATION_HASH_SIZE),
+            "aa3f890d32864bea31ee9bd57d2247d8f8ce07b5abaed9372f0b8999d28db963");
+
+    // the whole chain matches the hashes derived from the hex strings
+    for (int j = 1; j <= MAX_SHA256_OBFUSCATION_TIMES; ++j) {
+        BOOST_CHECK(ParseHex(vstrObfuscatedHashes[j]) == std::vector<unsigned char>(vchObfuscatedHashes[j], vchObfuscatedHashes[j] + OBFUSCATION_HASH_SIZE));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,205 @@
+#include <omnicore/dbspinfo.h>
+#include <omnicore/dex.h>
+#include <omnicore/journal.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/persistence.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <chain.h>
+#include <fs.h>
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <uint256.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+//! Path for file based persistence
+extern fs::path pathStateFiles;
+
+/** Provides a temporary SP database, and clears the in-memory state afterwards. */
+struct PersistenceTestingSetup : public BasicTestingSetup
+{
+    CMPSPInfo* pDbSpInfoPrev;
+
+    PersistenceTestingSetup() : pDbSpInfoPrev(pDbSpInfo)
+    {
+        pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_persistence", true);
+    }
+
+    ~PersistenceTestingSetup()
+    {
+        LOCK(cs_tally);
+        mp_tally_map.clear();
+        my_offers.clear();
+        my_accepts.clear();
+        my_crowds.clear();
+        delete pDbSpInfo;
+        pDbSpInfo = pDbSpInfoPrev;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_persistence_tests, PersistenceTestingSetup)
+
+BOOST_AUTO_TEST_CASE(snapshot_roundtrip)
+{
+    LOCK(cs_tally);
+    const uint256 blockHash = uint256S("a1");
+    const fs::path path = GetDataDir() / "snapshot-roundtrip.dat";
+
+    mp_tally_map.clear();
+    BOOST_CHECK(update_tally_map("alice", 1, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("alice", 1, 50, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("alice", 7, 3, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", 1, 25, ACCEPT_RESERVE));
+    BOOST_CHECK(update_tally_map("bob", 7, 10, PENDING));
+    BOOST_CHECK(update_tally_map("carol", 1, 5, BALANCE));
+    BOOST_CHECK(update_tally_map("carol", 1, -5, BALANCE));
+
+    my_offers.insert(std::make_pair(STR_SELLOFFER_ADDR_PROP_COMBO("alice", 1),
+            CMPOffer(10, 50, 1, 2000, 1000, 10, uint256S("b1"))));
+    my_accepts.insert(std::make_pair(STR_ACCEPT_ADDR_PROP_ADDR_COMBO("alice", "bob", 1),
+            CMPAccept(30, 25, 11, 10, 1, 50, 2000, uint256S("b1"))));
+    CMPCrowd crowd(8, 100, 1, 1500000000, 6, 10, 200, 20);
+    crowd.insertDatabase(uint256S("c1"), std::vector<int64_t>{100, 1500000000, 200, 20});
+    my_crowds.insert(std::make_pair("dave", crowd));
+    pDbSpInfo->init(9, TEST_ECO_PROPERTY_1 + 2);
+
+    BOOST_CHECK_EQUAL(WriteStateSnapshot(path, blockHash), 0);
+
+    std::map<std::string, CMPTally> tallies(mp_tally_map.begin(), mp_tally_map.end());
+    mp_tally_map.clear();
+    my_offers.clear();
+    my_accepts.clear();
+    my_crowds.clear();
+    pDbSpInfo->init();
+
+    BOOST_CHECK_EQUAL(RestoreStateSnapshot(path, blockHash, true), 0);
+
+    // empty balances and the pending tally are not persisted
+    BOOST_CHECK_EQUAL(mp_tally_map.size(), 2U);
+    BOOST_CHECK(mp_tally_map.find("alice")->second == tallies["alice"]);
+    BOOST_CHECK_EQUAL(GetTokenBalance("bob", 1, ACCEPT_RESERVE), 25);
+    BOOST_CHECK_EQUAL(GetTokenBalance("bob", 7, PENDING), 0);
+    BOOST_CHECK_EQUAL(mp_tally_map.getTotalTokens(1), 175);
+
+    BOOST_CHECK_EQUAL(my_offers.size(), 1U);
+    const CMPOffer& offer = my_offers.begin()->second;
+    BOOST_CHECK_EQUAL(my_offers.begin()->first, STR_SELLOFFER_ADDR_PROP_COMBO("alice", 1));
+    BOOST_CHECK_EQUAL(offer.getOfferAmountOriginal(), 50);
+    BOOST_CHECK_EQUAL(offer.getBTCDesiredOriginal(), 2000);
+    BOOST_CHECK_EQUAL(offer.getMinFee(), 1000);
+    BOOST_CHECK_EQUAL(offer.getBlockTimeLimit(), 10);
+    BOOST_CHECK(offer.getHash() == uint256S("b1"));
+
+    BOOST_CHECK_EQUAL(my_accepts.size(), 1U);
+    const CMPAccept& accept = my_accepts.begin()->second;
+    BOOST_CHECK_EQUAL(my_accepts.begin()->first, STR_ACCEPT_ADDR_PROP_ADDR_COMBO("alice", "bob", 1));
+    BOOST_CHECK_EQUAL(accept.getAcceptAmount(), 30);
+    BOOST_CHECK_EQUAL(accept.getAcceptAmountRemaining(), 25);
+    BOOST_CHECK_EQUAL(accept.getAcceptBlock(), 11);
+
+    BOOST_CHECK_EQUAL(my_crowds.size(), 1U);
+    const CMPCrowd& restoredCrowd = my_crowds.begin()->second;
+    BOOST_CHECK_EQUAL(restoredCrowd.getPropertyId(), 8U);
+    BOOST_CHECK_EQUAL(restoredCrowd.getUserCreated(), 200);
+    BOOST_CHECK_EQUAL(restoredCrowd.getIssuerCreated(), 20);
+    BOOST_CHECK(restoredCrowd.getDatabase() == crowd.getDatabase());
+
+    BOOST_CHECK_EQUAL(pDbSpInfo->peekNextSPID(1), 9U);
+    BOOST_CHECK_EQUAL(pDbSpInfo->peekNextSPID(2), TEST_ECO_PROPERTY_1 + 2);
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_invalid)
+{
+    LOCK(cs_tally);
+    const uint256 blockHash = uint256S("a2");
+    const fs::path path = GetDataDir() / "snapshot-invalid.dat";
+
+    mp_tally_map.clear();
+    BOOST_CHECK(update_tally_map("alice", 1, 100, BALANCE));
+    BOOST_CHECK_EQUAL(WriteStateSnapshot(path, blockHash), 0);
+
+    // the snapshot belongs to another block
+    BOOST_CHECK_EQUAL(RestoreStateSnapshot(path, uint256S("a3"), true), -1);
+    BOOST_CHECK_EQUAL(RestoreStateSnapshot(GetDataDir() / "snapshot-missing.dat", blockHash, true), -1);
+
+    // flip a bit of the balance
+    FILE* file = fsbridge::fopen(path, "rb+");
+    BOOST_REQUIRE(file);
+    BOOST_CHECK_EQUAL(fseek(file, -40, SEEK_END), 0);
+    int c = fgetc(file);
+    BOOST_CHECK_EQUAL(fseek(file, -40, SEEK_END), 0);
+    fputc(c ^ 0x01, file);
+    fclose(file);
+
+    BOOST_CHECK_EQUAL(RestoreStateSnapshot(path, blockHash, true), -1);
+}
+
+BOOST_AUTO_TEST_CASE(persist_in_background)
+{
+    const fs::path pathStateFilesPrev = pathStateFiles;
+    pathStateFiles = GetDataDir() / "MP_persist_background";
+    TryCreateDirectories(pathStateFiles);
+
+    std::vector<uint256> blockHashes{uint256S("d0"), uint256S("d1")};
+    std::vector<CBlockIndex> blocks(2);
+    LOCK2(cs_main, cs_tally);
+    for (size_t n = 0; n < blocks.size(); ++n) {
+        blocks[n].phashBlock = &blockHashes[n];
+        blocks[n].nHeight = 200 + n;
+        blocks[n].pprev = (n > 0) ? &blocks[n - 1] : nullptr;
+        mapBlockIndex.emplace(blockHashes[n], &blocks[n]);
+    }
+    mp_tally_map.clear();
+    ClearJournal();
+
+    // the first state has no journaled changes, and is captured as snapshot
+    BOOST_CHECK(update_tally_map("alice", 1, 100, BALANCE));
+    BOOST_CHECK_EQUAL(PersistInMemoryState(&blocks[0]), 0);
+
+    // the second state is captured as delta to the first one
+    JournalBlockBegin(&blocks[1]);
+    BOOST_CHECK(update_tally_map("alice", 1, -40, BALANCE));
+    BOOST_CHECK(update_tally_map("bob", 1, 40, BALANCE));
+    JournalBlockEnd(&blocks[1]);
+    BOOST_CHECK_EQUAL(PersistInMemoryState(&blocks[1]), 0);
+
+    // the watermark doesn't wait for the files
+    uint256 watermark;
+    BOOST_CHECK(pDbSpInfo->getWatermark(watermark));
+    BOOST_CHECK(watermark == blockHashes[1]);
+
+    StopStatePersistence();
+    const fs::path snapshotPath = pathStateFiles / strprintf("snapshot-%s.dat", blockHashes[0].ToString());
+    const fs::path deltaPath = pathStateFiles / strprintf("delta-%s.dat", blockHashes[1].ToString());
+    BOOST_CHECK(fs::exists(snapshotPath));
+    BOOST_CHECK(fs::exists(deltaPath));
+    BOOST_CHECK(!fs::exists(pathStateFiles / strprintf("snapshot-%s.dat", blockHashes[1].ToString())));
+
+    CMPBlockDelta delta;
+    BOOST_CHECK_EQUAL(ReadStateDelta(deltaPath, blockHashes[1], delta), 0);
+    BOOST_CHECK(delta.prevBlockHash == blockHashes[0]);
+    BOOST_CHECK_EQUAL(delta.tally.size(), 2U);
+    BOOST_CHECK_EQUAL(RestoreStateSnapshot(snapshotPath, blockHashes[0], true), 0);
+    BOOST_CHECK_EQUAL(GetTokenBalance("alice", 1, BALANCE), 100);
+
+    ClearJournal();
+    for (size_t n = 0; n < blocks.size(); ++n) {
+        mapBlockIndex.erase(blockHashes[n]);
+    }
+    pathStateFiles = pathStateFilesPrev;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -3,6 +3,7 @@
 #include <base58.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <span.h>
 #include <test/test_bitcoin.h>
 #include <util/strencodings.h>
 
@@ -287,4 +288,52 @@ BOOST_AUTO_TEST_CASE(extract_anypush_test)
 }
 
 
+BOOST_AUTO_TEST_CASE(extract_push_spans_test)
+{
+    std::vector<std::vector<unsigned char> > vvchPayloads;
+    vvchPayloads.push_back(std::vector<unsigned char>());
+    vvchPayloads.push_back(ParseHex("6f6d6e69"));
+    vvchPayloads.push_back(std::vector<unsigned char>(80, 0x11));    // OP_PUSHDATA1
+    vvchPayloads.push_back(std::vector<unsigned char>(300, 0x22));   // OP_PUSHDATA2
+    vvchPayloads.push_back(std::vector<unsigned char>(70000, 0x33)); // OP_PUSHDATA4
+
+    CScript script;
+    script << OP_RETURN;
+    for (const std::vector<unsigned char>& vch : vvchPayloads) {
+        script << vch << OP_16;
+    }
+
+    // The pushed data refers to the script
+    std::vector<Span<const unsigned char> > vPushes;
+    BOOST_CHECK(GetScriptPushes(script, vPushes));
+    BOOST_CHECK_EQUAL(vPushes.size(), vvchPayloads.size());
+    for (size_t n = 0; n < vPushes.size(); ++n) {
+        BOOST_CHECK(std::vector<unsigned char>(vPushes[n].begin(), vPushes[n].end()) == vvchPayloads[n]);
+        BOOST_CHECK(vPushes[n].begin() >= script.data() && vPushes[n].end() <= script.data() + script.size());
+    }
+
+    // The first push is skipped
+    vPushes.clear();
+    BOOST_CHECK(GetScriptPushes(script, vPushes, true));
+    BOOST_CHECK_EQUAL(vPushes.size(), vvchPayloads.size() - 1);
+    BOOST_CHECK(std::vector<unsigned char>(vPushes[0].begin(), vPushes[0].end()) == vvchPayloads[1]);
+
+    // The same data is extracted as hex-encoded string
+    std::vector<std::string> vstrPushes;
+    BOOST_CHECK(GetScriptPushes(script, vstrPushes));
+    BOOST_CHECK_EQUAL(vstrPushes.size(), vvchPayloads.size());
+    for (size_t n = 0; n < vstrPushes.size(); ++n) {
+        BOOST_CHECK_EQUAL(vstrPushes[n], HexStr(vvchPayloads[n]));
+    }
+
+    // Data pushed before a truncated push is still extracted
+    CScript scriptTruncated(script.begin(), script.begin() + 1 + 1 + 1 + 5 + 1 + 2 + 80 + 1 + 3 + 100);
+    vPushes.clear();
+    BOOST_CHECK(!GetScriptPushes(scriptTruncated, vPushes));
+    BOOST_CHECK_EQUAL(vPushes.size(), 3U);
+    vstrPushes.clear();
+    BOOST_CHECK(!GetScriptPushes(scriptTruncated, vstrPushes));
+    BOOST_CHECK_EQUAL(vstrPushes.size(), 3U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
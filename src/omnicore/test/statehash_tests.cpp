@@ -0,0 +1,199 @@
+#include <omnicore/consensushash.h>
+#include <omnicore/dbspinfo.h>
+#include <omnicore/dex.h>
+#include <omnicore/omnicore.h>
+#include <omnicore/sp.h>
+#include <omnicore/tally.h>
+
+#include <arith_uint256.h>
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <tinyformat.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_statehash_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(multiset_hash_order_independent)
+{
+    CMPMultisetHash a;
+    a.Insert("alpha");
+    a.Insert("beta");
+    a.Insert("gamma");
+
+    CMPMultisetHash b;
+    b.Insert("gamma");
+    b.Insert("alpha");
+    b.Insert("beta");
+    BOOST_CHECK(a == b);
+    BOOST_CHECK(a.GetHash() == b.GetHash());
+
+    b.Erase("beta");
+    BOOST_CHECK(a != b);
+    b.Replace("", "beta");
+    BOOST_CHECK(a == b);
+
+    b.Replace("beta", "delta");
+    b.Replace("delta", "beta");
+    BOOST_CHECK(a == b);
+
+    a.Erase("alpha");
+    a.Erase("beta");
+    a.Erase("gamma");
+    BOOST_CHECK(a == CMPMultisetHash());
+
+    // the hash doesn't change, when an element is added and removed again
+    b.Insert("delta");
+    uint256 hash = b.GetHash();
+    b.Insert("epsilon");
+    BOOST_CHECK(b.GetHash() != hash);
+    b.Erase("epsilon");
+    BOOST_CHECK(b.GetHash() == hash);
+}
+
+BOOST_AUTO_TEST_CASE(state_hash_incremental_matches_rebuild)
+{
+    LOCK(cs_tally);
+    CMPSPInfo* pDbSpInfoPrev = pDbSpInfo;
+    bool fOmniStateHashPrev = fOmniStateHash;
+    pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_statehash", true);
+    fOmniStateHash = true;
+    mp_tally_map.clear();
+    ClearStateHashBalances();
+    SeedInsecureRand(true);
+
+    // random credits, debits and reservations
+    for (int n = 0; n < 500; ++n) {
+        std::string address = strprintf("address%d", InsecureRandRange(20));
+        uint32_t propertyId = 1 + InsecureRandRange(3);
+        TallyType ttype = static_cast<TallyType>(InsecureRandRange(TALLY_TYPE_COUNT));
+        int64_t amount = 1 + InsecureRandRange(1000);
+        if (InsecureRandBool() && GetTokenBalance(address, propertyId, ttype) >= amount) {
+            amount = -amount;
+        }
+        update_tally_map(address, propertyId, amount, ttype);
+    }
+
+    // property creation and issuer changes
+    CMPSPInfo::Entry sp;
+    sp.issuer = "issuerA";
+    sp.txid = uint256S("01");
+    uint32_t propertyId = pDbSpInfo->putSP(1, sp);
+    sp.issuer = "issuerB";
+    sp.update_block = uint256S("02");
+    BOOST_CHECK(pDbSpInfo->updateSP(propertyId, sp));
+    BOOST_CHECK(pDbSpInfo->getIssuersHash() == pDbSpInfo->computeIssuersHash());
+
+    uint256 stateHash = GetStateHash();
+
+    // replay the final balances in reverse order
+    std::vector<std::pair<std::string, CMPTally> > tallies(mp_tally_map.begin(), mp_tally_map.end());
+    mp_tally_map.clear();
+    ClearStateHashBalances();
+    BOOST_CHECK(GetStateHash() != stateHash);
+    for (std::vector<std::pair<std::string, CMPTally> >::reverse_iterator it = tallies.rbegin(); it != tallies.rend(); ++it) {
+        CMPTally& tally = it->second;
+        tally.init();
+        uint32_t id = 0;
+        while (0 != (id = tally.next())) {
+            for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
+                int64_t amount = tally.getMoney(id, static_cast<TallyType>(ttype));
+                if (amount) update_tally_map(it->first, id, amount, static_cast<TallyType>(ttype));
+            }
+        }
+    }
+    BOOST_CHECK(GetStateHash() == stateHash);
+
+    mp_tally_map.clear();
+    ClearStateHashBalances();
+    delete pDbSpInfo;
+    pDbSpInfo = pDbSpInfoPrev;
+    fOmniStateHash = fOmniStateHashPrev;
+}
+
+BOOST_AUTO_TEST_CASE(state_hash_dex_and_crowdsales_incremental)
+{
+    LOCK(cs_tally);
+    CMPSPInfo* pDbSpInfoPrev = pDbSpInfo;
+    bool fOmniStateHashPrev = fOmniStateHash;
+    pDbSpInfo = new CMPSPInfo(GetDataDir() / "MP_spinfo_statehash_dex", true);
+    fOmniStateHash = true;
+    my_offers.clear();
+    my_accepts.clear();
+    my_crowds.clear();
+    ResetStateHashDExAndCrowdsales();
+    SeedInsecureRand(true);
+
+    uint256 emptyHash = GetStateHash();
+
+    // random offers, accepts and crowdsales, which are added, modified and removed
+    for (int n = 0; n < 200; ++n) {
+        std::string address = strprintf("address%d", InsecureRandRange(10));
+        uint32_t propertyId = 1 + InsecureRandRange(2);
+        std::string keyOffer = STR_SELLOFFER_ADDR_PROP_COMBO(address, propertyId);
+        std::string keyAccept = STR_ACCEPT_ADDR_PROP_ADDR_COMBO(address, "buyer", propertyId);
+        int64_t amount = 1 + InsecureRandRange(1000);
+
+        switch (InsecureRandRange(4)) {
+            case 0:
+                UpdateStateHashOffer(keyOffer);
+                my_offers.erase(keyOffer);
+                if (InsecureRandBool()) {
+                    my_offers.insert(std::make_pair(keyOffer, CMPOffer(n, amount, propertyId, 2 * amount, 1000, 10, ArithToUint256(n))));
+                }
+                break;
+            case 1:
+                UpdateStateHashAccept(keyAccept);
+                my_accepts.erase(keyAccept);
+                if (InsecureRandBool()) {
+                    my_accepts.insert(std::make_pair(keyAccept, CMPAccept(amount, amount, n, 10, propertyId, amount, 2 * amount, ArithToUint256(n))));
+                }
+                break;
+            case 2:
+                UpdateStateHashCrowd(address);
+                my_crowds.erase(address);
+                if (InsecureRandBool()) {
+                    my_crowds.insert(std::make_pair(address, CMPCrowd(propertyId, amount, 1, 1500000000, 6, 10, 0, 0)));
+                }
+                break;
+            case 3:
+                if (getCrowd(address)) {
+                    UpdateStateHashCrowd(address);
+                    getCrowd(address)->incTokensUserCreated(amount);
+                }
+                break;
+        }
+
+        // occasionally obtain the hash in between
+        if (InsecureRandRange(20) == 0) {
+            GetStateHash();
+        }
+    }
+
+    uint256 stateHash = GetStateHash();
+    BOOST_CHECK(stateHash != emptyHash);
+
+    // hashing everything from scratch yields the same hash
+    ResetStateHashDExAndCrowdsales();
+    BOOST_CHECK(GetStateHash() == stateHash);
+
+    my_offers.clear();
+    my_accepts.clear();
+    my_crowds.clear();
+    ResetStateHashDExAndCrowdsales();
+    BOOST_CHECK(GetStateHash() == emptyHash);
+
+    delete pDbSpInfo;
+    pDbSpInfo = pDbSpInfoPrev;
+    fOmniStateHash = fOmniStateHashPrev;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
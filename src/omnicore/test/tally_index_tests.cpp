@@ -0,0 +1,147 @@
+#include <omnicore/omnicore.h>
+#include <omnicore/tally.h>
+
+#include <sync.h>
+#include <test/test_bitcoin.h>
+#include <tinyformat.h>
+
+#include <stdint.h>
+#include <set>
+#include <string>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace mastercore;
+
+//! Number of properties, used in the tests
+static const uint32_t NUM_PROPERTIES = 4;
+//! Number of addresses, used in the tests
+static const uint32_t NUM_ADDRESSES = 40;
+
+static std::string GetAddress(uint32_t n)
+{
+    return strprintf("address%d", n);
+}
+
+/** Compares the holder index and totals of a property with a full scan of the tally map. */
+static void CheckPropertyIndex(uint32_t propertyId)
+{
+    std::set<uint32_t> holders;
+    int64_t totalTokens = 0;
+    int64_t owners = 0;
+
+    for (CMPTallyMap::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        const CMPTally& tally = it->second;
+        int64_t tokens = tally.getMoney(propertyId, BALANCE)
+                + tally.getMoney(propertyId, SELLOFFER_RESERVE)
+                + tally.getMoney(propertyId, ACCEPT_RESERVE);
+        totalTokens += tokens;
+        if (tokens > 0) {
+            ++owners;
+        }
+        if (tokens != 0 || tally.getMoney(propertyId, PENDING) != 0) {
+            holders.insert(mp_tally_map.getId(it->first));
+        }
+    }
+
+    BOOST_CHECK(holders == mp_tally_map.getHolders(propertyId));
+    BOOST_CHECK_EQUAL(totalTokens, mp_tally_map.getTotalTokens(propertyId));
+    BOOST_CHECK_EQUAL(owners, mp_tally_map.getNumberOfOwners(propertyId));
+}
+
+static void CheckIndex()
+{
+    for (uint32_t propertyId = 1; propertyId <= NUM_PROPERTIES; ++propertyId) {
+        CheckPropertyIndex(propertyId);
+    }
+}
+
+/** Moves tokens between two addresses and tally types, like a transaction would. */
+static void MoveTokens(const std::string& from, TallyType fromType, const std::string& to, TallyType toType, uint32_t propertyId, int64_t amount)
+{
+    if (amount <= 0 || GetTokenBalance(from, propertyId, fromType) < amount) {
+        return;
+    }
+    BOOST_CHECK(update_tally_map(from, propertyId, -amount, fromType));
+    BOOST_CHECK(update_tally_map(to, propertyId, amount, toType));
+}
+
+BOOST_FIXTURE_TEST_SUITE(omnicore_tally_index_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(tally_index_matches_full_scan)
+{
+    LOCK(cs_tally);
+    mp_tally_map.clear();
+    SeedInsecureRand(true);
+
+    for (int n = 0; n < 2000; ++n) {
+        uint32_t propertyId = 1 + InsecureRandRange(NUM_PROPERTIES);
+        std::string from = GetAddress(InsecureRandRange(NUM_ADDRESSES));
+        std::string to = GetAddress(InsecureRandRange(NUM_ADDRESSES));
+        int64_t amount = 1 + InsecureRandRange(1000);
+
+        switch (InsecureRandRange(7)) {
+            case 0: // grant or crowdsale
+                BOOST_CHECK(update_tally_map(to, propertyId, amount, BALANCE));
+                break;
+            case 1: // simple send
+                MoveTokens(from, BALANCE, to, BALANCE, propertyId, amount);
+                break;
+            case 2: // send all
+                MoveTokens(from, BALANCE, to, BALANCE, propertyId, GetTokenBalance(from, propertyId, BALANCE));
+                break;
+            case 3: // DEx offer
+                MoveTokens(from, BALANCE, from, SELLOFFER_RESERVE, propertyId, amount);
+                break;
+            case 4: // DEx accept
+                MoveTokens(from, SELLOFFER_RESERVE, from, ACCEPT_RESERVE, propertyId, amount);
+                break;
+            case 5: // DEx payment
+                MoveTokens(from, ACCEPT_RESERVE, to, BALANCE, propertyId, amount);
+                break;
+            case 6: // pending and confirmed wallet transaction
+                if (GetTokenBalance(from, propertyId, PENDING) < 0) {
+                    BOOST_CHECK(update_tally_map(from, propertyId, -GetTokenBalance(from, propertyId, PENDING), PENDING));
+                } else {
+                    BOOST_CHECK(update_tally_map(from, propertyId, -amount, PENDING));
+                }
+                break;
+        }
+
+        CheckIndex();
+    }
+
+    // restoring the state rebuilds the index from scratch
+    mp_tally_map.clear();
+    CheckIndex();
+    BOOST_CHECK(mp_tally_map.getHolders(1).empty());
+}
+
+BOOST_AUTO_TEST_CASE(tally_index_insert)
+{
+    CMPTally tally;
+    BOOST_CHECK(tally.updateMoney(3, 100, BALANCE));
+    BOOST_CHECK(tally.updateMoney(3, 50, SELLOFFER_RESERVE));
+    BOOST_CHECK(tally.updateMoney(5, -20, PENDING));
+
+    CMPTallyMap tallyMap;
+    CMPTallyMap::iterator it = tallyMap.insert(std::make_pair("address", tally)).first;
+    BOOST_CHECK_EQUAL(tallyMap.getHolders(3).size(), 1U);
+    BOOST_CHECK_EQUAL(tallyMap.getHolders(5).size(), 1U);
+    BOOST_CHECK_EQUAL(tallyMap.getTotalTokens(3), 150);
+    BOOST_CHECK_EQUAL(tallyMap.getNumberOfOwners(3), 1);
+    BOOST_CHECK_EQUAL(tallyMap.getTotalTokens(5), 0);
+    BOOST_CHECK_EQUAL(tallyMap.getNumberOfOwners(5), 0);
+
+    BOOST_CHECK(tallyMap.updateMoney(it, 3, -100, BALANCE));
+    BOOST_CHECK(tallyMap.updateMoney(it, 3, -50, SELLOFFER_RESERVE));
+    BOOST_CHECK(tallyMap.updateMoney(it, 5, 20, PENDING));
+    BOOST_CHECK(!tallyMap.updateMoney(it, 7, -1, BALANCE));
+    BOOST_CHECK(tallyMap.getHolders(3).empty());
+    BOOST_CHECK(tallyMap.getHolders(5).empty());
+    BOOST_CHECK(tallyMap.getHolders(7).empty());
+    BOOST_CHECK_EQUAL(tallyMap.getTotalTokens(3), 0);
+    BOOST_CHECK_EQUAL(tallyMap.getNumberOfOwners(3), 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
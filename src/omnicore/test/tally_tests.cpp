@@ -1,8 +1,10 @@
 #include <omnicore/tally.h>
 
 #include <test/test_bitcoin.h>
+#include <tinyformat.h>
 
 #include <stdint.h>
+#include <string>
 
 #include <boost/test/unit_test.hpp>
 
@@ -283,5 +285,86 @@ BOOST_AUTO_TEST_CASE(tally_overflow)
     BOOST_CHECK_EQUAL(tally.getMoneyReserved(3), int64_t(9223372036854775807LL));
 }
 
+BOOST_AUTO_TEST_CASE(tally_insert_while_iterating)
+{
+    CMPTally tally;
+    BOOST_CHECK(tally.updateMoney(3, 1, BALANCE));
+    BOOST_CHECK(tally.updateMoney(7, 1, BALANCE));
+
+    BOOST_CHECK_EQUAL(3, tally.init());
+    BOOST_CHECK_EQUAL(3, tally.next());
+    // inserted in front of the iterator, not visited
+    BOOST_CHECK(tally.updateMoney(1, 1, BALANCE));
+    BOOST_CHECK(tally.updateMoney(5, 1, BALANCE));
+    // inserted behind the iterator, visited
+    BOOST_CHECK(tally.updateMoney(9, 1, BALANCE));
+    BOOST_CHECK_EQUAL(7, tally.next());
+    BOOST_CHECK_EQUAL(9, tally.next());
+    BOOST_CHECK_EQUAL(0, tally.next());
+    // inserted, once the iterator reached the end, not visited
+    BOOST_CHECK(tally.updateMoney(11, 1, BALANCE));
+    BOOST_CHECK_EQUAL(0, tally.next());
+
+    BOOST_CHECK_EQUAL(1, tally.init());
+    BOOST_CHECK_EQUAL(1, tally.next());
+    BOOST_CHECK_EQUAL(3, tally.next());
+    BOOST_CHECK_EQUAL(5, tally.next());
+    BOOST_CHECK_EQUAL(7, tally.next());
+    BOOST_CHECK_EQUAL(9, tally.next());
+    BOOST_CHECK_EQUAL(11, tally.next());
+    BOOST_CHECK_EQUAL(0, tally.next());
+}
+
+BOOST_AUTO_TEST_CASE(tally_map_interning)
+{
+    CMPTallyMap tallyMap;
+    BOOST_CHECK(tallyMap.empty());
+    BOOST_CHECK(tallyMap.find("1ARjWDkZ7kT9fwjPrjcQyvbXDkEySzKHwu") == tallyMap.end());
+    BOOST_CHECK_EQUAL(tallyMap.getId("1ARjWDkZ7kT9fwjPrjcQyvbXDkEySzKHwu"), CMPTallyMap::NO_ID);
+
+    const uint32_t nAddresses = 1000;
+    for (uint32_t i = 0; i < nAddresses; ++i) {
+        std::string address = strprintf("address%d", i);
+        std::pair<CMPTallyMap::iterator, bool> ret = tallyMap.insert(std::make_pair(address, CMPTally()));
+        BOOST_CHECK(ret.second);
+        BOOST_CHECK_EQUAL(ret.first->first, address);
+        BOOST_CHECK(ret.first->second.updateMoney(i + 1, i + 1, BALANCE));
+    }
+    BOOST_CHECK_EQUAL(tallyMap.size(), size_t(nAddresses));
+
+    // identifiers are dense and assigned in insertion order
+    for (uint32_t i = 0; i < nAddresses; ++i) {
+        std::string address = strprintf("address%d", i);
+        uint32_t id = tallyMap.getId(address);
+        BOOST_CHECK_EQUAL(id, i);
+        BOOST_CHECK_EQUAL(tallyMap.getAddress(id), address);
+        BOOST_CHECK_EQUAL(tallyMap.getTally(id).getMoney(i + 1, BALANCE), int64_t(i + 1));
+        BOOST_CHECK(tallyMap.find(address) != tallyMap.end());
+    }
+
+    // inserting a known address keeps the existing tally
+    std::pair<CMPTallyMap::iterator, bool> ret = tallyMap.insert(std::make_pair("address5", CMPTally()));
+    BOOST_CHECK(!ret.second);
+    BOOST_CHECK_EQUAL(ret.first->second.getMoney(6, BALANCE), 6);
+    BOOST_CHECK_EQUAL(tallyMap.size(), size_t(nAddresses));
+
+    tallyMap.clear();
+    BOOST_CHECK(tallyMap.empty());
+    BOOST_CHECK(tallyMap.find("address5") == tallyMap.end());
+}
+
+BOOST_AUTO_TEST_CASE(tally_map_reference_stability)
+{
+    CMPTallyMap tallyMap;
+    CMPTally* pTally = &(tallyMap.insert(std::make_pair("sender", CMPTally())).first->second);
+    BOOST_CHECK(pTally->updateMoney(1, 50, BALANCE));
+
+    // growing the collection must not invalidate references to tallies
+    for (int i = 0; i < 10000; ++i) {
+        tallyMap.insert(std::make_pair(strprintf("receiver%d", i), CMPTally()));
+    }
+    BOOST_CHECK_EQUAL(pTally, &(tallyMap.find("sender")->second));
+    BOOST_CHECK_EQUAL(pTally->getMoney(1, BALANCE), 50);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,10 +3,12 @@
 #include <omnicore/tx.h>
 
 #include <omnicore/activation.h>
+#include <omnicore/consensushash.h>
 #include <omnicore/dbspinfo.h>
 #include <omnicore/dbstolist.h>
 #include <omnicore/dbtxlist.h>
 #include <omnicore/dex.h>
+#include <omnicore/journal.h>
 #include <omnicore/log.h>
 #include <omnicore/notifications.h>
 #include <omnicore/omnicore.h>
@@ -962,6 +964,8 @@ int CMPTransaction::logicHelper_CrowdsaleParticipation(uint256& blockHash)
     }
 
     // Update the crowdsale object
+    JournalCrowdChange(receiver);
+    UpdateStateHashCrowd(receiver);
     pcrowdsale->incTokensUserCreated(tokens.first);
     pcrowdsale->incTokensIssuerCreated(tokens.second);
 
@@ -1560,6 +1564,8 @@ int CMPTransaction::logicMath_CreatePropertyVariable(CBlockIndex* pindex)
 
     const uint32_t propertyId = pDbSpInfo->putSP(ecosystem, newSP);
     assert(propertyId > 0);
+    JournalCrowdChange(sender);
+    UpdateStateHashCrowd(sender);
     my_crowds.insert(std::make_pair(sender, CMPCrowd(propertyId, nValue, property, deadline, early_bird, percentage, 0, 0)));
 
     PrintToLog("CREATED CROWDSALE id: %d value: %d property: %d\n", propertyId, nValue, property);
@@ -1615,7 +1621,7 @@ int CMPTransaction::logicMath_CloseCrowdsale(CBlockIndex* pindex)
 
     int64_t missedTokens = GetMissedIssuerBonus(sp, crowd);
 
-    sp.historicalData = crowd.getDatabase();
+    assert(pDbSpInfo->putHistory(property, crowd.getDatabase(), blockHash));
     sp.update_block = blockHash;
     sp.close_early = true;
     sp.timeclosed = blockTime;
@@ -1626,6 +1632,8 @@ int CMPTransaction::logicMath_CloseCrowdsale(CBlockIndex* pindex)
     if (missedTokens > 0) {
         assert(update_tally_map(sp.issuer, property, missedTokens, BALANCE));
     }
+    JournalCrowdChange(sender);
+    UpdateStateHashCrowd(sender);
     my_crowds.erase(it);
 
     if (msc_debug_sp) PrintToLog("CLOSED CROWDSALE id: %d=%X\n", property, property);
@@ -1764,11 +1772,11 @@ int CMPTransaction::logicMath_GrantTokens(CBlockIndex* pindex)
     std::vector<int64_t> dataPt;
     dataPt.push_back(nValue);
     dataPt.push_back(0);
-    sp.historicalData.insert(std::make_pair(txid, dataPt));
-    sp.update_block = pindexBlockHash;
 
     // Persist the number of granted tokens
-    assert(pDbSpInfo->updateSP(property, sp));
+    CMPSPInfo::History records;
+    records.emplace(txid, dataPt);
+    assert(pDbSpInfo->putHistory(property, records, pindexBlockHash));
 
     // Move the tokens
     if (sp.unique) {
@@ -1842,11 +1850,11 @@ int CMPTransaction::logicMath_RevokeTokens(CBlockIndex* pindex)
     std::vector<int64_t> dataPt;
     dataPt.push_back(0);
     dataPt.push_back(nValue);
-    sp.historicalData.insert(std::make_pair(txid, dataPt));
-    sp.update_block = blockHash;
+    CMPSPInfo::History records;
+    records.emplace(txid, dataPt);
 
     assert(update_tally_map(sender, property, -nValue, BALANCE));
-    assert(pDbSpInfo->updateSP(property, sp));
+    assert(pDbSpInfo->putHistory(property, records, blockHash));
 
     return 0;
 }
@@ -24,8 +24,6 @@
 #include <wallet/wallet.h>
 #endif
 
-#include <boost/algorithm/string.hpp>
-
 #include <stdint.h>
 #include <list>
 #include <map>
@@ -90,25 +88,15 @@ std::map<std::string, uint256> FetchWalletOmniTransactions(interfaces::Wallet& i
     }
 
     // Insert STO receipts - receiving an STO has no inbound transaction to the wallet, so we will insert these manually into the response
-    std::string mySTOReceipts;
+    std::vector<CMPSTOList::Receipt> mySTOReceipts;
     {
         LOCK(cs_tally);
         mySTOReceipts = pDbStoList->getMySTOReceipts("", iWallet);
     }
-    std::vector<std::string> vecReceipts;
-    if (!mySTOReceipts.empty()) {
-        boost::split(vecReceipts, mySTOReceipts, boost::is_any_of(","), boost::token_compress_on);
-    }
-    for (size_t i = 0; i < vecReceipts.size(); i++) {
-        std::vector<std::string> svstr;
-        boost::split(svstr, vecReceipts[i], boost::is_any_of(":"), boost::token_compress_on);
-        if (svstr.size() != 4) {
-            PrintToLog("STODB Error - number of tokens is not as expected (%s)\n", vecReceipts[i]);
-            continue;
-        }
-        int blockHeight = atoi(svstr[1]);
+    for (std::vector<CMPSTOList::Receipt>::const_iterator it = mySTOReceipts.begin(); it != mySTOReceipts.end(); ++it) {
+        int blockHeight = it->block;
         if (blockHeight < startBlock || blockHeight > endBlock) continue;
-        uint256 txHash = uint256S(svstr[0]);
+        const uint256& txHash = it->txid;
         if (seenHashes.find(txHash) != seenHashes.end()) continue; // an STO may already be in the wallet if we sent it
         int blockPosition = GetTransactionByteOffset(txHash);
         std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
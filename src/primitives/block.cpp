@@ -25,6 +25,23 @@ uint256 CBlockHeader::GetPoWHash(unsigned int profile) const
     return(hash);
 }
 
+std::vector<uint256> CBlockHeader::GetPoWHashes(const std::vector<const CBlockHeader*>& headers, unsigned int profile)
+{
+    std::vector<unsigned char> input(80 * headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        memcpy(&input[80 * i], &headers[i]->nVersion, 80);
+    }
+
+    std::vector<uint256> hashes(headers.size());
+    std::vector<unsigned char> output(32 * headers.size());
+    neoscrypt_multi(input.data(), output.data(), profile, headers.size());
+    for (size_t i = 0; i < headers.size(); ++i) {
+        memcpy(hashes[i].begin(), &output[32 * i], 32);
+    }
+
+    return hashes;
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -64,6 +64,9 @@ public:
 
     uint256 GetPoWHash(unsigned int profile) const;
 
+    /** Computes the proof-of-work hashes of several headers at once, with the multi-lane NeoScrypt kernels. */
+    static std::vector<uint256> GetPoWHashes(const std::vector<const CBlockHeader*>& headers, unsigned int profile);
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
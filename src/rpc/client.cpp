@@ -187,6 +187,13 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "omni_listtransactions", 2, "skip" },
     { "omni_listtransactions", 3, "startblock" },
     { "omni_listtransactions", 4, "endblock" },
+    { "omni_listaddresstransactions", 1, "count" },
+    { "omni_listaddresstransactions", 3, "startblock" },
+    { "omni_listaddresstransactions", 4, "endblock" },
+    { "omni_listpropertytransactions", 0, "propertyid" },
+    { "omni_listpropertytransactions", 1, "count" },
+    { "omni_listpropertytransactions", 3, "startblock" },
+    { "omni_listpropertytransactions", 4, "endblock" },
     { "omni_getallbalancesforid", 0, "propertyid" },
     { "omni_listblocktransactions", 0, "index" },
     { "omni_listblockstransactions", 0, "firstblock" },
@@ -123,6 +123,77 @@ void BuildChain(const uint256& root, int height, const unsigned int invalid_rate
     }
 }
 
+BOOST_AUTO_TEST_CASE(processnewblockheaders_pow_batch)
+{
+    std::vector<CBlockHeader> headers;
+    uint256 prev_hash = Params().GenesisBlock().GetHash();
+    for (int i = 0; i < 10; i++) {
+        headers.push_back(GoodBlock(prev_hash)->GetBlockHeader());
+        prev_hash = headers.back().GetHash();
+    }
+
+    // break the proof-of-work of a header in the middle of the batch
+    unsigned int profile = (headers[5].GetBlockTime() >= Params().GetConsensus().nNeoScryptFork) ? 0x0 : 0x3;
+    while (CheckProofOfWork(headers[5].GetPoWHash(profile), headers[5].nBits, Params().GetConsensus())) {
+        ++headers[5].nNonce;
+    }
+
+    // the first invalid header is reported, like with sequential checks
+    CValidationState state;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, Params(), nullptr, &first_invalid));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK_EQUAL(first_invalid.GetHash(), headers[5].GetHash());
+    {
+        LOCK(cs_main);
+        for (int i = 0; i < 5; i++) {
+            BOOST_CHECK(mapBlockIndex.count(headers[i].GetHash()));
+        }
+        BOOST_CHECK(!mapBlockIndex.count(headers[5].GetHash()));
+    }
+
+    // the known headers are skipped, and the valid rest of the batch is accepted
+    headers.resize(5);
+    const CBlockIndex* pindex = nullptr;
+    CValidationState state2;
+    BOOST_CHECK(ProcessNewBlockHeaders(headers, state2, Params(), &pindex));
+    BOOST_CHECK_EQUAL(pindex->GetBlockHash(), headers[4].GetHash());
+}
+
+BOOST_AUTO_TEST_CASE(processnewblockheaders_pow_batch_stops)
+{
+    std::vector<CBlockHeader> headers;
+    uint256 prev_hash = Params().GenesisBlock().GetHash();
+    for (int i = 0; i < 10; i++) {
+        headers.push_back(GoodBlock(prev_hash)->GetBlockHeader());
+        prev_hash = headers.back().GetHash();
+    }
+    std::vector<char> valid;
+    BOOST_CHECK_EQUAL(PreVerifyHeadersPoW(headers, Params().GetConsensus(), valid), 10U);
+    BOOST_CHECK_EQUAL(std::count(valid.begin(), valid.end(), 1), 10);
+
+    // headers, which don't connect to a known header, are not hashed
+    std::vector<CBlockHeader> unconnected(headers.begin() + 1, headers.end());
+    BOOST_CHECK_EQUAL(PreVerifyHeadersPoW(unconnected, Params().GetConsensus(), valid), 0U);
+    BOOST_CHECK_EQUAL(std::count(valid.begin(), valid.end(), 0), 9);
+
+    // break the proof-of-work of the first header
+    unsigned int profile = (headers[0].GetBlockTime() >= Params().GetConsensus().nNeoScryptFork) ? 0x0 : 0x3;
+    while (CheckProofOfWork(headers[0].GetPoWHash(profile), headers[0].nBits, Params().GetConsensus())) {
+        ++headers[0].nNonce;
+    }
+
+    // the headers after the invalid header are not hashed
+    BOOST_CHECK_EQUAL(PreVerifyHeadersPoW(headers, Params().GetConsensus(), valid), 1U);
+    BOOST_CHECK_EQUAL(std::count(valid.begin(), valid.end(), 0), 10);
+
+    CValidationState state;
+    CBlockHeader first_invalid;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, state, Params(), nullptr, &first_invalid));
+    BOOST_CHECK_EQUAL(state.GetRejectReason(), "high-hash");
+    BOOST_CHECK_EQUAL(first_invalid.GetHash(), headers[0].GetHash());
+}
+
 BOOST_AUTO_TEST_CASE(processnewblock_signals_ordering)
 {
     // build a large-ish chain that's likely to have some forks
@@ -43,6 +43,7 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <atomic>
 #include <future>
 #include <sstream>
 
@@ -165,14 +166,16 @@ public:
     /**
      * If a block header hasn't already been seen, call CheckBlockHeader on it, ensure
      * that it doesn't descend from an invalid block, and then add it to mapBlockIndex.
+     * fCheckPOW=false skips the proof-of-work check for headers that were already
+     * verified by the caller.
      */
-    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW = true) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fRequested, const CDiskBlockPos* dbp, bool* fNewBlock) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool clean = true);
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false, std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false, CBlockUndo* pblockundo = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block disconnection on our pcoinsTip:
     bool DisconnectTip(CValidationState& state, const CChainParams& chainparams, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -295,7 +298,8 @@ namespace {
 // TODO: replace handlers with signals
 int mastercore_handler_block_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
 int mastercore_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int);
-bool mastercore_handler_tx(const CTransaction &tx, int nBlock, unsigned int idx, CBlockIndex const * pBlockIndex, std::shared_ptr<std::map<COutPoint, Coin>> removedCoins);
+void mastercore_handler_block_parse(const CBlock& block, int nBlock, const CBlockIndex* pBlockIndex, const CBlockUndo& blockundo);
+bool mastercore_handler_tx(const CTransaction &tx, int nBlock, unsigned int idx, CBlockIndex const * pBlockIndex, const CBlockUndo* pBlockUndo);
 void mastercore_handler_disc_begin(const int nHeight);
 void TryToAddToMarkerCache(const CTransactionRef& tx);
 void RemoveFromMarkerCache(const uint256& txHash);
@@ -1045,7 +1049,7 @@ bool GetTransaction(const uint256& hash, CTransactionRef& txOut, const Consensus
         }
     } else {
         CBlock block;
-        if (ReadBlockFromDisk(block, block_index, consensusParams)) {
+        if (ReadBlockFromDisk(block, block_index, consensusParams, false)) {
             for (const auto& tx : block.vtx) {
                 if (tx->GetHash() == hash) {
                     txOut = tx;
@@ -1090,7 +1094,7 @@ static bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMes
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams)
+bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams, bool fCheckPoW)
 {
     block.SetNull();
 
@@ -1107,6 +1111,11 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
 
+    // The NeoScrypt hash dominates the cost of reading a block, and was
+    // already checked, when the block was accepted
+    if (!fCheckPoW)
+        return true;
+
     unsigned int profile = 0x3;
     if (block.GetBlockTime() >= consensusParams.nNeoScryptFork)
         profile = 0x0;
@@ -1118,7 +1127,7 @@ bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus:
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
+bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams, bool fCheckPoW)
 {
     CDiskBlockPos blockPos;
     {
@@ -1126,7 +1135,7 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
         blockPos = pindex->GetBlockPos();
     }
 
-    if (!ReadBlockFromDisk(block, blockPos, consensusParams))
+    if (!ReadBlockFromDisk(block, blockPos, consensusParams, fCheckPoW))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1345,14 +1354,12 @@ void CChainState::InvalidBlockFound(CBlockIndex *pindex, const CValidationState
     }
 }
 
-void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txundo, int nHeight, std::shared_ptr<std::map<COutPoint, Coin>> removedCoins)
+void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txundo, int nHeight)
 {
     // mark inputs spent
     if (!tx.IsCoinBase()) {
         txundo.vprevout.reserve(tx.vin.size());
         for (const CTxIn &txin : tx.vin) {
-            if (removedCoins)
-                removedCoins->emplace(txin.prevout, inputs.AccessCoin(txin.prevout));
             txundo.vprevout.emplace_back();
             bool is_spent = inputs.SpendCoin(txin.prevout, &txundo.vprevout.back());
             assert(is_spent);
@@ -1365,7 +1372,7 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
 {
     CTxUndo txundo;
-    UpdateCoins(tx, inputs, txundo, nHeight, nullptr);
+    UpdateCoins(tx, inputs, txundo, nHeight);
 }
 
 bool CScriptCheck::operator()() {
@@ -1520,9 +1527,28 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
+/** Abort with a message */
+static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(
+        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
+        "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+    return false;
+}
+
+static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
+{
+    AbortNode(strMessage, userMessage);
+    return state.Error(strMessage);
+}
+
+} // namespace
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlockPrev)
 {
-    CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
         return error("%s: no undo data available", __func__);
     }
@@ -1536,7 +1562,7 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     uint256 hashChecksum;
     CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
     try {
-        verifier << pindex->pprev->GetBlockHash();
+        verifier << hashBlockPrev;
         verifier >> blockundo;
         filein >> hashChecksum;
     }
@@ -1551,26 +1577,16 @@ static bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex *pindex)
     return true;
 }
 
-/** Abort with a message */
-static bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
-    SetMiscWarning(strMessage);
-    LogPrintf("*** %s\n", strMessage);
-    uiInterface.ThreadSafeMessageBox(
-        userMessage.empty() ? _("Error: A fatal internal error occurred, see debug.log for details") : userMessage,
-        "", CClientUIInterface::MSG_ERROR);
-    StartShutdown();
-    return false;
-}
+    CDiskBlockPos pos = pindex->GetUndoPos();
+    if (pos.IsNull()) {
+        return error("%s: no undo data available", __func__);
+    }
 
-static bool AbortNode(CValidationState& state, const std::string& strMessage, const std::string& userMessage="")
-{
-    AbortNode(strMessage, userMessage);
-    return state.Error(strMessage);
+    return UndoReadFromDisk(blockundo, pos, pindex->pprev->GetBlockHash());
 }
 
-} // namespace
-
 void DoAbortNode(const std::string& strMessage, const std::string& userMessage)
 {
     AbortNode(strMessage, userMessage);
@@ -1781,6 +1797,73 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/**
+ * Closure representing the proof-of-work check of up to MAX_HEADERS block
+ * headers with the same NeoScrypt profile, which are hashed at once.
+ * The results are stored instead of returned. Once a header fails, the
+ * shared abort flag is set, and the checks, which didn't start yet, are
+ * skipped.
+ */
+class CPoWCheck
+{
+private:
+    std::vector<const CBlockHeader*> headers;
+    std::vector<char*> results;
+    const Consensus::Params* pconsensusParams;
+    unsigned int profile;
+    std::atomic<bool>* pfAbort;
+    std::atomic<size_t>* pnHashed;
+
+public:
+    //! Number of headers, which fill the lanes of the widest NeoScrypt kernel
+    static const size_t MAX_HEADERS = 8;
+
+    CPoWCheck() : pconsensusParams(nullptr), profile(0), pfAbort(nullptr), pnHashed(nullptr) {}
+    CPoWCheck(const Consensus::Params& consensusParams, unsigned int profileIn, std::atomic<bool>* pfAbortIn, std::atomic<size_t>* pnHashedIn) :
+        pconsensusParams(&consensusParams), profile(profileIn), pfAbort(pfAbortIn), pnHashed(pnHashedIn) {}
+
+    /** Returns whether another header can be added to the check. */
+    bool CanAdd(unsigned int profileIn) const
+    {
+        return profile == profileIn && headers.size() < MAX_HEADERS;
+    }
+
+    void Add(const CBlockHeader& header, char* pfValid)
+    {
+        headers.push_back(&header);
+        results.push_back(pfValid);
+    }
+
+    bool operator()()
+    {
+        if (*pfAbort) return true;
+        const std::vector<uint256> hashes = CBlockHeader::GetPoWHashes(headers, profile);
+        *pnHashed += headers.size();
+        for (size_t i = 0; i < headers.size(); ++i) {
+            *results[i] = CheckProofOfWork(hashes[i], headers[i]->nBits, *pconsensusParams);
+            if (!*results[i]) *pfAbort = true;
+        }
+        return true;
+    }
+
+    void swap(CPoWCheck& check)
+    {
+        headers.swap(check.headers);
+        results.swap(check.results);
+        std::swap(pconsensusParams, check.pconsensusParams);
+        std::swap(profile, check.profile);
+        std::swap(pfAbort, check.pfAbort);
+        std::swap(pnHashed, check.pnHashed);
+    }
+};
+
+static CCheckQueue<CPoWCheck> powcheckqueue(16);
+
+void ThreadPoWCheck() {
+    RenameThread("bitcoin-powch");
+    powcheckqueue.Thread();
+}
+
 VersionBitsCache versionbitscache GUARDED_BY(cs_main);
 
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params)
@@ -1883,7 +1966,7 @@ static int64_t nBlocksTotal = 0;
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, std::shared_ptr<std::map<COutPoint, Coin>> removedCoins)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck, CBlockUndo* pblockundo)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2003,7 +2086,9 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
 
-    CBlockUndo blockundo;
+    // the undo data is passed on, if requested, e.g. to provide the spent coins to Omni Core
+    CBlockUndo blockundoLocal;
+    CBlockUndo& blockundo = pblockundo ? *pblockundo : blockundoLocal;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
 
@@ -2120,7 +2205,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
         }
-        UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight, removedCoins);
+        UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
@@ -2548,15 +2633,15 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
         pthisBlock = pblock;
     }
     const CBlock& blockConnecting = *pthisBlock;
-    // Map used by Omni to track removals from the UTXO DB for this block.
-    std::shared_ptr<std::map<COutPoint, Coin>> removedCoins = std::make_shared<std::map<COutPoint, Coin>>();
+    // Undo data of the block, which provides the spent coins to Omni Core.
+    CBlockUndo blockundo;
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
     {
         CCoinsViewCache view(pcoinsTip.get());
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, removedCoins);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, &blockundo);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2599,10 +2684,13 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
+    //! Omni Core: parse the transactions of the block in parallel, before they are processed in order
+    mastercore_handler_block_parse(blockConnecting, pindexNew->nHeight, pindexNew, blockundo);
+
     for (size_t i = 0; i < blockConnecting.vtx.size(); i++) {
         //! Omni Core: new confirmed transaction notification
         LogPrint(BCLog::HANDLER, "Omni Core handler: new confirmed transaction [height: %d, idx: %u]\n", pindexNew->nHeight, nTxIdx);
-        if (mastercore_handler_tx(*blockConnecting.vtx[i], pindexNew->nHeight, nTxIdx++, pindexNew, removedCoins)) ++nNumMetaTxs;
+        if (mastercore_handler_tx(*blockConnecting.vtx[i], pindexNew->nHeight, nTxIdx++, pindexNew, &blockundo)) ++nNumMetaTxs;
     }
 
     //! Omni Core: end of block connect notification
@@ -3540,7 +3628,7 @@ static bool ContextualCheckBlock(const CBlock& block, CValidationState& state, c
     return true;
 }
 
-bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex)
+bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState& state, const CChainParams& chainparams, CBlockIndex** ppindex, bool fCheckPOW)
 {
     AssertLockHeld(cs_main);
     // Check for duplicate
@@ -3558,7 +3646,7 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, chainparams.GetConsensus()))
+        if (!CheckBlockHeader(block, state, chainparams.GetConsensus(), fCheckPOW))
             return error("%s: Consensus::CheckBlockHeader: %s, %s", __func__, hash.ToString(), FormatStateMessage(state));
 
         // Get prev block index
@@ -3621,15 +3709,83 @@ bool CChainState::AcceptBlockHeader(const CBlockHeader& block, CValidationState&
     return true;
 }
 
+size_t PreVerifyHeadersPoW(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams, std::vector<char>& vPoWValid)
+{
+    vPoWValid.assign(headers.size(), 0);
+
+    // Only unknown headers, which connect to a known header or to an earlier
+    // header of the batch, are verified, so that a peer can't make us hash
+    // headers, which are rejected anyway.
+    std::vector<size_t> vIndexes;
+    {
+        LOCK(cs_main);
+        std::set<uint256> setConnected;
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const uint256 hash = headers[i].GetHash();
+            const bool fConnects = setConnected.count(headers[i].hashPrevBlock) || mapBlockIndex.count(headers[i].hashPrevBlock);
+            if (mapBlockIndex.count(hash)) {
+                setConnected.insert(hash);
+            } else if (fConnects) {
+                setConnected.insert(hash);
+                vIndexes.push_back(i);
+            }
+        }
+    }
+    if (vIndexes.empty()) return 0;
+
+    std::atomic<bool> fAbort(false);
+    std::atomic<size_t> nHashed(0);
+    auto GetProfile = [&consensusParams](const CBlockHeader& header) -> unsigned int {
+        return (header.GetBlockTime() >= consensusParams.nNeoScryptFork) ? 0x0 : 0x3;
+    };
+
+    // The first header is checked on its own, so that a batch, which starts
+    // with an invalid header, costs a single hash, like a sequential check.
+    CPoWCheck first(consensusParams, GetProfile(headers[vIndexes[0]]), &fAbort, &nHashed);
+    first.Add(headers[vIndexes[0]], &vPoWValid[vIndexes[0]]);
+    first();
+    if (fAbort || vIndexes.size() == 1) return nHashed;
+
+    std::vector<CPoWCheck> vChecks;
+    for (size_t n = 1; n < vIndexes.size(); ++n) {
+        const size_t i = vIndexes[n];
+        const unsigned int profile = GetProfile(headers[i]);
+        if (vChecks.empty() || !vChecks.back().CanAdd(profile)) {
+            vChecks.emplace_back(consensusParams, profile, &fAbort, &nHashed);
+        }
+        vChecks.back().Add(headers[i], &vPoWValid[i]);
+    }
+
+    // The queue takes checks from the back, so the earlier headers are added
+    // last, and a failure near the front of the batch skips most of the rest.
+    std::reverse(vChecks.begin(), vChecks.end());
+    CCheckQueueControl<CPoWCheck> control(&powcheckqueue);
+    control.Add(vChecks);
+    control.Wait();
+
+    return nHashed;
+}
+
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex, CBlockHeader *first_invalid)
 {
     if (first_invalid != nullptr) first_invalid->SetNull();
+
+    // Verify the proof-of-work of unknown headers in parallel before cs_main
+    // is taken. Headers, which fail or weren't verified, are checked again by
+    // AcceptBlockHeader, so the order and the reporting of errors don't change.
+    std::vector<char> vPoWValid;
+    if (headers.size() > 1) {
+        PreVerifyHeadersPoW(headers, chainparams.GetConsensus(), vPoWValid);
+    }
+
     {
         LOCK(cs_main);
-        for (const CBlockHeader& header : headers) {
+        for (size_t i = 0; i < headers.size(); ++i) {
+            const CBlockHeader& header = headers[i];
+            const bool fCheckPOW = vPoWValid.empty() || !vPoWValid[i];
             CBlockIndex *pindex = nullptr; // Use a temp pindex instead of ppindex to avoid a const_cast
-            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex)) {
+            if (!g_chainstate.AcceptBlockHeader(header, state, chainparams, &pindex, fCheckPOW)) {
                 if (first_invalid) *first_invalid = header;
                 return false;
             }
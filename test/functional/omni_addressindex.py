@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2018 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the address index of Omni transactions, without a wallet."""
+
+from decimal import Decimal
+
+from test_framework.address import byte_to_base58, key_to_p2pkh
+from test_framework.key import ECKey
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class OmniAddressIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [['-omniaddressindex']]
+
+    def new_key(self):
+        key = ECKey()
+        key.generate()
+        return key_to_p2pkh(key.get_pubkey().get_bytes()), byte_to_base58(key.get_bytes() + b'\x01', 239)
+
+    def send_payload(self, height, payload, reference=None):
+        """Spends the coinbase of a block with the given payload, and an optional reference output."""
+        node = self.nodes[0]
+        coinbase = node.getblock(node.getblockhash(height))['tx'][0]
+        value = node.gettxout(coinbase, 0)['value'] - Decimal('0.01')
+        rawtx = node.createrawtransaction([{'txid': coinbase, 'vout': 0}], {self.address: value})
+        rawtx = node.omni_createrawtx_opreturn(rawtx, payload)
+        if reference:
+            rawtx = node.omni_createrawtx_reference(rawtx, reference)
+        signed = node.signrawtransactionwithkey(rawtx, [self.privkey])
+        return node.sendrawtransaction(signed['hex'])
+
+    def run_test(self):
+        self.log.info("check the address index without a wallet")
+        node = self.nodes[0]
+        self.address, self.privkey = self.new_key()
+        receiver, _ = self.new_key()
+
+        node.generatetoaddress(110, self.address)
+
+        # Create a property, which references the sender, and send tokens to the receiver
+        issuance = self.send_payload(1, node.omni_createpayload_issuancefixed(1, 1, 0, "", "", "Token", "", "", "1000"))
+        node.generatetoaddress(1, self.address)
+        property_id = node.omni_gettransaction(issuance)['propertyid']
+        send = self.send_payload(2, node.omni_createpayload_simplesend(property_id, "10"), receiver)
+        block_hash = node.generatetoaddress(1, self.address)[0]
+
+        transactions = node.omni_listaddresstransactions(self.address)['transactions']
+        assert_equal([tx['txid'] for tx in transactions], [issuance, send])
+        assert_equal(transactions[0]['roles'], ['sender', 'reference'])
+        assert_equal(transactions[1]['roles'], ['sender'])
+        assert_equal(transactions[1]['referenceaddress'], receiver)
+        assert_equal(transactions[1]['valid'], True)
+
+        result = node.omni_listaddresstransactions(receiver)
+        assert_equal(result['address'], receiver)
+        assert_equal(len(result['transactions']), 1)
+        assert_equal(result['transactions'][0]['txid'], send)
+        assert_equal(result['transactions'][0]['roles'], ['reference'])
+        assert 'cursor' not in result
+
+        # Pages continue at the cursor
+        page = node.omni_listaddresstransactions(self.address, 1)
+        assert_equal([tx['txid'] for tx in page['transactions']], [issuance])
+        page = node.omni_listaddresstransactions(self.address, 1, page['cursor'])
+        assert_equal([tx['txid'] for tx in page['transactions']], [send])
+        assert 'cursor' not in page
+        assert_raises_rpc_error(-8, "Invalid cursor", node.omni_listaddresstransactions, self.address, 1, "x")
+
+        # Block ranges
+        assert_equal([tx['txid'] for tx in node.omni_listaddresstransactions(self.address, 10, "", 112, 112)['transactions']], [send])
+        assert_equal([tx['txid'] for tx in node.omni_listaddresstransactions(self.address, 10, "", 0, 111)['transactions']], [issuance])
+
+        # Disconnected blocks are removed from the index
+        node.invalidateblock(block_hash)
+        assert_equal([tx['txid'] for tx in node.omni_listaddresstransactions(self.address)['transactions']], [issuance])
+        assert_equal(node.omni_listaddresstransactions(receiver)['transactions'], [])
+
+        # The index is kept, when the node runs without it, but misses the blocks processed meanwhile
+        self.restart_node(0, [])
+        assert_raises_rpc_error(-1, "Address index is disabled", node.omni_listaddresstransactions, self.address)
+        missed = self.send_payload(3, node.omni_createpayload_simplesend(property_id, "5"), receiver)
+        node.generatetoaddress(1, self.address)
+        assert_equal(node.omni_gettransaction(missed)['valid'], True)
+        self.restart_node(0, ['-omniaddressindex'])
+        assert_equal([tx['txid'] for tx in node.omni_listaddresstransactions(self.address)['transactions']], [issuance])
+        resumed = self.send_payload(4, node.omni_createpayload_simplesend(property_id, "1"), receiver)
+        node.generatetoaddress(1, self.address)
+        assert_equal([tx['txid'] for tx in node.omni_listaddresstransactions(receiver)['transactions']], [resumed])
+
+if __name__ == '__main__':
+    OmniAddressIndexTest().main()
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2018 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test parallel parsing of the transactions of a block matches serial parsing."""
+
+from decimal import Decimal
+
+from test_framework.address import byte_to_base58, key_to_p2pkh
+from test_framework.key import ECKey
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+class OmniParallelParsingTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [['-omniparsethreads=4'], ['-omniparsethreads=1']]
+
+    def new_key(self):
+        key = ECKey()
+        key.generate()
+        return key_to_p2pkh(key.get_pubkey().get_bytes()), byte_to_base58(key.get_bytes() + b'\x01', 239)
+
+    def send_payload(self, inputs, value, payload, reference=None):
+        """Spends the given outputs with the given payload, and an optional reference output."""
+        node = self.nodes[0]
+        rawtx = node.createrawtransaction(inputs, {self.address: value})
+        rawtx = node.omni_createrawtx_opreturn(rawtx, payload)
+        if reference:
+            rawtx = node.omni_createrawtx_reference(rawtx, reference)
+        signed = node.signrawtransactionwithkey(rawtx, [self.privkey])
+        return node.sendrawtransaction(signed['hex'])
+
+    def spend_coinbase(self, height, payload, reference=None):
+        node = self.nodes[0]
+        coinbase = node.getblock(node.getblockhash(height))['tx'][0]
+        value = node.gettxout(coinbase, 0)['value'] - Decimal('0.01')
+        return self.send_payload([{'txid': coinbase, 'vout': 0}], value, payload, reference)
+
+    def get_state(self, node, txids, height):
+        return {
+            'consensushash': node.omni_getcurrentconsensushash()['consensushash'],
+            'block': node.omni_listblocktransactions(height),
+            'transactions': [node.omni_gettransaction(txid) for txid in txids],
+        }
+
+    def run_test(self):
+        self.log.info("check parallel parsing matches serial parsing")
+        node = self.nodes[0]
+        self.address, self.privkey = self.new_key()
+        receiver, _ = self.new_key()
+
+        node.generatetoaddress(110, self.address)
+
+        issuance = self.spend_coinbase(1, node.omni_createpayload_issuancefixed(1, 2, 0, "", "", "Token", "", "", "1000"))
+        node.generatetoaddress(1, self.address)
+        property_id = node.omni_gettransaction(issuance)['propertyid']
+
+        # Several sends in one block, where one spends an output created in the same block,
+        # and one sends more tokens than available
+        txids = []
+        for height in range(2, 7):
+            txids.append(self.spend_coinbase(height, node.omni_createpayload_simplesend(property_id, "10"), receiver))
+        parent = txids[-1]
+        value = node.getrawtransaction(parent, True)['vout'][0]['value'] - Decimal('0.01')
+        txids.append(self.send_payload([{'txid': parent, 'vout': 0}], value, node.omni_createpayload_simplesend(property_id, "7"), receiver))
+        txids.append(self.spend_coinbase(7, node.omni_createpayload_simplesend(property_id, "5000"), receiver))
+        node.generatetoaddress(1, self.address)
+        self.sync_all()
+
+        height = node.getblockcount()
+        state = self.get_state(node, txids, height)
+        assert_equal(len(state['block']), len(txids))
+        assert_equal([tx['valid'] for tx in state['transactions']], [True] * 6 + [False])
+        assert_equal(node.omni_getbalance(receiver, property_id)['balance'], "57.00000000")
+        assert_equal(self.get_state(self.nodes[1], txids, height), state)
+
+if __name__ == '__main__':
+    OmniParallelParsingTest().main()
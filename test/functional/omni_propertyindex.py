@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2018 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the listing of the Omni transactions of a property."""
+
+from decimal import Decimal
+
+from test_framework.address import byte_to_base58, key_to_p2pkh
+from test_framework.key import ECKey
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, assert_raises_rpc_error
+
+class OmniPropertyIndexTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+        self.extra_args = [['-omnipropertyindex']]
+
+    def new_key(self):
+        key = ECKey()
+        key.generate()
+        return key_to_p2pkh(key.get_pubkey().get_bytes()), byte_to_base58(key.get_bytes() + b'\x01', 239)
+
+    def send_payload(self, height, payload, reference=None):
+        """Spends the coinbase of a block with the given payload, and an optional reference output."""
+        node = self.nodes[0]
+        coinbase = node.getblock(node.getblockhash(height))['tx'][0]
+        value = node.gettxout(coinbase, 0)['value'] - Decimal('0.01')
+        rawtx = node.createrawtransaction([{'txid': coinbase, 'vout': 0}], {self.address: value})
+        rawtx = node.omni_createrawtx_opreturn(rawtx, payload)
+        if reference:
+            rawtx = node.omni_createrawtx_reference(rawtx, reference)
+        signed = node.signrawtransactionwithkey(rawtx, [self.privkey])
+        return node.sendrawtransaction(signed['hex'])
+
+    def run_test(self):
+        self.log.info("check the transactions of a property")
+        node = self.nodes[0]
+        self.address, self.privkey = self.new_key()
+        receiver, _ = self.new_key()
+
+        node.generatetoaddress(110, self.address)
+
+        # Create a property, and send tokens in the next block
+        issuance = self.send_payload(1, node.omni_createpayload_issuancefixed(1, 2, 0, "", "", "Token", "", "", "1000"))
+        node.generatetoaddress(1, self.address)
+        property_id = node.omni_gettransaction(issuance)['propertyid']
+        sends = [self.send_payload(2, node.omni_createpayload_simplesend(property_id, "10"), receiver)]
+        node.generatetoaddress(1, self.address)
+        sends.append(self.send_payload(3, node.omni_createpayload_simplesend(property_id, "5"), receiver))
+        block_hash = node.generatetoaddress(1, self.address)[0]
+
+        result = node.omni_listpropertytransactions(property_id)
+        assert_equal(result['propertyid'], property_id)
+        assert_equal([tx['txid'] for tx in result['transactions']], [issuance] + sends)
+        assert_equal(result['transactions'][0]['type'], "Create Property - Fixed")
+        assert_equal(result['transactions'][0]['amount'], "1000.00000000")
+        assert_equal(result['transactions'][1]['type_int'], 0)
+        assert_equal(result['transactions'][1]['amount'], "10.00000000")
+        assert_equal(result['transactions'][2]['block'], 113)
+        assert 'cursor' not in result
+
+        # Pages continue at the cursor
+        page = node.omni_listpropertytransactions(property_id, 2)
+        assert_equal([tx['txid'] for tx in page['transactions']], [issuance, sends[0]])
+        page = node.omni_listpropertytransactions(property_id, 2, page['cursor'])
+        assert_equal([tx['txid'] for tx in page['transactions']], [sends[1]])
+        assert 'cursor' not in page
+
+        # Block ranges
+        result = node.omni_listpropertytransactions(property_id, 10, "", 112, 112)
+        assert_equal([tx['txid'] for tx in result['transactions']], [sends[0]])
+        assert_raises_rpc_error(-8, "Invalid cursor", node.omni_listpropertytransactions, property_id, 10, "x")
+        assert_raises_rpc_error(-8, "Property identifier does not exist", node.omni_listpropertytransactions, property_id + 1)
+
+        # Disconnected blocks are removed from the index
+        node.invalidateblock(block_hash)
+        result = node.omni_listpropertytransactions(property_id)
+        assert_equal([tx['txid'] for tx in result['transactions']], [issuance, sends[0]])
+
+        # The index matches the index of a fresh reparse
+        self.restart_node(0, ['-omnipropertyindex', '-startclean'])
+        assert_equal(node.omni_listpropertytransactions(property_id), result)
+
+        # The index is only available, if enabled
+        self.restart_node(0, [])
+        assert_raises_rpc_error(-1, "Property index is disabled", node.omni_listpropertytransactions, property_id)
+
+if __name__ == '__main__':
+    OmniPropertyIndexTest().main()
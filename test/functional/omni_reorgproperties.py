@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2018 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test property state after reorg matches a fresh reparse."""
+
+from decimal import Decimal
+
+from test_framework.address import byte_to_base58, key_to_p2pkh
+from test_framework.key import ECKey
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+class OmniReorgPropertiesTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def new_key(self):
+        key = ECKey()
+        key.generate()
+        return key_to_p2pkh(key.get_pubkey().get_bytes()), byte_to_base58(key.get_bytes() + b'\x01', 239)
+
+    def coinbase(self, height):
+        """Returns the coinbase output of a block, which is owned by the issuer."""
+        node = self.nodes[0]
+        txid = node.getblock(node.getblockhash(height))['tx'][0]
+        return (txid, 0, node.gettxout(txid, 0, False)['value'])
+
+    def send_payload(self, prevout, payload, reference=None, fee=Decimal('0.01'), replaceable=False):
+        """Spends an output of the issuer with the given payload, and an optional reference output.
+
+        Returns the change output, so that transactions can be chained in the order of processing."""
+        node = self.nodes[0]
+        txid, vout, value = prevout
+        value -= fee
+        rawtx = node.createrawtransaction([{'txid': txid, 'vout': vout}], {self.issuer: value}, 0, replaceable)
+        rawtx = node.omni_createrawtx_opreturn(rawtx, payload)
+        if reference:
+            rawtx = node.omni_createrawtx_reference(rawtx, reference)
+        signed = node.signrawtransactionwithkey(rawtx, [self.privkey])
+        return (node.sendrawtransaction(signed['hex']), 0, value)
+
+    def get_state(self, property_ids):
+        node = self.nodes[0]
+        state = {
+            'consensushash': node.omni_getcurrentconsensushash()['consensushash'],
+            'properties': node.omni_listproperties(),
+        }
+        for property_id in property_ids:
+            state[property_id] = {
+                'property': node.omni_getproperty(property_id),
+                'grants': node.omni_getgrants(property_id),
+            }
+        return state
+
+    def run_test(self):
+        self.log.info("check property state after reorg")
+        node = self.nodes[0]
+
+        # Preparing some mature coins, which are owned by the issuer
+        self.issuer, self.privkey = self.new_key()
+        new_issuer, _ = self.new_key()
+        new_coinbase_address, _ = self.new_key() # To avoid duplicate block hash
+        node.generatetoaddress(110, self.issuer)
+
+        # Create a managed property, and grant some tokens in the next block
+        issuance, _, _ = self.send_payload(self.coinbase(1), node.omni_createpayload_issuancemanaged(1, 2, 0, "Test Category", "Test Subcategory", "ManagedA", "", ""))
+        node.generatetoaddress(1, self.issuer)
+        property_a = node.omni_gettransaction(issuance)['propertyid']
+
+        self.send_payload(self.coinbase(2), node.omni_createpayload_grant(property_a, "1000", ""))
+        node.generatetoaddress(1, self.issuer)
+
+        state_before = self.get_state([property_a])
+        block_count_before = node.getblockcount()
+
+        # Grant again, change the issuer and create a second property in one block
+        prevout = self.send_payload(self.coinbase(3), node.omni_createpayload_grant(property_a, "500", ""), replaceable=True)
+        prevout = self.send_payload(prevout, node.omni_createpayload_changeissuer(property_a), new_issuer)
+        issuance_b, _, _ = self.send_payload(prevout, node.omni_createpayload_issuancemanaged(1, 1, 0, "Test Category", "Test Subcategory", "ManagedB", "", ""))
+        block_hash = node.generatetoaddress(1, self.issuer)[0]
+        property_b = node.omni_gettransaction(issuance_b)['propertyid']
+
+        assert_equal(node.omni_getproperty(property_a)['issuer'], new_issuer)
+        assert_equal(len(node.omni_getgrants(property_a)['issuances']), 2)
+
+        # Invalidate the block, and replace its transactions, which returned to the mempool, by a different grant
+        node.invalidateblock(block_hash)
+        assert_equal(node.getblockcount(), block_count_before)
+        grant, _, _ = self.send_payload(self.coinbase(3), node.omni_createpayload_grant(property_a, "250", ""), fee=Decimal('0.05'))
+        assert_equal(node.getrawmempool(), [grant])
+
+        # Mine a competing block, which rolls back the disconnected block
+        node.generatetoaddress(1, new_coinbase_address)
+
+        state_after_reorg = self.get_state([property_a])
+        assert_equal(state_after_reorg[property_a]['property']['issuer'], self.issuer)
+        assert_equal(state_after_reorg[property_a]['property']['totaltokens'], "1250.00000000")
+        assert_equal(len(state_after_reorg['properties']), len(state_before['properties']))
+        assert_equal(len([p for p in node.omni_listproperties() if p['propertyid'] == property_b]), 0)
+
+        # The state matches the state of a fresh reparse
+        self.restart_node(0, ['-startclean'])
+        assert_equal(self.get_state([property_a]), state_after_reorg)
+
+if __name__ == '__main__':
+    OmniReorgPropertiesTest().main()
@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+# Copyright (c) 2017-2018 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test a reparse resolves the inputs from the undo data without the transaction index."""
+
+from decimal import Decimal
+
+from test_framework.address import byte_to_base58, key_to_p2pkh
+from test_framework.key import ECKey
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+class OmniReparseTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.setup_clean_chain = True
+
+    def new_key(self):
+        key = ECKey()
+        key.generate()
+        return key_to_p2pkh(key.get_pubkey().get_bytes()), byte_to_base58(key.get_bytes() + b'\x01', 239)
+
+    def send_payload(self, inputs, value, payload, reference=None):
+        """Spends the given outputs with the given payload, and an optional reference output."""
+        node = self.nodes[0]
+        rawtx = node.createrawtransaction(inputs, {self.address: value})
+        rawtx = node.omni_createrawtx_opreturn(rawtx, payload)
+        if reference:
+            rawtx = node.omni_createrawtx_reference(rawtx, reference)
+        signed = node.signrawtransactionwithkey(rawtx, [self.privkey])
+        return node.sendrawtransaction(signed['hex'])
+
+    def spend_coinbase(self, height, payload, reference=None):
+        node = self.nodes[0]
+        coinbase = node.getblock(node.getblockhash(height))['tx'][0]
+        value = node.gettxout(coinbase, 0)['value'] - Decimal('0.01')
+        return self.send_payload([{'txid': coinbase, 'vout': 0}], value, payload, reference)
+
+    def get_state(self, property_id, receiver):
+        node = self.nodes[0]
+        return {
+            'consensushash': node.omni_getcurrentconsensushash()['consensushash'],
+            'property': node.omni_getproperty(property_id),
+            'sender': node.omni_getbalance(self.address, property_id),
+            'receiver': node.omni_getbalance(receiver, property_id),
+            'blocks': [node.omni_listblocktransactions(height) for height in range(111, node.getblockcount() + 1)],
+        }
+
+    def run_test(self):
+        self.log.info("check a reparse without transaction index")
+        node = self.nodes[0]
+        self.address, self.privkey = self.new_key()
+        receiver, _ = self.new_key()
+
+        node.generatetoaddress(110, self.address)
+
+        issuance = self.spend_coinbase(1, node.omni_createpayload_issuancefixed(1, 2, 0, "", "", "Token", "", "", "1000"))
+        node.generatetoaddress(1, self.address)
+        property_id = node.omni_gettransaction(issuance)['propertyid']
+
+        # The second send spends an output of the first one in the same block
+        parent = self.spend_coinbase(2, node.omni_createpayload_simplesend(property_id, "10"), receiver)
+        value = node.getrawtransaction(parent, True)['vout'][0]['value'] - Decimal('0.01')
+        self.send_payload([{'txid': parent, 'vout': 0}], value, node.omni_createpayload_simplesend(property_id, "7"), receiver)
+        node.generatetoaddress(1, self.address)
+        self.spend_coinbase(3, node.omni_createpayload_simplesend(property_id, "3"), receiver)
+        node.generatetoaddress(1, self.address)
+
+        state = self.get_state(property_id, receiver)
+        assert_equal(state['receiver']['balance'], "20.00000000")
+        assert_equal(len(state['blocks'][1]), 2)
+
+        # Without the transaction index, the inputs are only available in the undo data
+        self.restart_node(0, ['-startclean', '-txindex=0'])
+        assert_equal(self.get_state(property_id, receiver), state)
+
+if __name__ == '__main__':
+    OmniReparseTest().main()
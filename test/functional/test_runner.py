@@ -203,6 +203,11 @@ BASE_SCRIPTS = [
     'omni_dexversionsspec.py',
     'omni_basicspec.py',
     'omni_reorgspec.py',
+    'omni_reorgproperties.py',
+    'omni_addressindex.py',
+    'omni_propertyindex.py',
+    'omni_parallelparsing.py',
+    'omni_reparse.py',
     'omni_sendallspec.py',
     'omni_crowdsalespec.py',
     'omni_smartandmanagedspec.py',